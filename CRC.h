@@ -52,12 +52,24 @@
                                                           multiplication in the bit-by-bit calculation instead of a small conditional. The branchless implementation
                                                           may be faster on processor architectures which support single-instruction integer multiplication.
         #define CRCPP_USE_CPP11                         - Define to enables C++11 features (move semantics, constexpr, static_assert, etc.).
+                                                          Defined automatically when the compiler reports C++11 or later.
+        #define CRCPP_NO_CONSTEXPR_TABLES               - Define to build lookup tables at runtime even when the compiler supports C++14.
+                                                          By default, C++14 compilers can build Table and SlicingTable in constant expressions.
+        #define CRCPP_NO_COMPILE_TIME_TESTS             - Define to skip the static_assert check-value tests at the end of this header (saves compile time).
         #define CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS  - Define to include definitions for little-used CRCs.
 */
 
 #ifndef CRCPP_CRC_H_
 #define CRCPP_CRC_H_
 
+#if !defined(CRCPP_USE_CPP11) && ((defined(__cplusplus) && __cplusplus >= 201103L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L))
+#define CRCPP_USE_CPP11
+#endif
+
+#if defined(CRCPP_USE_CPP11) && !defined(CRCPP_NO_CONSTEXPR_TABLES) && ((defined(__cplusplus) && __cplusplus >= 201402L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L))
+#define CRCPP_CONSTEXPR_TABLES
+#endif
+
 #include <climits>  // Includes CHAR_BIT
 #ifdef CRCPP_USE_CPP11
 #include <cstddef>  // Includes ::std::size_t
@@ -127,6 +139,18 @@
 #   define crcpp_constexpr const
 #endif
 
+#ifdef CRCPP_CONSTEXPR_TABLES
+    /// @brief Function usable in constant expressions (requires C++14 relaxed constexpr).
+#   define crcpp_constexpr_fn constexpr
+    /// @brief Storage for lookup tables; constexpr tables are built by the compiler and placed in read-only data.
+#   define crcpp_constexpr_table constexpr
+#else
+    /// @brief Function usable in constant expressions (requires C++14 relaxed constexpr).
+#   define crcpp_constexpr_fn inline
+    /// @brief Storage for lookup tables; constexpr tables are built by the compiler and placed in read-only data.
+#   define crcpp_constexpr_table const
+#endif
+
 #if defined(WIN32) || defined(_WIN32) || defined(WINCE)
 /* Disable warning C4127: conditional expression is constant. */
 #pragma warning(push)
@@ -175,25 +199,46 @@ public:
     struct Table
     {
         // Constructors are intentionally NOT marked explicit.
-        Table(const Parameters<CRCType, CRCWidth> & parameters);
+        crcpp_constexpr_fn Table(const Parameters<CRCType, CRCWidth> & parameters);
 
 #ifdef CRCPP_USE_CPP11
-        Table(Parameters<CRCType, CRCWidth> && parameters);
+        crcpp_constexpr_fn Table(Parameters<CRCType, CRCWidth> && parameters);
 #endif
 
-        const Parameters<CRCType, CRCWidth> & GetParameters() const;
+        crcpp_constexpr_fn const Parameters<CRCType, CRCWidth> & GetParameters() const;
 
-        const CRCType * GetTable() const;
+        crcpp_constexpr_fn const CRCType * GetTable() const;
 
-        CRCType operator[](unsigned char index) const;
+        crcpp_constexpr_fn CRCType operator[](unsigned char index) const;
 
     private:
-        void InitTable();
+        crcpp_constexpr_fn void InitTable();
 
         Parameters<CRCType, CRCWidth> parameters; ///< CRC parameters used to construct the table
         CRCType table[1 << CHAR_BIT];             ///< CRC lookup table
     };
 
+    /**
+        @brief Slice-by-N CRC lookup tables. After construction, the CRC parameters are fixed.
+        @note Slice 0 is the regular byte-wise table; slice k gives the effect of a byte followed by k zero bytes,
+            which lets the calculation consume Slices bytes per step with independent table lookups.
+        @note Only CRCs at least CHAR_BIT bits wide are supported; narrower CRCs should use Table.
+    */
+    template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+    struct SlicingTable
+    {
+        // Constructors are intentionally NOT marked explicit.
+        crcpp_constexpr_fn SlicingTable(const Parameters<CRCType, CRCWidth> & parameters);
+
+        crcpp_constexpr_fn const Parameters<CRCType, CRCWidth> & GetParameters() const;
+
+        crcpp_constexpr_fn const CRCType * GetTable(crcpp_uint16 slice) const;
+
+    private:
+        Parameters<CRCType, CRCWidth> parameters; ///< CRC parameters used to construct the tables
+        CRCType table[Slices][1 << CHAR_BIT];     ///< CRC lookup tables, one per slice
+    };
+
     // The number of bits in CRCType must be at least as large as CRCWidth.
     // CRCType must be an unsigned integer type or a custom type with operator overloads.
     template <typename CRCType, crcpp_uint16 CRCWidth>
@@ -208,6 +253,22 @@ public:
     template <typename CRCType, crcpp_uint16 CRCWidth>
     static CRCType Calculate(const void * data, crcpp_size size, const Table<CRCType, CRCWidth> & lookupTable, CRCType crc);
 
+    template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+    static CRCType Calculate(const void * data, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable);
+
+    template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+    static CRCType Calculate(const void * data, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable, CRCType crc);
+
+    template <typename CRCType, crcpp_uint16 CRCWidth>
+    static CRCType Combine(CRCType crcA, CRCType crcB, crcpp_uint64 lengthB, const Parameters<CRCType, CRCWidth> & parameters);
+
+    // Constant-expression variants. These take a character pointer because a void pointer cannot be read in a constant expression.
+    template <typename CRCType, crcpp_uint16 CRCWidth>
+    static crcpp_constexpr_fn CRCType CalculateConstexpr(const char * data, crcpp_size size, const Table<CRCType, CRCWidth> & lookupTable);
+
+    template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+    static crcpp_constexpr_fn CRCType CalculateConstexpr(const char * data, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable);
+
     template <typename CRCType, crcpp_uint16 CRCWidth>
     static CRCType CalculateBits(const void * data, crcpp_size size, const Parameters<CRCType, CRCWidth> & parameters);
 
@@ -296,6 +357,89 @@ public:
     static const Parameters<crcpp_uint64, 64> & CRC_64();
 #endif
 
+
+    /**
+        @brief Common CRC parameter sets as constant expressions.
+        @note The accessors above return references to these values. Use these directly to build lookup tables
+            at compile time, e.g. static crcpp_constexpr_table CRC::Table<crcpp_uint32, 32> table(CRC::Standard::CRC_32());
+    */
+    struct Standard
+    {
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  4> CRC_4_ITU() { const Parameters< crcpp_uint8,  4> parameters = { 0x3, 0x0, 0x0, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  5> CRC_5_EPC() { const Parameters< crcpp_uint8,  5> parameters = { 0x09, 0x09, 0x00, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  5> CRC_5_ITU() { const Parameters< crcpp_uint8,  5> parameters = { 0x15, 0x00, 0x00, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  5> CRC_5_USB() { const Parameters< crcpp_uint8,  5> parameters = { 0x05, 0x1F, 0x1F, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  6> CRC_6_CDMA2000A() { const Parameters< crcpp_uint8,  6> parameters = { 0x27, 0x3F, 0x00, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  6> CRC_6_CDMA2000B() { const Parameters< crcpp_uint8,  6> parameters = { 0x07, 0x3F, 0x00, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  6> CRC_6_ITU() { const Parameters< crcpp_uint8,  6> parameters = { 0x03, 0x00, 0x00, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  6> CRC_6_NR() { const Parameters< crcpp_uint8,  6> parameters = { 0x21, 0x00, 0x00, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  7> CRC_7() { const Parameters< crcpp_uint8,  7> parameters = { 0x09, 0x00, 0x00, false, false }; return parameters; }
+#endif
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  8> CRC_8() { const Parameters< crcpp_uint8,  8> parameters = { 0x07, 0x00, 0x00, false, false }; return parameters; }
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  8> CRC_8_EBU() { const Parameters< crcpp_uint8,  8> parameters = { 0x1D, 0xFF, 0x00, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  8> CRC_8_HDLC() { const Parameters< crcpp_uint8,  8> parameters = { 0x07, 0xFF, 0xFF, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  8> CRC_8_MAXIM() { const Parameters< crcpp_uint8,  8> parameters = { 0x31, 0x00, 0x00, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  8> CRC_8_WCDMA() { const Parameters< crcpp_uint8,  8> parameters = { 0x9B, 0x00, 0x00, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters< crcpp_uint8,  8> CRC_8_LTE() { const Parameters< crcpp_uint8,  8> parameters = { 0x9B, 0x00, 0x00, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 10> CRC_10() { const Parameters<crcpp_uint16, 10> parameters = { 0x233, 0x000, 0x000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 10> CRC_10_CDMA2000() { const Parameters<crcpp_uint16, 10> parameters = { 0x3D9, 0x3FF, 0x000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 11> CRC_11() { const Parameters<crcpp_uint16, 11> parameters = { 0x385, 0x01A, 0x000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 11> CRC_11_NR() { const Parameters<crcpp_uint16, 11> parameters = { 0x621, 0x000, 0x000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 12> CRC_12_CDMA2000() { const Parameters<crcpp_uint16, 12> parameters = { 0xF13, 0xFFF, 0x000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 12> CRC_12_DECT() { const Parameters<crcpp_uint16, 12> parameters = { 0x80F, 0x000, 0x000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 12> CRC_12_UMTS() { const Parameters<crcpp_uint16, 12> parameters = { 0x80F, 0x000, 0x000, false, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 13> CRC_13_BBC() { const Parameters<crcpp_uint16, 13> parameters = { 0x1CF5, 0x0000, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 15> CRC_15() { const Parameters<crcpp_uint16, 15> parameters = { 0x4599, 0x0000, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 15> CRC_15_MPT1327() { const Parameters<crcpp_uint16, 15> parameters = { 0x6815, 0x0000, 0x0001, false, false }; return parameters; }
+#endif
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_ARC() { const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0x0000, 0x0000, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_BUYPASS() { const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0x0000, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_CCITTFALSE() { const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_MCRF4XX() { const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0x0000, true, true}; return parameters; }
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_CDMA2000() { const Parameters<crcpp_uint16, 16> parameters = { 0xC867, 0xFFFF, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_CMS() { const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0xFFFF, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_DECTR() { const Parameters<crcpp_uint16, 16> parameters = { 0x0589, 0x0000, 0x0001, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_DECTX() { const Parameters<crcpp_uint16, 16> parameters = { 0x0589, 0x0000, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_DNP() { const Parameters<crcpp_uint16, 16> parameters = { 0x3D65, 0x0000, 0xFFFF, true, true }; return parameters; }
+#endif
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_GENIBUS() { const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0xFFFF, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_KERMIT() { const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0x0000, 0x0000, true, true }; return parameters; }
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_MAXIM() { const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0x0000, 0xFFFF, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_MODBUS() { const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0xFFFF, 0x0000, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_T10DIF() { const Parameters<crcpp_uint16, 16> parameters = { 0x8BB7, 0x0000, 0x0000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_USB() { const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0xFFFF, 0xFFFF, true, true }; return parameters; }
+#endif
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_X25() { const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0xFFFF, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint16, 16> CRC_16_XMODEM() { const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0x0000, 0x0000, false, false }; return parameters; }
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 17> CRC_17_CAN() { const Parameters<crcpp_uint32, 17> parameters = { 0x1685B, 0x00000, 0x00000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 21> CRC_21_CAN() { const Parameters<crcpp_uint32, 21> parameters = { 0x102899, 0x000000, 0x000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 24> CRC_24() { const Parameters<crcpp_uint32, 24> parameters = { 0x864CFB, 0xB704CE, 0x000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 24> CRC_24_FLEXRAYA() { const Parameters<crcpp_uint32, 24> parameters = { 0x5D6DCB, 0xFEDCBA, 0x000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 24> CRC_24_FLEXRAYB() { const Parameters<crcpp_uint32, 24> parameters = { 0x5D6DCB, 0xABCDEF, 0x000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 24> CRC_24_LTEA() { const Parameters<crcpp_uint32, 24> parameters = { 0x864CFB, 0x000000, 0x000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 24> CRC_24_LTEB() { const Parameters<crcpp_uint32, 24> parameters = { 0x800063, 0x000000, 0x000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 24> CRC_24_NRC() { const Parameters<crcpp_uint32, 24> parameters = { 0xB2B117, 0x000000, 0x000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 30> CRC_30() { const Parameters<crcpp_uint32, 30> parameters = { 0x2030B9C7, 0x3FFFFFFF, 0x00000000, false, false }; return parameters; }
+#endif
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 32> CRC_32() { const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, true, true }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 32> CRC_32_BZIP2() { const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, false, false }; return parameters; }
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 32> CRC_32_C() { const Parameters<crcpp_uint32, 32> parameters = { 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true }; return parameters; }
+#endif
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 32> CRC_32_MPEG2() { const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0xFFFFFFFF, 0x00000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 32> CRC_32_POSIX() { const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0x00000000, 0xFFFFFFFF, false, false }; return parameters; }
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+        static crcpp_constexpr_fn Parameters<crcpp_uint32, 32> CRC_32_Q() { const Parameters<crcpp_uint32, 32> parameters = { 0x814141AB, 0x00000000, 0x00000000, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint64, 40> CRC_40_GSM() { const Parameters<crcpp_uint64, 40> parameters = { 0x0004820009, 0x0000000000, 0xFFFFFFFFFF, false, false }; return parameters; }
+        static crcpp_constexpr_fn Parameters<crcpp_uint64, 64> CRC_64() { const Parameters<crcpp_uint64, 64> parameters = { 0x42F0E1EBA9EA3693, 0x0000000000000000, 0x0000000000000000, false, false }; return parameters; }
+#endif
+    };
+
 #ifdef CRCPP_USE_CPP11
     CRC() = delete;
     CRC(const CRC & other) = delete;
@@ -312,13 +456,16 @@ private:
 #endif
 
     template <typename IntegerType>
-    static IntegerType Reflect(IntegerType value, crcpp_uint16 numBits);
+    static crcpp_constexpr_fn IntegerType Reflect(IntegerType value, crcpp_uint16 numBits);
+
+    template <typename CRCType, crcpp_uint16 CRCWidth>
+    static crcpp_constexpr_fn CRCType Finalize(CRCType remainder, CRCType finalXOR, bool reflectOutput);
 
     template <typename CRCType, crcpp_uint16 CRCWidth>
-    static CRCType Finalize(CRCType remainder, CRCType finalXOR, bool reflectOutput);
+    static crcpp_constexpr_fn CRCType UndoFinalize(CRCType remainder, CRCType finalXOR, bool reflectOutput);
 
     template <typename CRCType, crcpp_uint16 CRCWidth>
-    static CRCType UndoFinalize(CRCType remainder, CRCType finalXOR, bool reflectOutput);
+    static crcpp_constexpr_fn CRCType CalculateTableEntry(unsigned char byte, const Parameters<CRCType, CRCWidth> & parameters);
 
     template <typename CRCType, crcpp_uint16 CRCWidth>
     static CRCType CalculateRemainder(const void * data, crcpp_size size, const Parameters<CRCType, CRCWidth> & parameters, CRCType remainder);
@@ -326,8 +473,17 @@ private:
     template <typename CRCType, crcpp_uint16 CRCWidth>
     static CRCType CalculateRemainder(const void * data, crcpp_size size, const Table<CRCType, CRCWidth> & lookupTable, CRCType remainder);
 
+    template <typename ByteType, typename CRCType, crcpp_uint16 CRCWidth>
+    static crcpp_constexpr_fn CRCType CalculateRemainderBytes(const ByteType * current, crcpp_size size, const Table<CRCType, CRCWidth> & lookupTable, CRCType remainder);
+
+    template <typename ByteType, typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+    static crcpp_constexpr_fn CRCType CalculateRemainderSliced(const ByteType * current, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable, CRCType remainder);
+
     template <typename CRCType, crcpp_uint16 CRCWidth>
     static CRCType CalculateRemainderBits(unsigned char byte, crcpp_size numBits, const Parameters<CRCType, CRCWidth> & parameters, CRCType remainder);
+
+    template <typename CRCType, crcpp_uint16 CRCWidth>
+    static CRCType MultiplyMatrix(const CRCType * matrix, CRCType vector);
 };
 
 /**
@@ -352,8 +508,9 @@ inline CRC::Table<CRCType, CRCWidth> CRC::Parameters<CRCType, CRCWidth>::MakeTab
     @tparam CRCWidth Number of bits in the CRC
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline CRC::Table<CRCType, CRCWidth>::Table(const Parameters<CRCType, CRCWidth> & params) :
-    parameters(params)
+crcpp_constexpr_fn CRC::Table<CRCType, CRCWidth>::Table(const Parameters<CRCType, CRCWidth> & params) :
+    parameters(params),
+    table()
 {
     InitTable();
 }
@@ -366,8 +523,9 @@ inline CRC::Table<CRCType, CRCWidth>::Table(const Parameters<CRCType, CRCWidth>
     @tparam CRCWidth Number of bits in the CRC
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline CRC::Table<CRCType, CRCWidth>::Table(Parameters<CRCType, CRCWidth> && params) :
-    parameters(::std::move(params))
+crcpp_constexpr_fn CRC::Table<CRCType, CRCWidth>::Table(Parameters<CRCType, CRCWidth> && params) :
+    parameters(::std::move(params)),
+    table()
 {
     InitTable();
 }
@@ -380,7 +538,7 @@ inline CRC::Table<CRCType, CRCWidth>::Table(Parameters<CRCType, CRCWidth> && par
     @return CRC parameters
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline const CRC::Parameters<CRCType, CRCWidth> & CRC::Table<CRCType, CRCWidth>::GetParameters() const
+crcpp_constexpr_fn const CRC::Parameters<CRCType, CRCWidth> & CRC::Table<CRCType, CRCWidth>::GetParameters() const
 {
     return parameters;
 }
@@ -392,7 +550,7 @@ inline const CRC::Parameters<CRCType, CRCWidth> & CRC::Table<CRCType, CRCWidth>:
     @return CRC table
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline const CRCType * CRC::Table<CRCType, CRCWidth>::GetTable() const
+crcpp_constexpr_fn const CRCType * CRC::Table<CRCType, CRCWidth>::GetTable() const
 {
     return table;
 }
@@ -405,7 +563,7 @@ inline const CRCType * CRC::Table<CRCType, CRCWidth>::GetTable() const
     @return CRC table entry
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline CRCType CRC::Table<CRCType, CRCWidth>::operator[](unsigned char index) const
+crcpp_constexpr_fn CRCType CRC::Table<CRCType, CRCWidth>::operator[](unsigned char index) const
 {
     return table[index];
 }
@@ -416,22 +574,23 @@ inline CRCType CRC::Table<CRCType, CRCWidth>::operator[](unsigned char index) co
     @tparam CRCWidth Number of bits in the CRC
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline void CRC::Table<CRCType, CRCWidth>::InitTable()
+crcpp_constexpr_fn void CRC::Table<CRCType, CRCWidth>::InitTable()
 {
     // For masking off the bits for the CRC (in the event that the number of bits in CRCType is larger than CRCWidth)
-    static crcpp_constexpr CRCType BIT_MASK((CRCType(1) << (CRCWidth - CRCType(1))) |
-                                           ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1)));
+    // Note: these are not static because static locals are not permitted in constexpr functions.
+    crcpp_constexpr CRCType BIT_MASK((CRCType(1) << (CRCWidth - CRCType(1))) |
+                                    ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1)));
 
     // The conditional expression is used to avoid a -Wshift-count-overflow warning.
-    static crcpp_constexpr CRCType SHIFT((CHAR_BIT >= CRCWidth) ? static_cast<CRCType>(CHAR_BIT - CRCWidth) : 0);
+    crcpp_constexpr CRCType SHIFT((CHAR_BIT >= CRCWidth) ? static_cast<CRCType>(CHAR_BIT - CRCWidth) : 0);
 
-    CRCType crc;
+    CRCType crc = 0;
     unsigned char byte = 0;
 
     // Loop over each dividend (each possible number storable in an unsigned char)
     do
     {
-        crc = CRC::CalculateRemainder<CRCType, CRCWidth>(&byte, sizeof(byte), parameters, CRCType(0));
+        crc = CRC::CalculateTableEntry<CRCType, CRCWidth>(byte, parameters);
 
         // This mask might not be necessary; all unit tests pass with this line commented out,
         // but that might just be a coincidence based on the CRC parameters used for testing.
@@ -450,6 +609,81 @@ inline void CRC::Table<CRCType, CRCWidth>::InitTable()
     while (++byte);
 }
 
+/**
+    @brief Constructs a set of slice-by-N CRC tables from a set of CRC parameters
+    @param[in] params CRC parameters
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @tparam Slices Number of bytes consumed per table step
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+crcpp_constexpr_fn CRC::SlicingTable<CRCType, CRCWidth, Slices>::SlicingTable(const Parameters<CRCType, CRCWidth> & params) :
+    parameters(params),
+    table()
+{
+#ifdef CRCPP_USE_CPP11
+    static_assert(CRCWidth >= CHAR_BIT, "SlicingTable requires a CRC at least CHAR_BIT bits wide; use Table instead.");
+    static_assert(Slices >= 1, "SlicingTable requires at least one slice.");
+#endif
+
+    crcpp_constexpr CRCType BIT_MASK((CRCType(1) << (CRCWidth - CRCType(1))) |
+                                    ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1)));
+
+    // The conditional expression is used to avoid a -Wshift-count-overflow warning.
+    crcpp_constexpr CRCType SHIFT((CRCWidth >= CHAR_BIT) ? static_cast<CRCType>(CRCWidth - CHAR_BIT) : 0);
+
+    const Table<CRCType, CRCWidth> base(params);
+
+    for (crcpp_size i = 0; i < (1 << CHAR_BIT); ++i)
+    {
+        table[0][i] = base[static_cast<unsigned char>(i)];
+    }
+
+    for (crcpp_uint16 slice = 1; slice < Slices; ++slice)
+    {
+        for (crcpp_size i = 0; i < (1 << CHAR_BIT); ++i)
+        {
+            CRCType previous = table[slice - 1][i];
+
+            if (params.reflectInput)
+            {
+                table[slice][i] = static_cast<CRCType>((previous >> CHAR_BIT) ^ base[static_cast<unsigned char>(previous)]);
+            }
+            else
+            {
+                table[slice][i] = static_cast<CRCType>(((previous << CHAR_BIT) ^ base[static_cast<unsigned char>(previous >> SHIFT)]) & BIT_MASK);
+            }
+        }
+    }
+}
+
+/**
+    @brief Gets the CRC parameters used to construct the slicing tables
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @tparam Slices Number of bytes consumed per table step
+    @return CRC parameters
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+crcpp_constexpr_fn const CRC::Parameters<CRCType, CRCWidth> & CRC::SlicingTable<CRCType, CRCWidth, Slices>::GetParameters() const
+{
+    return parameters;
+}
+
+/**
+    @brief Gets one slice of the CRC tables
+    @param[in] slice Slice index; 0 is the regular byte-wise table
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @tparam Slices Number of bytes consumed per table step
+    @return CRC table for the slice
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+crcpp_constexpr_fn const CRCType * CRC::SlicingTable<CRCType, CRCWidth, Slices>::GetTable(crcpp_uint16 slice) const
+{
+    return table[slice];
+}
+
 /**
     @brief Computes a CRC.
     @param[in] data Data over which CRC will be computed
@@ -537,6 +771,172 @@ inline CRCType CRC::Calculate(const void * data, crcpp_size size, const Table<CR
     return Finalize<CRCType, CRCWidth>(remainder, parameters.finalXOR, parameters.reflectInput != parameters.reflectOutput);
 }
 
+/**
+    @brief Computes a CRC via slice-by-N lookup tables.
+    @param[in] data Data over which CRC will be computed
+    @param[in] size Size of the data, in bytes
+    @param[in] lookupTable CRC slicing tables
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @tparam Slices Number of bytes consumed per table step
+    @return CRC
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+inline CRCType CRC::Calculate(const void * data, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable)
+{
+    const Parameters<CRCType, CRCWidth> & parameters = lookupTable.GetParameters();
+
+    CRCType remainder = CalculateRemainderSliced(reinterpret_cast<const unsigned char *>(data), size, lookupTable, parameters.initialValue);
+
+    return Finalize<CRCType, CRCWidth>(remainder, parameters.finalXOR, parameters.reflectInput != parameters.reflectOutput);
+}
+
+/**
+    @brief Appends additional data to a previous CRC calculation using slice-by-N lookup tables.
+    @note This function can be used to compute multi-part CRCs.
+    @param[in] data Data over which CRC will be computed
+    @param[in] size Size of the data, in bytes
+    @param[in] lookupTable CRC slicing tables
+    @param[in] crc CRC from a previous calculation
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @tparam Slices Number of bytes consumed per table step
+    @return CRC
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+inline CRCType CRC::Calculate(const void * data, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable, CRCType crc)
+{
+    const Parameters<CRCType, CRCWidth> & parameters = lookupTable.GetParameters();
+
+    CRCType remainder = UndoFinalize<CRCType, CRCWidth>(crc, parameters.finalXOR, parameters.reflectInput != parameters.reflectOutput);
+
+    remainder = CalculateRemainderSliced(reinterpret_cast<const unsigned char *>(data), size, lookupTable, remainder);
+
+    return Finalize<CRCType, CRCWidth>(remainder, parameters.finalXOR, parameters.reflectInput != parameters.reflectOutput);
+}
+
+/**
+    @brief Combines the CRCs of two consecutive blocks into the CRC of their concatenation.
+    @note This allows a large buffer to be split into blocks whose CRCs are computed independently (e.g. on several
+        threads) and then merged into exactly the value a single pass over the whole buffer produces. Appending
+        lengthB zero bytes to a remainder is a linear map over GF(2); its matrix is raised to the required power by
+        repeated squaring, so the cost is O(CRCWidth^2 * log(lengthB)) independent of the data.
+    @param[in] crcA CRC of the first block
+    @param[in] crcB CRC of the second block, computed from the standard initial value
+    @param[in] lengthB Size of the second block, in bytes
+    @param[in] parameters CRC parameters
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @return CRC of the first block followed by the second block
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth>
+inline CRCType CRC::Combine(CRCType crcA, CRCType crcB, crcpp_uint64 lengthB, const Parameters<CRCType, CRCWidth> & parameters)
+{
+    // For masking off the bits for the CRC (in the event that the number of bits in CRCType is larger than CRCWidth)
+    static crcpp_constexpr CRCType BIT_MASK((CRCType(1) << (CRCWidth - CRCType(1))) |
+                                           ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1)));
+
+    const bool reflect = parameters.reflectInput != parameters.reflectOutput;
+
+    CRCType remainderA = UndoFinalize<CRCType, CRCWidth>(crcA, parameters.finalXOR, reflect);
+    CRCType remainderB = UndoFinalize<CRCType, CRCWidth>(crcB, parameters.finalXOR, reflect);
+
+    // R(init, A || B) = Z^n(R(init, A)) ^ R(0, B) and R(init, B) = Z^n(init) ^ R(0, B), where Z^n appends n zero bytes.
+    CRCType vector = static_cast<CRCType>((remainderA ^ parameters.initialValue) & BIT_MASK);
+
+    // Column i of the operator is the effect of one zero byte on a remainder with only bit i set.
+    CRCType matrix[CRCWidth];
+    CRCType square[CRCWidth];
+    const unsigned char zero = 0;
+    for (crcpp_uint16 i = 0; i < CRCWidth; ++i)
+    {
+        matrix[i] = static_cast<CRCType>(CalculateRemainder(&zero, 1, parameters, static_cast<CRCType>(CRCType(1) << i)) & BIT_MASK);
+    }
+
+    while (lengthB != 0)
+    {
+        if (lengthB & 1)
+        {
+            vector = MultiplyMatrix<CRCType, CRCWidth>(matrix, vector);
+        }
+
+        lengthB >>= 1;
+
+        if (lengthB != 0)
+        {
+            for (crcpp_uint16 i = 0; i < CRCWidth; ++i)
+            {
+                square[i] = MultiplyMatrix<CRCType, CRCWidth>(matrix, matrix[i]);
+            }
+            for (crcpp_uint16 i = 0; i < CRCWidth; ++i)
+            {
+                matrix[i] = square[i];
+            }
+        }
+    }
+
+    return Finalize<CRCType, CRCWidth>(static_cast<CRCType>(vector ^ remainderB), parameters.finalXOR, reflect);
+}
+
+/**
+    @brief Multiplies a GF(2) matrix, stored as one CRCType column per bit, by a vector.
+    @param[in] matrix CRCWidth columns
+    @param[in] vector Vector to multiply
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @return Product
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth>
+inline CRCType CRC::MultiplyMatrix(const CRCType * matrix, CRCType vector)
+{
+    CRCType result(0);
+
+    for (crcpp_uint16 i = 0; i < CRCWidth && vector != 0; ++i, vector = static_cast<CRCType>(vector >> 1))
+    {
+        if (vector & 1)
+        {
+            result = static_cast<CRCType>(result ^ matrix[i]);
+        }
+    }
+
+    return result;
+}
+
+/**
+    @brief Computes a CRC via a lookup table in a constant expression.
+    @param[in] data Data over which CRC will be computed
+    @param[in] size Size of the data, in bytes
+    @param[in] lookupTable CRC lookup table
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @return CRC
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth>
+crcpp_constexpr_fn CRCType CRC::CalculateConstexpr(const char * data, crcpp_size size, const Table<CRCType, CRCWidth> & lookupTable)
+{
+    return Finalize<CRCType, CRCWidth>(CalculateRemainderBytes(data, size, lookupTable, lookupTable.GetParameters().initialValue),
+                                       lookupTable.GetParameters().finalXOR,
+                                       lookupTable.GetParameters().reflectInput != lookupTable.GetParameters().reflectOutput);
+}
+
+/**
+    @brief Computes a CRC via slice-by-N lookup tables in a constant expression.
+    @param[in] data Data over which CRC will be computed
+    @param[in] size Size of the data, in bytes
+    @param[in] lookupTable CRC slicing tables
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @tparam Slices Number of bytes consumed per table step
+    @return CRC
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+crcpp_constexpr_fn CRCType CRC::CalculateConstexpr(const char * data, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable)
+{
+    return Finalize<CRCType, CRCWidth>(CalculateRemainderSliced(data, size, lookupTable, lookupTable.GetParameters().initialValue),
+                                       lookupTable.GetParameters().finalXOR,
+                                       lookupTable.GetParameters().reflectInput != lookupTable.GetParameters().reflectOutput);
+}
+
 /**
     @brief Computes a CRC.
     @param[in] data Data over which CRC will be computed
@@ -688,7 +1088,7 @@ inline CRCType CRC::CalculateBits(const void * data, crcpp_size size, const Tabl
     @return Reflected value
 */
 template <typename IntegerType>
-inline IntegerType CRC::Reflect(IntegerType value, crcpp_uint16 numBits)
+crcpp_constexpr_fn IntegerType CRC::Reflect(IntegerType value, crcpp_uint16 numBits)
 {
     IntegerType reversedValue(0);
 
@@ -711,11 +1111,11 @@ inline IntegerType CRC::Reflect(IntegerType value, crcpp_uint16 numBits)
     @return Final CRC
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline CRCType CRC::Finalize(CRCType remainder, CRCType finalXOR, bool reflectOutput)
+crcpp_constexpr_fn CRCType CRC::Finalize(CRCType remainder, CRCType finalXOR, bool reflectOutput)
 {
     // For masking off the bits for the CRC (in the event that the number of bits in CRCType is larger than CRCWidth)
-    static crcpp_constexpr CRCType BIT_MASK = (CRCType(1) << (CRCWidth - CRCType(1))) |
-                                             ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1));
+    crcpp_constexpr CRCType BIT_MASK = (CRCType(1) << (CRCWidth - CRCType(1))) |
+                                      ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1));
 
     if (reflectOutput)
     {
@@ -743,11 +1143,11 @@ inline CRCType CRC::Finalize(CRCType remainder, CRCType finalXOR, bool reflectOu
     @return Un-finalized CRC remainder
 */
 template <typename CRCType, crcpp_uint16 CRCWidth>
-inline CRCType CRC::UndoFinalize(CRCType crc, CRCType finalXOR, bool reflectOutput)
+crcpp_constexpr_fn CRCType CRC::UndoFinalize(CRCType crc, CRCType finalXOR, bool reflectOutput)
 {
     // For masking off the bits for the CRC (in the event that the number of bits in CRCType is larger than CRCWidth)
-    static crcpp_constexpr CRCType BIT_MASK = (CRCType(1) << (CRCWidth - CRCType(1))) |
-                                             ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1));
+    crcpp_constexpr CRCType BIT_MASK = (CRCType(1) << (CRCWidth - CRCType(1))) |
+                                      ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1));
 
     crc = (crc & BIT_MASK) ^ finalXOR;
 
@@ -889,8 +1289,24 @@ inline CRCType CRC::CalculateRemainder(const void * data, crcpp_size size, const
 template <typename CRCType, crcpp_uint16 CRCWidth>
 inline CRCType CRC::CalculateRemainder(const void * data, crcpp_size size, const Table<CRCType, CRCWidth> & lookupTable, CRCType remainder)
 {
-    const unsigned char * current = reinterpret_cast<const unsigned char *>(data);
+    return CalculateRemainderBytes(reinterpret_cast<const unsigned char *>(data), size, lookupTable, remainder);
+}
 
+/**
+    @brief Computes a CRC remainder using lookup table.
+    @note Templated on the byte type so the same loop serves runtime callers (unsigned char) and constant expressions (char).
+    @param[in] current Data over which the remainder will be computed
+    @param[in] size Size of the data, in bytes
+    @param[in] lookupTable CRC lookup table
+    @param[in] remainder Running CRC remainder. Can be an initial value or the result of a previous CRC remainder calculation.
+    @tparam ByteType Character type of the data
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @return CRC remainder
+*/
+template <typename ByteType, typename CRCType, crcpp_uint16 CRCWidth>
+crcpp_constexpr_fn CRCType CRC::CalculateRemainderBytes(const ByteType * current, crcpp_size size, const Table<CRCType, CRCWidth> & lookupTable, CRCType remainder)
+{
     if (lookupTable.GetParameters().reflectInput)
     {
         while (size--)
@@ -902,7 +1318,7 @@ inline CRCType CRC::CalculateRemainder(const void * data, crcpp_size size, const
 #   pragma warning (push)
 #   pragma warning (disable : 4333)
 #endif
-            remainder = static_cast<CRCType>((remainder >> CHAR_BIT) ^ lookupTable[static_cast<unsigned char>(remainder ^ *current++)]);
+            remainder = static_cast<CRCType>((remainder >> CHAR_BIT) ^ lookupTable[static_cast<unsigned char>(remainder ^ static_cast<unsigned char>(*current++))]);
 #if defined(WIN32) || defined(_WIN32) || defined(WINCE)
 #   pragma warning (pop)
 #endif
@@ -911,24 +1327,155 @@ inline CRCType CRC::CalculateRemainder(const void * data, crcpp_size size, const
     else if (CRCWidth >= CHAR_BIT)
     {
         // The conditional expression is used to avoid a -Wshift-count-overflow warning.
-        static crcpp_constexpr CRCType SHIFT((CRCWidth >= CHAR_BIT) ? static_cast<CRCType>(CRCWidth - CHAR_BIT) : 0);
+        crcpp_constexpr CRCType SHIFT((CRCWidth >= CHAR_BIT) ? static_cast<CRCType>(CRCWidth - CHAR_BIT) : 0);
 
         while (size--)
         {
-            remainder = static_cast<CRCType>((remainder << CHAR_BIT) ^ lookupTable[static_cast<unsigned char>((remainder >> SHIFT) ^ *current++)]);
+            remainder = static_cast<CRCType>((remainder << CHAR_BIT) ^ lookupTable[static_cast<unsigned char>((remainder >> SHIFT) ^ static_cast<unsigned char>(*current++))]);
         }
     }
     else
     {
         // The conditional expression is used to avoid a -Wshift-count-overflow warning.
-        static crcpp_constexpr CRCType SHIFT((CHAR_BIT >= CRCWidth) ? static_cast<CRCType>(CHAR_BIT - CRCWidth) : 0);
+        crcpp_constexpr CRCType SHIFT((CHAR_BIT >= CRCWidth) ? static_cast<CRCType>(CHAR_BIT - CRCWidth) : 0);
 
         remainder = static_cast<CRCType>(remainder << SHIFT);
 
         while (size--)
         {
             // Note: no need to mask here since remainder is guaranteed to fit in a single byte.
-            remainder = lookupTable[static_cast<unsigned char>(remainder ^ *current++)];
+            remainder = lookupTable[static_cast<unsigned char>(remainder ^ static_cast<unsigned char>(*current++))];
+        }
+
+        remainder = static_cast<CRCType>(remainder >> SHIFT);
+    }
+
+    return remainder;
+}
+
+/**
+    @brief Computes a CRC remainder using slice-by-N lookup tables.
+    @note Whole groups of Slices bytes are folded into the remainder with one lookup per byte from independent tables;
+        the tail falls back to the byte-wise step using slice 0.
+    @param[in] current Data over which the remainder will be computed
+    @param[in] size Size of the data, in bytes
+    @param[in] lookupTable CRC slicing tables
+    @param[in] remainder Running CRC remainder. Can be an initial value or the result of a previous CRC remainder calculation.
+    @tparam ByteType Character type of the data
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @tparam Slices Number of bytes consumed per table step
+    @return CRC remainder
+*/
+template <typename ByteType, typename CRCType, crcpp_uint16 CRCWidth, crcpp_uint16 Slices>
+crcpp_constexpr_fn CRCType CRC::CalculateRemainderSliced(const ByteType * current, crcpp_size size, const SlicingTable<CRCType, CRCWidth, Slices> & lookupTable, CRCType remainder)
+{
+    crcpp_constexpr CRCType BIT_MASK((CRCType(1) << (CRCWidth - CRCType(1))) |
+                                    ((CRCType(1) << (CRCWidth - CRCType(1))) - CRCType(1)));
+
+    // Bits of the remainder that survive a whole step untouched. The conditional expressions avoid -Wshift-count-overflow.
+    crcpp_constexpr bool CARRY = Slices * CHAR_BIT < CRCWidth;
+    crcpp_constexpr int CARRY_SHIFT = CARRY ? Slices * CHAR_BIT : 0;
+    crcpp_constexpr int SHIFT = CRCWidth - CHAR_BIT;
+
+    const bool reflect = lookupTable.GetParameters().reflectInput;
+    const CRCType * base = lookupTable.GetTable(0);
+
+    while (size >= Slices)
+    {
+        CRCType next = 0;
+        if (CARRY)
+        {
+            next = reflect ? static_cast<CRCType>(remainder >> CARRY_SHIFT) : static_cast<CRCType>((remainder << CARRY_SHIFT) & BIT_MASK);
+        }
+
+        for (crcpp_uint16 j = 0; j < Slices; ++j)
+        {
+            // The byte of the remainder that lines up with input byte j.
+            unsigned char overlap = 0;
+            if (reflect)
+            {
+                if (j * CHAR_BIT < CRCWidth)
+                    overlap = static_cast<unsigned char>(remainder >> (j * CHAR_BIT));
+            }
+            else
+            {
+                const int shift = SHIFT - j * CHAR_BIT;
+                if (shift >= 0)
+                    overlap = static_cast<unsigned char>(remainder >> shift);
+                else if (shift > -CHAR_BIT)
+                    overlap = static_cast<unsigned char>(remainder << -shift);
+            }
+
+            next = static_cast<CRCType>(next ^ lookupTable.GetTable(Slices - 1 - j)[static_cast<unsigned char>(overlap ^ static_cast<unsigned char>(current[j]))]);
+        }
+
+        remainder = next;
+        current += Slices;
+        size -= Slices;
+    }
+
+    while (size--)
+    {
+        if (reflect)
+            remainder = static_cast<CRCType>((remainder >> CHAR_BIT) ^ base[static_cast<unsigned char>(remainder ^ static_cast<unsigned char>(*current++))]);
+        else
+            remainder = static_cast<CRCType>(((remainder << CHAR_BIT) ^ base[static_cast<unsigned char>((remainder >> SHIFT) ^ static_cast<unsigned char>(*current++))]) & BIT_MASK);
+    }
+
+    return remainder;
+}
+
+/**
+    @brief Computes one entry of a CRC lookup table: the remainder of a single byte with a zero initial value.
+    @note This is the bit-by-bit algorithm of CalculateRemainder() specialised for one byte, written without static locals
+        or pointer casts so that it can run in a constant expression.
+    @param[in] byte Table index
+    @param[in] parameters CRC parameters
+    @tparam CRCType Integer type for storing the CRC result
+    @tparam CRCWidth Number of bits in the CRC
+    @return CRC remainder for the byte
+*/
+template <typename CRCType, crcpp_uint16 CRCWidth>
+crcpp_constexpr_fn CRCType CRC::CalculateTableEntry(unsigned char byte, const Parameters<CRCType, CRCWidth> & parameters)
+{
+    CRCType remainder = 0;
+
+    if (parameters.reflectInput)
+    {
+        const CRCType polynomial = CRC::Reflect(parameters.polynomial, CRCWidth);
+        remainder = static_cast<CRCType>(byte);
+
+        for (crcpp_size i = 0; i < CHAR_BIT; ++i)
+        {
+            remainder = static_cast<CRCType>((remainder & 1) ? ((remainder >> 1) ^ polynomial) : (remainder >> 1));
+        }
+    }
+    else if (CRCWidth >= CHAR_BIT)
+    {
+        crcpp_constexpr CRCType CRC_HIGHEST_BIT_MASK(CRCType(1) << (CRCWidth - CRCType(1)));
+        // The conditional expression is used to avoid a -Wshift-count-overflow warning.
+        crcpp_constexpr CRCType SHIFT((CRCWidth >= CHAR_BIT) ? static_cast<CRCType>(CRCWidth - CHAR_BIT) : 0);
+
+        remainder = static_cast<CRCType>(static_cast<CRCType>(byte) << SHIFT);
+
+        for (crcpp_size i = 0; i < CHAR_BIT; ++i)
+        {
+            remainder = static_cast<CRCType>((remainder & CRC_HIGHEST_BIT_MASK) ? ((remainder << 1) ^ parameters.polynomial) : (remainder << 1));
+        }
+    }
+    else
+    {
+        crcpp_constexpr CRCType CHAR_BIT_HIGHEST_BIT_MASK(CRCType(1) << (CHAR_BIT - 1));
+        // The conditional expression is used to avoid a -Wshift-count-overflow warning.
+        crcpp_constexpr CRCType SHIFT((CHAR_BIT >= CRCWidth) ? static_cast<CRCType>(CHAR_BIT - CRCWidth) : 0);
+
+        const CRCType polynomial = static_cast<CRCType>(parameters.polynomial << SHIFT);
+        remainder = static_cast<CRCType>(byte);
+
+        for (crcpp_size i = 0; i < CHAR_BIT; ++i)
+        {
+            remainder = static_cast<CRCType>((remainder & CHAR_BIT_HIGHEST_BIT_MASK) ? ((remainder << 1) ^ polynomial) : (remainder << 1));
         }
 
         remainder = static_cast<CRCType>(remainder >> SHIFT);
@@ -1036,7 +1583,7 @@ inline CRCType CRC::CalculateRemainderBits(unsigned char byte, crcpp_size numBit
 */
 inline const CRC::Parameters<crcpp_uint8, 4> & CRC::CRC_4_ITU()
 {
-    static const Parameters<crcpp_uint8, 4> parameters = { 0x3, 0x0, 0x0, true, true };
+    static const Parameters<crcpp_uint8, 4> parameters = Standard::CRC_4_ITU();
     return parameters;
 }
 
@@ -1054,7 +1601,7 @@ inline const CRC::Parameters<crcpp_uint8, 4> & CRC::CRC_4_ITU()
 */
 inline const CRC::Parameters<crcpp_uint8, 5> & CRC::CRC_5_EPC()
 {
-    static const Parameters<crcpp_uint8, 5> parameters = { 0x09, 0x09, 0x00, false, false };
+    static const Parameters<crcpp_uint8, 5> parameters = Standard::CRC_5_EPC();
     return parameters;
 }
 
@@ -1072,7 +1619,7 @@ inline const CRC::Parameters<crcpp_uint8, 5> & CRC::CRC_5_EPC()
 */
 inline const CRC::Parameters<crcpp_uint8, 5> & CRC::CRC_5_ITU()
 {
-    static const Parameters<crcpp_uint8, 5> parameters = { 0x15, 0x00, 0x00, true, true };
+    static const Parameters<crcpp_uint8, 5> parameters = Standard::CRC_5_ITU();
     return parameters;
 }
 
@@ -1090,7 +1637,7 @@ inline const CRC::Parameters<crcpp_uint8, 5> & CRC::CRC_5_ITU()
 */
 inline const CRC::Parameters<crcpp_uint8, 5> & CRC::CRC_5_USB()
 {
-    static const Parameters<crcpp_uint8, 5> parameters = { 0x05, 0x1F, 0x1F, true, true };
+    static const Parameters<crcpp_uint8, 5> parameters = Standard::CRC_5_USB();
     return parameters;
 }
 
@@ -1108,7 +1655,7 @@ inline const CRC::Parameters<crcpp_uint8, 5> & CRC::CRC_5_USB()
 */
 inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_CDMA2000A()
 {
-    static const Parameters<crcpp_uint8, 6> parameters = { 0x27, 0x3F, 0x00, false, false };
+    static const Parameters<crcpp_uint8, 6> parameters = Standard::CRC_6_CDMA2000A();
     return parameters;
 }
 
@@ -1126,7 +1673,7 @@ inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_CDMA2000A()
 */
 inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_CDMA2000B()
 {
-    static const Parameters<crcpp_uint8, 6> parameters = { 0x07, 0x3F, 0x00, false, false };
+    static const Parameters<crcpp_uint8, 6> parameters = Standard::CRC_6_CDMA2000B();
     return parameters;
 }
 
@@ -1144,7 +1691,7 @@ inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_CDMA2000B()
 */
 inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_ITU()
 {
-    static const Parameters<crcpp_uint8, 6> parameters = { 0x03, 0x00, 0x00, true, true };
+    static const Parameters<crcpp_uint8, 6> parameters = Standard::CRC_6_ITU();
     return parameters;
 }
 
@@ -1163,7 +1710,7 @@ inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_ITU()
 */
 inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_NR()
 {
-    static const Parameters<crcpp_uint8, 6> parameters = { 0x21, 0x00, 0x00, false, false };
+    static const Parameters<crcpp_uint8, 6> parameters = Standard::CRC_6_NR();
     return parameters;
 }
 
@@ -1181,7 +1728,7 @@ inline const CRC::Parameters<crcpp_uint8, 6> & CRC::CRC_6_NR()
 */
 inline const CRC::Parameters<crcpp_uint8, 7> & CRC::CRC_7()
 {
-    static const Parameters<crcpp_uint8, 7> parameters = { 0x09, 0x00, 0x00, false, false };
+    static const Parameters<crcpp_uint8, 7> parameters = Standard::CRC_7();
     return parameters;
 }
 #endif // CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
@@ -1200,7 +1747,7 @@ inline const CRC::Parameters<crcpp_uint8, 7> & CRC::CRC_7()
 */
 inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8()
 {
-    static const Parameters<crcpp_uint8, 8> parameters = { 0x07, 0x00, 0x00, false, false };
+    static const Parameters<crcpp_uint8, 8> parameters = Standard::CRC_8();
     return parameters;
 }
 
@@ -1219,7 +1766,7 @@ inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8()
 */
 inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_EBU()
 {
-    static const Parameters<crcpp_uint8, 8> parameters = { 0x1D, 0xFF, 0x00, true, true };
+    static const Parameters<crcpp_uint8, 8> parameters = Standard::CRC_8_EBU();
     return parameters;
 }
 
@@ -1237,7 +1784,7 @@ inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_EBU()
 */
 inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_HDLC()
 {
-    static const Parameters<crcpp_uint8, 8> parameters = { 0x07, 0xFF, 0xFF, true, true };
+    static const Parameters<crcpp_uint8, 8> parameters = Standard::CRC_8_HDLC();
     return parameters;
 }
 
@@ -1255,7 +1802,7 @@ inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_HDLC()
 */
 inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_MAXIM()
 {
-    static const Parameters<crcpp_uint8, 8> parameters = { 0x31, 0x00, 0x00, true, true };
+    static const Parameters<crcpp_uint8, 8> parameters = Standard::CRC_8_MAXIM();
     return parameters;
 }
 
@@ -1273,7 +1820,7 @@ inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_MAXIM()
 */
 inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_WCDMA()
 {
-    static const Parameters<crcpp_uint8, 8> parameters = { 0x9B, 0x00, 0x00, true, true };
+    static const Parameters<crcpp_uint8, 8> parameters = Standard::CRC_8_WCDMA();
     return parameters;
 }
 
@@ -1291,7 +1838,7 @@ inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_WCDMA()
 */
 inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_LTE()
 {
-    static const Parameters<crcpp_uint8, 8> parameters = { 0x9B, 0x00, 0x00, false, false };
+    static const Parameters<crcpp_uint8, 8> parameters = Standard::CRC_8_LTE();
     return parameters;
 }
 
@@ -1309,7 +1856,7 @@ inline const CRC::Parameters<crcpp_uint8, 8> & CRC::CRC_8_LTE()
 */
 inline const CRC::Parameters<crcpp_uint16, 10> & CRC::CRC_10()
 {
-    static const Parameters<crcpp_uint16, 10> parameters = { 0x233, 0x000, 0x000, false, false };
+    static const Parameters<crcpp_uint16, 10> parameters = Standard::CRC_10();
     return parameters;
 }
 
@@ -1327,7 +1874,7 @@ inline const CRC::Parameters<crcpp_uint16, 10> & CRC::CRC_10()
 */
 inline const CRC::Parameters<crcpp_uint16, 10> & CRC::CRC_10_CDMA2000()
 {
-    static const Parameters<crcpp_uint16, 10> parameters = { 0x3D9, 0x3FF, 0x000, false, false };
+    static const Parameters<crcpp_uint16, 10> parameters = Standard::CRC_10_CDMA2000();
     return parameters;
 }
 
@@ -1345,7 +1892,7 @@ inline const CRC::Parameters<crcpp_uint16, 10> & CRC::CRC_10_CDMA2000()
 */
 inline const CRC::Parameters<crcpp_uint16, 11> & CRC::CRC_11()
 {
-    static const Parameters<crcpp_uint16, 11> parameters = { 0x385, 0x01A, 0x000, false, false };
+    static const Parameters<crcpp_uint16, 11> parameters = Standard::CRC_11();
     return parameters;
 }
 
@@ -1364,7 +1911,7 @@ inline const CRC::Parameters<crcpp_uint16, 11> & CRC::CRC_11()
 */
 inline const CRC::Parameters<crcpp_uint16, 11> & CRC::CRC_11_NR()
 {
-    static const Parameters<crcpp_uint16, 11> parameters = { 0x621, 0x000, 0x000, false, false };
+    static const Parameters<crcpp_uint16, 11> parameters = Standard::CRC_11_NR();
     return parameters;
 }
 
@@ -1382,7 +1929,7 @@ inline const CRC::Parameters<crcpp_uint16, 11> & CRC::CRC_11_NR()
 */
 inline const CRC::Parameters<crcpp_uint16, 12> & CRC::CRC_12_CDMA2000()
 {
-    static const Parameters<crcpp_uint16, 12> parameters = { 0xF13, 0xFFF, 0x000, false, false };
+    static const Parameters<crcpp_uint16, 12> parameters = Standard::CRC_12_CDMA2000();
     return parameters;
 }
 
@@ -1400,7 +1947,7 @@ inline const CRC::Parameters<crcpp_uint16, 12> & CRC::CRC_12_CDMA2000()
 */
 inline const CRC::Parameters<crcpp_uint16, 12> & CRC::CRC_12_DECT()
 {
-    static const Parameters<crcpp_uint16, 12> parameters = { 0x80F, 0x000, 0x000, false, false };
+    static const Parameters<crcpp_uint16, 12> parameters = Standard::CRC_12_DECT();
     return parameters;
 }
 
@@ -1418,7 +1965,7 @@ inline const CRC::Parameters<crcpp_uint16, 12> & CRC::CRC_12_DECT()
 */
 inline const CRC::Parameters<crcpp_uint16, 12> & CRC::CRC_12_UMTS()
 {
-    static const Parameters<crcpp_uint16, 12> parameters = { 0x80F, 0x000, 0x000, false, true };
+    static const Parameters<crcpp_uint16, 12> parameters = Standard::CRC_12_UMTS();
     return parameters;
 }
 
@@ -1436,8 +1983,8 @@ inline const CRC::Parameters<crcpp_uint16, 12> & CRC::CRC_12_UMTS()
 */
 inline const CRC::Parameters<crcpp_uint16, 13> & CRC::CRC_13_BBC()
 {
-    static const Parameters<crcpp_uint16, 13> parameters = { 0x1CF5, 0x0000, 0x0000, false, false };
-   return parameters;
+    static const Parameters<crcpp_uint16, 13> parameters = Standard::CRC_13_BBC();
+    return parameters;
 }
 
 /**
@@ -1454,7 +2001,7 @@ inline const CRC::Parameters<crcpp_uint16, 13> & CRC::CRC_13_BBC()
 */
 inline const CRC::Parameters<crcpp_uint16, 15> & CRC::CRC_15()
 {
-    static const Parameters<crcpp_uint16, 15> parameters = { 0x4599, 0x0000, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 15> parameters = Standard::CRC_15();
     return parameters;
 }
 
@@ -1472,7 +2019,7 @@ inline const CRC::Parameters<crcpp_uint16, 15> & CRC::CRC_15()
 */
 inline const CRC::Parameters<crcpp_uint16, 15> & CRC::CRC_15_MPT1327()
 {
-    static const Parameters<crcpp_uint16, 15> parameters = { 0x6815, 0x0000, 0x0001, false, false };
+    static const Parameters<crcpp_uint16, 15> parameters = Standard::CRC_15_MPT1327();
     return parameters;
 }
 #endif // CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
@@ -1491,7 +2038,7 @@ inline const CRC::Parameters<crcpp_uint16, 15> & CRC::CRC_15_MPT1327()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_ARC()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0x0000, 0x0000, true, true };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_ARC();
     return parameters;
 }
 
@@ -1509,7 +2056,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_ARC()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_BUYPASS()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0x0000, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_BUYPASS();
     return parameters;
 }
 
@@ -1527,7 +2074,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_BUYPASS()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_CCITTFALSE()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_CCITTFALSE();
     return parameters;
 }
 
@@ -1545,7 +2092,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_CCITTFALSE()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_MCRF4XX()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0x0000, true, true};
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_MCRF4XX();
     return parameters;
 }
 
@@ -1564,7 +2111,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_MCRF4XX()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_CDMA2000()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0xC867, 0xFFFF, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_CDMA2000();
     return parameters;
 }
 
@@ -1582,7 +2129,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_CDMA2000()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_CMS()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0xFFFF, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_CMS();
     return parameters;
 }
 
@@ -1600,7 +2147,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_CMS()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_DECTR()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x0589, 0x0000, 0x0001, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_DECTR();
     return parameters;
 }
 
@@ -1618,7 +2165,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_DECTR()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_DECTX()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x0589, 0x0000, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_DECTX();
     return parameters;
 }
 
@@ -1636,7 +2183,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_DECTX()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_DNP()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x3D65, 0x0000, 0xFFFF, true, true };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_DNP();
     return parameters;
 }
 #endif // CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
@@ -1655,7 +2202,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_DNP()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_GENIBUS()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0xFFFF, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_GENIBUS();
     return parameters;
 }
 
@@ -1673,7 +2220,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_GENIBUS()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_KERMIT()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0x0000, 0x0000, true, true };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_KERMIT();
     return parameters;
 }
 
@@ -1692,7 +2239,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_KERMIT()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_MAXIM()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0x0000, 0xFFFF, true, true };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_MAXIM();
     return parameters;
 }
 
@@ -1710,7 +2257,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_MAXIM()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_MODBUS()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0xFFFF, 0x0000, true, true };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_MODBUS();
     return parameters;
 }
 
@@ -1728,7 +2275,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_MODBUS()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_T10DIF()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x8BB7, 0x0000, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_T10DIF();
     return parameters;
 }
 
@@ -1746,7 +2293,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_T10DIF()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_USB()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x8005, 0xFFFF, 0xFFFF, true, true };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_USB();
     return parameters;
 }
 
@@ -1766,7 +2313,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_USB()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_X25()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0xFFFF, 0xFFFF, true, true };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_X25();
     return parameters;
 }
 
@@ -1784,7 +2331,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_X25()
 */
 inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_XMODEM()
 {
-    static const Parameters<crcpp_uint16, 16> parameters = { 0x1021, 0x0000, 0x0000, false, false };
+    static const Parameters<crcpp_uint16, 16> parameters = Standard::CRC_16_XMODEM();
     return parameters;
 }
 
@@ -1803,7 +2350,7 @@ inline const CRC::Parameters<crcpp_uint16, 16> & CRC::CRC_16_XMODEM()
 */
 inline const CRC::Parameters<crcpp_uint32, 17> & CRC::CRC_17_CAN()
 {
-    static const Parameters<crcpp_uint32, 17> parameters = { 0x1685B, 0x00000, 0x00000, false, false };
+    static const Parameters<crcpp_uint32, 17> parameters = Standard::CRC_17_CAN();
     return parameters;
 }
 
@@ -1821,7 +2368,7 @@ inline const CRC::Parameters<crcpp_uint32, 17> & CRC::CRC_17_CAN()
 */
 inline const CRC::Parameters<crcpp_uint32, 21> & CRC::CRC_21_CAN()
 {
-    static const Parameters<crcpp_uint32, 21> parameters = { 0x102899, 0x000000, 0x000000, false, false };
+    static const Parameters<crcpp_uint32, 21> parameters = Standard::CRC_21_CAN();
     return parameters;
 }
 
@@ -1839,7 +2386,7 @@ inline const CRC::Parameters<crcpp_uint32, 21> & CRC::CRC_21_CAN()
 */
 inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24()
 {
-    static const Parameters<crcpp_uint32, 24> parameters = { 0x864CFB, 0xB704CE, 0x000000, false, false };
+    static const Parameters<crcpp_uint32, 24> parameters = Standard::CRC_24();
     return parameters;
 }
 
@@ -1857,7 +2404,7 @@ inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24()
 */
 inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_FLEXRAYA()
 {
-    static const Parameters<crcpp_uint32, 24> parameters = { 0x5D6DCB, 0xFEDCBA, 0x000000, false, false };
+    static const Parameters<crcpp_uint32, 24> parameters = Standard::CRC_24_FLEXRAYA();
     return parameters;
 }
 
@@ -1875,7 +2422,7 @@ inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_FLEXRAYA()
 */
 inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_FLEXRAYB()
 {
-    static const Parameters<crcpp_uint32, 24> parameters = { 0x5D6DCB, 0xABCDEF, 0x000000, false, false };
+    static const Parameters<crcpp_uint32, 24> parameters = Standard::CRC_24_FLEXRAYB();
     return parameters;
 }
 
@@ -1894,7 +2441,7 @@ inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_FLEXRAYB()
 */
 inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_LTEA()
 {
-    static const Parameters<crcpp_uint32, 24> parameters = { 0x864CFB, 0x000000, 0x000000, false, false };
+    static const Parameters<crcpp_uint32, 24> parameters = Standard::CRC_24_LTEA();
     return parameters;
 }
 
@@ -1913,7 +2460,7 @@ inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_LTEA()
 */
 inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_LTEB()
 {
-    static const Parameters<crcpp_uint32, 24> parameters = { 0x800063, 0x000000, 0x000000, false, false };
+    static const Parameters<crcpp_uint32, 24> parameters = Standard::CRC_24_LTEB();
     return parameters;
 }
 
@@ -1932,7 +2479,7 @@ inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_LTEB()
 */
 inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_NRC()
 {
-    static const Parameters<crcpp_uint32, 24> parameters = { 0xB2B117, 0x000000, 0x000000, false, false };
+    static const Parameters<crcpp_uint32, 24> parameters = Standard::CRC_24_NRC();
     return parameters;
 }
 
@@ -1950,7 +2497,7 @@ inline const CRC::Parameters<crcpp_uint32, 24> & CRC::CRC_24_NRC()
 */
 inline const CRC::Parameters<crcpp_uint32, 30> & CRC::CRC_30()
 {
-    static const Parameters<crcpp_uint32, 30> parameters = { 0x2030B9C7, 0x3FFFFFFF, 0x00000000, false, false };
+    static const Parameters<crcpp_uint32, 30> parameters = Standard::CRC_30();
     return parameters;
 }
 #endif // CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
@@ -1969,7 +2516,7 @@ inline const CRC::Parameters<crcpp_uint32, 30> & CRC::CRC_30()
 */
 inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32()
 {
-    static const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, true, true };
+    static const Parameters<crcpp_uint32, 32> parameters = Standard::CRC_32();
     return parameters;
 }
 
@@ -1987,7 +2534,7 @@ inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32()
 */
 inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_BZIP2()
 {
-    static const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, false, false };
+    static const Parameters<crcpp_uint32, 32> parameters = Standard::CRC_32_BZIP2();
     return parameters;
 }
 
@@ -2006,7 +2553,7 @@ inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_BZIP2()
 */
 inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_C()
 {
-    static const Parameters<crcpp_uint32, 32> parameters = { 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true };
+    static const Parameters<crcpp_uint32, 32> parameters = Standard::CRC_32_C();
     return parameters;
 }
 #endif
@@ -2025,7 +2572,7 @@ inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_C()
 */
 inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_MPEG2()
 {
-    static const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0xFFFFFFFF, 0x00000000, false, false };
+    static const Parameters<crcpp_uint32, 32> parameters = Standard::CRC_32_MPEG2();
     return parameters;
 }
 
@@ -2043,7 +2590,7 @@ inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_MPEG2()
 */
 inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_POSIX()
 {
-    static const Parameters<crcpp_uint32, 32> parameters = { 0x04C11DB7, 0x00000000, 0xFFFFFFFF, false, false };
+    static const Parameters<crcpp_uint32, 32> parameters = Standard::CRC_32_POSIX();
     return parameters;
 }
 
@@ -2062,7 +2609,7 @@ inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_POSIX()
 */
 inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_Q()
 {
-    static const Parameters<crcpp_uint32, 32> parameters = { 0x814141AB, 0x00000000, 0x00000000, false, false };
+    static const Parameters<crcpp_uint32, 32> parameters = Standard::CRC_32_Q();
     return parameters;
 }
 
@@ -2080,7 +2627,7 @@ inline const CRC::Parameters<crcpp_uint32, 32> & CRC::CRC_32_Q()
 */
 inline const CRC::Parameters<crcpp_uint64, 40> & CRC::CRC_40_GSM()
 {
-    static const Parameters<crcpp_uint64, 40> parameters = { 0x0004820009, 0x0000000000, 0xFFFFFFFFFF, false, false };
+    static const Parameters<crcpp_uint64, 40> parameters = Standard::CRC_40_GSM();
     return parameters;
 }
 
@@ -2098,7 +2645,7 @@ inline const CRC::Parameters<crcpp_uint64, 40> & CRC::CRC_40_GSM()
 */
 inline const CRC::Parameters<crcpp_uint64, 64> & CRC::CRC_64()
 {
-    static const Parameters<crcpp_uint64, 64> parameters = { 0x42F0E1EBA9EA3693, 0x0000000000000000, 0x0000000000000000, false, false };
+    static const Parameters<crcpp_uint64, 64> parameters = Standard::CRC_64();
     return parameters;
 }
 #endif // CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
@@ -2107,6 +2654,161 @@ inline const CRC::Parameters<crcpp_uint64, 64> & CRC::CRC_64()
 }
 #endif
 
+
+#if defined(CRCPP_CONSTEXPR_TABLES) && !defined(CRCPP_NO_COMPILE_TIME_TESTS)
+/*
+    Compile-time self test: every standard CRC must reproduce its published check value (the CRC of the ASCII
+    string "123456789") through a table built in a constant expression, and every CRC at least CHAR_BIT bits wide
+    must produce the same value through slice-by-8 tables. A broken table generator fails the build instead of
+    producing silently wrong checksums at runtime.
+*/
+#ifdef CRCPP_USE_NAMESPACE
+namespace CRCPP
+{
+#endif
+namespace crcpp_self_test
+{
+    template <typename CRCType, crcpp_uint16 CRCWidth>
+    constexpr bool CheckTable(const CRC::Parameters<CRCType, CRCWidth> & parameters, crcpp_uint64 check)
+    {
+        return static_cast<crcpp_uint64>(CRC::CalculateConstexpr("123456789", 9, CRC::Table<CRCType, CRCWidth>(parameters))) == check;
+    }
+
+    template <typename CRCType, crcpp_uint16 CRCWidth>
+    constexpr bool CheckSlicing(const CRC::Parameters<CRCType, CRCWidth> & parameters, crcpp_uint64 check)
+    {
+        return static_cast<crcpp_uint64>(CRC::CalculateConstexpr("123456789", 9, CRC::SlicingTable<CRCType, CRCWidth, 8>(parameters))) == check;
+    }
+
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+    static_assert(CheckTable(CRC::Standard::CRC_4_ITU(), 0x7), "CRC_4_ITU check value");
+    static_assert(CheckTable(CRC::Standard::CRC_5_EPC(), 0x00), "CRC_5_EPC check value");
+    static_assert(CheckTable(CRC::Standard::CRC_5_ITU(), 0x07), "CRC_5_ITU check value");
+    static_assert(CheckTable(CRC::Standard::CRC_5_USB(), 0x19), "CRC_5_USB check value");
+    static_assert(CheckTable(CRC::Standard::CRC_6_CDMA2000A(), 0x0D), "CRC_6_CDMA2000A check value");
+    static_assert(CheckTable(CRC::Standard::CRC_6_CDMA2000B(), 0x3B), "CRC_6_CDMA2000B check value");
+    static_assert(CheckTable(CRC::Standard::CRC_6_ITU(), 0x06), "CRC_6_ITU check value");
+    static_assert(CheckTable(CRC::Standard::CRC_6_NR(), 0x15), "CRC_6_NR check value");
+    static_assert(CheckTable(CRC::Standard::CRC_7(), 0x75), "CRC_7 check value");
+#endif
+    static_assert(CheckTable(CRC::Standard::CRC_8(), 0xF4), "CRC_8 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_8(), 0xF4), "CRC_8 slice-by-8 check value");
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+    static_assert(CheckTable(CRC::Standard::CRC_8_EBU(), 0x97), "CRC_8_EBU check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_8_EBU(), 0x97), "CRC_8_EBU slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_8_HDLC(), 0x2F), "CRC_8_HDLC check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_8_HDLC(), 0x2F), "CRC_8_HDLC slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_8_MAXIM(), 0xA1), "CRC_8_MAXIM check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_8_MAXIM(), 0xA1), "CRC_8_MAXIM slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_8_WCDMA(), 0x25), "CRC_8_WCDMA check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_8_WCDMA(), 0x25), "CRC_8_WCDMA slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_8_LTE(), 0xEA), "CRC_8_LTE check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_8_LTE(), 0xEA), "CRC_8_LTE slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_10(), 0x199), "CRC_10 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_10(), 0x199), "CRC_10 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_10_CDMA2000(), 0x233), "CRC_10_CDMA2000 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_10_CDMA2000(), 0x233), "CRC_10_CDMA2000 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_11(), 0x5A3), "CRC_11 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_11(), 0x5A3), "CRC_11 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_11_NR(), 0x5CA), "CRC_11_NR check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_11_NR(), 0x5CA), "CRC_11_NR slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_12_CDMA2000(), 0xD4D), "CRC_12_CDMA2000 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_12_CDMA2000(), 0xD4D), "CRC_12_CDMA2000 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_12_DECT(), 0xF5B), "CRC_12_DECT check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_12_DECT(), 0xF5B), "CRC_12_DECT slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_12_UMTS(), 0xDAF), "CRC_12_UMTS check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_12_UMTS(), 0xDAF), "CRC_12_UMTS slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_13_BBC(), 0x04FA), "CRC_13_BBC check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_13_BBC(), 0x04FA), "CRC_13_BBC slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_15(), 0x059E), "CRC_15 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_15(), 0x059E), "CRC_15 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_15_MPT1327(), 0x2566), "CRC_15_MPT1327 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_15_MPT1327(), 0x2566), "CRC_15_MPT1327 slice-by-8 check value");
+#endif
+    static_assert(CheckTable(CRC::Standard::CRC_16_ARC(), 0xBB3D), "CRC_16_ARC check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_ARC(), 0xBB3D), "CRC_16_ARC slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_BUYPASS(), 0xFEE8), "CRC_16_BUYPASS check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_BUYPASS(), 0xFEE8), "CRC_16_BUYPASS slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_CCITTFALSE(), 0x29B1), "CRC_16_CCITTFALSE check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_CCITTFALSE(), 0x29B1), "CRC_16_CCITTFALSE slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_MCRF4XX(), 0x6F91), "CRC_16_MCRF4XX check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_MCRF4XX(), 0x6F91), "CRC_16_MCRF4XX slice-by-8 check value");
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+    static_assert(CheckTable(CRC::Standard::CRC_16_CDMA2000(), 0x4C06), "CRC_16_CDMA2000 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_CDMA2000(), 0x4C06), "CRC_16_CDMA2000 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_CMS(), 0xAEE7), "CRC_16_CMS check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_CMS(), 0xAEE7), "CRC_16_CMS slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_DECTR(), 0x007E), "CRC_16_DECTR check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_DECTR(), 0x007E), "CRC_16_DECTR slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_DECTX(), 0x007F), "CRC_16_DECTX check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_DECTX(), 0x007F), "CRC_16_DECTX slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_DNP(), 0xEA82), "CRC_16_DNP check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_DNP(), 0xEA82), "CRC_16_DNP slice-by-8 check value");
+#endif
+    static_assert(CheckTable(CRC::Standard::CRC_16_GENIBUS(), 0xD64E), "CRC_16_GENIBUS check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_GENIBUS(), 0xD64E), "CRC_16_GENIBUS slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_KERMIT(), 0x2189), "CRC_16_KERMIT check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_KERMIT(), 0x2189), "CRC_16_KERMIT slice-by-8 check value");
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+    static_assert(CheckTable(CRC::Standard::CRC_16_MAXIM(), 0x44C2), "CRC_16_MAXIM check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_MAXIM(), 0x44C2), "CRC_16_MAXIM slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_MODBUS(), 0x4B37), "CRC_16_MODBUS check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_MODBUS(), 0x4B37), "CRC_16_MODBUS slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_T10DIF(), 0xD0DB), "CRC_16_T10DIF check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_T10DIF(), 0xD0DB), "CRC_16_T10DIF slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_USB(), 0xB4C8), "CRC_16_USB check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_USB(), 0xB4C8), "CRC_16_USB slice-by-8 check value");
+#endif
+    static_assert(CheckTable(CRC::Standard::CRC_16_X25(), 0x906E), "CRC_16_X25 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_X25(), 0x906E), "CRC_16_X25 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_16_XMODEM(), 0x31C3), "CRC_16_XMODEM check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_16_XMODEM(), 0x31C3), "CRC_16_XMODEM slice-by-8 check value");
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+    static_assert(CheckTable(CRC::Standard::CRC_17_CAN(), 0x04F03), "CRC_17_CAN check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_17_CAN(), 0x04F03), "CRC_17_CAN slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_21_CAN(), 0x0ED841), "CRC_21_CAN check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_21_CAN(), 0x0ED841), "CRC_21_CAN slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_24(), 0x21CF02), "CRC_24 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_24(), 0x21CF02), "CRC_24 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_24_FLEXRAYA(), 0x7979BD), "CRC_24_FLEXRAYA check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_24_FLEXRAYA(), 0x7979BD), "CRC_24_FLEXRAYA slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_24_FLEXRAYB(), 0x1F23B8), "CRC_24_FLEXRAYB check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_24_FLEXRAYB(), 0x1F23B8), "CRC_24_FLEXRAYB slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_24_LTEA(), 0xCDE703), "CRC_24_LTEA check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_24_LTEA(), 0xCDE703), "CRC_24_LTEA slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_24_LTEB(), 0x23EF52), "CRC_24_LTEB check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_24_LTEB(), 0x23EF52), "CRC_24_LTEB slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_24_NRC(), 0xF48279), "CRC_24_NRC check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_24_NRC(), 0xF48279), "CRC_24_NRC slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_30(), 0x3B3CB540), "CRC_30 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_30(), 0x3B3CB540), "CRC_30 slice-by-8 check value");
+#endif
+    static_assert(CheckTable(CRC::Standard::CRC_32(), 0xCBF43926), "CRC_32 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_32(), 0xCBF43926), "CRC_32 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_32_BZIP2(), 0xFC891918), "CRC_32_BZIP2 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_32_BZIP2(), 0xFC891918), "CRC_32_BZIP2 slice-by-8 check value");
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+    static_assert(CheckTable(CRC::Standard::CRC_32_C(), 0xE3069283), "CRC_32_C check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_32_C(), 0xE3069283), "CRC_32_C slice-by-8 check value");
+#endif
+    static_assert(CheckTable(CRC::Standard::CRC_32_MPEG2(), 0x0376E6E7), "CRC_32_MPEG2 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_32_MPEG2(), 0x0376E6E7), "CRC_32_MPEG2 slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_32_POSIX(), 0x765E7680), "CRC_32_POSIX check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_32_POSIX(), 0x765E7680), "CRC_32_POSIX slice-by-8 check value");
+#ifdef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+    static_assert(CheckTable(CRC::Standard::CRC_32_Q(), 0x3010BF7F), "CRC_32_Q check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_32_Q(), 0x3010BF7F), "CRC_32_Q slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_40_GSM(), 0xD4164FC646), "CRC_40_GSM check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_40_GSM(), 0xD4164FC646), "CRC_40_GSM slice-by-8 check value");
+    static_assert(CheckTable(CRC::Standard::CRC_64(), 0x6C40DF5F0B497347), "CRC_64 check value");
+    static_assert(CheckSlicing(CRC::Standard::CRC_64(), 0x6C40DF5F0B497347), "CRC_64 slice-by-8 check value");
+#endif
+}
+#ifdef CRCPP_USE_NAMESPACE
+}
+#endif
+#endif // CRCPP_CONSTEXPR_TABLES && !CRCPP_NO_COMPILE_TIME_TESTS
+
 #if defined(WIN32) || defined(_WIN32) || defined(WINCE)
 #pragma warning(pop)
 #endif
@@ -0,0 +1,303 @@
+/*
+	Packet capture
+	  + mirrors every datagram a socket sends or receives into a standard pcap file that Wireshark and tcpdump read
+	  + each datagram gets synthetic IPv4 and UDP headers built from the socket's port and the peer's address, with
+	    nanosecond timestamps, so filters such as "udp.port == 30000" work as on a real capture
+	  + the socket thread only appends the record to a buffer under a short lock; a writer thread swaps the buffer
+	    out and writes it, so capture costs a copy per datagram rather than a file write
+	  + ReliableUDP.lua is a Wireshark dissector for the protocol id and reliability header
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "Net.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#endif
+
+namespace net
+{
+	// pcap file layout: a 24 byte global header, then per datagram a 16 byte record header followed by the packet
+	//  + the nanosecond magic, so record timestamps are seconds and nanoseconds
+	//  + link type raw IPv4, so each packet is an IPv4 header, a UDP header and the datagram
+
+	const uint32_t PcapMagicNanoseconds = 0xA1B23C4D;
+	const uint32_t PcapLinkTypeRaw = 101;
+	const int PcapIpHeaderSize = 20;
+	const int PcapUdpHeaderSize = 8;
+
+	class PcapWriter : public PacketCapture
+	{
+	public:
+
+		static const size_t MaxBuffered = 64 * 1024 * 1024;	// bytes the socket threads can get ahead of the writer
+		static const size_t InitialBuffer = 4 * 1024 * 1024;	// the two buffers swap, so each keeps the capacity it grows to
+
+		PcapWriter() : file(NULL), running(false), stopping(false), captured(0), dropped(0), ipId(0), wallStart(0), steadyStart(0)
+		{
+		}
+
+		~PcapWriter()
+		{
+			Stop();
+		}
+
+		bool Start(const std::string& path)
+		{
+			assert(file == NULL);
+			file = fopen(path.c_str(), "wb");
+			if (file == NULL)
+				return false;
+
+			unsigned char header[24];
+			WriteLittle32(header, PcapMagicNanoseconds);
+			WriteLittle16(header + 4, 2);		// version 2.4
+			WriteLittle16(header + 6, 4);
+			WriteLittle32(header + 8, 0);		// timestamps are UTC
+			WriteLittle32(header + 12, 0);
+			WriteLittle32(header + 16, 65535);	// snapshot length, datagrams are never cut
+			WriteLittle32(header + 20, PcapLinkTypeRaw);
+			fwrite(header, 1, sizeof(header), file);
+
+			// pcap wants wall clock time, so stamp with the monotonic clock and offset it once
+			wallStart = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			steadyStart = GetTimeNs();
+
+			pending.reserve(InitialBuffer);
+			writing.reserve(InitialBuffer);
+
+			stopping = false;
+			writer = std::thread(&PcapWriter::WriterThread, this);
+			running = true;
+			return true;
+		}
+
+		// write out everything captured so far and close the file
+		void Stop()
+		{
+			running = false;
+			stopping = true;
+			if (writer.joinable())
+				writer.join();
+			if (file)
+			{
+				Drain();
+				fclose(file);
+				file = NULL;
+			}
+		}
+
+		bool IsRunning() const
+		{
+			return running;
+		}
+
+		void Capture(bool outgoing, const Address& peer, unsigned short localPort, const void* header, int headerSize, const void* data, int size)
+		{
+			if (!running)
+				return;
+
+			const int datagramSize = headerSize + size;
+			const int packetSize = PcapIpHeaderSize + PcapUdpHeaderSize + datagramSize;
+			if (packetSize > 65535)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (pending.size() + 16 + packetSize > MaxBuffered)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			// stamped under the lock, so records from different threads stay in time order
+			const uint64_t time = wallStart + (GetTimeNs() - steadyStart);
+			const unsigned int peerAddress = peer.GetAddress();
+			const unsigned int localAddress = GetLocalAddress(peerAddress);
+
+			const size_t offset = pending.size();
+			pending.resize(offset + 16 + packetSize);
+			unsigned char* record = &pending[offset];
+
+			WriteLittle32(record, (uint32_t)(time / 1000000000));
+			WriteLittle32(record + 4, (uint32_t)(time % 1000000000));
+			WriteLittle32(record + 8, (uint32_t)packetSize);
+			WriteLittle32(record + 12, (uint32_t)packetSize);
+
+			unsigned char* ip = record + 16;
+			ip[0] = 0x45;					// version 4, 20 byte header
+			ip[1] = 0;
+			WriteBig16(ip + 2, (uint16_t)packetSize);
+			WriteBig16(ip + 4, ipId++);
+			WriteBig16(ip + 6, 0x4000);		// don't fragment
+			ip[8] = 64;						// ttl
+			ip[9] = 17;						// udp
+			WriteBig16(ip + 10, 0);
+			WriteBig32(ip + 12, outgoing ? localAddress : peerAddress);
+			WriteBig32(ip + 16, outgoing ? peerAddress : localAddress);
+			WriteBig16(ip + 10, IpChecksum(ip));
+
+			unsigned char* udp = ip + PcapIpHeaderSize;
+			WriteBig16(udp, outgoing ? localPort : peer.GetPort());
+			WriteBig16(udp + 2, outgoing ? peer.GetPort() : localPort);
+			WriteBig16(udp + 4, (uint16_t)(PcapUdpHeaderSize + datagramSize));
+			WriteBig16(udp + 6, 0);			// no checksum, which IPv4 allows
+
+			unsigned char* payload = udp + PcapUdpHeaderSize;
+			if (headerSize > 0)
+				memcpy(payload, header, headerSize);
+			if (size > 0)
+			{
+				memcpy(payload + headerSize, data, size);
+				CountPayloadCopy((size_t)size);
+			}
+
+			captured.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// datagrams written (or waiting to be)
+		uint64_t GetCapturedPackets() const
+		{
+			return captured.load(std::memory_order_relaxed);
+		}
+
+		// datagrams left out because the writer fell too far behind
+		uint64_t GetDroppedPackets() const
+		{
+			return dropped.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		static void WriteLittle16(unsigned char* p, uint16_t value)
+		{
+			p[0] = (unsigned char)value;
+			p[1] = (unsigned char)(value >> 8);
+		}
+
+		static void WriteLittle32(unsigned char* p, uint32_t value)
+		{
+			for (int i = 0; i < 4; ++i)
+				p[i] = (unsigned char)(value >> (i * 8));
+		}
+
+		static void WriteBig16(unsigned char* p, uint16_t value)
+		{
+			p[0] = (unsigned char)(value >> 8);
+			p[1] = (unsigned char)value;
+		}
+
+		static void WriteBig32(unsigned char* p, uint32_t value)
+		{
+			for (int i = 0; i < 4; ++i)
+				p[i] = (unsigned char)(value >> ((3 - i) * 8));
+		}
+
+		static uint16_t IpChecksum(const unsigned char* header)
+		{
+			uint32_t sum = 0;
+			for (int i = 0; i < PcapIpHeaderSize; i += 2)
+				sum += ((uint32_t)header[i] << 8) | header[i + 1];
+			while (sum >> 16)
+				sum = (sum & 0xFFFF) + (sum >> 16);
+			return (uint16_t)~sum;
+		}
+
+		// the address this host sends to peer from, found once per peer by connecting a spare udp socket to it
+		// (a socket bound to INADDR_ANY has no address of its own)
+		unsigned int GetLocalAddress(unsigned int peerAddress)
+		{
+			std::map<unsigned int, unsigned int>::const_iterator found = localAddresses.find(peerAddress);
+			if (found != localAddresses.end())
+				return found->second;
+
+			unsigned int local = 0;
+			const int probe = (int)::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			if (probe > 0)
+			{
+				sockaddr_in address;
+				memset(&address, 0, sizeof(address));
+				address.sin_family = AF_INET;
+				address.sin_addr.s_addr = htonl(peerAddress);
+				address.sin_port = htons(9);
+#if PLATFORM == PLATFORM_WINDOWS
+				typedef int socklen_t;
+#endif
+				sockaddr_in bound;
+				socklen_t boundLength = sizeof(bound);
+				if (::connect(probe, (const sockaddr*)&address, sizeof(address)) == 0 &&
+					getsockname(probe, (sockaddr*)&bound, &boundLength) == 0)
+					local = ntohl(bound.sin_addr.s_addr);
+#if PLATFORM == PLATFORM_WINDOWS
+				closesocket(probe);
+#else
+				close(probe);
+#endif
+			}
+			localAddresses[peerAddress] = local;
+			return local;
+		}
+
+		void WriterThread()
+		{
+			while (!stopping)
+			{
+				if (Drain() == 0)
+					wait(0.01f);
+			}
+		}
+
+		size_t Drain()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				writing.swap(pending);
+			}
+			const size_t bytes = writing.size();
+			if (bytes > 0)
+			{
+				fwrite(&writing[0], 1, bytes, file);
+				// the server usually ends by being killed, so keep the file current rather than relying on Stop
+				fflush(file);
+				writing.clear();
+			}
+			return bytes;
+		}
+
+		FILE* file;
+		std::atomic<bool> running;
+		std::thread writer;
+		std::atomic<bool> stopping;
+		std::atomic<uint64_t> captured;
+		std::atomic<uint64_t> dropped;
+		uint16_t ipId;
+		uint64_t wallStart;
+		uint64_t steadyStart;
+		std::mutex mutex;
+		std::vector<unsigned char> pending;		// records captured since the writer last swapped
+		std::vector<unsigned char> writing;		// records the writer is putting in the file
+		std::map<unsigned int, unsigned int> localAddresses;
+	};
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
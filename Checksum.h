@@ -0,0 +1,852 @@
+/*
+	Pluggable checksum engines for whole-file integrity checks
+	  + every CRC parameter set shipped in CRC.h, selectable by name or id
+	  + fast non-CRC 64/128-bit hashes in the style of xxHash3, with SSE2/AVX2 kernels
+	  + the numeric id is what travels in the metadata message, so both peers agree on the algorithm
+*/
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#if defined(CRCPP_CRC_H_) && !defined(CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS)
+#error "include Checksum.h before CRC.h so that every CRC parameter set is available"
+#endif
+
+#ifndef CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+#define CRCPP_INCLUDE_ESOTERIC_CRC_DEFINITIONS
+#endif
+
+#include "CRC.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CHECKSUM_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace net
+{
+	// checksum engine interface
+	//  + engines are streaming: Reset, then any number of Update calls, then GetDigest
+	//  + digests are lowercase hex so they can be carried in the text metadata message
+
+	class ChecksumEngine
+	{
+	public:
+
+		virtual ~ChecksumEngine() {}
+
+		virtual void Reset() = 0;
+
+		virtual void Update(const void* data, size_t size) = 0;
+
+		virtual std::string GetDigest() const = 0;
+
+		// hash length zero bytes, such as a hole in a sparse file; engines with a shortcut override this
+		virtual void UpdateZeros(uint64_t length)
+		{
+			static const std::vector<unsigned char> zeros(64 * 1024, 0);
+			while (length > 0)
+			{
+				const size_t size = length < zeros.size() ? (size_t)length : zeros.size();
+				Update(zeros.data(), size);
+				length -= size;
+			}
+		}
+
+		// engines whose digests can be merged (the CRCs) let a file be hashed in independent blocks
+
+		virtual bool CanCombine() const
+		{
+			return false;
+		}
+
+		// fold in an engine that hashed the next `length` bytes on its own; result equals one pass over both
+		virtual void Combine(const ChecksumEngine& /*next*/, uint64_t /*length*/)
+		{
+			assert(false);
+		}
+	};
+
+	inline std::string ChecksumToHex(uint64_t value, int digits)
+	{
+		static const char hex[] = "0123456789abcdef";
+		std::string result(digits, '0');
+		for (int i = digits - 1; i >= 0; --i)
+		{
+			result[i] = hex[value & 0xF];
+			value >>= 4;
+		}
+		return result;
+	}
+
+	// crc engine built on the CRC.h lookup tables
+	//  + tables are constexpr where the compiler allows it, so they live in read-only data and cost nothing at start-up
+	//  + CRCs of at least 8 bits use slice-by-8 tables, narrower ones the byte-wise table
+
+	template <typename CRCType, crcpp_uint16 CRCWidth, bool Sliced = (CRCWidth >= CHAR_BIT)>
+	struct CrcTable
+	{
+		typedef CRC::SlicingTable<CRCType, CRCWidth, 8> Type;
+	};
+
+	template <typename CRCType, crcpp_uint16 CRCWidth>
+	struct CrcTable<CRCType, CRCWidth, false>
+	{
+		typedef CRC::Table<CRCType, CRCWidth> Type;
+	};
+
+	template <typename CRCType, crcpp_uint16 CRCWidth, CRC::Parameters<CRCType, CRCWidth> (*GetParameters)()>
+	class CrcChecksum : public ChecksumEngine
+	{
+	public:
+
+		typedef typename CrcTable<CRCType, CRCWidth>::Type TableType;
+
+		CrcChecksum()
+		{
+			Reset();
+		}
+
+		void Reset()
+		{
+			crc = CRC::Calculate(NULL, 0, GetTable());
+		}
+
+		void Update(const void* data, size_t size)
+		{
+			crc = CRC::Calculate(data, size, GetTable(), crc);
+		}
+
+		// zero blocks are combined in by doubling, so a hole of gigabytes costs a few dozen combines instead of a pass
+		void UpdateZeros(uint64_t length)
+		{
+			CRCType block = GetZeroBlock();
+			uint64_t blockLength = ZeroBlockSize;
+			uint64_t blocks = length / ZeroBlockSize;
+			while (blocks != 0)
+			{
+				if (blocks & 1)
+					crc = CRC::Combine(crc, block, blockLength, GetTable().GetParameters());
+				blocks >>= 1;
+				if (blocks != 0)
+				{
+					block = CRC::Combine(block, block, blockLength, GetTable().GetParameters());
+					blockLength *= 2;
+				}
+			}
+			static const unsigned char zeros[ZeroBlockSize] = {};
+			Update(zeros, (size_t)(length % ZeroBlockSize));
+		}
+
+		std::string GetDigest() const
+		{
+			return ChecksumToHex((uint64_t)crc, (CRCWidth + 3) / 4);
+		}
+
+		bool CanCombine() const
+		{
+			return true;
+		}
+
+		void Combine(const ChecksumEngine& next, uint64_t length)
+		{
+			crc = CRC::Combine(crc, static_cast<const CrcChecksum&>(next).crc, length, GetTable().GetParameters());
+		}
+
+		static const TableType& GetTable()
+		{
+			static crcpp_constexpr_table TableType table(GetParameters());
+			return table;
+		}
+
+		// crc of ZeroBlockSize zero bytes, the unit UpdateZeros doubles up from
+		static CRCType GetZeroBlock()
+		{
+			static const unsigned char zeros[ZeroBlockSize] = {};
+			static const CRCType block = CRC::Calculate(zeros, ZeroBlockSize, GetTable());
+			return block;
+		}
+
+	private:
+
+		static const int ZeroBlockSize = 4096;
+
+		CRCType crc;							// running (finalized) crc
+	};
+
+	// xxHash3-style hash
+	//  + 8 x 64-bit accumulators fed 64-byte stripes, scrambled every 16 stripes (one 1 KiB block)
+	//  + the accumulate/scramble kernels map directly onto SSE2/AVX2 so throughput is memory bound
+	//  + not bit-compatible with the reference XXH3; the digest is only meaningful between two copies of this code
+
+	namespace xx3
+	{
+		const int StripeSize = 64;
+		const int StripesPerBlock = 16;
+		const int BlockSize = StripeSize * StripesPerBlock;
+		const int SecretSize = StripeSize + StripesPerBlock * 8 + 64;
+
+		const uint64_t Prime32_1 = 0x9E3779B1U;
+		const uint64_t Prime64_1 = 0x9E3779B185EBCA87ULL;
+		const uint64_t Prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+		const uint64_t Prime64_3 = 0x165667B19E3779F9ULL;
+		const uint64_t Prime64_4 = 0x85EBCA77C2B2AE63ULL;
+		const uint64_t Prime64_5 = 0x27D4EB2F165667C5ULL;
+
+		inline uint64_t Read64(const unsigned char* p)
+		{
+			uint64_t value;
+			memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		inline const unsigned char* GetSecret()
+		{
+			// secret is derived once from a splitmix64 sequence rather than pasted in as a table
+			struct Secret
+			{
+				unsigned char bytes[SecretSize];
+				Secret()
+				{
+					uint64_t state = Prime64_3;
+					for (int i = 0; i < SecretSize; i += 8)
+					{
+						uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+						z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+						z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+						z ^= z >> 31;
+						memcpy(bytes + i, &z, 8);
+					}
+				}
+			};
+			static const Secret secret;
+			return secret.bytes;
+		}
+
+		inline uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs)
+		{
+#if defined(__SIZEOF_INT128__)
+			unsigned __int128 product = (unsigned __int128)lhs * rhs;
+			return (uint64_t)product ^ (uint64_t)(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			uint64_t high;
+			uint64_t low = _umul128(lhs, rhs, &high);
+			return low ^ high;
+#else
+			uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+			uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+			uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+			uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+			uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+			uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+			uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+			return lower ^ upper;
+#endif
+		}
+
+		inline uint64_t Avalanche(uint64_t h)
+		{
+			h ^= h >> 37;
+			h *= 0x165667919E3779F9ULL;
+			h ^= h >> 32;
+			return h;
+		}
+
+		// kernels: accumulate one 64-byte stripe, scramble all accumulators
+
+		inline void AccumulateScalar(uint64_t* acc, const unsigned char* input, const unsigned char* secret)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				uint64_t data = Read64(input + i * 8);
+				uint64_t key = data ^ Read64(secret + i * 8);
+				acc[i ^ 1] += data;
+				acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+			}
+		}
+
+		inline void ScrambleScalar(uint64_t* acc, const unsigned char* secret)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				uint64_t a = acc[i];
+				a ^= a >> 47;
+				a ^= Read64(secret + i * 8);
+				acc[i] = a * Prime32_1;
+			}
+		}
+
+#ifdef CHECKSUM_X86
+
+		inline void AccumulateSSE2(uint64_t* acc, const unsigned char* input, const unsigned char* secret)
+		{
+			__m128i* xacc = (__m128i*)acc;
+			for (int i = 0; i < 4; ++i)
+			{
+				__m128i data = _mm_loadu_si128((const __m128i*)input + i);
+				__m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)secret + i));
+				__m128i key_hi = _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1));
+				__m128i product = _mm_mul_epu32(key, key_hi);
+				__m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+				__m128i a = _mm_loadu_si128(xacc + i);
+				_mm_storeu_si128(xacc + i, _mm_add_epi64(_mm_add_epi64(a, swapped), product));
+			}
+		}
+
+		inline void ScrambleSSE2(uint64_t* acc, const unsigned char* secret)
+		{
+			__m128i* xacc = (__m128i*)acc;
+			const __m128i prime = _mm_set1_epi32((int)Prime32_1);
+			for (int i = 0; i < 4; ++i)
+			{
+				__m128i a = _mm_loadu_si128(xacc + i);
+				a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+				a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*)secret + i));
+				__m128i a_hi = _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+				__m128i product_lo = _mm_mul_epu32(a, prime);
+				__m128i product_hi = _mm_mul_epu32(a_hi, prime);
+				_mm_storeu_si128(xacc + i, _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32)));
+			}
+		}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CHECKSUM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CHECKSUM_TARGET_AVX2
+#endif
+
+		CHECKSUM_TARGET_AVX2 inline void AccumulateAVX2(uint64_t* acc, const unsigned char* input, const unsigned char* secret)
+		{
+			__m256i* xacc = (__m256i*)acc;
+			for (int i = 0; i < 2; ++i)
+			{
+				__m256i data = _mm256_loadu_si256((const __m256i*)input + i);
+				__m256i key = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)secret + i));
+				__m256i key_hi = _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1));
+				__m256i product = _mm256_mul_epu32(key, key_hi);
+				__m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+				__m256i a = _mm256_loadu_si256(xacc + i);
+				_mm256_storeu_si256(xacc + i, _mm256_add_epi64(_mm256_add_epi64(a, swapped), product));
+			}
+		}
+
+		CHECKSUM_TARGET_AVX2 inline void ScrambleAVX2(uint64_t* acc, const unsigned char* secret)
+		{
+			__m256i* xacc = (__m256i*)acc;
+			const __m256i prime = _mm256_set1_epi32((int)Prime32_1);
+			for (int i = 0; i < 2; ++i)
+			{
+				__m256i a = _mm256_loadu_si256(xacc + i);
+				a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+				a = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i*)secret + i));
+				__m256i a_hi = _mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+				__m256i product_lo = _mm256_mul_epu32(a, prime);
+				__m256i product_hi = _mm256_mul_epu32(a_hi, prime);
+				_mm256_storeu_si256(xacc + i, _mm256_add_epi64(product_lo, _mm256_slli_epi64(product_hi, 32)));
+			}
+		}
+
+		CHECKSUM_TARGET_AVX2 inline void ConsumeBlocksAVX2(uint64_t* acc, const unsigned char* input, size_t blocks, const unsigned char* secret)
+		{
+			for (size_t b = 0; b < blocks; ++b, input += BlockSize)
+			{
+				for (int s = 0; s < StripesPerBlock; ++s)
+					AccumulateAVX2(acc, input + s * StripeSize, secret + s * 8);
+				ScrambleAVX2(acc, secret + SecretSize - StripeSize);
+			}
+		}
+
+		inline bool CpuHasAVX2()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+
+#endif // CHECKSUM_X86
+
+		inline void ConsumeBlocksScalar(uint64_t* acc, const unsigned char* input, size_t blocks, const unsigned char* secret)
+		{
+			for (size_t b = 0; b < blocks; ++b, input += BlockSize)
+			{
+				for (int s = 0; s < StripesPerBlock; ++s)
+				{
+#ifdef CHECKSUM_X86
+					AccumulateSSE2(acc, input + s * StripeSize, secret + s * 8);
+#else
+					AccumulateScalar(acc, input + s * StripeSize, secret + s * 8);
+#endif
+				}
+#ifdef CHECKSUM_X86
+				ScrambleSSE2(acc, secret + SecretSize - StripeSize);
+#else
+				ScrambleScalar(acc, secret + SecretSize - StripeSize);
+#endif
+			}
+		}
+
+		// whole blocks go through the widest kernel the cpu supports; all kernels produce identical results
+
+		inline void ConsumeBlocks(uint64_t* acc, const unsigned char* input, size_t blocks)
+		{
+			const unsigned char* secret = GetSecret();
+#ifdef CHECKSUM_X86
+			static const bool avx2 = CpuHasAVX2();
+			if (avx2)
+			{
+				ConsumeBlocksAVX2(acc, input, blocks, secret);
+				return;
+			}
+#endif
+			ConsumeBlocksScalar(acc, input, blocks, secret);
+		}
+
+		inline uint64_t MergeAccumulators(const uint64_t* acc, const unsigned char* secret, uint64_t start)
+		{
+			uint64_t result = start;
+			for (int i = 0; i < 4; ++i)
+				result += Mul128Fold64(acc[2 * i] ^ Read64(secret + 16 * i), acc[2 * i + 1] ^ Read64(secret + 16 * i + 8));
+			return Avalanche(result);
+		}
+
+		// streaming state shared by the 64 and 128 bit variants
+
+		class State
+		{
+		public:
+
+			State()
+			{
+				Reset();
+			}
+
+			void Reset()
+			{
+				acc[0] = Prime32_1;
+				acc[1] = Prime64_1;
+				acc[2] = Prime64_2;
+				acc[3] = Prime64_3;
+				acc[4] = Prime64_4;
+				acc[5] = Prime32_1 ^ Prime64_5;
+				acc[6] = Prime64_5;
+				acc[7] = Prime64_1 ^ Prime64_2;
+				total_length = 0;
+				buffered = 0;
+			}
+
+			void Update(const void* data, size_t size)
+			{
+				const unsigned char* input = (const unsigned char*)data;
+				total_length += size;
+
+				if (buffered > 0)
+				{
+					size_t fill = BlockSize - buffered;
+					if (fill > size)
+						fill = size;
+					memcpy(buffer + buffered, input, fill);
+					buffered += fill;
+					input += fill;
+					size -= fill;
+					if (buffered < (size_t)BlockSize)
+						return;
+					ConsumeBlocks(acc, buffer, 1);
+					buffered = 0;
+				}
+
+				size_t blocks = size / BlockSize;
+				if (blocks > 0)
+				{
+					ConsumeBlocks(acc, input, blocks);
+					input += blocks * BlockSize;
+					size -= blocks * BlockSize;
+				}
+
+				memcpy(buffer, input, size);
+				buffered = size;
+			}
+
+			// finish a copy of the accumulators so the running state stays usable
+
+			void Finish(uint64_t* out) const
+			{
+				const unsigned char* secret = GetSecret();
+				memcpy(out, acc, sizeof(acc));
+
+				size_t stripes = buffered / StripeSize;
+				for (size_t s = 0; s < stripes; ++s)
+					AccumulateScalar(out, buffer + s * StripeSize, secret + s * 8);
+
+				size_t tail = buffered - stripes * StripeSize;
+				if (tail > 0)
+				{
+					unsigned char last[StripeSize];
+					memset(last, 0, sizeof(last));
+					memcpy(last, buffer + stripes * StripeSize, tail);
+					AccumulateScalar(out, last, secret + stripes * 8);
+				}
+			}
+
+			uint64_t GetTotalLength() const
+			{
+				return total_length;
+			}
+
+		private:
+
+			uint64_t acc[8];					// stripe accumulators
+			uint64_t total_length;				// bytes consumed so far, mixed into the final merge
+			size_t buffered;					// bytes of a partial block waiting in buffer
+			unsigned char buffer[BlockSize];	// partial block carried between Update calls
+		};
+	}
+
+	class XX3Checksum64 : public ChecksumEngine
+	{
+	public:
+
+		void Reset()
+		{
+			state.Reset();
+		}
+
+		void Update(const void* data, size_t size)
+		{
+			state.Update(data, size);
+		}
+
+		std::string GetDigest() const
+		{
+			uint64_t acc[8];
+			state.Finish(acc);
+			uint64_t hash = xx3::MergeAccumulators(acc, xx3::GetSecret() + 11, state.GetTotalLength() * xx3::Prime64_1);
+			return ChecksumToHex(hash, 16);
+		}
+
+	private:
+
+		xx3::State state;
+	};
+
+	class XX3Checksum128 : public ChecksumEngine
+	{
+	public:
+
+		void Reset()
+		{
+			state.Reset();
+		}
+
+		void Update(const void* data, size_t size)
+		{
+			state.Update(data, size);
+		}
+
+		std::string GetDigest() const
+		{
+			uint64_t acc[8];
+			state.Finish(acc);
+			const unsigned char* secret = xx3::GetSecret();
+			uint64_t low = xx3::MergeAccumulators(acc, secret + 11, state.GetTotalLength() * xx3::Prime64_1);
+			uint64_t high = xx3::MergeAccumulators(acc, secret + xx3::SecretSize - 64 - 11, ~(state.GetTotalLength() * xx3::Prime64_2));
+			return ChecksumToHex(high, 16) + ChecksumToHex(low, 16);
+		}
+
+	private:
+
+		xx3::State state;
+	};
+
+	// algorithm registry
+
+	typedef std::unique_ptr<ChecksumEngine> ChecksumEnginePtr;
+
+	struct ChecksumAlgorithm
+	{
+		int id;								// identifier carried in the metadata message
+		const char* name;					// name accepted on the command line
+		ChecksumEnginePtr (*create)();		// engine factory
+	};
+
+	template <typename CRCType, crcpp_uint16 CRCWidth, CRC::Parameters<CRCType, CRCWidth> (*GetParameters)()>
+	ChecksumEnginePtr CreateCrcChecksum()
+	{
+		return ChecksumEnginePtr(new CrcChecksum<CRCType, CRCWidth, GetParameters>());
+	}
+
+	template <typename Engine>
+	ChecksumEnginePtr CreateChecksum()
+	{
+		return ChecksumEnginePtr(new Engine());
+	}
+
+	const int ChecksumIdXX3_64 = 100;
+	const int ChecksumIdXX3_128 = 101;
+
+	inline const ChecksumAlgorithm* GetChecksumAlgorithms(int& count)
+	{
+		static const ChecksumAlgorithm algorithms[] =
+		{
+			{  1, "CRC4-ITU",          &CreateCrcChecksum<crcpp_uint8,  4, &CRC::Standard::CRC_4_ITU> },
+			{  2, "CRC5-EPC",          &CreateCrcChecksum<crcpp_uint8,  5, &CRC::Standard::CRC_5_EPC> },
+			{  3, "CRC5-ITU",          &CreateCrcChecksum<crcpp_uint8,  5, &CRC::Standard::CRC_5_ITU> },
+			{  4, "CRC5-USB",          &CreateCrcChecksum<crcpp_uint8,  5, &CRC::Standard::CRC_5_USB> },
+			{  5, "CRC6-CDMA2000A",    &CreateCrcChecksum<crcpp_uint8,  6, &CRC::Standard::CRC_6_CDMA2000A> },
+			{  6, "CRC6-CDMA2000B",    &CreateCrcChecksum<crcpp_uint8,  6, &CRC::Standard::CRC_6_CDMA2000B> },
+			{  7, "CRC6-ITU",          &CreateCrcChecksum<crcpp_uint8,  6, &CRC::Standard::CRC_6_ITU> },
+			{  8, "CRC6-NR",           &CreateCrcChecksum<crcpp_uint8,  6, &CRC::Standard::CRC_6_NR> },
+			{  9, "CRC7",              &CreateCrcChecksum<crcpp_uint8,  7, &CRC::Standard::CRC_7> },
+			{ 10, "CRC8",              &CreateCrcChecksum<crcpp_uint8,  8, &CRC::Standard::CRC_8> },
+			{ 11, "CRC8-EBU",          &CreateCrcChecksum<crcpp_uint8,  8, &CRC::Standard::CRC_8_EBU> },
+			{ 12, "CRC8-HDLC",         &CreateCrcChecksum<crcpp_uint8,  8, &CRC::Standard::CRC_8_HDLC> },
+			{ 13, "CRC8-MAXIM",        &CreateCrcChecksum<crcpp_uint8,  8, &CRC::Standard::CRC_8_MAXIM> },
+			{ 14, "CRC8-WCDMA",        &CreateCrcChecksum<crcpp_uint8,  8, &CRC::Standard::CRC_8_WCDMA> },
+			{ 15, "CRC8-LTE",          &CreateCrcChecksum<crcpp_uint8,  8, &CRC::Standard::CRC_8_LTE> },
+			{ 16, "CRC10",             &CreateCrcChecksum<crcpp_uint16, 10, &CRC::Standard::CRC_10> },
+			{ 17, "CRC10-CDMA2000",    &CreateCrcChecksum<crcpp_uint16, 10, &CRC::Standard::CRC_10_CDMA2000> },
+			{ 18, "CRC11",             &CreateCrcChecksum<crcpp_uint16, 11, &CRC::Standard::CRC_11> },
+			{ 19, "CRC11-NR",          &CreateCrcChecksum<crcpp_uint16, 11, &CRC::Standard::CRC_11_NR> },
+			{ 20, "CRC12-CDMA2000",    &CreateCrcChecksum<crcpp_uint16, 12, &CRC::Standard::CRC_12_CDMA2000> },
+			{ 21, "CRC12-DECT",        &CreateCrcChecksum<crcpp_uint16, 12, &CRC::Standard::CRC_12_DECT> },
+			{ 22, "CRC12-UMTS",        &CreateCrcChecksum<crcpp_uint16, 12, &CRC::Standard::CRC_12_UMTS> },
+			{ 23, "CRC13-BBC",         &CreateCrcChecksum<crcpp_uint16, 13, &CRC::Standard::CRC_13_BBC> },
+			{ 24, "CRC15",             &CreateCrcChecksum<crcpp_uint16, 15, &CRC::Standard::CRC_15> },
+			{ 25, "CRC15-MPT1327",     &CreateCrcChecksum<crcpp_uint16, 15, &CRC::Standard::CRC_15_MPT1327> },
+			{ 26, "CRC16-ARC",         &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_ARC> },
+			{ 27, "CRC16-BUYPASS",     &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_BUYPASS> },
+			{ 28, "CRC16-CCITTFALSE",  &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_CCITTFALSE> },
+			{ 29, "CRC16-MCRF4XX",     &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_MCRF4XX> },
+			{ 30, "CRC16-CDMA2000",    &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_CDMA2000> },
+			{ 31, "CRC16-CMS",         &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_CMS> },
+			{ 32, "CRC16-DECTR",       &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_DECTR> },
+			{ 33, "CRC16-DECTX",       &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_DECTX> },
+			{ 34, "CRC16-DNP",         &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_DNP> },
+			{ 35, "CRC16-GENIBUS",     &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_GENIBUS> },
+			{ 36, "CRC16-KERMIT",      &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_KERMIT> },
+			{ 37, "CRC16-MAXIM",       &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_MAXIM> },
+			{ 38, "CRC16-MODBUS",      &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_MODBUS> },
+			{ 39, "CRC16-T10DIF",      &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_T10DIF> },
+			{ 40, "CRC16-USB",         &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_USB> },
+			{ 41, "CRC16-X25",         &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_X25> },
+			{ 42, "CRC16-XMODEM",      &CreateCrcChecksum<crcpp_uint16, 16, &CRC::Standard::CRC_16_XMODEM> },
+			{ 43, "CRC17-CAN",         &CreateCrcChecksum<crcpp_uint32, 17, &CRC::Standard::CRC_17_CAN> },
+			{ 44, "CRC21-CAN",         &CreateCrcChecksum<crcpp_uint32, 21, &CRC::Standard::CRC_21_CAN> },
+			{ 45, "CRC24",             &CreateCrcChecksum<crcpp_uint32, 24, &CRC::Standard::CRC_24> },
+			{ 46, "CRC24-FLEXRAYA",    &CreateCrcChecksum<crcpp_uint32, 24, &CRC::Standard::CRC_24_FLEXRAYA> },
+			{ 47, "CRC24-FLEXRAYB",    &CreateCrcChecksum<crcpp_uint32, 24, &CRC::Standard::CRC_24_FLEXRAYB> },
+			{ 48, "CRC24-LTEA",        &CreateCrcChecksum<crcpp_uint32, 24, &CRC::Standard::CRC_24_LTEA> },
+			{ 49, "CRC24-LTEB",        &CreateCrcChecksum<crcpp_uint32, 24, &CRC::Standard::CRC_24_LTEB> },
+			{ 50, "CRC24-NRC",         &CreateCrcChecksum<crcpp_uint32, 24, &CRC::Standard::CRC_24_NRC> },
+			{ 51, "CRC30",             &CreateCrcChecksum<crcpp_uint32, 30, &CRC::Standard::CRC_30> },
+			{ 52, "CRC32",             &CreateCrcChecksum<crcpp_uint32, 32, &CRC::Standard::CRC_32> },
+			{ 53, "CRC32-BZIP2",       &CreateCrcChecksum<crcpp_uint32, 32, &CRC::Standard::CRC_32_BZIP2> },
+			{ 54, "CRC32-C",           &CreateCrcChecksum<crcpp_uint32, 32, &CRC::Standard::CRC_32_C> },
+			{ 55, "CRC32-MPEG2",       &CreateCrcChecksum<crcpp_uint32, 32, &CRC::Standard::CRC_32_MPEG2> },
+			{ 56, "CRC32-POSIX",       &CreateCrcChecksum<crcpp_uint32, 32, &CRC::Standard::CRC_32_POSIX> },
+			{ 57, "CRC32-Q",           &CreateCrcChecksum<crcpp_uint32, 32, &CRC::Standard::CRC_32_Q> },
+			{ 58, "CRC40-GSM",         &CreateCrcChecksum<crcpp_uint64, 40, &CRC::Standard::CRC_40_GSM> },
+			{ 59, "CRC64",             &CreateCrcChecksum<crcpp_uint64, 64, &CRC::Standard::CRC_64> },
+			{ ChecksumIdXX3_64,  "XX3-64",  &CreateChecksum<XX3Checksum64> },
+			{ ChecksumIdXX3_128, "XX3-128", &CreateChecksum<XX3Checksum128> },
+		};
+		count = (int)(sizeof(algorithms) / sizeof(algorithms[0]));
+		return algorithms;
+	}
+
+	inline const ChecksumAlgorithm* FindChecksumAlgorithm(int id)
+	{
+		int count = 0;
+		const ChecksumAlgorithm* algorithms = GetChecksumAlgorithms(count);
+		for (int i = 0; i < count; ++i)
+			if (algorithms[i].id == id)
+				return &algorithms[i];
+		return NULL;
+	}
+
+	inline const ChecksumAlgorithm* FindChecksumAlgorithm(const std::string& name)
+	{
+		// names are matched case-insensitively and "CRC_32_BZIP2" style spellings are accepted too
+		std::string wanted;
+		for (size_t i = 0; i < name.size(); ++i)
+		{
+			char c = name[i] == '_' ? '-' : (char)toupper((unsigned char)name[i]);
+			if (wanted == "CRC" && c == '-')
+				continue;
+			wanted += c;
+		}
+		int count = 0;
+		const ChecksumAlgorithm* algorithms = GetChecksumAlgorithms(count);
+		for (int i = 0; i < count; ++i)
+			if (wanted == algorithms[i].name)
+				return &algorithms[i];
+		return NULL;
+	}
+
+	// parallel whole-file checksum
+	//  + the file is split into large blocks that worker threads hash independently, then merged in order with Combine
+	//  + runs in the background so the caller can start sending while later blocks are still being hashed
+	//  + algorithms that cannot combine are hashed by a single background worker, which still overlaps with sending
+
+	class ParallelChecksum
+	{
+	public:
+
+		ParallelChecksum(const ChecksumAlgorithm& algorithm, int threads, uint64_t blockSize = 64ULL << 20)
+			: algorithm(algorithm), blockSize(blockSize), nextBlock(0), completedBlocks(0), failed(false)
+		{
+			if (threads <= 0)
+				threads = (int)std::thread::hardware_concurrency();
+			if (threads <= 0)
+				threads = 1;
+			this->threads = threads;
+		}
+
+		~ParallelChecksum()
+		{
+			Join();
+		}
+
+		void Start(const std::string& filePath, uint64_t fileSize)
+		{
+			assert(workers.empty());
+			this->filePath = filePath;
+
+			ChecksumEnginePtr probe = algorithm.create();
+			if (!probe->CanCombine())
+				blockSize = fileSize > 0 ? fileSize : 1;
+
+			size_t blocks = (size_t)((fileSize + blockSize - 1) / blockSize);
+			if (blocks == 0)
+				blocks = 1;
+			results.resize(blocks);
+			lengths.resize(blocks, 0);
+
+			int count = threads < (int)blocks ? threads : (int)blocks;
+			for (int i = 0; i < count; ++i)
+				workers.push_back(std::thread(&ParallelChecksum::Worker, this));
+		}
+
+		bool IsDone() const
+		{
+			return completedBlocks.load() == results.size();
+		}
+
+		// blocks until every block is hashed, then merges them; returns an empty string if the file could not be read
+		std::string Wait()
+		{
+			Join();
+			if (failed || results.empty())
+				return std::string();
+			ChecksumEngine& total = *results[0];
+			for (size_t i = 1; i < results.size(); ++i)
+				total.Combine(*results[i], lengths[i]);
+			return total.GetDigest();
+		}
+
+	private:
+
+		void Join()
+		{
+			for (size_t i = 0; i < workers.size(); ++i)
+				workers[i].join();
+			workers.clear();
+		}
+
+		void Worker()
+		{
+			std::ifstream file(filePath.c_str(), std::ios::binary);
+			std::vector<char> buffer(1 << 20);
+
+			while (true)
+			{
+				size_t block = nextBlock++;
+				if (block >= results.size())
+					break;
+
+				ChecksumEnginePtr engine = algorithm.create();
+				uint64_t remaining = blockSize;
+				uint64_t length = 0;
+
+				file.clear();
+				file.seekg((std::streamoff)(block * blockSize), std::ios::beg);
+				if (!file)
+					failed = true;
+
+				// runs of zeros (holes in a sparse file) are hashed in one go, see ChecksumEngine::UpdateZeros
+				uint64_t zeroRun = 0;
+				while (remaining > 0 && file)
+				{
+					size_t want = remaining < buffer.size() ? (size_t)remaining : buffer.size();
+					file.read(buffer.data(), want);
+					std::streamsize bytesRead = file.gcount();
+					if (bytesRead <= 0)
+						break;
+					if (buffer[0] == 0 && memcmp(buffer.data(), buffer.data() + 1, (size_t)bytesRead - 1) == 0)
+					{
+						zeroRun += (uint64_t)bytesRead;
+					}
+					else
+					{
+						if (zeroRun > 0)
+							engine->UpdateZeros(zeroRun);
+						zeroRun = 0;
+						engine->Update(buffer.data(), (size_t)bytesRead);
+					}
+					remaining -= (uint64_t)bytesRead;
+					length += (uint64_t)bytesRead;
+				}
+				if (zeroRun > 0)
+					engine->UpdateZeros(zeroRun);
+
+				results[block] = std::move(engine);
+				lengths[block] = length;
+				completedBlocks++;
+			}
+		}
+
+		const ChecksumAlgorithm& algorithm;
+		std::string filePath;
+		int threads;
+		uint64_t blockSize;							// bytes per independently hashed block
+		std::vector<ChecksumEnginePtr> results;		// per-block engines, merged in order by Wait
+		std::vector<uint64_t> lengths;				// bytes actually hashed per block
+		std::vector<std::thread> workers;
+		std::atomic<size_t> nextBlock;				// next block index to claim
+		std::atomic<size_t> completedBlocks;		// blocks finished so far
+		std::atomic<bool> failed;					// a worker could not seek in the file
+	};
+
+	inline void PrintChecksumAlgorithms()
+	{
+		int count = 0;
+		const ChecksumAlgorithm* algorithms = GetChecksumAlgorithms(count);
+		printf("Available checksum methods:\n");
+		for (int i = 0; i < count; ++i)
+			printf("  %3d  %s\n", algorithms[i].id, algorithms[i].name);
+	}
+}
+
+#endif
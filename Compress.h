@@ -0,0 +1,244 @@
+/*
+	Fast block compression for the data path
+	  + an in-tree codec for the LZ4 block format: a byte token of literal and match lengths, the literals, then a
+	    16-bit little-endian distance back to the match; lengths of 15 or more continue in bytes of 255
+	  + the compressor finds matches through a hash table of 4 byte sequences, one probe a position, and takes longer
+	    strides through data that stops matching, so incompressible input costs little more than a copy
+	  + the decompressor checks every length and distance against both buffers, so a damaged or hostile block fails
+	    rather than reading or writing out of bounds
+	  + whether a block is worth compressing at all is guessed from the byte entropy of a sample of it
+*/
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace net
+{
+	// name of the codec in the metadata message
+	const char* const CompressCodec = "lz4";
+
+	// above this many bits a byte of sampled entropy a block is sent as it is; text and logs sample at 4 to 6,
+	// already compressed data at nearly 8
+	const double CompressEntropyLimit = 7.5;
+
+	// largest output of compressing size bytes
+	inline int CompressBound(int size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	namespace lz
+	{
+		const int MinMatch = 4;
+		const int LastLiterals = 5;		// the format ends every block with at least this many literals
+		const int MatchFindLimit = 12;	// and starts no match closer than this to the end
+		const int MaxDistance = 65535;
+		const int HashBits = 12;
+
+		inline uint32_t Read32(const unsigned char* p)
+		{
+			uint32_t value;
+			memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		inline uint32_t Hash(uint32_t sequence)
+		{
+			return (sequence * 2654435761u) >> (32 - HashBits);
+		}
+
+		// a length past what the token holds, in bytes of 255 and a remainder
+		inline unsigned char* WriteLength(unsigned char* out, int length)
+		{
+			for (; length >= 255; length -= 255)
+				*out++ = 255;
+			*out++ = (unsigned char)length;
+			return out;
+		}
+
+		// one sequence: the literals, then the match unless length is zero (the last sequence); null if out of room
+		inline unsigned char* WriteSequence(unsigned char* out, unsigned char* outEnd, const unsigned char* literals, int literalLength,
+			int distance, int matchLength)
+		{
+			if (outEnd - out < 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1)
+				return nullptr;
+			unsigned char* token = out++;
+			*token = (unsigned char)((literalLength < 15 ? literalLength : 15) << 4);
+			if (literalLength >= 15)
+				out = WriteLength(out, literalLength - 15);
+			if (literalLength > 0)
+				memcpy(out, literals, (size_t)literalLength);
+			out += literalLength;
+			if (matchLength == 0)
+				return out;
+
+			*out++ = (unsigned char)distance;
+			*out++ = (unsigned char)(distance >> 8);
+			const int extra = matchLength - MinMatch;
+			*token |= (unsigned char)(extra < 15 ? extra : 15);
+			if (extra >= 15)
+				out = WriteLength(out, extra - 15);
+			return out;
+		}
+	}
+
+	// compress size bytes into out (capacity bytes), returns the compressed size, or 0 if it does not fit
+	inline int Compress(const unsigned char* data, int size, unsigned char* out, int capacity)
+	{
+		unsigned char* const outStart = out;
+		unsigned char* const outEnd = out + capacity;
+		int anchor = 0;
+
+		if (size > lz::MatchFindLimit)
+		{
+			// positions by hash of the 4 bytes there; a stale or colliding entry is caught by comparing the bytes
+			int table[1 << lz::HashBits];
+			memset(table, 0, sizeof(table));
+			const int matchLimit = size - lz::LastLiterals;
+			const int findLimit = size - lz::MatchFindLimit;
+
+			int position = 1;
+			while (position < findLimit)
+			{
+				const uint32_t sequence = lz::Read32(data + position);
+				const uint32_t hash = lz::Hash(sequence);
+				int match = table[hash];
+				table[hash] = position;
+				if (position - match > lz::MaxDistance || lz::Read32(data + match) != sequence)
+				{
+					// the longer since the last match, the bigger the step
+					position += 1 + ((position - anchor) >> 6);
+					continue;
+				}
+
+				while (position > anchor && match > 0 && data[position - 1] == data[match - 1])
+				{
+					position--;
+					match--;
+				}
+				int length = lz::MinMatch;
+				while (position + length < matchLimit && data[position + length] == data[match + length])
+					length++;
+
+				out = lz::WriteSequence(out, outEnd, data + anchor, position - anchor, position - match, length);
+				if (out == nullptr)
+					return 0;
+				position += length;
+				anchor = position;
+				if (position < findLimit)
+					table[lz::Hash(lz::Read32(data + position - 2))] = position - 2;
+			}
+		}
+
+		out = lz::WriteSequence(out, outEnd, data + anchor, size - anchor, 0, 0);
+		return out != nullptr ? (int)(out - outStart) : 0;
+	}
+
+	// decompress size bytes into out (capacity bytes), returns the decompressed size, or -1 if the block is damaged
+	inline int Decompress(const unsigned char* data, int size, unsigned char* out, int capacity)
+	{
+		int in = 0;
+		int written = 0;
+		while (in < size)
+		{
+			const int token = data[in++];
+			int literalLength = token >> 4;
+			if (literalLength == 15)
+			{
+				int byte;
+				do
+				{
+					if (in >= size || literalLength > capacity)
+						return -1;
+					byte = data[in++];
+					literalLength += byte;
+				}
+				while (byte == 255);
+			}
+			if (literalLength > size - in || literalLength > capacity - written)
+				return -1;
+			if (literalLength > 0)
+				memcpy(out + written, data + in, (size_t)literalLength);
+			in += literalLength;
+			written += literalLength;
+			if (in == size)
+				return written;	// the last sequence has no match
+
+			if (size - in < 2)
+				return -1;
+			const int distance = data[in] | (data[in + 1] << 8);
+			in += 2;
+			if (distance == 0 || distance > written)
+				return -1;
+			int matchLength = token & 15;
+			if (matchLength == 15)
+			{
+				int byte;
+				do
+				{
+					if (in >= size || matchLength > capacity)
+						return -1;
+					byte = data[in++];
+					matchLength += byte;
+				}
+				while (byte == 255);
+			}
+			matchLength += lz::MinMatch;
+			if (matchLength > capacity - written)
+				return -1;
+
+			// a match may overlap the bytes it produces, which repeats them
+			const unsigned char* from = out + written - distance;
+			if (distance >= matchLength)
+			{
+				memcpy(out + written, from, (size_t)matchLength);
+			}
+			else
+			{
+				for (int i = 0; i < matchLength; ++i)
+					out[written + i] = from[i];
+			}
+			written += matchLength;
+		}
+		return -1;	// ended without a last sequence
+	}
+
+	// Shannon entropy in bits a byte of a sample of the block: runs of 32 bytes spread over it, so text still shows
+	// the repeats inside words and records
+	inline double SampleEntropy(const unsigned char* data, int size)
+	{
+		const int Run = 32;
+		const int Runs = 64;
+		uint32_t counts[256];
+		memset(counts, 0, sizeof(counts));
+		int sampled = 0;
+		const int stride = size / Runs > Run ? size / Runs : Run;
+		for (int start = 0; start < size && sampled < Run * Runs; start += stride)
+		{
+			const int end = start + Run < size ? start + Run : size;
+			for (int i = start; i < end; ++i)
+				counts[data[i]]++;
+			sampled += end - start;
+		}
+		if (sampled == 0)
+			return 0.0;
+
+		double entropy = 0.0;
+		for (int i = 0; i < 256; ++i)
+		{
+			if (counts[i] > 0)
+			{
+				const double p = (double)counts[i] / sampled;
+				entropy -= p * log2(p);
+			}
+		}
+		return entropy;
+	}
+}
+
+#endif
@@ -0,0 +1,806 @@
+/*
+	Authenticated encryption of datagrams with a pre-shared key
+	  + XChaCha20-Poly1305: ChaCha20 encrypts, Poly1305 authenticates the ciphertext and the cleartext before it
+	  + every connection start picks a random 64-bit session id, and a subkey for it is derived from the key with
+	    HChaCha20; a packet's nonce is then its 64-bit counter within the session, so no nonce repeats under a key
+	    without a session id repeating too
+	  + the ChaCha20 keystream is made four blocks at a time with an SSE2 kernel (a 256 byte packet in one pass), or
+	    eight with an AVX2 one for longer packets; Poly1305 works in 26-bit limbs, so it needs no 64x64 bit multiplies
+	  + a packet that fails its tag is dropped before anything reads it, and tags are compared in constant time
+	  + a sliding window over the last 64 counters of the session drops a packet seen before, and a connected
+	    receiver takes no other session, so an old session's packets cannot be replayed into it either
+	  + SipHash-2-4 makes the connection handshake's cookies
+*/
+
+#ifndef CRYPTO_H
+#define CRYPTO_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <random>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRYPTO_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace net
+{
+	const int AeadKeySize = 32;
+	const int AeadTagSize = 16;
+	const int AeadNonceSize = 16;	// session id and counter, as they travel
+
+	namespace chacha
+	{
+		inline uint32_t Load32(const unsigned char* p)
+		{
+			return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+
+		inline void Store32(unsigned char* p, uint32_t value)
+		{
+			p[0] = (unsigned char)value;
+			p[1] = (unsigned char)(value >> 8);
+			p[2] = (unsigned char)(value >> 16);
+			p[3] = (unsigned char)(value >> 24);
+		}
+
+		inline uint32_t Rotate(uint32_t value, int bits)
+		{
+			return (value << bits) | (value >> (32 - bits));
+		}
+
+		inline void QuarterRound(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+		{
+			a += b; d = Rotate(d ^ a, 16);
+			c += d; b = Rotate(b ^ c, 12);
+			a += b; d = Rotate(d ^ a, 8);
+			c += d; b = Rotate(b ^ c, 7);
+		}
+
+		// the 20 rounds: a column round then a diagonal round, ten times
+		inline void Rounds(uint32_t x[16])
+		{
+			for (int i = 0; i < 10; ++i)
+			{
+				QuarterRound(x[0], x[4], x[8], x[12]);
+				QuarterRound(x[1], x[5], x[9], x[13]);
+				QuarterRound(x[2], x[6], x[10], x[14]);
+				QuarterRound(x[3], x[7], x[11], x[15]);
+				QuarterRound(x[0], x[5], x[10], x[15]);
+				QuarterRound(x[1], x[6], x[11], x[12]);
+				QuarterRound(x[2], x[7], x[8], x[13]);
+				QuarterRound(x[3], x[4], x[9], x[14]);
+			}
+		}
+
+		// "expand 32-byte k", then the key, then four words of counter and nonce
+		inline void Setup(uint32_t state[16], const unsigned char key[32], const unsigned char input[16])
+		{
+			state[0] = 0x61707865;
+			state[1] = 0x3320646e;
+			state[2] = 0x79622d32;
+			state[3] = 0x6b206574;
+			for (int i = 0; i < 8; ++i)
+				state[4 + i] = Load32(key + i * 4);
+			for (int i = 0; i < 4; ++i)
+				state[12 + i] = Load32(input + i * 4);
+		}
+
+		// one block of keystream; the block counter (state[12]) moves on
+		inline void Block(uint32_t state[16], unsigned char out[64])
+		{
+			uint32_t x[16];
+			memcpy(x, state, sizeof(x));
+			Rounds(x);
+			for (int i = 0; i < 16; ++i)
+				Store32(out + i * 4, x[i] + state[i]);
+			state[12]++;
+		}
+
+		// subkey for a 16 byte nonce: the rounds without the final addition, first and last rows out
+		inline void HChaCha20(const unsigned char key[32], const unsigned char nonce[16], unsigned char subkey[32])
+		{
+			uint32_t x[16];
+			Setup(x, key, nonce);
+			Rounds(x);
+			for (int i = 0; i < 4; ++i)
+			{
+				Store32(subkey + i * 4, x[i]);
+				Store32(subkey + 16 + i * 4, x[12 + i]);
+			}
+		}
+
+#ifdef CRYPTO_X86
+
+		template <int Bits>
+		inline __m128i Rotate128(__m128i value)
+		{
+			return _mm_or_si128(_mm_slli_epi32(value, Bits), _mm_srli_epi32(value, 32 - Bits));
+		}
+
+		inline void QuarterRound128(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+		{
+			a = _mm_add_epi32(a, b); d = Rotate128<16>(_mm_xor_si128(d, a));
+			c = _mm_add_epi32(c, d); b = Rotate128<12>(_mm_xor_si128(b, c));
+			a = _mm_add_epi32(a, b); d = Rotate128<8>(_mm_xor_si128(d, a));
+			c = _mm_add_epi32(c, d); b = Rotate128<7>(_mm_xor_si128(b, c));
+		}
+
+		// four blocks at once, a lane per block, xored over 256 bytes of in; the block counter moves on by four
+		inline void Xor4SSE2(uint32_t state[16], const unsigned char* in, unsigned char* out)
+		{
+			__m128i start[16];
+			__m128i x[16];
+			for (int i = 0; i < 16; ++i)
+				start[i] = _mm_set1_epi32((int)state[i]);
+			start[12] = _mm_add_epi32(start[12], _mm_setr_epi32(0, 1, 2, 3));
+			for (int i = 0; i < 16; ++i)
+				x[i] = start[i];
+
+			for (int i = 0; i < 10; ++i)
+			{
+				QuarterRound128(x[0], x[4], x[8], x[12]);
+				QuarterRound128(x[1], x[5], x[9], x[13]);
+				QuarterRound128(x[2], x[6], x[10], x[14]);
+				QuarterRound128(x[3], x[7], x[11], x[15]);
+				QuarterRound128(x[0], x[5], x[10], x[15]);
+				QuarterRound128(x[1], x[6], x[11], x[12]);
+				QuarterRound128(x[2], x[7], x[8], x[13]);
+				QuarterRound128(x[3], x[4], x[9], x[14]);
+			}
+
+			// transpose each group of four words from a lane per block to a block per row
+			for (int j = 0; j < 16; j += 4)
+			{
+				const __m128i a = _mm_add_epi32(x[j], start[j]);
+				const __m128i b = _mm_add_epi32(x[j + 1], start[j + 1]);
+				const __m128i c = _mm_add_epi32(x[j + 2], start[j + 2]);
+				const __m128i d = _mm_add_epi32(x[j + 3], start[j + 3]);
+				const __m128i ab0 = _mm_unpacklo_epi32(a, b);
+				const __m128i cd0 = _mm_unpacklo_epi32(c, d);
+				const __m128i ab1 = _mm_unpackhi_epi32(a, b);
+				const __m128i cd1 = _mm_unpackhi_epi32(c, d);
+				const __m128i rows[4] = { _mm_unpacklo_epi64(ab0, cd0), _mm_unpackhi_epi64(ab0, cd0), _mm_unpacklo_epi64(ab1, cd1), _mm_unpackhi_epi64(ab1, cd1) };
+				for (int block = 0; block < 4; ++block)
+				{
+					const size_t at = (size_t)block * 64 + (size_t)j * 4;
+					const __m128i bytes = _mm_loadu_si128((const __m128i*)(in + at));
+					_mm_storeu_si128((__m128i*)(out + at), _mm_xor_si128(bytes, rows[block]));
+				}
+			}
+			state[12] += 4;
+		}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CRYPTO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CRYPTO_TARGET_AVX2
+#endif
+
+		template <int Bits>
+		CRYPTO_TARGET_AVX2 inline __m256i Rotate256(__m256i value)
+		{
+			return _mm256_or_si256(_mm256_slli_epi32(value, Bits), _mm256_srli_epi32(value, 32 - Bits));
+		}
+
+		// rotations by whole bytes are a byte shuffle within each lane
+		CRYPTO_TARGET_AVX2 inline void QuarterRound256(__m256i& a, __m256i& b, __m256i& c, __m256i& d, const __m256i& rotate16, const __m256i& rotate8)
+		{
+			a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate16);
+			c = _mm256_add_epi32(c, d); b = Rotate256<12>(_mm256_xor_si256(b, c));
+			a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate8);
+			c = _mm256_add_epi32(c, d); b = Rotate256<7>(_mm256_xor_si256(b, c));
+		}
+
+		// eight blocks at once over 512 bytes of in, as Xor4SSE2
+		CRYPTO_TARGET_AVX2 inline void Xor8AVX2(uint32_t state[16], const unsigned char* in, unsigned char* out)
+		{
+			const __m256i rotate16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+				2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+			const __m256i rotate8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+				3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+			__m256i start[16];
+			__m256i x[16];
+			for (int i = 0; i < 16; ++i)
+				start[i] = _mm256_set1_epi32((int)state[i]);
+			start[12] = _mm256_add_epi32(start[12], _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			for (int i = 0; i < 16; ++i)
+				x[i] = start[i];
+
+			for (int i = 0; i < 10; ++i)
+			{
+				QuarterRound256(x[0], x[4], x[8], x[12], rotate16, rotate8);
+				QuarterRound256(x[1], x[5], x[9], x[13], rotate16, rotate8);
+				QuarterRound256(x[2], x[6], x[10], x[14], rotate16, rotate8);
+				QuarterRound256(x[3], x[7], x[11], x[15], rotate16, rotate8);
+				QuarterRound256(x[0], x[5], x[10], x[15], rotate16, rotate8);
+				QuarterRound256(x[1], x[6], x[11], x[12], rotate16, rotate8);
+				QuarterRound256(x[2], x[7], x[8], x[13], rotate16, rotate8);
+				QuarterRound256(x[3], x[4], x[9], x[14], rotate16, rotate8);
+			}
+
+			// as the SSE2 transpose, within each 128-bit half: the low halves hold blocks 0 to 3, the high ones 4 to 7
+			for (int j = 0; j < 16; j += 4)
+			{
+				const __m256i a = _mm256_add_epi32(x[j], start[j]);
+				const __m256i b = _mm256_add_epi32(x[j + 1], start[j + 1]);
+				const __m256i c = _mm256_add_epi32(x[j + 2], start[j + 2]);
+				const __m256i d = _mm256_add_epi32(x[j + 3], start[j + 3]);
+				const __m256i ab0 = _mm256_unpacklo_epi32(a, b);
+				const __m256i cd0 = _mm256_unpacklo_epi32(c, d);
+				const __m256i ab1 = _mm256_unpackhi_epi32(a, b);
+				const __m256i cd1 = _mm256_unpackhi_epi32(c, d);
+				const __m256i rows[4] = { _mm256_unpacklo_epi64(ab0, cd0), _mm256_unpackhi_epi64(ab0, cd0), _mm256_unpacklo_epi64(ab1, cd1), _mm256_unpackhi_epi64(ab1, cd1) };
+				for (int block = 0; block < 4; ++block)
+				{
+					const size_t low = (size_t)block * 64 + (size_t)j * 4;
+					const size_t high = low + 256;
+					const __m128i lowBytes = _mm_loadu_si128((const __m128i*)(in + low));
+					const __m128i highBytes = _mm_loadu_si128((const __m128i*)(in + high));
+					_mm_storeu_si128((__m128i*)(out + low), _mm_xor_si128(lowBytes, _mm256_castsi256_si128(rows[block])));
+					_mm_storeu_si128((__m128i*)(out + high), _mm_xor_si128(highBytes, _mm256_extracti128_si256(rows[block], 1)));
+				}
+			}
+			state[12] += 8;
+		}
+
+		inline bool CpuHasAVX2()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+
+#endif // CRYPTO_X86
+
+		// keystream xored over a message that may come in several pieces (in and out may be the same)
+		//  + keystream is made ahead into a buffer, four blocks at a time whenever more than one is wanted (eight past
+		//    four), so the SIMD kernels cover a packet even though its header and payload arrive as separate pieces
+		//  + a long run with nothing buffered is xored by the kernels straight from in to out
+
+		class Stream
+		{
+		public:
+
+			void Start(const unsigned char key[32], const unsigned char input[16])
+			{
+				Setup(state, key, input);
+				used = 0;
+				filled = 0;
+			}
+
+			void Xor(const unsigned char* in, unsigned char* out, size_t size)
+			{
+				while (size > 0)
+				{
+#ifdef CRYPTO_X86
+					if (used == filled && size >= 512 && HasAVX2())
+					{
+						for (; size >= 512; size -= 512, in += 512, out += 512)
+							Xor8AVX2(state, in, out);
+						continue;
+					}
+#endif
+					if (used == filled)
+						Refill(size);
+					size_t take = (size_t)(filled - used);
+					if (take > size)
+						take = size;
+					for (size_t i = 0; i < take; ++i)
+						out[i] = in[i] ^ keystream[used + i];
+					used += (int)take;
+					in += take;
+					out += take;
+					size -= take;
+				}
+			}
+
+			// the next block of keystream whole, skipping whatever is left in the buffer (only at the start)
+			void Next(unsigned char out[64])
+			{
+				assert(used == filled);
+				Block(state, out);
+			}
+
+		private:
+
+			void Refill(size_t wanted)
+			{
+#ifdef CRYPTO_X86
+				static const unsigned char zeros[512] = { 0 };
+				if (wanted > 256 && HasAVX2())
+				{
+					Xor8AVX2(state, zeros, keystream);
+					used = 0;
+					filled = 512;
+					return;
+				}
+				if (wanted > 64)
+				{
+					Xor4SSE2(state, zeros, keystream);
+					used = 0;
+					filled = 256;
+					return;
+				}
+#endif
+				(void)wanted;
+				Block(state, keystream);
+				used = 0;
+				filled = 64;
+			}
+
+#ifdef CRYPTO_X86
+			static bool HasAVX2()
+			{
+				static const bool avx2 = CpuHasAVX2();
+				return avx2;
+			}
+#endif
+
+			uint32_t state[16];
+			unsigned char keystream[512];
+			int used;		// bytes of keystream used
+			int filled;		// bytes of keystream made
+		};
+	}
+
+	// Poly1305 one-time authenticator over 26-bit limbs (after poly1305-donna)
+
+	class Poly1305
+	{
+	public:
+
+		void Start(const unsigned char key[32])
+		{
+			using chacha::Load32;
+			r[0] = Load32(key + 0) & 0x3ffffff;
+			r[1] = (Load32(key + 3) >> 2) & 0x3ffff03;
+			r[2] = (Load32(key + 6) >> 4) & 0x3ffc0ff;
+			r[3] = (Load32(key + 9) >> 6) & 0x3f03fff;
+			r[4] = (Load32(key + 12) >> 8) & 0x00fffff;
+			for (int i = 0; i < 5; ++i)
+				h[i] = 0;
+			for (int i = 0; i < 4; ++i)
+				pad[i] = Load32(key + 16 + i * 4);
+			leftover = 0;
+		}
+
+		void Update(const unsigned char* data, size_t size)
+		{
+			if (size == 0)
+				return;
+			if (leftover > 0)
+			{
+				size_t take = 16 - leftover;
+				if (take > size)
+					take = size;
+				memcpy(buffer + leftover, data, take);
+				leftover += take;
+				data += take;
+				size -= take;
+				if (leftover < 16)
+					return;
+				Blocks(buffer, 16, 1 << 24);
+				leftover = 0;
+			}
+			const size_t whole = size & ~(size_t)15;
+			if (whole > 0)
+				Blocks(data, whole, 1 << 24);
+			if (size > whole)
+			{
+				memcpy(buffer, data + whole, size - whole);
+				leftover = size - whole;
+			}
+		}
+
+		// zeros up to a multiple of 16 bytes, as the AEAD construction pads its parts
+		void Pad()
+		{
+			static const unsigned char zeros[16] = { 0 };
+			if (leftover > 0)
+				Update(zeros, 16 - leftover);
+		}
+
+		void Finish(unsigned char tag[16])
+		{
+			if (leftover > 0)
+			{
+				buffer[leftover] = 1;
+				for (size_t i = leftover + 1; i < 16; ++i)
+					buffer[i] = 0;
+				Blocks(buffer, 16, 0);
+			}
+
+			// carry through, then take h - p if h is at least p
+			uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+			uint32_t c = h1 >> 26; h1 &= 0x3ffffff;
+			h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+			h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+			h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+			h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+			h1 += c;
+
+			uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+			uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+			uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+			uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+			uint32_t g4 = h4 + c - (1u << 26);
+
+			uint32_t mask = (g4 >> 31) - 1;
+			g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+			mask = ~mask;
+			h0 = (h0 & mask) | g0;
+			h1 = (h1 & mask) | g1;
+			h2 = (h2 & mask) | g2;
+			h3 = (h3 & mask) | g3;
+			h4 = (h4 & mask) | g4;
+
+			// to 32-bit words, and add the pad modulo 2^128
+			h0 = h0 | (h1 << 26);
+			h1 = (h1 >> 6) | (h2 << 20);
+			h2 = (h2 >> 12) | (h3 << 14);
+			h3 = (h3 >> 18) | (h4 << 8);
+			uint64_t f = (uint64_t)h0 + pad[0]; chacha::Store32(tag + 0, (uint32_t)f);
+			f = (uint64_t)h1 + pad[1] + (f >> 32); chacha::Store32(tag + 4, (uint32_t)f);
+			f = (uint64_t)h2 + pad[2] + (f >> 32); chacha::Store32(tag + 8, (uint32_t)f);
+			f = (uint64_t)h3 + pad[3] + (f >> 32); chacha::Store32(tag + 12, (uint32_t)f);
+		}
+
+	private:
+
+		// h = (h + block) * r for each 16 byte block; hibit is the 2^128 bit, clear only for a padded final block
+		void Blocks(const unsigned char* data, size_t size, uint32_t hibit)
+		{
+			using chacha::Load32;
+			const uint32_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+			const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+			uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+			for (; size >= 16; size -= 16, data += 16)
+			{
+				h0 += Load32(data + 0) & 0x3ffffff;
+				h1 += (Load32(data + 3) >> 2) & 0x3ffffff;
+				h2 += (Load32(data + 6) >> 4) & 0x3ffffff;
+				h3 += (Load32(data + 9) >> 6) & 0x3ffffff;
+				h4 += (Load32(data + 12) >> 8) | hibit;
+
+				const uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+				uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+				uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+				uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+				uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+				uint32_t c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+				d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+				d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+				d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+				d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+				h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+				h1 += c;
+			}
+
+			h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+		}
+
+		uint32_t r[5];
+		uint32_t h[5];
+		uint32_t pad[4];
+		unsigned char buffer[16];
+		size_t leftover;
+	};
+
+	// SipHash-2-4: a 64-bit keyed hash of short inputs, for values a peer must hand back unchanged, such as the
+	// handshake cookie; a 16 byte key
+	inline uint64_t SipHash(const unsigned char key[16], const unsigned char* data, size_t size)
+	{
+		struct Lanes
+		{
+			static uint64_t Load64(const unsigned char* p)
+			{
+				uint64_t value = 0;
+				for (int i = 7; i >= 0; --i)
+					value = (value << 8) | p[i];
+				return value;
+			}
+
+			static uint64_t Rotate(uint64_t value, int bits)
+			{
+				return (value << bits) | (value >> (64 - bits));
+			}
+
+			static void Round(uint64_t v[4])
+			{
+				v[0] += v[1]; v[1] = Rotate(v[1], 13); v[1] ^= v[0]; v[0] = Rotate(v[0], 32);
+				v[2] += v[3]; v[3] = Rotate(v[3], 16); v[3] ^= v[2];
+				v[0] += v[3]; v[3] = Rotate(v[3], 21); v[3] ^= v[0];
+				v[2] += v[1]; v[1] = Rotate(v[1], 17); v[1] ^= v[2]; v[2] = Rotate(v[2], 32);
+			}
+		};
+
+		const uint64_t k0 = Lanes::Load64(key);
+		const uint64_t k1 = Lanes::Load64(key + 8);
+		uint64_t v[4] = { k0 ^ 0x736f6d6570736575ull, k1 ^ 0x646f72616e646f6dull, k0 ^ 0x6c7967656e657261ull, k1 ^ 0x7465646279746573ull };
+
+		const size_t whole = size & ~(size_t)7;
+		for (size_t i = 0; i < whole; i += 8)
+		{
+			const uint64_t m = Lanes::Load64(data + i);
+			v[3] ^= m;
+			Lanes::Round(v);
+			Lanes::Round(v);
+			v[0] ^= m;
+		}
+
+		// the last word is the leftover bytes with the length in its top byte
+		uint64_t last = (uint64_t)size << 56;
+		for (size_t i = whole; i < size; ++i)
+			last |= (uint64_t)data[i] << ((i - whole) * 8);
+		v[3] ^= last;
+		Lanes::Round(v);
+		Lanes::Round(v);
+		v[0] ^= last;
+
+		v[2] ^= 0xff;
+		for (int i = 0; i < 4; ++i)
+			Lanes::Round(v);
+		return v[0] ^ v[1] ^ v[2] ^ v[3];
+	}
+
+	// seals and opens the datagrams of one connection
+	//  + a sealed datagram is the cleartext prefix (protocol id), the session id and counter, the tag, then the
+	//    ciphertext; the tag goes ahead of the ciphertext so a receiver can scatter the payload straight into its
+	//    buffer and decrypt it there
+	//  + the prefix, session id and counter are authenticated as associated data
+	//  + sending and receiving keep separate state, so one thread may send while another receives
+	//  + a receiver remembers the highest counter of its session and which of the 64 below it have arrived; a counter
+	//    already seen or older than that is a replay, and is dropped without being decrypted
+
+	class PacketCipher
+	{
+	public:
+
+		static const int Overhead = AeadNonceSize + AeadTagSize;
+
+		PacketCipher() : enabled(false), sendSession(0), sendCounter(0), receiveSession(0), receiveKnown(false),
+			receiveLocked(false), receiveHighest(0), receiveWindow(0) {}
+
+		// key (AeadKeySize bytes) for both directions, null for cleartext
+		void SetKey(const unsigned char* key)
+		{
+			enabled = key != NULL;
+			if (enabled)
+				memcpy(this->key, key, AeadKeySize);
+			receiveKnown = false;
+			receiveLocked = false;
+			NewSession();
+		}
+
+		bool IsEnabled() const
+		{
+			return enabled;
+		}
+
+		// a fresh session id for what is sent from now on
+		void NewSession()
+		{
+			if (!enabled)
+				return;
+			std::random_device random;
+			sendSession = ((uint64_t)random() << 32) ^ (uint64_t)random();
+			sendCounter = 0;
+			DeriveKey(sendSession, sendKey);
+		}
+
+		// while locked, packets of any session but the one last opened are dropped; a connection locks once it is up,
+		// so a replayed packet of an earlier session cannot switch it back to that session's key
+		void LockSession(bool locked)
+		{
+			receiveLocked = locked;
+		}
+
+		// seal a datagram in place: nonce and tag go in the AeadNonceSize + AeadTagSize bytes after the prefix, the two
+		// pieces of plaintext are encrypted from their buffers into out (which may be either of them)
+		void Seal(unsigned char* prefix, int prefixSize, unsigned char* firstOut, const unsigned char* first, int firstSize,
+			unsigned char* secondOut, const unsigned char* second, int secondSize)
+		{
+			assert(enabled);
+			unsigned char* nonce = prefix + prefixSize;
+			WriteLittle64(nonce, sendSession);
+			WriteLittle64(nonce + 8, sendCounter++);
+
+			chacha::Stream stream;
+			Poly1305 mac;
+			StartPacket(sendKey, nonce + 8, stream, mac, prefix, prefixSize + AeadNonceSize);
+			stream.Xor(first, firstOut, (size_t)firstSize);
+			stream.Xor(second, secondOut, (size_t)secondSize);
+			mac.Update(firstOut, (size_t)firstSize);
+			mac.Update(secondOut, (size_t)secondSize);
+			FinishPacket(mac, prefixSize + AeadNonceSize, firstSize + secondSize, nonce + AeadNonceSize);
+		}
+
+		// check a datagram's tag and decrypt its two pieces in place; false (and nothing decrypted) if it fails or is
+		// a replay
+		bool Open(const unsigned char* prefix, int prefixSize, unsigned char* first, int firstSize, unsigned char* second, int secondSize)
+		{
+			assert(enabled);
+			const unsigned char* nonce = prefix + prefixSize;
+			const uint64_t session = ReadLittle64(nonce);
+			const uint64_t counter = ReadLittle64(nonce + 8);
+
+			// a new session's key (and window) is kept only once a packet of it is genuine
+			unsigned char candidate[AeadKeySize];
+			const bool known = receiveKnown && session == receiveSession;
+			if (known ? !IsFresh(counter) : receiveLocked)
+				return false;
+			if (!known)
+				DeriveKey(session, candidate);
+			const unsigned char* packetKey = known ? receiveKey : candidate;
+
+			chacha::Stream stream;
+			Poly1305 mac;
+			StartPacket(packetKey, nonce + 8, stream, mac, prefix, prefixSize + AeadNonceSize);
+			mac.Update(first, (size_t)firstSize);
+			mac.Update(second, (size_t)secondSize);
+			unsigned char tag[AeadTagSize];
+			FinishPacket(mac, prefixSize + AeadNonceSize, firstSize + secondSize, tag);
+
+			unsigned char difference = 0;
+			for (int i = 0; i < AeadTagSize; ++i)
+				difference |= (unsigned char)(tag[i] ^ nonce[AeadNonceSize + i]);
+			if (difference != 0)
+				return false;
+
+			if (!known)
+			{
+				memcpy(receiveKey, candidate, AeadKeySize);
+				receiveSession = session;
+				receiveKnown = true;
+				receiveHighest = 0;
+				receiveWindow = 0;
+			}
+			MarkReceived(counter);
+			stream.Xor(first, first, (size_t)firstSize);
+			stream.Xor(second, second, (size_t)secondSize);
+			return true;
+		}
+
+	private:
+
+		// bit n of the window is the counter n below the highest one received
+		bool IsFresh(uint64_t counter) const
+		{
+			if (counter > receiveHighest)
+				return true;
+			const uint64_t behind = receiveHighest - counter;
+			return behind < 64 && ((receiveWindow >> behind) & 1) == 0;
+		}
+
+		void MarkReceived(uint64_t counter)
+		{
+			if (counter > receiveHighest)
+			{
+				const uint64_t ahead = counter - receiveHighest;
+				receiveWindow = ahead < 64 ? receiveWindow << ahead : 0;
+				receiveHighest = counter;
+			}
+			receiveWindow |= (uint64_t)1 << (receiveHighest - counter);
+		}
+
+		static void WriteLittle64(unsigned char* p, uint64_t value)
+		{
+			for (int i = 0; i < 8; ++i)
+				p[i] = (unsigned char)(value >> (i * 8));
+		}
+
+		static uint64_t ReadLittle64(const unsigned char* p)
+		{
+			uint64_t value = 0;
+			for (int i = 7; i >= 0; --i)
+				value = (value << 8) | p[i];
+			return value;
+		}
+
+		// XChaCha20: the subkey for a session is HChaCha20 of the key over a fixed label and the session id
+		void DeriveKey(uint64_t session, unsigned char out[AeadKeySize]) const
+		{
+			unsigned char nonce[16] = { 'R', 'U', 'D', 'P', 'a', 'e', 'a', 'd' };
+			WriteLittle64(nonce + 8, session);
+			chacha::HChaCha20(key, nonce, out);
+		}
+
+		// the keystream from block 1 on under the packet's nonce (four zero bytes and the counter), block 0 keys the mac,
+		// which starts on the associated data
+		static void StartPacket(const unsigned char* packetKey, const unsigned char counter[8], chacha::Stream& stream, Poly1305& mac,
+			const unsigned char* associated, int associatedSize)
+		{
+			unsigned char input[16] = { 0 };
+			memcpy(input + 8, counter, 8);
+			stream.Start(packetKey, input);
+			unsigned char block[64];
+			stream.Next(block);
+			mac.Start(block);
+			mac.Update(associated, (size_t)associatedSize);
+			mac.Pad();
+		}
+
+		static void FinishPacket(Poly1305& mac, int associatedSize, int cipherSize, unsigned char tag[AeadTagSize])
+		{
+			mac.Pad();
+			unsigned char lengths[16];
+			WriteLittle64(lengths, (uint64_t)associatedSize);
+			WriteLittle64(lengths + 8, (uint64_t)cipherSize);
+			mac.Update(lengths, sizeof(lengths));
+			mac.Finish(tag);
+		}
+
+		bool enabled;
+		unsigned char key[AeadKeySize];
+		uint64_t sendSession;
+		uint64_t sendCounter;
+		unsigned char sendKey[AeadKeySize];
+		uint64_t receiveSession;		// the peer's session whose key is kept
+		bool receiveKnown;
+		bool receiveLocked;				// only receiveSession is taken
+		unsigned char receiveKey[AeadKeySize];
+		uint64_t receiveHighest;		// the replay window of receiveSession
+		uint64_t receiveWindow;
+	};
+
+	// read a key file: 64 hex digits (whitespace around them is fine) or exactly 32 raw bytes
+	inline bool LoadKeyFile(const std::string& path, unsigned char key[AeadKeySize])
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == NULL)
+			return false;
+		unsigned char contents[256];
+		const size_t size = fread(contents, 1, sizeof(contents), file);
+		fclose(file);
+
+		size_t start = 0;
+		size_t end = size;
+		while (start < end && isspace(contents[start]))
+			start++;
+		while (end > start && isspace(contents[end - 1]))
+			end--;
+		if (end - start == (size_t)AeadKeySize * 2)
+		{
+			bool hex = true;
+			for (int i = 0; i < AeadKeySize * 2 && hex; ++i)
+				hex = isxdigit(contents[start + i]) != 0;
+			if (hex)
+			{
+				for (int i = 0; i < AeadKeySize; ++i)
+				{
+					char digits[3] = { (char)contents[start + i * 2], (char)contents[start + i * 2 + 1], 0 };
+					key[i] = (unsigned char)strtoul(digits, NULL, 16);
+				}
+				return true;
+			}
+		}
+		if (size == (size_t)AeadKeySize)
+		{
+			memcpy(key, contents, AeadKeySize);
+			return true;
+		}
+		return false;
+	}
+}
+
+#endif
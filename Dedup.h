@@ -0,0 +1,353 @@
+/*
+	Content-defined chunking and a chunk store, for sending only the parts of a file the receiver has not seen
+	  + chunk boundaries come from a gear hash of the last 64 bytes (FastCDC style), so an insertion moves only the
+	    boundaries next to it and identical regions of different files cut into identical chunks
+	  + a chunk is known by its 128-bit xxHash3 style id (Checksum.h, SSE2/AVX2 kernels)
+	  + the store appends chunk bytes to a data log and a 32 byte record per chunk to an index log; the index log is
+	    read back into an in-memory table when the store opens, so the store carries over from one transfer to the next
+	  + the table keeps 16 bytes a chunk: the low half of its id and where it lies in the data log
+*/
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "Checksum.h"
+#include "LargeFile.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace net
+{
+	// chunk sizes: none is cut shorter than the minimum (except at the end of the file) or longer than the maximum, and
+	// normalised chunking keeps most of them near the average
+	const int MinChunkSize = 4 * 1024;
+	const int AverageChunkSize = 16 * 1024;
+	const int MaxChunkSize = 64 * 1024;
+
+	struct ChunkId
+	{
+		uint64_t low;
+		uint64_t high;
+
+		bool operator==(const ChunkId& other) const
+		{
+			return low == other.low && high == other.high;
+		}
+	};
+
+	inline ChunkId ComputeChunkId(const unsigned char* data, int size)
+	{
+		xx3::State state;
+		state.Update(data, (size_t)size);
+		uint64_t acc[8];
+		state.Finish(acc);
+		const unsigned char* secret = xx3::GetSecret();
+		ChunkId id;
+		id.low = xx3::MergeAccumulators(acc, secret + 11, (uint64_t)size * xx3::Prime64_1);
+		id.high = xx3::MergeAccumulators(acc, secret + xx3::SecretSize - 64 - 11, ~((uint64_t)size * xx3::Prime64_2));
+		return id;
+	}
+
+	// random value per byte for the gear hash, the same on every host (splitmix64 from a fixed seed)
+	inline const uint64_t* GetGearTable()
+	{
+		struct Table
+		{
+			uint64_t values[256];
+
+			Table()
+			{
+				uint64_t state = 0x52554450u;	// "RUDP"
+				for (int i = 0; i < 256; ++i)
+				{
+					uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+					z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+					z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+					values[i] = z ^ (z >> 31);
+				}
+			}
+		};
+		static const Table table;
+		return table.values;
+	}
+
+	// length of the chunk starting at data, given size bytes of the file from there
+	//  + the hash shifts one bit a byte, so its top bits cover the last 64 bytes; a boundary is where the top bits
+	//    of the mask are all zero
+	//  + below the average size the mask is two bits longer and above it two bits shorter (normalised chunking)
+	//  + returns size when no boundary lies in it, which is the chunk only if size reached the maximum or the file ends
+	inline int FindChunkBoundary(const unsigned char* data, int size)
+	{
+		const uint64_t MaskSmall = 0xFFFFull << 48;	// 16 bits, a boundary every 64 KB on average
+		const uint64_t MaskLarge = 0xFFFull << 52;	// 12 bits, every 4 KB
+		if (size <= MinChunkSize)
+			return size;
+
+		const uint64_t* gear = GetGearTable();
+		const int normal = size < AverageChunkSize ? size : AverageChunkSize;
+		const int end = size < MaxChunkSize ? size : MaxChunkSize;
+		uint64_t hash = 0;
+		int i = MinChunkSize;
+		for (; i < normal; ++i)
+		{
+			hash = (hash << 1) + gear[data[i]];
+			if (!(hash & MaskSmall))
+				return i + 1;
+		}
+		for (; i < end; ++i)
+		{
+			hash = (hash << 1) + gear[data[i]];
+			if (!(hash & MaskLarge))
+				return i + 1;
+		}
+		return end;
+	}
+
+	// first bytes of an index log, a format change gets a new one
+	const char ChunkIndexMagic[] = "RUDPCI01";
+
+	// length of a chunk cut from a run of zeros at least the maximum long, the same every time, so a sparse hole
+	// need not be hashed
+	inline int ZeroChunkSize()
+	{
+		struct Size
+		{
+			int value;
+
+			Size()
+			{
+				std::vector<unsigned char> zeros(MaxChunkSize, 0);
+				value = FindChunkBoundary(&zeros[0], MaxChunkSize);
+			}
+		};
+		static const Size size;
+		return size.value;
+	}
+
+	// chunks seen by earlier transfers, by id
+	//  + used by one thread, apart from reading the data log, which another can do through a handle of its own
+	//  + a lookup compares the low 64 bits of the id; the bytes of a chunk are hashed again whenever it is used, so a
+	//    false match (or a damaged data log) fails the file rather than going unnoticed
+
+	class ChunkStore
+	{
+	public:
+
+		ChunkStore() : dataSize(0), indexEnd(0), chunkCount(0), bits(0) {}
+
+		// open (or create) the store in directory and read its index log
+		bool Open(const std::string& directory)
+		{
+			assert(!IsOpen());
+			dataPath = directory + "/" + "chunks.dat";
+			const std::string indexPath = directory + "/" + "chunks.idx";
+			CreateParentDirectories(dataPath);
+			if (!data.Open(dataPath, LargeFile::Updating) || !index.Open(indexPath, LargeFile::Updating))
+			{
+				Close();
+				return false;
+			}
+
+			dataSize = data.GetSize();
+			chunkCount = 0;
+			bits = 10;
+			slots.assign((size_t)1 << bits, Slot());
+
+			// a header names the format, then whole records; a torn last record or one past the data log is left out
+			unsigned char header[IndexHeaderSize];
+			uint64_t indexSize = index.GetSize();
+			if (indexSize < (uint64_t)IndexHeaderSize)
+			{
+				memcpy(header, ChunkIndexMagic, IndexHeaderSize);
+				if (!index.SetSize(0) || !index.Write(0, header, IndexHeaderSize))
+				{
+					Close();
+					return false;
+				}
+				indexSize = IndexHeaderSize;
+			}
+			else if (index.Read(0, header, IndexHeaderSize) != IndexHeaderSize || memcmp(header, ChunkIndexMagic, IndexHeaderSize) != 0)
+			{
+				Close();
+				return false;
+			}
+
+			std::vector<unsigned char> block(IndexRecordSize * 4096);
+			indexEnd = IndexHeaderSize;
+			while (indexEnd + IndexRecordSize <= indexSize)
+			{
+				const int bytesRead = index.Read(indexEnd, &block[0], (int)block.size());
+				const int records = bytesRead > 0 ? bytesRead / IndexRecordSize : 0;
+				if (records == 0)
+					break;
+				for (int i = 0; i < records; ++i)
+				{
+					const unsigned char* record = &block[(size_t)i * IndexRecordSize];
+					const uint64_t low = ReadLittle64(record);
+					const uint64_t offset = ReadLittle64(record + 16);
+					const uint32_t size = (uint32_t)ReadLittle64(record + 24);
+					if (offset + size <= dataSize && size <= (uint32_t)MaxChunkSize)
+						Insert(low, offset, (int)size);
+				}
+				indexEnd += (uint64_t)records * IndexRecordSize;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+			data.Close();
+			index.Close();
+		}
+
+		bool IsOpen() const
+		{
+			return data.IsOpen();
+		}
+
+		// where the chunk lies in the data log, false if the store does not have it
+		bool Find(const ChunkId& id, uint64_t& offset, int& size) const
+		{
+			if (!IsOpen())
+				return false;
+			const size_t mask = slots.size() - 1;
+			for (size_t i = Home(id.low); slots[i].location != 0; i = (i + 1) & mask)
+			{
+				if (slots[i].key == id.low)
+				{
+					offset = (slots[i].location >> LocationSizeBits) - 1;
+					size = (int)(slots[i].location & ((1u << LocationSizeBits) - 1));
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// append a chunk, unless the store has it already; false if it could not be written
+		bool Add(const ChunkId& id, const unsigned char* bytes, int size)
+		{
+			uint64_t offset;
+			int storedSize;
+			if (!IsOpen() || size > MaxChunkSize || Find(id, offset, storedSize))
+				return IsOpen();
+
+			// the data goes first, so an index record never points past what was written
+			unsigned char record[IndexRecordSize];
+			WriteLittle64(record, id.low);
+			WriteLittle64(record + 8, id.high);
+			WriteLittle64(record + 16, dataSize);
+			WriteLittle64(record + 24, (uint64_t)size);
+			if (!data.Write(dataSize, bytes, size) || !index.Write(indexEnd, record, IndexRecordSize))
+				return false;
+			Insert(id.low, dataSize, size);
+			dataSize += (uint64_t)size;
+			indexEnd += IndexRecordSize;
+			return true;
+		}
+
+		// read size bytes of the data log at offset
+		int Read(uint64_t offset, unsigned char* bytes, int size)
+		{
+			return data.Read(offset, bytes, size);
+		}
+
+		const std::string& GetDataPath() const
+		{
+			return dataPath;
+		}
+
+		uint64_t GetChunkCount() const
+		{
+			return chunkCount;
+		}
+
+		uint64_t GetDataSize() const
+		{
+			return dataSize;
+		}
+
+	private:
+
+		static const int IndexHeaderSize = 8;
+		static const int IndexRecordSize = 32;	// id low and high, data log offset, size, all little-endian u64
+		static const int LocationSizeBits = 20;	// location is (offset + 1) << 20 | size, zero marks an empty slot
+
+		struct Slot
+		{
+			Slot() : key(0), location(0) {}
+
+			uint64_t key;		// low half of the id
+			uint64_t location;
+		};
+
+		static uint64_t ReadLittle64(const unsigned char* p)
+		{
+			uint64_t value = 0;
+			for (int i = 7; i >= 0; --i)
+				value = (value << 8) | p[i];
+			return value;
+		}
+
+		static void WriteLittle64(unsigned char* p, uint64_t value)
+		{
+			for (int i = 0; i < 8; ++i)
+				p[i] = (unsigned char)(value >> (i * 8));
+		}
+
+		size_t Home(uint64_t key) const
+		{
+			return (size_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+		}
+
+		// kept at most three quarters full, doubling when it gets there
+		void Insert(uint64_t key, uint64_t offset, int size)
+		{
+			if ((chunkCount + 1) * 4 > (uint64_t)slots.size() * 3)
+			{
+				std::vector<Slot> old;
+				old.swap(slots);
+				bits++;
+				slots.assign((size_t)1 << bits, Slot());
+				for (size_t i = 0; i < old.size(); ++i)
+				{
+					if (old[i].location != 0)
+						Place(old[i]);
+				}
+			}
+			Slot slot;
+			slot.key = key;
+			slot.location = ((offset + 1) << LocationSizeBits) | (uint64_t)size;
+			if (Place(slot))
+				chunkCount++;
+		}
+
+		// false if a slot with the key is there already
+		bool Place(const Slot& slot)
+		{
+			const size_t mask = slots.size() - 1;
+			size_t i = Home(slot.key);
+			for (; slots[i].location != 0; i = (i + 1) & mask)
+			{
+				if (slots[i].key == slot.key)
+					return false;
+			}
+			slots[i] = slot;
+			return true;
+		}
+
+		LargeFile data;			// chunk bytes, back to back
+		LargeFile index;		// header, then a record per chunk
+		std::string dataPath;
+		uint64_t dataSize;
+		uint64_t indexEnd;
+		uint64_t chunkCount;
+		int bits;
+		std::vector<Slot> slots;
+	};
+}
+
+#endif
@@ -0,0 +1,399 @@
+/*
+	Delta encoding against an existing copy of a file, in the style of rsync
+	  + the receiver splits its copy into fixed size blocks and sends a signature of each: a weak checksum that can
+	    be rolled along a byte at a time, and a strong 64-bit hash to confirm a weak match
+	  + the sender slides a block sized window over its file, looks the weak checksum up at every offset and only
+	    hashes the window when a block with the same weak checksum exists; a match becomes a copy of that block,
+	    everything between matches goes as literal bytes
+	  + the weak checksum of a whole block is computed with an SSE2 kernel, rolling costs a few adds per byte
+*/
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include "Checksum.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+namespace net
+{
+	const int MinDeltaBlockSize = 1024;
+	const int MaxDeltaBlockSize = 128 * 1024;
+
+	// block size for a file: about the square root of its size, so the signatures and the literal bytes around each
+	// change grow alike; a power of two, so the SSE2 kernel never has a tail
+	inline int DeltaBlockSize(uint64_t fileSize)
+	{
+		int size = MinDeltaBlockSize;
+		while (size < MaxDeltaBlockSize && (uint64_t)size * size < fileSize)
+			size <<= 1;
+		return size;
+	}
+
+	// weak checksum sums over data: a is the sum of the bytes, b the sum of each byte times its distance from the end
+	//  + both wrap at 32 bits, which rolling preserves
+
+	inline void WeakSumsScalar(const unsigned char* data, size_t size, uint32_t& a, uint32_t& b)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			a += data[i];
+			b += a;
+		}
+	}
+
+#ifdef CHECKSUM_X86
+
+	// 16 bytes at a time: b gains 16 times the a before them plus their own weighted sum (weights 16 down to 1)
+	inline void WeakSumsSSE2(const unsigned char* data, size_t size, uint32_t& a, uint32_t& b)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i weightsLow = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+		const __m128i weightsHigh = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+		__m128i weighted = _mm_setzero_si128();
+		const size_t blocks = size / 16;
+		for (size_t i = 0; i < blocks; ++i)
+		{
+			const __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i * 16));
+			const __m128i sums = _mm_sad_epu8(bytes, zero);
+			const __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weightsLow);
+			const __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weightsHigh);
+			weighted = _mm_add_epi32(weighted, _mm_add_epi32(low, high));
+			b += a * 16;
+			a += (uint32_t)_mm_cvtsi128_si32(sums) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+		}
+		weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 8));
+		weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 4));
+		b += (uint32_t)_mm_cvtsi128_si32(weighted);
+		WeakSumsScalar(data + blocks * 16, size - blocks * 16, a, b);
+	}
+
+#endif // CHECKSUM_X86
+
+	// weak checksum of a window that moves along the data a byte at a time
+
+	class RollingChecksum
+	{
+	public:
+
+		RollingChecksum() : a(0), b(0), size(0) {}
+
+		// start over on the size bytes at data
+		void Reset(const unsigned char* data, int size)
+		{
+			a = 0;
+			b = 0;
+			this->size = (uint32_t)size;
+#ifdef CHECKSUM_X86
+			WeakSumsSSE2(data, (size_t)size, a, b);
+#else
+			WeakSumsScalar(data, (size_t)size, a, b);
+#endif
+		}
+
+		// slide the window one byte: out leaves at the front, in joins at the back
+		void Roll(unsigned char out, unsigned char in)
+		{
+			a += (uint32_t)in - out;
+			b += a - size * out;
+		}
+
+		uint32_t Get() const
+		{
+			return (a & 0xFFFF) | (b << 16);
+		}
+
+	private:
+
+		uint32_t a;
+		uint32_t b;
+		uint32_t size;
+	};
+
+	inline uint32_t WeakChecksum(const unsigned char* data, int size)
+	{
+		RollingChecksum checksum;
+		checksum.Reset(data, size);
+		return checksum.Get();
+	}
+
+	// strong hash of a block, the 64-bit xxHash3 style hash of Checksum.h
+	inline uint64_t StrongChecksum(const unsigned char* data, int size)
+	{
+		xx3::State state;
+		state.Update(data, (size_t)size);
+		uint64_t acc[8];
+		state.Finish(acc);
+		return xx3::MergeAccumulators(acc, xx3::GetSecret() + 11, (uint64_t)size * xx3::Prime64_1);
+	}
+
+	struct BlockSignature
+	{
+		uint32_t weak;
+		uint64_t strong;
+	};
+
+	inline BlockSignature ComputeBlockSignature(const unsigned char* data, int size)
+	{
+		BlockSignature signature;
+		signature.weak = WeakChecksum(data, size);
+		signature.strong = StrongChecksum(data, size);
+		return signature;
+	}
+
+	// the receiver's block signatures, looked up by weak checksum
+	//  + open addressing over 8 byte slots (weak checksum and block number), at most half full, so a miss, which is
+	//    what almost every offset of a changed region is, costs one probe
+	//  + blocks with the same contents are kept once, any of them serves as the copy
+
+	class SignatureIndex
+	{
+	public:
+
+		SignatureIndex() : blockCount(0), entries(0), bits(0) {}
+
+		// empty the index for a file of blockCount blocks
+		void Reset(uint64_t blockCount)
+		{
+			this->blockCount = blockCount;
+			entries = 0;
+			bits = 1;
+			while (((uint64_t)1 << bits) < blockCount * 2)
+				bits++;
+			Slot empty = { 0, EmptySlot };
+			slots.assign((size_t)1 << bits, empty);
+			strong.assign((size_t)blockCount, 0);
+		}
+
+		void Add(uint64_t block, const BlockSignature& signature)
+		{
+			if (block >= blockCount)
+				return;
+			const size_t mask = slots.size() - 1;
+			for (size_t i = Home(signature.weak); ; i = (i + 1) & mask)
+			{
+				Slot& slot = slots[i];
+				if (slot.block == EmptySlot)
+				{
+					slot.weak = signature.weak;
+					slot.block = (uint32_t)block;
+					strong[(size_t)block] = signature.strong;
+					entries++;
+					return;
+				}
+				if (slot.weak == signature.weak && strong[slot.block] == signature.strong)
+					return;
+			}
+		}
+
+		// block whose contents match the size bytes at data, whose weak checksum is weak; -1 if there is none
+		int64_t Find(uint32_t weak, const unsigned char* data, int size) const
+		{
+			if (entries == 0)
+				return -1;
+			const size_t mask = slots.size() - 1;
+			bool hashed = false;
+			uint64_t hash = 0;
+			for (size_t i = Home(weak); slots[i].block != EmptySlot; i = (i + 1) & mask)
+			{
+				if (slots[i].weak != weak)
+					continue;
+				if (!hashed)
+				{
+					hash = StrongChecksum(data, size);
+					hashed = true;
+				}
+				if (strong[slots[i].block] == hash)
+					return slots[i].block;
+			}
+			return -1;
+		}
+
+		uint64_t GetBlockCount() const
+		{
+			return blockCount;
+		}
+
+		// distinct blocks added
+		uint64_t GetEntries() const
+		{
+			return entries;
+		}
+
+	private:
+
+		static const uint32_t EmptySlot = 0xFFFFFFFF;
+
+		struct Slot
+		{
+			uint32_t weak;
+			uint32_t block;
+		};
+
+		size_t Home(uint32_t weak) const
+		{
+			return (size_t)((weak * 2654435761u) >> (32 - bits));
+		}
+
+		uint64_t blockCount;
+		uint64_t entries;
+		int bits;
+		std::vector<Slot> slots;
+		std::vector<uint64_t> strong;	// by block number
+	};
+
+	// turns the sender's file into copies of the receiver's blocks and literal bytes
+	//  + the file is fed in as it is read, and the encoder keeps only the bytes from the start of the pending literal
+	//    on, so memory stays at a block plus a literal plus whatever was fed last
+	//  + an operation is handed out once it is certain: a literal when it reaches maxLiteral bytes or a match ends it
+
+	class DeltaEncoder
+	{
+	public:
+
+		struct Operation
+		{
+			bool copy;
+			uint64_t offset;		// where it goes in the sender's file
+			uint64_t block;			// copy: the receiver's block
+			unsigned char* data;	// the bytes (a copy's as well), valid until the next Feed
+			int size;				// literal: byte count, copy: the block size
+		};
+
+		DeltaEncoder() : index(nullptr), blockSize(0), maxLiteral(0), base(0), literalStart(0), position(0), rolling(false), finished(false) {}
+
+		// index may be empty (or cover only some blocks), whatever is not found goes as literals
+		void Start(const SignatureIndex* index, int blockSize, int maxLiteral)
+		{
+			assert(maxLiteral > 0);
+			this->index = index;
+			this->blockSize = blockSize;
+			this->maxLiteral = maxLiteral;
+			buffer.clear();
+			base = 0;
+			literalStart = 0;
+			position = 0;
+			rolling = false;
+			finished = false;
+		}
+
+		// the next size bytes of the file
+		void Feed(const unsigned char* data, int size)
+		{
+			if (literalStart > 0)
+			{
+				buffer.erase(buffer.begin(), buffer.begin() + literalStart);
+				base += literalStart;
+				position -= literalStart;
+				literalStart = 0;
+			}
+			buffer.insert(buffer.end(), data, data + size);
+		}
+
+		// the whole file has been fed
+		void Finish()
+		{
+			finished = true;
+		}
+
+		// true once every byte fed has been handed out
+		bool IsDone() const
+		{
+			return finished && literalStart == buffer.size();
+		}
+
+		// next operation, false if it depends on bytes not fed yet (or everything is done)
+		bool Next(Operation& operation)
+		{
+			const bool matching = index != nullptr && index->GetEntries() > 0 && blockSize > 0;
+			while (true)
+			{
+				const size_t available = buffer.size() - position;
+				if (matching && available >= (size_t)blockSize)
+				{
+					unsigned char* window = &buffer[position];
+					if (!rolling)
+					{
+						checksum.Reset(window, blockSize);
+						rolling = true;
+					}
+					const int64_t block = index->Find(checksum.Get(), window, blockSize);
+					if (block >= 0)
+					{
+						if (position > literalStart)
+							return TakeLiteral(operation, position);
+						operation.copy = true;
+						operation.offset = base + position;
+						operation.block = (uint64_t)block;
+						operation.data = window;
+						operation.size = blockSize;
+						position += blockSize;
+						literalStart = position;
+						rolling = false;
+						return true;
+					}
+					if (position - literalStart >= (size_t)maxLiteral)
+						return TakeLiteral(operation, literalStart + maxLiteral);
+					if (available > (size_t)blockSize)
+					{
+						checksum.Roll(window[0], window[blockSize]);
+						position++;
+						continue;
+					}
+				}
+				if (!finished)
+				{
+					// the window needs more of the file; bytes before it are literal for certain, and without blocks to
+					// match against so is everything fed
+					const size_t certain = matching ? position : buffer.size();
+					if (certain - literalStart >= (size_t)maxLiteral)
+						return TakeLiteral(operation, literalStart + maxLiteral);
+					return false;
+				}
+
+				// no block starts in what is left (or there is nothing to match against), it is literal
+				position = buffer.size();
+				rolling = false;
+				if (position == literalStart)
+					return false;
+				return TakeLiteral(operation, std::min(position, literalStart + maxLiteral));
+			}
+		}
+
+	private:
+
+		// hand out the literal bytes from literalStart to end
+		bool TakeLiteral(Operation& operation, size_t end)
+		{
+			operation.copy = false;
+			operation.offset = base + literalStart;
+			operation.block = 0;
+			operation.data = &buffer[literalStart];
+			operation.size = (int)(end - literalStart);
+			literalStart = end;
+			if (position < literalStart)
+			{
+				position = literalStart;
+				rolling = false;
+			}
+			return true;
+		}
+
+		const SignatureIndex* index;
+		int blockSize;
+		int maxLiteral;
+		std::vector<unsigned char> buffer;	// the file from base on
+		uint64_t base;						// file offset of buffer[0]
+		size_t literalStart;				// first byte not handed out yet
+		size_t position;					// start of the window
+		RollingChecksum checksum;			// of the window, when rolling
+		bool rolling;
+		bool finished;
+	};
+}
+
+#endif
@@ -0,0 +1,301 @@
+/*
+	Large file access
+	  + 64-bit sizes and offsets everywhere, so files past 2 and 4 GB behave like any other
+	  + reads and writes are positional (pread/pwrite, or overlapped offsets on Windows), so a stage never depends on a
+	    shared file position and writes can land wherever their offset says
+	  + SetSize extends a file without writing it, which leaves a sparse hole on filesystems that support them
+	  + ListFiles and CreateParentDirectories walk and rebuild directory trees for batch transfers; paths inside a
+	    tree are relative and separated by '/' on every platform
+  + RenameOver moves a finished file over the one it replaces, for updates written beside the original
+*/
+
+#ifndef LARGE_FILE_H
+#define LARGE_FILE_H
+
+#include <stdio.h>
+
+#include "Net.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#if PLATFORM == PLATFORM_WINDOWS
+#include <winioctl.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#endif
+
+namespace net
+{
+#if PLATFORM != PLATFORM_WINDOWS
+	static_assert(sizeof(off_t) >= 8, "large files need a 64-bit off_t, build with -D_FILE_OFFSET_BITS=64");
+#endif
+
+	class LargeFile
+	{
+	public:
+
+		enum Mode
+		{
+			Reading,
+			Writing,	// created if missing, truncated if not
+			Updating	// read and written, created if missing, kept as it is if not; other handles may update it too
+		};
+
+		LargeFile()
+		{
+#if PLATFORM == PLATFORM_WINDOWS
+			handle = INVALID_HANDLE_VALUE;
+#else
+			handle = -1;
+#endif
+		}
+
+		~LargeFile()
+		{
+			Close();
+		}
+
+		bool Open(const std::string& path, Mode mode)
+		{
+			assert(!IsOpen());
+#if PLATFORM == PLATFORM_WINDOWS
+			handle = CreateFileA(path.c_str(), mode == Reading ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+				mode == Updating ? FILE_SHARE_READ | FILE_SHARE_WRITE : FILE_SHARE_READ, NULL,
+				mode == Reading ? OPEN_EXISTING : mode == Writing ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (handle != INVALID_HANDLE_VALUE && mode == Writing)
+			{
+				// NTFS only leaves holes in files marked sparse
+				DWORD returned = 0;
+				DeviceIoControl(handle, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &returned, NULL);
+			}
+#else
+			int flags = mode == Reading ? O_RDONLY : mode == Writing ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR | O_CREAT;
+#ifdef O_LARGEFILE
+			flags |= O_LARGEFILE;
+#endif
+			handle = open(path.c_str(), flags, 0644);
+#endif
+			return IsOpen();
+		}
+
+		void Close()
+		{
+			if (!IsOpen())
+				return;
+#if PLATFORM == PLATFORM_WINDOWS
+			CloseHandle(handle);
+			handle = INVALID_HANDLE_VALUE;
+#else
+			close(handle);
+			handle = -1;
+#endif
+		}
+
+		bool IsOpen() const
+		{
+#if PLATFORM == PLATFORM_WINDOWS
+			return handle != INVALID_HANDLE_VALUE;
+#else
+			return handle >= 0;
+#endif
+		}
+
+		// current size in bytes, zero if it cannot be read
+		uint64_t GetSize() const
+		{
+#if PLATFORM == PLATFORM_WINDOWS
+			LARGE_INTEGER size;
+			return GetFileSizeEx(handle, &size) ? (uint64_t)size.QuadPart : 0;
+#else
+			struct stat status;
+			return fstat(handle, &status) == 0 ? (uint64_t)status.st_size : 0;
+#endif
+		}
+
+		// grow (or cut) the file to size bytes; growing writes nothing, the new bytes read as zero
+		bool SetSize(uint64_t size)
+		{
+#if PLATFORM == PLATFORM_WINDOWS
+			FILE_END_OF_FILE_INFO end;
+			end.EndOfFile.QuadPart = (LONGLONG)size;
+			return SetFileInformationByHandle(handle, FileEndOfFileInfo, &end, sizeof(end)) != 0;
+#else
+			return ftruncate(handle, (off_t)size) == 0;
+#endif
+		}
+
+		// read up to size bytes at offset, returns the bytes read (short only at the end of the file) or -1 on error
+		int Read(uint64_t offset, void* data, int size)
+		{
+			int total = 0;
+			while (total < size)
+			{
+#if PLATFORM == PLATFORM_WINDOWS
+				OVERLAPPED position = OVERLAPPED();
+				position.Offset = (DWORD)(offset + total);
+				position.OffsetHigh = (DWORD)((offset + total) >> 32);
+				DWORD bytes = 0;
+				if (!ReadFile(handle, (char*)data + total, (DWORD)(size - total), &bytes, &position))
+					return GetLastError() == ERROR_HANDLE_EOF ? total : -1;
+#else
+				const ssize_t bytes = pread(handle, (char*)data + total, (size_t)(size - total), (off_t)(offset + total));
+				if (bytes < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return -1;
+				}
+#endif
+				if (bytes == 0)
+					break;
+				total += (int)bytes;
+			}
+			return total;
+		}
+
+		// write all size bytes at offset, extending the file if they go past its end
+		bool Write(uint64_t offset, const void* data, int size)
+		{
+			int total = 0;
+			while (total < size)
+			{
+#if PLATFORM == PLATFORM_WINDOWS
+				OVERLAPPED position = OVERLAPPED();
+				position.Offset = (DWORD)(offset + total);
+				position.OffsetHigh = (DWORD)((offset + total) >> 32);
+				DWORD bytes = 0;
+				if (!WriteFile(handle, (const char*)data + total, (DWORD)(size - total), &bytes, &position))
+					return false;
+#else
+				const ssize_t bytes = pwrite(handle, (const char*)data + total, (size_t)(size - total), (off_t)(offset + total));
+				if (bytes < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+#endif
+				if (bytes == 0)
+					return false;
+				total += (int)bytes;
+			}
+			return true;
+		}
+
+	private:
+
+#if PLATFORM == PLATFORM_WINDOWS
+		HANDLE handle;
+#else
+		int handle;
+#endif
+	};
+
+	// a regular file found by ListFiles
+	struct DirectoryEntry
+	{
+		std::string path;		// relative to the root
+		uint64_t size;
+
+		bool operator<(const DirectoryEntry& other) const
+		{
+			return path < other.path;
+		}
+	};
+
+	// adds the regular files below root/relative to files, descending into subdirectories (links are not followed)
+	inline bool ListDirectory(const std::string& root, const std::string& relative, std::vector<DirectoryEntry>& files)
+	{
+#if PLATFORM == PLATFORM_WINDOWS
+		WIN32_FIND_DATAA entry;
+		HANDLE find = FindFirstFileA((root + "/" + relative + "*").c_str(), &entry);
+		if (find == INVALID_HANDLE_VALUE)
+			return false;
+		do
+		{
+			const std::string name = entry.cFileName;
+			if (name == "." || name == ".." || (entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+				continue;
+			if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				ListDirectory(root, relative + name + "/", files);
+			else
+			{
+				DirectoryEntry file = { relative + name, ((uint64_t)entry.nFileSizeHigh << 32) | entry.nFileSizeLow };
+				files.push_back(file);
+			}
+		}
+		while (FindNextFileA(find, &entry));
+		FindClose(find);
+#else
+		DIR* directory = opendir((root + "/" + relative).c_str());
+		if (directory == NULL)
+			return false;
+		while (dirent* entry = readdir(directory))
+		{
+			const std::string name = entry->d_name;
+			struct stat status;
+			if (name == "." || name == ".." || lstat((root + "/" + relative + name).c_str(), &status) != 0)
+				continue;
+			if (S_ISDIR(status.st_mode))
+				ListDirectory(root, relative + name + "/", files);
+			else if (S_ISREG(status.st_mode))
+			{
+				DirectoryEntry file = { relative + name, (uint64_t)status.st_size };
+				files.push_back(file);
+			}
+		}
+		closedir(directory);
+#endif
+		return true;
+	}
+
+	// relative paths of every regular file in the tree under root, sorted so neighbours share directory prefixes
+	inline bool ListFiles(const std::string& root, std::vector<DirectoryEntry>& files)
+	{
+		files.clear();
+		if (!ListDirectory(root, "", files))
+			return false;
+		std::sort(files.begin(), files.end());
+		return true;
+	}
+
+	// create each missing directory on the way to a file, false if one could not be made
+	inline bool CreateParentDirectories(const std::string& filePath)
+	{
+		for (size_t slash = filePath.find('/', 1); slash != std::string::npos; slash = filePath.find('/', slash + 1))
+		{
+			const std::string directory = filePath.substr(0, slash);
+#if PLATFORM == PLATFORM_WINDOWS
+			if (!CreateDirectoryA(directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+				return false;
+#else
+			if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+				return false;
+#endif
+		}
+		return true;
+	}
+
+	// move the file at from over the one at to, which is replaced if it exists
+	inline bool RenameOver(const std::string& from, const std::string& to)
+	{
+#if PLATFORM == PLATFORM_WINDOWS
+		return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(from.c_str(), to.c_str()) == 0;
+#endif
+	}
+
+	inline bool RemoveFile(const std::string& path)
+	{
+		return remove(path.c_str()) == 0;
+	}
+}
+
+#endif
@@ -0,0 +1,387 @@
+/*
+	In-process link emulator
+	  + sits on a socket's send path and decides what happens to each outgoing datagram before it reaches the wire
+	  + random or Gilbert-Elliott loss, fixed delay with jitter, reordering, duplication and a token bucket bandwidth cap
+	  + a scenario is a list of phases, each starting at a time offset, so loss or delay can change mid transfer
+	  + profiles are written as key=value pairs, inline on the command line or one or more per line in a file
+*/
+
+#ifndef LINK_EMULATOR_H
+#define LINK_EMULATOR_H
+
+#include "Net.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <queue>
+#include <random>
+#include <fstream>
+#include <sstream>
+
+namespace net
+{
+	// impairments applied to outgoing datagrams
+
+	struct LinkProfile
+	{
+		float loss;				// loss probability, in the good state when Gilbert-Elliott is on
+		float burstEnter;		// Gilbert-Elliott: probability of moving from the good to the bad state (zero = independent loss)
+		float burstExit;		// Gilbert-Elliott: probability of moving from the bad back to the good state
+		float burstLoss;		// Gilbert-Elliott: loss probability in the bad state
+		float delay;			// one-way delay in seconds
+		float jitter;			// delay varies uniformly by up to this much either way (packets stay in order)
+		float reorder;			// probability a packet is held back so later packets overtake it
+		float reorderDelay;		// extra hold for reordered packets, seconds
+		float duplicate;		// probability a packet is sent twice
+		float rate;				// bandwidth cap in bytes per second (zero = unlimited)
+		int burst;				// token bucket depth in bytes
+		int queue;				// bytes that may wait for the bandwidth cap before tail drop
+
+		LinkProfile()
+		{
+			loss = 0.0f;
+			burstEnter = 0.0f;
+			burstExit = 0.0f;
+			burstLoss = 0.0f;
+			delay = 0.0f;
+			jitter = 0.0f;
+			reorder = 0.0f;
+			reorderDelay = 0.005f;
+			duplicate = 0.0f;
+			rate = 0.0f;
+			burst = 16 * 1024;
+			queue = 256 * 1024;
+		}
+	};
+
+	struct LinkPhase
+	{
+		float start;			// seconds after the first datagram
+		LinkProfile profile;
+	};
+
+	class LinkEmulator : public PacketShaper
+	{
+	public:
+
+		LinkEmulator()
+		{
+			phases.resize(1);
+			phases[0].start = 0.0f;
+			seed = 1;
+			Reset();
+		}
+
+		// configure from an inline spec ("loss=1%,delay=20ms") or the name of a scenario file
+		//  + keys: loss, burst_enter, burst_exit, burst_loss (percent), delay, jitter, reorder_delay (ms),
+		//    reorder, duplicate (percent), rate (kbps), burst, queue (bytes), seed
+		//  + "at=<seconds>" starts a new phase that inherits every setting of the one before it
+		//  + '#' starts a comment, pairs are separated by commas, semicolons or whitespace
+		bool Configure(const std::string& specOrFile, std::string& error)
+		{
+			std::string text = specOrFile;
+			std::ifstream file(specOrFile.c_str());
+			if (file.is_open())
+			{
+				std::stringstream contents;
+				contents << file.rdbuf();
+				text = contents.str();
+			}
+
+			std::vector<LinkPhase> parsed(1);
+			parsed[0].start = 0.0f;
+			unsigned int parsedSeed = seed;
+
+			size_t position = 0;
+			while (position < text.size())
+			{
+				const char c = text[position];
+				if (c == '#')
+				{
+					while (position < text.size() && text[position] != '\n')
+						position++;
+					continue;
+				}
+				if (c == ',' || c == ';' || isspace((unsigned char)c))
+				{
+					position++;
+					continue;
+				}
+
+				size_t end = position;
+				while (end < text.size() && text[end] != ',' && text[end] != ';' && text[end] != '#' && !isspace((unsigned char)text[end]))
+					end++;
+				const std::string token = text.substr(position, end - position);
+				position = end;
+
+				const size_t equals = token.find('=');
+				if (equals == std::string::npos)
+				{
+					error = "expected key=value, got '" + token + "'";
+					return false;
+				}
+				const std::string key = token.substr(0, equals);
+				const std::string value = token.substr(equals + 1);
+				char* valueEnd = NULL;
+				const double number = strtod(value.c_str(), &valueEnd);
+				if (value.empty() || (*valueEnd != '\0' && *valueEnd != '%' && strcmp(valueEnd, "ms") != 0))
+				{
+					error = "bad value for " + key + ": '" + value + "'";
+					return false;
+				}
+
+				LinkProfile& profile = parsed.back().profile;
+				if (key == "at")
+				{
+					LinkPhase phase = parsed.back();
+					phase.start = (float)number;
+					if (phase.start <= parsed.back().start)
+					{
+						error = "phases must start in increasing time order";
+						return false;
+					}
+					parsed.push_back(phase);
+				}
+				else if (key == "loss")
+					profile.loss = (float)(number / 100.0);
+				else if (key == "burst_enter")
+					profile.burstEnter = (float)(number / 100.0);
+				else if (key == "burst_exit")
+					profile.burstExit = (float)(number / 100.0);
+				else if (key == "burst_loss")
+					profile.burstLoss = (float)(number / 100.0);
+				else if (key == "delay")
+					profile.delay = (float)(number / 1000.0);
+				else if (key == "jitter")
+					profile.jitter = (float)(number / 1000.0);
+				else if (key == "reorder")
+					profile.reorder = (float)(number / 100.0);
+				else if (key == "reorder_delay")
+					profile.reorderDelay = (float)(number / 1000.0);
+				else if (key == "duplicate")
+					profile.duplicate = (float)(number / 100.0);
+				else if (key == "rate")
+					profile.rate = (float)(number * 1000.0 / 8.0);
+				else if (key == "burst")
+					profile.burst = (int)number;
+				else if (key == "queue")
+					profile.queue = (int)number;
+				else if (key == "seed")
+					parsedSeed = (unsigned int)number;
+				else
+				{
+					error = "unknown link setting '" + key + "'";
+					return false;
+				}
+			}
+
+			phases = parsed;
+			seed = parsedSeed;
+			Reset();
+			return true;
+		}
+
+		void Reset()
+		{
+			random.seed(seed);
+			held = std::priority_queue<HeldPacket>();
+			startTime = 0;
+			linkTime = 0;
+			lastArrival = 0;
+			order = 0;
+			bad = false;
+			submitted = 0;
+			dropped = 0;
+			duplicated = 0;
+			reordered = 0;
+		}
+
+		void PrintProfile() const
+		{
+			for (size_t i = 0; i < phases.size(); ++i)
+			{
+				const LinkProfile& p = phases[i].profile;
+				printf("link from %.1fs: loss %.2f%%", phases[i].start, p.loss * 100.0f);
+				if (p.burstEnter > 0.0f)
+					printf(" (bursts: enter %.2f%%, exit %.2f%%, loss %.2f%%)", p.burstEnter * 100.0f, p.burstExit * 100.0f, p.burstLoss * 100.0f);
+				printf(", delay %.1fms +/- %.1fms, reorder %.2f%%, duplicate %.2f%%", p.delay * 1000.0f, p.jitter * 1000.0f, p.reorder * 100.0f, p.duplicate * 100.0f);
+				if (p.rate > 0.0f)
+					printf(", rate %.0fkbps", p.rate * 8.0f / 1000.0f);
+				printf("\n");
+			}
+		}
+
+		void PrintStats() const
+		{
+			printf("link: %llu datagrams, dropped %llu, duplicated %llu, reordered %llu\n",
+				(unsigned long long)submitted, (unsigned long long)dropped, (unsigned long long)duplicated, (unsigned long long)reordered);
+		}
+
+		// true when no datagram is being held back
+		bool IsIdle() const
+		{
+			return held.empty();
+		}
+
+		// PacketShaper
+
+		void Submit(const Address& destination, const void* header, int headerSize, const void* data, int size)
+		{
+			const uint64_t now = GetTimeNs();
+			if (startTime == 0)
+				startTime = now;
+			const LinkProfile& profile = GetProfile(now);
+			const int datagramSize = headerSize + size;
+			submitted++;
+
+			// loss, independent or in bursts
+
+			float lossProbability = profile.loss;
+			if (profile.burstEnter > 0.0f)
+			{
+				bad = bad ? !Chance(profile.burstExit) : Chance(profile.burstEnter);
+				if (bad)
+					lossProbability = profile.burstLoss;
+			}
+			if (Chance(lossProbability))
+			{
+				dropped++;
+				return;
+			}
+
+			// bandwidth cap: a token bucket is a link that may run up to burst bytes ahead of real time
+
+			uint64_t departure = now;
+			if (profile.rate > 0.0f)
+			{
+				const uint64_t burstTime = (uint64_t)(profile.burst / profile.rate * 1e9);
+				if (linkTime + burstTime < now)
+					linkTime = now - burstTime;
+				const uint64_t finish = linkTime + (uint64_t)(datagramSize / profile.rate * 1e9);
+				if (finish > now + (uint64_t)(profile.queue / profile.rate * 1e9))
+				{
+					dropped++;	// queue full, tail drop
+					return;
+				}
+				linkTime = finish;
+				if (finish > departure)
+					departure = finish;
+			}
+
+			const int copies = Chance(profile.duplicate) ? 2 : 1;
+			if (copies == 2)
+				duplicated++;
+
+			for (int copy = 0; copy < copies; ++copy)
+			{
+				// delay and jitter keep packets in order; a reordered packet gets an extra hold and is overtaken
+
+				float delay = profile.delay;
+				if (profile.jitter > 0.0f)
+					delay += profile.jitter * (2.0f * Uniform() - 1.0f);
+				if (delay < 0.0f)
+					delay = 0.0f;
+				uint64_t arrival = departure + (uint64_t)(delay * 1e9);
+
+				if (Chance(profile.reorder))
+				{
+					arrival += (uint64_t)(profile.reorderDelay * 1e9);
+					reordered++;
+				}
+				else
+				{
+					if (arrival < lastArrival)
+						arrival = lastArrival;
+					lastArrival = arrival;
+				}
+
+				HeldPacket packet;
+				packet.release = arrival;
+				packet.order = order++;
+				packet.destination = destination;
+				packet.datagram.resize(datagramSize);
+				memcpy(&packet.datagram[0], header, headerSize);
+				if (size > 0)
+				{
+					memcpy(&packet.datagram[headerSize], data, size);
+					CountPayloadCopy((size_t)size);
+				}
+				held.push(packet);
+			}
+		}
+
+		bool Release(Address& destination, std::vector<unsigned char>& datagram)
+		{
+			if (held.empty() || held.top().release > GetTimeNs())
+				return false;
+			destination = held.top().destination;
+			datagram = held.top().datagram;
+			held.pop();
+			return true;
+		}
+
+		float GetNextRelease() const
+		{
+			if (held.empty())
+				return -1.0f;
+			const uint64_t now = GetTimeNs();
+			return held.top().release > now ? (held.top().release - now) / 1e9f : 0.0f;
+		}
+
+	private:
+
+		struct HeldPacket
+		{
+			uint64_t release;
+			uint64_t order;
+			Address destination;
+			std::vector<unsigned char> datagram;
+
+			// priority_queue puts the largest on top, so invert to release the earliest first
+			bool operator<(const HeldPacket& other) const
+			{
+				return release != other.release ? release > other.release : order > other.order;
+			}
+		};
+
+		const LinkProfile& GetProfile(uint64_t now) const
+		{
+			const float elapsed = (now - startTime) / 1e9f;
+			size_t phase = 0;
+			while (phase + 1 < phases.size() && phases[phase + 1].start <= elapsed)
+				phase++;
+			return phases[phase].profile;
+		}
+
+		float Uniform()
+		{
+			return std::uniform_real_distribution<float>(0.0f, 1.0f)(random);
+		}
+
+		bool Chance(float probability)
+		{
+			return probability > 0.0f && Uniform() < probability;
+		}
+
+		std::vector<LinkPhase> phases;
+		unsigned int seed;
+		std::mt19937 random;
+		std::priority_queue<HeldPacket> held;
+		uint64_t startTime;			// first datagram, phases are timed from here
+		uint64_t linkTime;			// when the capped link finishes sending what it has already accepted
+		uint64_t lastArrival;		// keeps jittered packets in order
+		uint64_t order;
+		bool bad;					// Gilbert-Elliott state
+		uint64_t submitted;
+		uint64_t dropped;
+		uint64_t duplicated;
+		uint64_t reordered;
+	};
+}
+
+#endif
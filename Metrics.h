@@ -0,0 +1,502 @@
+/*
+	Live metrics
+	  + counters, gauges and log-linear (HDR style) histograms updated with relaxed atomics, so the hot path never locks
+	  + a registry names them and renders the Prometheus text format
+	  + an exporter thread serves that text over a local HTTP endpoint or rewrites a file periodically
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "Net.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <fstream>
+
+namespace net
+{
+	// monotonically increasing count
+
+	class Counter
+	{
+	public:
+
+		Counter() : value(0) {}
+
+		void Add(uint64_t amount = 1)
+		{
+			value.fetch_add(amount, std::memory_order_relaxed);
+		}
+
+		uint64_t Get() const
+		{
+			return value.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		std::atomic<uint64_t> value;
+	};
+
+	// value that goes up and down, stored as the bits of a double
+
+	class Gauge
+	{
+	public:
+
+		Gauge() : bits(0) {}
+
+		void Set(double value)
+		{
+			uint64_t b;
+			memcpy(&b, &value, sizeof(b));
+			bits.store(b, std::memory_order_relaxed);
+		}
+
+		double Get() const
+		{
+			const uint64_t b = bits.load(std::memory_order_relaxed);
+			double value;
+			memcpy(&value, &b, sizeof(value));
+			return value;
+		}
+
+	private:
+
+		std::atomic<uint64_t> bits;
+	};
+
+	// distribution of non-negative integer values
+	//  + values below 16 get a bucket each; above that every power of two is split into 8 linear sub-buckets,
+	//    so any value is placed within 12.5% and the whole 64 bit range takes 496 buckets
+	//  + Record is two relaxed adds and a bucket add; quantiles are read from a snapshot of the counts
+
+	class Histogram
+	{
+	public:
+
+		static const int SubBucketBits = 3;
+		static const int SubBuckets = 1 << SubBucketBits;
+		static const int BucketCount = (64 - SubBucketBits) * SubBuckets + SubBuckets;
+
+		Histogram() : count(0), sum(0)
+		{
+			for (int i = 0; i < BucketCount; ++i)
+				buckets[i].store(0, std::memory_order_relaxed);
+		}
+
+		void Record(uint64_t value)
+		{
+			buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+			sum.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		uint64_t GetCount() const
+		{
+			return count.load(std::memory_order_relaxed);
+		}
+
+		uint64_t GetSum() const
+		{
+			return sum.load(std::memory_order_relaxed);
+		}
+
+		// value at or below which the given fraction of the recorded values fall (upper edge of its bucket)
+		uint64_t GetQuantile(double fraction) const
+		{
+			uint64_t total = 0;
+			uint64_t snapshot[BucketCount];
+			for (int i = 0; i < BucketCount; ++i)
+			{
+				snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+				total += snapshot[i];
+			}
+			if (total == 0)
+				return 0;
+			uint64_t rank = (uint64_t)(fraction * total + 0.5);
+			if (rank < 1)
+				rank = 1;
+			uint64_t seen = 0;
+			for (int i = 0; i < BucketCount; ++i)
+			{
+				seen += snapshot[i];
+				if (seen >= rank)
+					return BucketUpperBound(i);
+			}
+			return BucketUpperBound(BucketCount - 1);
+		}
+
+		static int BucketIndex(uint64_t value)
+		{
+			if (value < 2 * SubBuckets)
+				return (int)value;
+			const int shift = HighestBit(value) - SubBucketBits;
+			return shift * SubBuckets + (int)(value >> shift);
+		}
+
+		static uint64_t BucketUpperBound(int index)
+		{
+			if (index < 2 * SubBuckets)
+				return (uint64_t)index;
+			const int shift = index / SubBuckets - 1;
+			const uint64_t top = (uint64_t)(index % SubBuckets + SubBuckets);
+			return ((top + 1) << shift) - 1;
+		}
+
+	private:
+
+		static int HighestBit(uint64_t value)
+		{
+			int bit = 0;
+			for (int step = 32; step > 0; step >>= 1)
+			{
+				if (value >> step)
+				{
+					value >>= step;
+					bit += step;
+				}
+			}
+			return bit;
+		}
+
+		std::atomic<uint64_t> buckets[BucketCount];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+	};
+
+	// named metrics
+	//  + metrics are created once up front and never removed, so the references handed out stay valid
+	//  + registration takes a lock; updating a metric never does
+
+	class MetricsRegistry
+	{
+	public:
+
+		Counter& AddCounter(const std::string& name, const std::string& help)
+		{
+			Entry& entry = Add(name, help, Entry::CounterType);
+			entry.counter.reset(new Counter());
+			return *entry.counter;
+		}
+
+		Gauge& AddGauge(const std::string& name, const std::string& help)
+		{
+			Entry& entry = Add(name, help, Entry::GaugeType);
+			entry.gauge.reset(new Gauge());
+			return *entry.gauge;
+		}
+
+		// histograms are exported as Prometheus summaries; scale converts recorded values to the exported unit
+		Histogram& AddHistogram(const std::string& name, const std::string& help, double scale = 1.0)
+		{
+			Entry& entry = Add(name, help, Entry::HistogramType);
+			entry.histogram.reset(new Histogram());
+			entry.scale = scale;
+			return *entry.histogram;
+		}
+
+		// Prometheus text exposition format, version 0.0.4
+		std::string Render() const
+		{
+			static const double Quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+			std::lock_guard<std::mutex> lock(mutex);
+			std::string text;
+			char line[512];
+			for (size_t i = 0; i < entries.size(); ++i)
+			{
+				const Entry& entry = *entries[i];
+				const char* type = entry.type == Entry::CounterType ? "counter" : entry.type == Entry::GaugeType ? "gauge" : "summary";
+				snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", entry.name.c_str(), entry.help.c_str(), entry.name.c_str(), type);
+				text += line;
+				if (entry.type == Entry::CounterType)
+				{
+					snprintf(line, sizeof(line), "%s %llu\n", entry.name.c_str(), (unsigned long long)entry.counter->Get());
+					text += line;
+				}
+				else if (entry.type == Entry::GaugeType)
+				{
+					snprintf(line, sizeof(line), "%s %.9g\n", entry.name.c_str(), entry.gauge->Get());
+					text += line;
+				}
+				else
+				{
+					for (size_t q = 0; q < sizeof(Quantiles) / sizeof(Quantiles[0]); ++q)
+					{
+						snprintf(line, sizeof(line), "%s{quantile=\"%g\"} %.9g\n", entry.name.c_str(), Quantiles[q],
+							entry.histogram->GetQuantile(Quantiles[q]) * entry.scale);
+						text += line;
+					}
+					snprintf(line, sizeof(line), "%s_sum %.9g\n%s_count %llu\n", entry.name.c_str(), entry.histogram->GetSum() * entry.scale,
+						entry.name.c_str(), (unsigned long long)entry.histogram->GetCount());
+					text += line;
+				}
+			}
+			return text;
+		}
+
+	private:
+
+		struct Entry
+		{
+			enum Type { CounterType, GaugeType, HistogramType };
+			std::string name;
+			std::string help;
+			Type type;
+			double scale;
+			std::unique_ptr<Counter> counter;
+			std::unique_ptr<Gauge> gauge;
+			std::unique_ptr<Histogram> histogram;
+		};
+
+		Entry& Add(const std::string& name, const std::string& help, Entry::Type type)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			entries.push_back(std::unique_ptr<Entry>(new Entry()));
+			Entry& entry = *entries.back();
+			entry.name = name;
+			entry.help = help;
+			entry.type = type;
+			entry.scale = 1.0;
+			return entry;
+		}
+
+		mutable std::mutex mutex;
+		std::vector<std::unique_ptr<Entry> > entries;
+	};
+
+	// reliability events turned into metrics, attach with ReliabilitySystem::SetObserver
+	//  + prefix keeps the client and server (or several connections) apart in one registry
+
+	class ReliabilityMetrics : public ReliabilityObserver
+	{
+	public:
+
+		ReliabilityMetrics(MetricsRegistry& registry, const std::string& prefix)
+			: packetsSent(registry.AddCounter(prefix + "_packets_sent_total", "Packets sent with a sequence number.")),
+			  bytesSent(registry.AddCounter(prefix + "_payload_bytes_sent_total", "Payload bytes of the packets sent.")),
+			  packetsReceived(registry.AddCounter(prefix + "_packets_received_total", "New packets received (duplicates not counted).")),
+			  bytesReceived(registry.AddCounter(prefix + "_payload_bytes_received_total", "Payload bytes of the packets received.")),
+			  packetsAcked(registry.AddCounter(prefix + "_packets_acked_total", "Sent packets the peer has acknowledged.")),
+			  packetsLost(registry.AddCounter(prefix + "_packets_lost_total", "Sent packets never acknowledged within the rtt limit.")),
+			  rtt(registry.AddHistogram(prefix + "_rtt_seconds", "Round trip time samples.", 1e-9))
+		{
+		}
+
+		void OnPacketSent(unsigned int, int size)
+		{
+			packetsSent.Add();
+			bytesSent.Add((uint64_t)size);
+		}
+
+		void OnPacketReceived(unsigned int, int size)
+		{
+			packetsReceived.Add();
+			bytesReceived.Add((uint64_t)size);
+		}
+
+		void OnPacketAcked(unsigned int)
+		{
+			packetsAcked.Add();
+		}
+
+		void OnPacketLost(unsigned int)
+		{
+			packetsLost.Add();
+		}
+
+		void OnRoundTripTime(uint64_t sample)
+		{
+			rtt.Record(sample);
+		}
+
+	private:
+
+		Counter& packetsSent;
+		Counter& bytesSent;
+		Counter& packetsReceived;
+		Counter& bytesReceived;
+		Counter& packetsAcked;
+		Counter& packetsLost;
+		Histogram& rtt;
+	};
+
+	// publishes a registry from a background thread
+	//  + StartHttp answers every request on 127.0.0.1:port with the current metrics (point a Prometheus scrape at /metrics)
+	//  + StartFile rewrites a file every interval, through a temporary file so readers never see half of it
+
+	class MetricsExporter
+	{
+	public:
+
+		explicit MetricsExporter(const MetricsRegistry& registry) : registry(registry)
+		{
+			listener = 0;
+			interval = 1.0f;
+			stopping = false;
+		}
+
+		~MetricsExporter()
+		{
+			Stop();
+		}
+
+		bool StartHttp(unsigned short port)
+		{
+			assert(!thread.joinable());
+
+			listener = (int)::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+			if (listener <= 0)
+			{
+				listener = 0;
+				return false;
+			}
+
+			int reuse = 1;
+			setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+			sockaddr_in address;
+			memset(&address, 0, sizeof(address));
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			address.sin_port = htons(port);
+
+			if (bind(listener, (const sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 8) < 0)
+			{
+				CloseSocket(listener);
+				listener = 0;
+				return false;
+			}
+
+			thread = std::thread(&MetricsExporter::ServeHttp, this);
+			return true;
+		}
+
+		bool StartFile(const std::string& path, float interval)
+		{
+			assert(!thread.joinable());
+			this->path = path;
+			this->interval = interval;
+			if (!WriteFile())
+				return false;
+			thread = std::thread(&MetricsExporter::ServeFile, this);
+			return true;
+		}
+
+		void Stop()
+		{
+			stopping = true;
+			if (thread.joinable())
+				thread.join();
+			if (listener)
+			{
+				CloseSocket(listener);
+				listener = 0;
+			}
+			if (!path.empty())
+				WriteFile();	// leave the final values behind
+		}
+
+	private:
+
+		void ServeHttp()
+		{
+			while (!stopping)
+			{
+				// poll for connections so Stop is noticed within a tenth of a second
+				fd_set readSet;
+				FD_ZERO(&readSet);
+				FD_SET(listener, &readSet);
+				timeval timeout;
+				timeout.tv_sec = 0;
+				timeout.tv_usec = 100000;
+				if (select(listener + 1, &readSet, NULL, NULL, &timeout) <= 0)
+					continue;
+
+				const int client = (int)accept(listener, NULL, NULL);
+				if (client <= 0)
+					continue;
+
+				// the request itself does not matter, read what has arrived so closing does not reset the connection
+				char request[1024];
+				recv(client, request, sizeof(request), 0);
+
+				const std::string body = registry.Render();
+				char header[256];
+				snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", (int)body.size());
+				const std::string response = header + body;
+				SendAll(client, response.c_str(), (int)response.size());
+				CloseSocket(client);
+			}
+		}
+
+		void ServeFile()
+		{
+			while (!stopping)
+			{
+				for (float waited = 0.0f; waited < interval && !stopping; waited += 0.1f)
+					wait(0.1f);
+				WriteFile();
+			}
+		}
+
+		bool WriteFile()
+		{
+			const std::string temporary = path + ".tmp";
+			{
+				std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+				if (!file.is_open())
+					return false;
+				const std::string text = registry.Render();
+				file.write(text.c_str(), text.size());
+			}
+#if PLATFORM == PLATFORM_WINDOWS
+			remove(path.c_str());
+#endif
+			return rename(temporary.c_str(), path.c_str()) == 0;
+		}
+
+		static void SendAll(int socket, const char* data, int size)
+		{
+#ifdef MSG_NOSIGNAL
+			const int flags = MSG_NOSIGNAL;		// a scraper hanging up early must not raise SIGPIPE
+#else
+			const int flags = 0;
+#endif
+			while (size > 0)
+			{
+				const int sent = (int)send(socket, data, size, flags);
+				if (sent <= 0)
+					return;
+				data += sent;
+				size -= sent;
+			}
+		}
+
+		static void CloseSocket(int socket)
+		{
+#if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
+			close(socket);
+#elif PLATFORM == PLATFORM_WINDOWS
+			closesocket(socket);
+#endif
+		}
+
+		const MetricsRegistry& registry;
+		int listener;
+		std::string path;
+		float interval;
+		std::atomic<bool> stopping;
+		std::thread thread;
+	};
+}
+
+#endif
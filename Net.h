@@ -9,6 +9,11 @@
 #define NET_H
 
 #include <cstring> // for memcpy
+#include <stdint.h>
+#include <chrono>
+#include <atomic>
+
+#include "Crypto.h"
 
 // platform detection
 
@@ -28,10 +33,14 @@
 
 #include <winsock2.h>
 #pragma comment( lib, "wsock32.lib" )
+#pragma comment( lib, "ws2_32.lib" )
 
 #elif PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
 
 #include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <netinet/in.h>
 #include <fcntl.h>
 
@@ -48,13 +57,12 @@
 #include <list>
 #include <algorithm>
 #include <functional>
+#include <memory>
+#include <math.h>
 
 namespace net
 {
 
-	// Added constant
-	const int PacketSizeHack = 384;
-
 	// platform independent wait for n seconds
 
 #if PLATFORM == PLATFORM_WINDOWS
@@ -71,6 +79,28 @@ namespace net
 
 #endif
 
+	// monotonic time in nanoseconds, used to timestamp packets for rtt measurement
+
+	inline uint64_t GetTimeNs()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// payload bytes copied on their way between a file and a socket, across the process, for benchmarks
+	//  + every place that memcpys a payload instead of passing it through (packing, the link emulator, capture) adds
+	//    what it copied, so a plain transfer, which gathers from and scatters into the chunk buffers, counts none
+
+	inline std::atomic<uint64_t>& PayloadBytesCopied()
+	{
+		static std::atomic<uint64_t> bytes(0);
+		return bytes;
+	}
+
+	inline void CountPayloadCopy(size_t bytes)
+	{
+		PayloadBytesCopied().fetch_add((uint64_t)bytes, std::memory_order_relaxed);
+	}
+
 	// internet address
 
 	class Address
@@ -171,6 +201,54 @@ namespace net
 #endif
 	}
 
+	// hook on a socket's send path, lets a link emulator drop, delay, duplicate or reorder outgoing datagrams
+	//  + the socket hands every datagram to Submit and puts on the wire whatever Release gives back
+
+	class PacketShaper
+	{
+	public:
+
+		virtual ~PacketShaper() {}
+
+		// take a copy of an outgoing datagram (header followed by data)
+		virtual void Submit(const Address& destination, const void* header, int headerSize, const void* data, int size) = 0;
+
+		// next datagram that is due on the wire, false if none is due yet
+		virtual bool Release(Address& destination, std::vector<unsigned char>& datagram) = 0;
+
+		// seconds until the next held datagram is due, negative if nothing is held
+		virtual float GetNextRelease() const = 0;
+	};
+
+	// hook on a socket that sees every datagram it puts on or takes off the wire, for packet capture
+	//  + called on the thread using the socket, so implementations should copy the datagram and return quickly
+
+	class PacketCapture
+	{
+	public:
+
+		virtual ~PacketCapture() {}
+
+		// one datagram (header followed by data) sent to or received from peer by the socket bound to localPort
+		virtual void Capture(bool outgoing, const Address& peer, unsigned short localPort, const void* header, int headerSize, const void* data, int size) = 0;
+	};
+
+	// system calls made by a socket, for benchmarks (empty receives and timed out waits count too)
+
+	struct SocketCounters
+	{
+		uint64_t sends;
+		uint64_t receives;
+		uint64_t waits;
+
+		SocketCounters()
+		{
+			sends = 0;
+			receives = 0;
+			waits = 0;
+		}
+	};
+
 	class Socket
 	{
 	public:
@@ -178,6 +256,10 @@ namespace net
 		Socket()
 		{
 			socket = 0;
+			receiveTime = 0;
+			shaper = NULL;
+			capture = NULL;
+			localPort = 0;
 		}
 
 		~Socket()
@@ -185,7 +267,8 @@ namespace net
 			Close();
 		}
 
-		bool Open(unsigned short port)
+		// bindAddress picks the local interface to send and receive on, zero for all of them
+		bool Open(unsigned short port, unsigned int bindAddress = 0)
 		{
 			assert(!IsOpen());
 
@@ -204,7 +287,7 @@ namespace net
 
 			sockaddr_in address;
 			address.sin_family = AF_INET;
-			address.sin_addr.s_addr = INADDR_ANY;
+			address.sin_addr.s_addr = bindAddress != 0 ? htonl(bindAddress) : INADDR_ANY;
 			address.sin_port = htons((unsigned short)port);
 
 			if (::bind(socket, (const sockaddr*)&address, sizeof(sockaddr_in)) < 0)
@@ -214,6 +297,8 @@ namespace net
 				return false;
 			}
 
+			localPort = port;
+
 			// set non-blocking io
 
 #if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
@@ -236,6 +321,13 @@ namespace net
 				return false;
 			}
 
+#endif
+
+			// ask the kernel to stamp each datagram on arrival, so time spent queued in the socket is not counted as rtt
+
+#ifdef SO_TIMESTAMPNS
+			int timestamps = 1;
+			setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &timestamps, sizeof(timestamps));
 #endif
 
 			return true;
@@ -267,6 +359,65 @@ namespace net
 			if (socket == 0)
 				return false;
 
+			if (shaper)
+			{
+				shaper->Submit(destination, data, size, NULL, 0);
+				FlushShaper();
+				return true;
+			}
+
+			return SendTo(destination, data, size);
+		}
+
+		int Receive(Address& sender, void* data, int size)
+		{
+			assert(data);
+			assert(size > 0);
+
+			if (socket == 0)
+				return false;
+
+#if PLATFORM == PLATFORM_WINDOWS
+			typedef int socklen_t;
+#endif
+
+			sockaddr_in from;
+			socklen_t fromLength = sizeof(from);
+
+			counters.receives++;
+			int received_bytes = recvfrom(socket, (char*)data, size, 0, (sockaddr*)&from, &fromLength);
+
+			if (received_bytes <= 0)
+				return 0;
+
+			unsigned int address = ntohl(from.sin_addr.s_addr);
+			unsigned short port = ntohs(from.sin_port);
+
+			sender = Address(address, port);
+
+			if (capture)
+				capture->Capture(false, sender, localPort, data, received_bytes, NULL, 0);
+
+			return received_bytes;
+		}
+
+		// gather send: the header and payload buffers go out as one datagram without being copied together
+		bool Send(const Address& destination, const void* header, int headerSize, const void* data, int size)
+		{
+			assert(header);
+			assert(headerSize > 0);
+			assert(size >= 0);
+
+			if (socket == 0)
+				return false;
+
+			if (shaper)
+			{
+				shaper->Submit(destination, header, headerSize, data, size);
+				FlushShaper();
+				return true;
+			}
+
 			assert(destination.GetAddress() != 0);
 			assert(destination.GetPort() != 0);
 
@@ -275,50 +426,505 @@ namespace net
 			address.sin_addr.s_addr = htonl(destination.GetAddress());
 			address.sin_port = htons((unsigned short)destination.GetPort());
 
-			int sent_bytes = sendto(socket, (const char*)data, size, 0, (sockaddr*)&address, sizeof(sockaddr_in));
+#if PLATFORM == PLATFORM_WINDOWS
+
+			WSABUF buffers[2];
+			buffers[0].buf = (char*)header;
+			buffers[0].len = headerSize;
+			buffers[1].buf = (char*)data;
+			buffers[1].len = size;
+
+			DWORD sent_bytes = 0;
+			counters.sends++;
+			if (WSASendTo(socket, buffers, size > 0 ? 2 : 1, &sent_bytes, 0, (sockaddr*)&address, sizeof(sockaddr_in), NULL, NULL) != 0)
+				return false;
+
+#else
+
+			iovec buffers[2];
+			buffers[0].iov_base = (void*)header;
+			buffers[0].iov_len = headerSize;
+			buffers[1].iov_base = (void*)data;
+			buffers[1].iov_len = size;
+
+			msghdr message;
+			memset(&message, 0, sizeof(message));
+			message.msg_name = &address;
+			message.msg_namelen = sizeof(sockaddr_in);
+			message.msg_iov = buffers;
+			message.msg_iovlen = size > 0 ? 2 : 1;
+
+			counters.sends++;
+			int sent_bytes = (int)sendmsg(socket, &message, 0);
+
+#endif
 
-			return sent_bytes == size;
+			if ((int)sent_bytes != headerSize + size)
+				return false;
+
+			if (capture)
+				capture->Capture(true, destination, localPort, header, headerSize, data, size);
+
+			return true;
 		}
 
-		int Receive(Address& sender, void* data, int size)
+		// scatter receive: the first headerSize bytes land in header and the rest directly in data
+		// returns the total datagram size received (header included), or zero if nothing was waiting
+		int Receive(Address& sender, void* header, int headerSize, void* data, int size)
 		{
+			assert(header);
+			assert(headerSize > 0);
 			assert(data);
 			assert(size > 0);
 
 			if (socket == 0)
 				return false;
 
+			FlushShaper();
+
+			sockaddr_in from;
+
 #if PLATFORM == PLATFORM_WINDOWS
-			typedef int socklen_t;
+
+			WSABUF buffers[2];
+			buffers[0].buf = (char*)header;
+			buffers[0].len = headerSize;
+			buffers[1].buf = (char*)data;
+			buffers[1].len = size;
+
+			int fromLength = sizeof(from);
+			DWORD received_bytes = 0;
+			DWORD flags = 0;
+			counters.receives++;
+			if (WSARecvFrom(socket, buffers, 2, &received_bytes, &flags, (sockaddr*)&from, &fromLength, NULL, NULL) != 0)
+				return 0;
+
+#else
+
+			iovec buffers[2];
+			buffers[0].iov_base = header;
+			buffers[0].iov_len = headerSize;
+			buffers[1].iov_base = data;
+			buffers[1].iov_len = size;
+
+#ifdef SO_TIMESTAMPNS
+			char control[CMSG_SPACE(sizeof(timespec))];
 #endif
 
-			sockaddr_in from;
-			socklen_t fromLength = sizeof(from);
+			msghdr message;
+			memset(&message, 0, sizeof(message));
+			message.msg_name = &from;
+			message.msg_namelen = sizeof(from);
+			message.msg_iov = buffers;
+			message.msg_iovlen = 2;
+#ifdef SO_TIMESTAMPNS
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
+#endif
 
-			int received_bytes = recvfrom(socket, (char*)data, size, 0, (sockaddr*)&from, &fromLength);
+			counters.receives++;
+			int received_bytes = (int)recvmsg(socket, &message, 0);
 
-			if (received_bytes <= 0)
+#endif
+
+			if ((int)received_bytes <= 0)
 				return 0;
 
+			receiveTime = GetTimeNs();
+
+#ifdef SO_TIMESTAMPNS
+			// the kernel stamp is wall clock time, so move it onto the monotonic clock by the packet's age
+			for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header))
+			{
+				if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_TIMESTAMPNS)
+				{
+					timespec stamp;
+					memcpy(&stamp, CMSG_DATA(header), sizeof(stamp));
+					timespec wall;
+					clock_gettime(CLOCK_REALTIME, &wall);
+					const int64_t age = ((int64_t)wall.tv_sec - (int64_t)stamp.tv_sec) * 1000000000 + ((int64_t)wall.tv_nsec - (int64_t)stamp.tv_nsec);
+					if (age > 0 && (uint64_t)age < receiveTime)
+						receiveTime -= (uint64_t)age;
+				}
+			}
+#endif
+
 			unsigned int address = ntohl(from.sin_addr.s_addr);
 			unsigned short port = ntohs(from.sin_port);
 
 			sender = Address(address, port);
 
-			return received_bytes;
+			if (capture)
+			{
+				const int dataBytes = (int)received_bytes > headerSize ? (int)received_bytes - headerSize : 0;
+				capture->Capture(false, sender, localPort, header, (int)received_bytes - dataBytes, data, dataBytes);
+			}
+
+			return (int)received_bytes;
+		}
+
+		// block until a datagram is waiting or the timeout expires
+		bool WaitForData(float seconds)
+		{
+			if (socket == 0)
+				return false;
+
+			// wake in time to put held datagrams on the wire
+			FlushShaper();
+			if (shaper && shaper->GetNextRelease() >= 0.0f && shaper->GetNextRelease() < seconds)
+				seconds = shaper->GetNextRelease();
+
+			fd_set readSet;
+			FD_ZERO(&readSet);
+			FD_SET(socket, &readSet);
+
+			timeval timeout;
+			timeout.tv_sec = (long)seconds;
+			timeout.tv_usec = (long)((seconds - (float)timeout.tv_sec) * 1000000.0f);
+
+			counters.waits++;
+			return select(socket + 1, &readSet, NULL, NULL, &timeout) > 0;
+		}
+
+		// arrival time of the last datagram from the scatter Receive (GetTimeNs clock)
+		uint64_t GetReceiveTime() const
+		{
+			return receiveTime;
+		}
+
+		const SocketCounters& GetCounters() const
+		{
+			return counters;
+		}
+
+		// route outgoing datagrams through a shaper (null sends straight to the wire)
+		void SetShaper(PacketShaper* shaper)
+		{
+			this->shaper = shaper;
+		}
+
+		// mirror every datagram sent or received to a capture (null for none)
+		void SetCapture(PacketCapture* capture)
+		{
+			this->capture = capture;
+		}
+
+		// send whatever the shaper has made due
+		void FlushShaper()
+		{
+			if (!shaper)
+				return;
+			Address destination;
+			while (shaper->Release(destination, shaperDatagram))
+				SendTo(destination, &shaperDatagram[0], (int)shaperDatagram.size());
 		}
 
 	private:
 
+		bool SendTo(const Address& destination, const void* data, int size)
+		{
+			assert(destination.GetAddress() != 0);
+			assert(destination.GetPort() != 0);
+
+			sockaddr_in address;
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(destination.GetAddress());
+			address.sin_port = htons((unsigned short)destination.GetPort());
+
+			counters.sends++;
+			int sent_bytes = sendto(socket, (const char*)data, size, 0, (sockaddr*)&address, sizeof(sockaddr_in));
+
+			if (sent_bytes != size)
+				return false;
+
+			if (capture)
+				capture->Capture(true, destination, localPort, data, size, NULL, 0);
+
+			return true;
+		}
+
 		int socket;
+		uint64_t receiveTime;
+		PacketShaper* shaper;
+		std::vector<unsigned char> shaperDatagram;	// reused for datagrams coming out of the shaper
+		PacketCapture* capture;
+		unsigned short localPort;
+		SocketCounters counters;
+	};
+
+	// timer wheel
+	//  + hierarchical: four levels of 64 slots, a tick of a millisecond at the bottom and each level up 64 times
+	//    coarser, so a deadline up to about 4.6 hours out is placed with a shift and a mask; one further out waits in
+	//    the top level and is placed again when its slot comes round
+	//  + timers are intrusive list nodes embedded in whatever owns them, so scheduling and cancelling are a few pointer
+	//    swaps and never allocate, however many timers are out
+	//  + when the level below wraps, a level's next slot is cascaded down; a tick's due timers are taken off the wheel
+	//    together before any callback runs, so a callback may schedule or cancel any timer, itself included
+	//  + a bitmask of possibly occupied slots per level lets Advance skip runs of empty ticks
+	//  + the clock is only what Advance is told, so the wheel runs on simulated time as well as real time
+	//  + not thread safe, a wheel belongs to the thread that drives its connections
+
+	struct TimerLink
+	{
+		TimerLink* next;
+		TimerLink* prev;
+	};
+
+	// a deadline on a timer wheel; it must not outlive the wheel while it is scheduled
+	class Timer : private TimerLink
+	{
+	public:
+
+		explicit Timer(const std::function<void()>& callback = std::function<void()>())
+			: expires(0), callback(callback)
+		{
+			next = NULL;
+			prev = NULL;
+		}
+
+		~Timer()
+		{
+			Cancel();
+		}
+
+		bool IsScheduled() const
+		{
+			return next != NULL;
+		}
+
+		void Cancel()
+		{
+			if (next == NULL)
+				return;
+			next->prev = prev;
+			prev->next = next;
+			next = NULL;
+			prev = NULL;
+		}
+
+	private:
+
+		friend class TimerWheel;
+
+		Timer(const Timer& other);
+		Timer& operator=(const Timer& other);
+
+		uint64_t expires;						// tick the timer is due
+		std::function<void()> callback;
+	};
+
+	class TimerWheel
+	{
+	public:
+
+		static const int LevelBits = 6;
+		static const int Slots = 1 << LevelBits;
+		static const int Levels = 4;
+		static const int TicksPerSecond = 1000;
+
+		TimerWheel() : time(0.0), current(0)
+		{
+			for (int level = 0; level < Levels; ++level)
+			{
+				for (int slot = 0; slot < Slots; ++slot)
+					Clear(slots[level][slot]);
+				occupied[level] = 0;
+			}
+		}
+
+		// timers still out are left unscheduled rather than pointing into a wheel that is gone
+		~TimerWheel()
+		{
+			for (int level = 0; level < Levels; ++level)
+			{
+				for (int slot = 0; slot < Slots; ++slot)
+				{
+					TimerLink& head = slots[level][slot];
+					while (head.next != &head)
+						static_cast<Timer*>(head.next)->Cancel();
+				}
+			}
+		}
+
+		// seconds the wheel has been advanced
+		double GetTime() const
+		{
+			return time;
+		}
+
+		// run the timer delay seconds from now, moving it if it is out already; it comes due at the first tick at or
+		// after the deadline, and never on the tick being run
+		void Schedule(Timer& timer, double delay)
+		{
+			ScheduleAt(timer, time + delay);
+		}
+
+		void ScheduleAt(Timer& timer, double when)
+		{
+			timer.Cancel();
+			const double tick = ceil(when * TicksPerSecond);
+			timer.expires = tick > (double)current ? (uint64_t)tick : current + 1;
+			Place(timer);
+		}
+
+		// move the clock on and run every timer that came due, a tick at a time
+		void Advance(float deltaTime)
+		{
+			time += deltaTime;
+			const uint64_t target = (uint64_t)(time * TicksPerSecond);
+			while (current < target)
+			{
+				current = GetNextTick(target);
+				if ((current & (Slots - 1)) == 0)
+					Cascade();
+				Expire(slots[0][current & (Slots - 1)], 0);
+			}
+		}
+
+	private:
+
+		TimerWheel(const TimerWheel& other);
+		TimerWheel& operator=(const TimerWheel& other);
+
+		static void Clear(TimerLink& head)
+		{
+			head.next = &head;
+			head.prev = &head;
+		}
+
+		static int LowestBit(uint64_t bits)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_ctzll(bits);
+#else
+			int bit = 0;
+			while (!(bits & 1))
+			{
+				bits >>= 1;
+				bit++;
+			}
+			return bit;
+#endif
+		}
+
+		// the first tick after the current one that expires or cascades a slot that may hold timers, at most limit
+		//  + a level's slots come round a block of its ticks at a time, so the next one set in its bitmask after the
+		//    current block's, wrapping round, is where it next has work
+		uint64_t GetNextTick(uint64_t limit) const
+		{
+			uint64_t next = limit;
+			for (int level = 0; level < Levels; ++level)
+			{
+				if (occupied[level] == 0)
+					continue;
+				const int shift = LevelBits * level;
+				const uint64_t block = current >> shift;
+				const int index = (int)(block & (Slots - 1));
+				const uint64_t ahead = index + 1 < Slots ? occupied[level] >> (index + 1) : 0;
+				const uint64_t due = ahead != 0 ? block + 1 + LowestBit(ahead) : block - index + Slots + LowestBit(occupied[level]);
+				if ((due << shift) < next)
+					next = due << shift;
+			}
+			return next;
+		}
+
+		// into the lowest level whose span covers the deadline; due on the current tick only while cascading
+		void Place(Timer& timer)
+		{
+			const uint64_t delta = timer.expires - current;
+			int level = 0;
+			while (level < Levels - 1 && delta >= (uint64_t)1 << (LevelBits * (level + 1)))
+				level++;
+			uint64_t expires = timer.expires;
+			if (delta >= (uint64_t)1 << (LevelBits * Levels))
+				expires = current + ((uint64_t)1 << (LevelBits * Levels)) - 1;
+			const int slot = (int)((expires >> (LevelBits * level)) & (Slots - 1));
+			TimerLink& head = slots[level][slot];
+			timer.next = &head;
+			timer.prev = head.prev;
+			head.prev->next = &timer;
+			head.prev = &timer;
+			occupied[level] |= (uint64_t)1 << slot;
+		}
+
+		// take a slot's timers off the wheel into a list of their own
+		void Take(TimerLink& head, int level, TimerLink& list)
+		{
+			const int slot = (int)(&head - slots[level]);
+			occupied[level] &= ~((uint64_t)1 << slot);
+			if (head.next == &head)
+			{
+				Clear(list);
+				return;
+			}
+			list.next = head.next;
+			list.prev = head.prev;
+			list.next->prev = &list;
+			list.prev->next = &list;
+			Clear(head);
+		}
+
+		// the bottom level wrapped: bring down the next slot of each level above, as far up as wrapped too
+		void Cascade()
+		{
+			for (int level = 1; level < Levels; ++level)
+			{
+				const int slot = (int)((current >> (LevelBits * level)) & (Slots - 1));
+				TimerLink list;
+				Take(slots[level][slot], level, list);
+				while (list.next != &list)
+				{
+					Timer* timer = static_cast<Timer*>(list.next);
+					timer->Cancel();
+					Place(*timer);
+				}
+				if (slot != 0)
+					break;
+			}
+		}
+
+		void Expire(TimerLink& head, int level)
+		{
+			TimerLink due;
+			Take(head, level, due);
+			while (due.next != &due)
+			{
+				Timer* timer = static_cast<Timer*>(due.next);
+				timer->Cancel();
+				if (timer->callback)
+					timer->callback();
+			}
+		}
+
+		double time;							// seconds advanced
+		uint64_t current;						// last tick run
+		TimerLink slots[Levels][Slots];			// list heads
+		uint64_t occupied[Levels];				// bit per slot that may hold timers
 	};
 
 	// connection
+	//  + with a key, every datagram is sealed with XChaCha20-Poly1305 (Crypto.h) behind the protocol id, and one that
+	//    fails its tag is dropped before it can change the connection's state
+	//  + a client connects with a handshake, sent behind the complement of the protocol id so it is never taken for
+	//    data: hello, which the server answers with a challenge holding a cookie, the client's response echoing the
+	//    cookie, then the server's welcome
+	//  + the cookie is a SipHash of the client's address and the time under a secret of the server's, so the server
+	//    keeps nothing for a hello and gives its one connection only to an address that proved it receives there; a
+	//    hello is padded to the size of the challenge, so the answer to a spoofed one is no bigger than it
+	//  + a client sends hello again every HandshakeInterval until it is welcomed or the timeout passes
+	//  + the connection's deadlines, and those of the layers above it, are timers on a wheel that Update advances
+	//  + a connected peer sends a keepalive once it has sent nothing else for the keepalive interval, so a side that
+	//    is busy, or just has nothing to say, is not timed out; one that is sending anyway never sends one
+
+	const float HandshakeInterval = 0.1f;
 
 	class Connection
 	{
 	public:
 
+		static const int MaxHeaderSize = 32;		// largest header a layer above may pass through SendPacket/ReceivePacket
+		static const int CookieLifetime = 5;		// seconds a challenge's cookie is good for
+
 		enum Mode
 		{
 			None,
@@ -327,11 +933,15 @@ namespace net
 		};
 
 		Connection(unsigned int protocolId, float timeout)
+			: timeoutTimer([this] { CheckTimeout(); }), handshakeTimer([this] { SendHello(); }),
+			keepAliveTimer([this] { CheckKeepAlive(); })
 		{
 			this->protocolId = protocolId;
 			this->timeout = timeout;
+			keepAliveInterval = timeout / 4;
 			mode = None;
 			running = false;
+			rejectedPackets = 0;
 			ClearData();
 		}
 
@@ -341,12 +951,16 @@ namespace net
 				Stop();
 		}
 
-		bool Start(int port)
+		bool Start(int port, unsigned int bindAddress = 0)
 		{
 			assert(!running);
 			printf("start connection on port %d\n", port);
-			if (!socket.Open(port))
+			if (!socket.Open(port, bindAddress))
 				return false;
+			cipher.NewSession();
+			std::random_device random;
+			for (int i = 0; i < (int)sizeof(cookieSecret); ++i)
+				cookieSecret[i] = (unsigned char)random();
 			running = true;
 			OnStart();
 			return true;
@@ -365,154 +979,431 @@ namespace net
 			OnStop();
 		}
 
-		bool IsRunning() const
+		bool IsRunning() const
+		{
+			return running;
+		}
+
+		void Listen()
+		{
+			printf("server listening for connection\n");
+			bool connected = IsConnected();
+			ClearData();
+			if (connected)
+				OnDisconnect();
+			mode = Server;
+			state = Listening;
+		}
+
+		void Connect(const Address& address)
+		{
+			printf("client connecting to %d.%d.%d.%d:%d\n",
+				address.GetA(), address.GetB(), address.GetC(), address.GetD(), address.GetPort());
+			bool connected = IsConnected();
+			ClearData();
+			if (connected)
+				OnDisconnect();
+			mode = Client;
+			state = Connecting;
+			this->address = address;
+			lastReceiveTime = timers.GetTime();
+			timers.Schedule(timeoutTimer, timeout);
+			timers.Schedule(handshakeTimer, 0.0);	// hello goes with the next update
+		}
+
+		bool IsConnecting() const
+		{
+			return state == Connecting;
+		}
+
+		bool ConnectFailed() const
+		{
+			return state == ConnectFail;
+		}
+
+		bool IsConnected() const
+		{
+			return state == Connected;
+		}
+
+		bool IsListening() const
+		{
+			return state == Listening;
+		}
+
+		Mode GetMode() const
+		{
+			return mode;
+		}
+
+		// move the connection's clock on, running whatever timers came due
+		virtual void Update(float deltaTime)
+		{
+			assert(running);
+			timers.Advance(deltaTime);
+		}
+
+		virtual bool SendPacket(const unsigned char data[], int size)
+		{
+			return SendPacket(NULL, 0, data, size);
+		}
+
+		// send a packet with a header for the layer above, without copying the payload
+		//  + the protocol id and header are assembled in a small prefix and the payload is gathered from the caller's buffer
+		//  + sealed, the header is encrypted into the prefix behind the nonce and tag, and the payload from the caller's
+		//    buffer into the connection's own, which is what goes on the wire
+		bool SendPacket(const unsigned char header[], int headerSize, const unsigned char data[], int size)
+		{
+			assert(running);
+			assert(headerSize >= 0 && headerSize <= MaxHeaderSize);
+			if (state != Connected)
+				return false;
+			lastSendTime = timers.GetTime();
+			unsigned char prefix[4 + PacketCipher::Overhead + MaxHeaderSize];
+			WriteId(prefix, protocolId);
+			if (cipher.IsEnabled())
+			{
+				if ((int)sealed.size() < size)
+					sealed.resize(size);
+				unsigned char* body = size > 0 ? &sealed[0] : NULL;
+				cipher.Seal(prefix, 4, &prefix[4 + PacketCipher::Overhead], header, headerSize, body, data, size);
+				return socket.Send(address, prefix, 4 + PacketCipher::Overhead + headerSize, body, size);
+			}
+			if (headerSize > 0)
+				std::memcpy(&prefix[4], header, headerSize);
+			return socket.Send(address, prefix, 4 + headerSize, data, size);
+		}
+
+		// send a keepalive once nothing has gone to the peer for interval seconds, zero for never; a quarter of the
+		// timeout unless set
+		void SetKeepAlive(float interval)
+		{
+			keepAliveInterval = interval;
+			if (state == Connected)
+				CheckKeepAlive();
+		}
+
+		// seal every packet with key (AeadKeySize bytes, both peers the same), null to send and accept cleartext
+		void SetKey(const unsigned char* key)
+		{
+			cipher.SetKey(key);
+		}
+
+		bool IsEncrypted() const
+		{
+			return cipher.IsEnabled();
+		}
+
+		// packets dropped because they failed their tag (or were cleartext to a connection with a key)
+		uint64_t GetRejectedPackets() const
+		{
+			return rejectedPackets;
+		}
+
+		// pass outgoing packets through a shaper such as a link emulator (null to send directly)
+		void SetPacketShaper(PacketShaper* shaper)
+		{
+			socket.SetShaper(shaper);
+		}
+
+		// mirror every datagram the connection sends or receives to a capture (null for none)
+		void SetPacketCapture(PacketCapture* capture)
+		{
+			socket.SetCapture(capture);
+		}
+
+		// arrival time of the last packet returned by ReceivePacket (GetTimeNs clock)
+		uint64_t GetReceiveTime() const
+		{
+			return socket.GetReceiveTime();
+		}
+
+		const SocketCounters& GetSocketCounters() const
+		{
+			return socket.GetCounters();
+		}
+
+		// sleep until a packet arrives, at most for the given time
+		bool WaitForPacket(float seconds)
+		{
+			assert(running);
+			return socket.WaitForData(seconds);
+		}
+
+		virtual int ReceivePacket(unsigned char data[], int size)
+		{
+			return ReceivePacket(NULL, 0, data, size);
+		}
+
+		// receive a packet, scattering the header for the layer above into header and the payload straight into data
+		// returns the header plus payload size, zero if no packet for this connection was waiting
+		//  + control packets (the handshake and keepalives) are handled here and passed over
+		//  + so are datagrams that are not ours, fail their tag or come from anyone but the peer: zero means the
+		//    socket is empty, and a stray datagram must not stop the caller draining it
+		int ReceivePacket(unsigned char header[], int headerSize, unsigned char data[], int size)
+		{
+			assert(running);
+			assert(headerSize >= 0 && headerSize <= MaxHeaderSize);
+			unsigned char prefix[4 + PacketCipher::Overhead + MaxHeaderSize];
+			const int overhead = cipher.IsEnabled() ? PacketCipher::Overhead : 0;
+			while (true)
+			{
+				Address sender;
+				int bytes_read = socket.Receive(sender, prefix, 4 + overhead + headerSize, data, size);
+				if (bytes_read == 0)
+					return 0;
+				if (bytes_read <= 4 + overhead)
+					continue;
+				const unsigned int id = ReadId(prefix);
+				if (id != protocolId && id != ~protocolId)
+					continue;
+				const int body = bytes_read - 4 - overhead;
+				const int headerBytes = std::min(body, headerSize);
+				if (overhead > 0)
+				{
+					// decrypted where it landed: the header in the prefix, the payload in the caller's buffer
+					if (!cipher.Open(prefix, 4, &prefix[4 + overhead], headerBytes, data, body - headerBytes))
+					{
+						rejectedPackets++;
+						continue;
+					}
+					bytes_read -= overhead;
+				}
+				if (id != protocolId)
+				{
+					// a control message is small enough to have landed in the header, the payload or both
+					if (body <= ControlSize)
+					{
+						unsigned char message[ControlSize] = { 0 };
+						if (headerBytes > 0)
+							std::memcpy(message, &prefix[4 + overhead], headerBytes);
+						if (body > headerBytes)
+							std::memcpy(&message[headerBytes], data, body - headerBytes);
+						ProcessControl(sender, message, body);
+					}
+					continue;
+				}
+				if (state == Connected && sender == address)
+				{
+					lastReceiveTime = timers.GetTime();
+					if (headerSize > 0)
+						std::memcpy(header, &prefix[4 + overhead], headerSize);
+					return bytes_read - 4;
+				}
+			}
+		}
+
+		int GetHeaderSize() const
+		{
+			return 4 + (cipher.IsEnabled() ? PacketCipher::Overhead : 0);
+		}
+
+	protected:
+
+		virtual void OnStart() {}
+		virtual void OnStop() {}
+		virtual void OnConnect() {}
+		virtual void OnDisconnect() {}
+
+		// deadlines of the connection and the layers above it, advanced by Update
+		TimerWheel& GetTimers()
 		{
-			return running;
+			return timers;
 		}
 
-		void Listen()
+		// the link has been idle for the keepalive interval; a layer above may send something of its own instead
+		virtual bool SendKeepAlive()
 		{
-			printf("server listening for connection\n");
-			bool connected = IsConnected();
-			ClearData();
-			if (connected)
-				OnDisconnect();
-			mode = Server;
-			state = Listening;
+			return SendControl(address, KeepAlive, 0, 0);
 		}
 
-		void Connect(const Address& address)
+	private:
+
+		// control messages: a type byte, then for a challenge or response the time the cookie was made (seconds,
+		// big-endian u32) and the cookie (u64)
+		enum ControlType
 		{
-			printf("client connecting to %d.%d.%d.%d:%d\n",
-				address.GetA(), address.GetB(), address.GetC(), address.GetD(), address.GetPort());
-			bool connected = IsConnected();
-			ClearData();
-			if (connected)
-				OnDisconnect();
-			mode = Client;
-			state = Connecting;
-			this->address = address;
-		}
+			Hello = 1,
+			Challenge,
+			Response,
+			Welcome,
+			KeepAlive
+		};
 
-		bool IsConnecting() const
+		static const int ControlSize = 1 + 4 + 8;
+
+		static void WriteId(unsigned char* p, unsigned int id)
 		{
-			return state == Connecting;
+			p[0] = (unsigned char)(id >> 24);
+			p[1] = (unsigned char)((id >> 16) & 0xFF);
+			p[2] = (unsigned char)((id >> 8) & 0xFF);
+			p[3] = (unsigned char)(id & 0xFF);
 		}
 
-		bool ConnectFailed() const
+		static unsigned int ReadId(const unsigned char* p)
 		{
-			return state == ConnectFail;
+			return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3];
 		}
 
-		bool IsConnected() const
+		static uint32_t GetCookieTime()
 		{
-			return state == Connected;
+			return (uint32_t)(GetTimeNs() / 1000000000ull);
 		}
 
-		bool IsListening() const
+		uint64_t MakeCookie(const Address& client, uint32_t time) const
 		{
-			return state == Listening;
+			unsigned char input[10];
+			WriteId(input, time);
+			WriteId(input + 4, client.GetAddress());
+			input[8] = (unsigned char)(client.GetPort() >> 8);
+			input[9] = (unsigned char)(client.GetPort() & 0xFF);
+			return SipHash(cookieSecret, input, sizeof(input));
 		}
 
-		Mode GetMode() const
+		// a hello and a response are padded to ControlSize, a welcome or keepalive is its type alone
+		bool SendControl(const Address& destination, ControlType type, uint32_t time, uint64_t cookie)
 		{
-			return mode;
+			unsigned char prefix[4 + PacketCipher::Overhead];
+			unsigned char message[ControlSize] = { 0 };
+			const int messageSize = type == Welcome || type == KeepAlive ? 1 : ControlSize;
+			WriteId(prefix, ~protocolId);
+			message[0] = (unsigned char)type;
+			if (type == Challenge || type == Response)
+			{
+				WriteId(&message[1], time);
+				WriteId(&message[5], (unsigned int)(cookie >> 32));
+				WriteId(&message[9], (unsigned int)cookie);
+			}
+			if (cipher.IsEnabled())
+			{
+				cipher.Seal(prefix, 4, NULL, NULL, 0, message, message, messageSize);
+				return socket.Send(destination, prefix, 4 + PacketCipher::Overhead, message, messageSize);
+			}
+			return socket.Send(destination, prefix, 4, message, messageSize);
 		}
 
-		virtual void Update(float deltaTime)
+		void ProcessControl(const Address& sender, const unsigned char message[ControlSize], int size)
 		{
-			assert(running);
-			timeoutAccumulator += deltaTime;
-			if (timeoutAccumulator > timeout)
+			if (size < 1)
+				return;
+			const ControlType type = (ControlType)message[0];
+			const uint32_t time = ReadId(&message[1]);
+			const uint64_t cookie = ((uint64_t)ReadId(&message[5]) << 32) | ReadId(&message[9]);
+			if (type == KeepAlive)
+			{
+				if (state == Connected && sender == address)
+					lastReceiveTime = timers.GetTime();
+			}
+			else if (mode == Server)
+			{
+				// the connected client asks again when it did not hear the welcome
+				if (IsConnected())
+				{
+					if ((type == Hello || type == Response) && sender == address)
+						SendControl(address, Welcome, 0, 0);
+				}
+				else if (type == Hello && size == ControlSize)
+				{
+					const uint32_t now = GetCookieTime();
+					SendControl(sender, Challenge, now, MakeCookie(sender, now));
+				}
+				else if (type == Response && size == ControlSize)
+				{
+					if (GetCookieTime() - time > (uint32_t)CookieLifetime || cookie != MakeCookie(sender, time))
+						return;
+					printf("server accepts connection from client %d.%d.%d.%d:%d\n",
+						sender.GetA(), sender.GetB(), sender.GetC(), sender.GetD(), sender.GetPort());
+					address = sender;
+					SetConnected();
+					SendControl(address, Welcome, 0, 0);
+				}
+			}
+			else if (mode == Client && state == Connecting && sender == address)
 			{
-				if (state == Connecting)
+				if (type == Challenge && size == ControlSize)
 				{
-					printf("connect timed out\n");
-					ClearData();
-					state = ConnectFail;
-					OnDisconnect();
+					SendControl(address, Response, time, cookie);
 				}
-				else if (state == Connected)
+				else if (type == Welcome)
 				{
-					printf("connection timed out\n");
-					ClearData();
-					if (state == Connecting)
-						state = ConnectFail;
-					OnDisconnect();
+					printf("client completes connection with server\n");
+					SetConnected();
 				}
 			}
 		}
 
-		virtual bool SendPacket(const unsigned char data[], int size)
+		// the timeout timer comes due a timeout after it was last pushed back, and only then looks at when a packet
+		// last arrived, so receiving is a store rather than a reschedule
+		void CheckTimeout()
 		{
-			assert(running);
-			if (address.GetAddress() == 0)
-				return false;
-			unsigned char packet[PacketSizeHack + 4];
-			packet[0] = (unsigned char)(protocolId >> 24);
-			packet[1] = (unsigned char)((protocolId >> 16) & 0xFF);
-			packet[2] = (unsigned char)((protocolId >> 8) & 0xFF);
-			packet[3] = (unsigned char)((protocolId) & 0xFF);
-			std::memcpy(&packet[4], data, size);
-			return socket.Send(address, packet, size + 4);
+			if (timers.GetTime() - lastReceiveTime <= timeout)
+			{
+				timers.ScheduleAt(timeoutTimer, lastReceiveTime + timeout);
+				return;
+			}
+			if (state == Connecting)
+			{
+				printf("connect timed out\n");
+				ClearData();
+				state = ConnectFail;
+				OnDisconnect();
+			}
+			else if (state == Connected)
+			{
+				printf("connection timed out\n");
+				ClearData();
+				OnDisconnect();
+			}
 		}
 
-		virtual int ReceivePacket(unsigned char data[], int size)
+		void SetConnected()
 		{
-			assert(running);
-			unsigned char packet[PacketSizeHack + 4];
-			Address sender;
-			int bytes_read = socket.Receive(sender, packet, size + 4);
-			if (bytes_read == 0)
-				return 0;
-			if (bytes_read <= 4)
-				return 0;
-			if (packet[0] != (unsigned char)(protocolId >> 24) ||
-				packet[1] != (unsigned char)((protocolId >> 16) & 0xFF) ||
-				packet[2] != (unsigned char)((protocolId >> 8) & 0xFF) ||
-				packet[3] != (unsigned char)(protocolId & 0xFF))
-				return 0;
-			if (mode == Server && !IsConnected())
+			state = Connected;
+			cipher.LockSession(true);
+			handshakeTimer.Cancel();
+			lastReceiveTime = timers.GetTime();
+			lastSendTime = lastReceiveTime;
+			timers.Schedule(timeoutTimer, timeout);
+			if (keepAliveInterval > 0.0f)
+				timers.Schedule(keepAliveTimer, keepAliveInterval);
+			OnConnect();
+		}
+
+		// the keepalive timer is due an interval after it was last pushed back, and only then looks at when a packet
+		// last went out, as the timeout timer does for arrivals
+		void CheckKeepAlive()
+		{
+			if (state != Connected || keepAliveInterval <= 0.0f)
 			{
-				printf("server accepts connection from client %d.%d.%d.%d:%d\n",
-					sender.GetA(), sender.GetB(), sender.GetC(), sender.GetD(), sender.GetPort());
-				state = Connected;
-				address = sender;
-				OnConnect();
+				keepAliveTimer.Cancel();
+				return;
 			}
-			if (sender == address)
+			const double now = timers.GetTime();
+			if (now - lastSendTime >= keepAliveInterval)
 			{
-				if (mode == Client && state == Connecting)
-				{
-					printf("client completes connection with server\n");
-					state = Connected;
-					OnConnect();
-				}
-				timeoutAccumulator = 0.0f;
-				memcpy(data, &packet[4], bytes_read - 4);
-				return bytes_read - 4;
+				SendKeepAlive();
+				lastSendTime = now;
 			}
-			return 0;
+			timers.ScheduleAt(keepAliveTimer, lastSendTime + keepAliveInterval);
 		}
 
-		int GetHeaderSize() const
+		void SendHello()
 		{
-			return 4;
+			if (state != Connecting)
+				return;
+			SendControl(address, Hello, 0, 0);
+			timers.Schedule(handshakeTimer, HandshakeInterval);
 		}
 
-	protected:
-
-		virtual void OnStart() {}
-		virtual void OnStop() {}
-		virtual void OnConnect() {}
-		virtual void OnDisconnect() {}
-
-	private:
-
 		void ClearData()
 		{
 			state = Disconnected;
-			timeoutAccumulator = 0.0f;
+			cipher.LockSession(false);
+			timeoutTimer.Cancel();
+			handshakeTimer.Cancel();
+			keepAliveTimer.Cancel();
+			lastReceiveTime = timers.GetTime();
+			lastSendTime = lastReceiveTime;
 			address = Address();
 		}
 
@@ -532,8 +1423,156 @@ namespace net
 		Mode mode;
 		State state;
 		Socket socket;
-		float timeoutAccumulator;
+		TimerWheel timers;
+		Timer timeoutTimer;
+		Timer handshakeTimer;
+		Timer keepAliveTimer;
+		double lastReceiveTime;				// wheel time a packet last came from the peer
+		double lastSendTime;				// and last went to it
+		float keepAliveInterval;
 		Address address;
+		unsigned char cookieSecret[16];
+		PacketCipher cipher;
+		std::vector<unsigned char> sealed;	// the payload of the packet being sent, encrypted
+		uint64_t rejectedPackets;
+	};
+
+	// per-connection arena for small fixed-size blocks such as list nodes
+	//  + blocks are carved out of slabs that live as long as the arena, freed blocks go on a free list per size class
+	//  + once the queues reach their working size, allocating and freeing is a pointer swap and never reaches the heap
+	//  + not thread safe, an arena belongs to the thread that drives its connection
+
+	class SlabArena
+	{
+	public:
+
+		SlabArena()
+		{
+			for (int i = 0; i < SizeClasses; ++i)
+				freeLists[i] = NULL;
+			slabs = NULL;
+		}
+
+		~SlabArena()
+		{
+			while (slabs)
+			{
+				Slab* next = slabs->next;
+				::operator delete(slabs);
+				slabs = next;
+			}
+		}
+
+		void* Allocate(size_t size)
+		{
+			const int sizeClass = GetSizeClass(size);
+			if (sizeClass < 0)
+				return ::operator new(size);
+			if (!freeLists[sizeClass])
+				AddSlab(sizeClass);
+			FreeBlock* block = freeLists[sizeClass];
+			freeLists[sizeClass] = block->next;
+			return block;
+		}
+
+		void Free(void* pointer, size_t size)
+		{
+			const int sizeClass = GetSizeClass(size);
+			if (sizeClass < 0)
+			{
+				::operator delete(pointer);
+				return;
+			}
+			FreeBlock* block = (FreeBlock*)pointer;
+			block->next = freeLists[sizeClass];
+			freeLists[sizeClass] = block;
+		}
+
+	private:
+
+		SlabArena(const SlabArena& other);
+		SlabArena& operator=(const SlabArena& other);
+
+		static const size_t Granularity = 16;		// block sizes are multiples of this, which also keeps blocks aligned
+		static const int SizeClasses = 8;			// blocks up to 128 bytes come from slabs, anything larger from the heap
+		static const int BlocksPerSlab = 256;
+
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		struct Slab
+		{
+			Slab* next;
+		};
+
+		static int GetSizeClass(size_t size)
+		{
+			const size_t sizeClass = (size + Granularity - 1) / Granularity - 1;
+			return size > 0 && sizeClass < (size_t)SizeClasses ? (int)sizeClass : -1;
+		}
+
+		void AddSlab(int sizeClass)
+		{
+			const size_t blockSize = (sizeClass + 1) * Granularity;
+			char* memory = (char*)::operator new(Granularity + blockSize * BlocksPerSlab);
+			Slab* slab = (Slab*)memory;
+			slab->next = slabs;
+			slabs = slab;
+			for (int i = BlocksPerSlab - 1; i >= 0; --i)
+			{
+				FreeBlock* block = (FreeBlock*)(memory + Granularity + i * blockSize);
+				block->next = freeLists[sizeClass];
+				freeLists[sizeClass] = block;
+			}
+		}
+
+		FreeBlock* freeLists[SizeClasses];
+		Slab* slabs;
+	};
+
+	// standard allocator adaptor over a slab arena (no arena means the ordinary heap)
+
+	template <typename T>
+	class ArenaAllocator
+	{
+	public:
+
+		typedef T value_type;
+
+		explicit ArenaAllocator(SlabArena* arena = NULL) : arena(arena) {}
+
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+		T* allocate(size_t count)
+		{
+			const size_t size = count * sizeof(T);
+			return (T*)(arena ? arena->Allocate(size) : ::operator new(size));
+		}
+
+		void deallocate(T* pointer, size_t count)
+		{
+			if (arena)
+				arena->Free(pointer, count * sizeof(T));
+			else
+				::operator delete(pointer);
+		}
+
+		template <typename U>
+		bool operator==(const ArenaAllocator<U>& other) const
+		{
+			return arena == other.arena;
+		}
+
+		template <typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const
+		{
+			return arena != other.arena;
+		}
+
+		SlabArena* arena;
 	};
 
 	// packet queue to store information about sent and received packets sorted in sequence order
@@ -542,10 +1581,14 @@ namespace net
 	struct PacketData
 	{
 		unsigned int sequence;			// packet sequence number
-		float time;					    // time offset since packet was sent or received (depending on context)
+		double time;					// clock time the packet was sent or received (depending on context)
 		int size;						// packet size in bytes
+		uint64_t sendTime;				// GetTimeNs when the packet was sent (sent packets only)
 	};
 
+	// slack on the maximum round trip time before a queued packet ages out (seconds)
+	const double QueueEpsilon = 0.001;
+
 	inline bool sequence_more_recent(unsigned int s1, unsigned int s2, unsigned int max_sequence)
 	{
 		auto half_max = max_sequence / 2;
@@ -556,10 +1599,15 @@ namespace net
 			);
 	}
 
-	class PacketQueue : public std::list<PacketData>
+	class PacketQueue : public std::list<PacketData, ArenaAllocator<PacketData> >
 	{
 	public:
 
+		explicit PacketQueue(SlabArena* arena = NULL)
+			: std::list<PacketData, ArenaAllocator<PacketData> >(ArenaAllocator<PacketData>(arena))
+		{
+		}
+
 		bool exists(unsigned int sequence)
 		{
 			for (iterator itor = begin(); itor != end(); ++itor)
@@ -618,14 +1666,43 @@ namespace net
 	//  + manages sent, received, pending ack and acked packet queues
 	//  + separated out from reliable connection because it is quite complex and i want to unit test it!
 
+	// receives reliability events as they happen, for metrics or tracing
+	//  + called on the thread driving the connection, in the middle of packet processing, so keep it cheap
+
+	class ReliabilityObserver
+	{
+	public:
+
+		virtual ~ReliabilityObserver() {}
+
+		virtual void OnPacketSent(unsigned int sequence, int size) = 0;
+		virtual void OnPacketReceived(unsigned int sequence, int size) = 0;
+		virtual void OnPacketAcked(unsigned int sequence) = 0;
+		virtual void OnPacketLost(unsigned int sequence) = 0;
+		// rtt sample in nanoseconds, after the peer's ack delay has been taken off
+		virtual void OnRoundTripTime(uint64_t sample) = 0;
+	};
+
 	class ReliabilitySystem
 	{
 	public:
 
-		ReliabilitySystem(unsigned int max_sequence = 0xFFFFFFFF)
+		// timers is the wheel the loss deadline goes on, which its owner advances; without one the system keeps a
+		// wheel of its own and advances it in Update
+		ReliabilitySystem(unsigned int max_sequence = 0xFFFFFFFF, TimerWheel* timers = NULL)
+			: sentQueue(&arena), pendingAckQueue(&arena), receivedQueue(&arena), ackedQueue(&arena),
+			lossTimer([this] { DetectLosses(); })
 		{
+			if (timers == NULL)
+			{
+				ownTimers.reset(new TimerWheel());
+				timers = ownTimers.get();
+			}
+			this->timers = timers;
+			observer = NULL;
 			this->rtt_maximum = rtt_maximum;
 			this->max_sequence = max_sequence;
+			acks.reserve(MaxAcksPerUpdate);
 			Reset();
 		}
 
@@ -633,7 +1710,9 @@ namespace net
 		{
 			local_sequence = 0;
 			remote_sequence = 0;
+			lossTimer.Cancel();
 			sentQueue.clear();
+			sentQueueBytes = 0;
 			receivedQueue.clear();
 			pendingAckQueue.clear();
 			ackedQueue.clear();
@@ -643,7 +1722,10 @@ namespace net
 			acked_packets = 0;
 			sent_bandwidth = 0.0f;
 			acked_bandwidth = 0.0f;
-			rtt = 0.0f;
+			srtt = 0;
+			rttvar = 0;
+			min_rtt = 0;
+			remote_receive_time = 0;
 			rtt_maximum = 1.0f;
 		}
 
@@ -659,28 +1741,55 @@ namespace net
 			assert(!pendingAckQueue.exists(local_sequence));
 			PacketData data;
 			data.sequence = local_sequence;
-			data.time = 0.0f;
+			data.time = timers->GetTime();
 			data.size = size;
+			data.sendTime = GetTimeNs();
 			sentQueue.push_back(data);
+			sentQueueBytes += size;
+			if (pendingAckQueue.empty())
+				timers->ScheduleAt(lossTimer, data.time + rtt_maximum + QueueEpsilon);
 			pendingAckQueue.push_back(data);
 			sent_packets++;
+			if (observer)
+				observer->OnPacketSent(local_sequence, size);
 			local_sequence++;
 			if (local_sequence > max_sequence)
 				local_sequence = 0;
 		}
 
-		void PacketReceived(unsigned int sequence, int size)
+		// receiveTime is when the packet arrived (GetTimeNs clock, zero for now)
+		void PacketReceived(unsigned int sequence, int size, uint64_t receiveTime = 0)
 		{
 			recv_packets++;
 			if (receivedQueue.exists(sequence))
 				return;
 			PacketData data;
 			data.sequence = sequence;
-			data.time = 0.0f;
+			data.time = timers->GetTime();
 			data.size = size;
+			data.sendTime = 0;
 			receivedQueue.push_back(data);
+			if (observer)
+				observer->OnPacketReceived(sequence, size);
 			if (sequence_more_recent(sequence, remote_sequence, max_sequence))
+			{
 				remote_sequence = sequence;
+				remote_receive_time = receiveTime ? receiveTime : GetTimeNs();
+			}
+			else if (sequence == remote_sequence && remote_receive_time == 0)
+			{
+				remote_receive_time = receiveTime ? receiveTime : GetTimeNs();
+			}
+		}
+
+		// microseconds the most recent remote packet has been waiting for its ack, echoed so the peer can subtract it from rtt
+		unsigned int GetAckDelay() const
+		{
+			if (remote_receive_time == 0)
+				return 0;
+			const uint64_t now = GetTimeNs();
+			const uint64_t delay = now > remote_receive_time ? (now - remote_receive_time) / 1000 : 0;
+			return delay < 0xFFFFFFFF ? (unsigned int)delay : 0xFFFFFFFF;
 		}
 
 		unsigned int GenerateAckBits()
@@ -688,15 +1797,62 @@ namespace net
 			return generate_ack_bits(GetRemoteSequence(), receivedQueue, max_sequence);
 		}
 
-		void ProcessAck(unsigned int ack, unsigned int ack_bits)
+		// ack_delay is the peer's reported hold time in microseconds, receiveTime when the ack arrived (zero for now)
+		void ProcessAck(unsigned int ack, unsigned int ack_bits, unsigned int ack_delay = 0, uint64_t receiveTime = 0)
+		{
+			// sample rtt from the newest acked packet only, and only the first time it is acked
+			uint64_t sendTime = 0;
+			for (PacketQueue::iterator itor = pendingAckQueue.begin(); itor != pendingAckQueue.end(); ++itor)
+			{
+				if (itor->sequence == ack)
+				{
+					sendTime = itor->sendTime;
+					break;
+				}
+			}
+			const size_t previous_acks = acks.size();
+			process_ack(ack, ack_bits, pendingAckQueue, ackedQueue, acks, acked_packets, max_sequence);
+			if (observer)
+			{
+				for (size_t i = previous_acks; i < acks.size(); ++i)
+					observer->OnPacketAcked(acks[i]);
+			}
+			if (sendTime != 0)
+			{
+				const uint64_t now = receiveTime ? receiveTime : GetTimeNs();
+				if (now > sendTime)
+					UpdateRoundTripTime(now - sendTime, (uint64_t)ack_delay * 1000);
+			}
+		}
+
+		// rtt estimator in the style of RFC 6298, kept in nanoseconds
+		//  + min rtt tracks the raw samples; the peer's ack delay is only subtracted when that would not undercut it
+		void UpdateRoundTripTime(uint64_t sample, uint64_t ack_delay)
 		{
-			process_ack(ack, ack_bits, pendingAckQueue, ackedQueue, acks, acked_packets, rtt, max_sequence);
+			if (min_rtt == 0 || sample < min_rtt)
+				min_rtt = sample;
+			if (sample >= min_rtt + ack_delay)
+				sample -= ack_delay;
+			if (observer)
+				observer->OnRoundTripTime(sample);
+			if (srtt == 0)
+			{
+				srtt = sample;
+				rttvar = sample / 2;
+			}
+			else
+			{
+				const uint64_t deviation = srtt > sample ? srtt - sample : sample - srtt;
+				rttvar = (3 * rttvar + deviation) / 4;
+				srtt = (7 * srtt + sample) / 8;
+			}
 		}
 
 		void Update(float deltaTime)
 		{
 			acks.clear();
-			AdvanceQueueTime(deltaTime);
+			if (ownTimers)
+				ownTimers->Advance(deltaTime);
 			UpdateQueues();
 			UpdateStats();
 #ifdef NET_UNIT_TEST
@@ -727,7 +1883,7 @@ namespace net
 			assert(!sequence_more_recent(sequence, ack, max_sequence));
 			if (sequence > ack)
 			{
-				assert(ack < 33);
+				// behind ack across the wrap; the distance can be past 31, which callers leave out of the ack bits
 				assert(max_sequence >= sequence);
 				return ack + (max_sequence - sequence);
 			}
@@ -756,7 +1912,7 @@ namespace net
 		static void process_ack(unsigned int ack, unsigned int ack_bits,
 			PacketQueue& pending_ack_queue, PacketQueue& acked_queue,
 			std::vector<unsigned int>& acks, unsigned int& acked_packets,
-			float& rtt, unsigned int max_sequence)
+			unsigned int max_sequence)
 		{
 			if (pending_ack_queue.empty())
 				return;
@@ -779,8 +1935,6 @@ namespace net
 
 				if (acked)
 				{
-					rtt += (itor->time - rtt) * 0.1f;
-
 					acked_queue.insert_sorted(*itor, max_sequence);
 					acks.push_back(itor->sequence);
 					acked_packets++;
@@ -791,6 +1945,12 @@ namespace net
 			}
 		}
 
+		// report events to an observer (null for none), which must outlive the reliability system
+		void SetObserver(ReliabilityObserver* observer)
+		{
+			this->observer = observer;
+		}
+
 		// data accessors
 
 		unsigned int GetLocalSequence() const
@@ -834,6 +1994,11 @@ namespace net
 			return acked_packets;
 		}
 
+		int GetPendingAckPackets() const
+		{
+			return (int)pendingAckQueue.size();
+		}
+
 		float GetSentBandwidth() const
 		{
 			return sent_bandwidth;
@@ -844,39 +2009,40 @@ namespace net
 			return acked_bandwidth;
 		}
 
+		// smoothed rtt in seconds (microsecond resolution)
 		float GetRoundTripTime() const
 		{
-			return rtt;
+			return srtt / 1000 / 1000000.0f;
 		}
 
-		int GetHeaderSize() const
+		float GetRoundTripTimeVariance() const
 		{
-			return 12;
+			return rttvar / 1000 / 1000000.0f;
 		}
 
-	protected:
-
-		void AdvanceQueueTime(float deltaTime)
+		float GetMinRoundTripTime() const
 		{
-			for (PacketQueue::iterator itor = sentQueue.begin(); itor != sentQueue.end(); itor++)
-				itor->time += deltaTime;
-
-			for (PacketQueue::iterator itor = receivedQueue.begin(); itor != receivedQueue.end(); itor++)
-				itor->time += deltaTime;
-
-			for (PacketQueue::iterator itor = pendingAckQueue.begin(); itor != pendingAckQueue.end(); itor++)
-				itor->time += deltaTime;
+			return min_rtt / 1000 / 1000000.0f;
+		}
 
-			for (PacketQueue::iterator itor = ackedQueue.begin(); itor != ackedQueue.end(); itor++)
-				itor->time += deltaTime;
+		int GetHeaderSize() const
+		{
+			return 16;
 		}
 
+	protected:
+
+		// packets are sent in sequence order, so every queue but the received one is oldest first and only its front
+		// can have aged out
 		void UpdateQueues()
 		{
-			const float epsilon = 0.001f;
+			const double now = timers->GetTime();
 
-			while (sentQueue.size() && sentQueue.front().time > rtt_maximum + epsilon)
+			while (sentQueue.size() && now - sentQueue.front().time > rtt_maximum + QueueEpsilon)
+			{
+				sentQueueBytes -= sentQueue.front().size;
 				sentQueue.pop_front();
+			}
 
 			if (receivedQueue.size())
 			{
@@ -886,30 +2052,36 @@ namespace net
 					receivedQueue.pop_front();
 			}
 
-			while (ackedQueue.size() && ackedQueue.front().time > rtt_maximum * 2 - epsilon)
+			while (ackedQueue.size() && now - ackedQueue.front().time > rtt_maximum * 2 - QueueEpsilon)
 				ackedQueue.pop_front();
+		}
 
-			while (pendingAckQueue.size() && pendingAckQueue.front().time > rtt_maximum + epsilon)
+		// the loss timer is due a round trip maximum after the oldest unacked packet was sent; acks may since have
+		// taken that packet, in which case it just moves on to the new oldest
+		void DetectLosses()
+		{
+			const double now = timers->GetTime();
+			while (pendingAckQueue.size() && now - pendingAckQueue.front().time > rtt_maximum + QueueEpsilon)
 			{
+				if (observer)
+					observer->OnPacketLost(pendingAckQueue.front().sequence);
 				pendingAckQueue.pop_front();
 				lost_packets++;
 			}
+			if (pendingAckQueue.size())
+				timers->ScheduleAt(lossTimer, pendingAckQueue.front().time + rtt_maximum + QueueEpsilon);
 		}
 
 		void UpdateStats()
 		{
-			int sent_bytes_per_second = 0;
-			for (PacketQueue::iterator itor = sentQueue.begin(); itor != sentQueue.end(); ++itor)
-				sent_bytes_per_second += itor->size;
+			const double now = timers->GetTime();
+			int sent_bytes_per_second = sentQueueBytes;
 			int acked_packets_per_second = 0;
 			int acked_bytes_per_second = 0;
-			for (PacketQueue::iterator itor = ackedQueue.begin(); itor != ackedQueue.end(); ++itor)
+			for (PacketQueue::iterator itor = ackedQueue.begin(); itor != ackedQueue.end() && now - itor->time >= rtt_maximum; ++itor)
 			{
-				if (itor->time >= rtt_maximum)
-				{
-					acked_packets_per_second++;
-					acked_bytes_per_second += itor->size;
-				}
+				acked_packets_per_second++;
+				acked_bytes_per_second += itor->size;
 			}
 			sent_bytes_per_second /= rtt_maximum;
 			acked_bytes_per_second /= rtt_maximum;
@@ -919,6 +2091,11 @@ namespace net
 
 	private:
 
+		ReliabilitySystem(const ReliabilitySystem& other);
+		ReliabilitySystem& operator=(const ReliabilitySystem& other);
+
+		static const int MaxAcksPerUpdate = 1024;	// acks reserved up front; the vector only grows past this and then keeps the capacity
+
 		unsigned int max_sequence;			// maximum sequence value before wrap around (used to test sequence wrap at low # values)
 		unsigned int local_sequence;		// local sequence number for most recently sent packet
 		unsigned int remote_sequence;		// remote sequence number for most recently received packet
@@ -930,15 +2107,26 @@ namespace net
 
 		float sent_bandwidth;				// approximate sent bandwidth over the last second
 		float acked_bandwidth;				// approximate acked bandwidth over the last second
-		float rtt;							// estimated round trip time
+		uint64_t srtt;						// smoothed round trip time (ns, zero until the first sample)
+		uint64_t rttvar;					// round trip time variation (ns)
+		uint64_t min_rtt;					// smallest round trip time sample seen (ns)
+		uint64_t remote_receive_time;		// when the packet with remote_sequence arrived (ns)
 		float rtt_maximum;					// maximum expected round trip time (hard coded to one second for the moment)
 
 		std::vector<unsigned int> acks;		// acked packets from last set of packet receives. cleared each update!
 
+		SlabArena arena;					// list nodes for the queues below, so steady state traffic does not touch the heap
 		PacketQueue sentQueue;				// sent packets used to calculate sent bandwidth (kept until rtt_maximum)
 		PacketQueue pendingAckQueue;		// sent packets which have not been acked yet (kept until rtt_maximum * 2 )
 		PacketQueue receivedQueue;			// received packets for determining acks to send (kept up to most recent recv sequence - 32)
 		PacketQueue ackedQueue;				// acked packets (kept until rtt_maximum * 2)
+
+		ReliabilityObserver* observer;		// optional event sink for metrics or tracing
+
+		std::unique_ptr<TimerWheel> ownTimers;	// the wheel when no owner lends one
+		TimerWheel* timers;					// clock for the queues and home of the loss timer
+		Timer lossTimer;					// due when the oldest unacked packet counts as lost
+		int sentQueueBytes;					// bytes of the packets in sentQueue
 	};
 
 	// connection with reliability (seq/ack)
@@ -948,8 +2136,10 @@ namespace net
 	public:
 
 		ReliableConnection(unsigned int protocolId, float timeout, unsigned int max_sequence = 0xFFFFFFFF)
-			: Connection(protocolId, timeout), reliabilitySystem(max_sequence)
+			: Connection(protocolId, timeout), reliabilitySystem(max_sequence, &GetTimers()), ackTimer([this] { SendDelayedAck(); })
 		{
+			ackFrequency = 16;
+			ackDelay = 0.02f;
 			ClearData();
 #ifdef NET_UNIT_TEST
 			packet_loss_mask = 0;
@@ -966,45 +2156,85 @@ namespace net
 
 		bool SendPacket(const unsigned char data[], int size)
 		{
+			return SendPacket(NULL, 0, data, size);
+		}
+
+		// send a packet whose payload starts with a small message header of the caller's, without copying the data
+		//  + the message header rides behind the reliability header, so prefixSize is at most MaxHeaderSize - 16
+		//  + the receiver gets the message header and data together as one payload
+		bool SendPacket(const unsigned char prefix[], int prefixSize, const unsigned char data[], int size)
+		{
 #ifdef NET_UNIT_TEST
 			if (reliabilitySystem.GetLocalSequence() & packet_loss_mask)
 			{
-				reliabilitySystem.PacketSent(size);
+				reliabilitySystem.PacketSent(prefixSize + size);
 				return true;
 			}
 #endif
-			const int header = 12;
-			unsigned char packet[header + PacketSizeHack];
+			const int header = 16;
+			assert(prefixSize >= 0 && header + prefixSize <= MaxHeaderSize);
+			unsigned char packet[MaxHeaderSize];
 			unsigned int seq = reliabilitySystem.GetLocalSequence();
 			unsigned int ack = reliabilitySystem.GetRemoteSequence();
 			unsigned int ack_bits = reliabilitySystem.GenerateAckBits();
-			WriteHeader(packet, seq, ack, ack_bits);
-			std::memcpy(packet + header, data, size);
-			if (!Connection::SendPacket(packet, size + header))
+			WriteHeader(packet, seq, ack, ack_bits, reliabilitySystem.GetAckDelay());
+			if (prefixSize > 0)
+				std::memcpy(&packet[header], prefix, prefixSize);
+			if (!Connection::SendPacket(packet, header + prefixSize, data, size))
 				return false;
-			reliabilitySystem.PacketSent(size);
+			reliabilitySystem.PacketSent(prefixSize + size);
+			ClearPendingAcks();		// the header just carried them
 			return true;
 		}
 
+		// send a header-only packet carrying the current acks
+		//  + it does not consume a sequence number, so ack-only packets are never themselves acked or counted as lost
+		bool SendAck()
+		{
+			const int header = 16;
+			unsigned char packet[header];
+			unsigned int seq = reliabilitySystem.GetLocalSequence();
+			unsigned int ack = reliabilitySystem.GetRemoteSequence();
+			unsigned int ack_bits = reliabilitySystem.GenerateAckBits();
+			WriteHeader(packet, seq, ack, ack_bits, reliabilitySystem.GetAckDelay());
+			ClearPendingAcks();
+			return Connection::SendPacket(packet, header, NULL, 0);
+		}
+
 		int ReceivePacket(unsigned char data[], int size)
 		{
-			const int header = 12;
+			const int header = 16;
 			if (size <= header)
 				return false;
-			unsigned char packet[header + PacketSizeHack];
-			int received_bytes = Connection::ReceivePacket(packet, size + header);
-			if (received_bytes == 0)
-				return false;
-			if (received_bytes <= header)
-				return false;
-			unsigned int packet_sequence = 0;
-			unsigned int packet_ack = 0;
-			unsigned int packet_ack_bits = 0;
-			ReadHeader(packet, packet_sequence, packet_ack, packet_ack_bits);
-			reliabilitySystem.PacketReceived(packet_sequence, received_bytes - header);
-			reliabilitySystem.ProcessAck(packet_ack, packet_ack_bits);
-			std::memcpy(data, packet + header, received_bytes - header);
-			return received_bytes - header;
+			unsigned char packet[header];
+			while (true)
+			{
+				int received_bytes = Connection::ReceivePacket(packet, header, data, size);
+				if (received_bytes == 0)
+					return false;
+				if (received_bytes < header)
+					continue;
+				unsigned int packet_sequence = 0;
+				unsigned int packet_ack = 0;
+				unsigned int packet_ack_bits = 0;
+				unsigned int packet_ack_delay = 0;
+				ReadHeader(packet, packet_sequence, packet_ack, packet_ack_bits, packet_ack_delay);
+				const uint64_t receiveTime = GetReceiveTime();
+				if (received_bytes == header)
+				{
+					// ack-only packet: its sequence is not one of ours to ack, take the acks and keep draining
+					reliabilitySystem.ProcessAck(packet_ack, packet_ack_bits, packet_ack_delay, receiveTime);
+					continue;
+				}
+				reliabilitySystem.PacketReceived(packet_sequence, received_bytes - header, receiveTime);
+				reliabilitySystem.ProcessAck(packet_ack, packet_ack_bits, packet_ack_delay, receiveTime);
+				packetSequence = packet_sequence;
+				if (++unackedPackets >= ackFrequency)
+					SendAck();
+				else if (unackedPackets == 1)
+					GetTimers().Schedule(ackTimer, ackDelay);
+				return received_bytes - header;
+			}
 		}
 
 		void Update(float deltaTime)
@@ -1013,11 +2243,26 @@ namespace net
 			reliabilitySystem.Update(deltaTime);
 		}
 
+		// ack-only packets go out after every n received packets or once the oldest unacked packet is delay seconds old
+		//  + n must stay below 32 so every packet is covered by the ack bits of some ack
+		void SetAckPolicy(int everyPackets, float delay)
+		{
+			assert(everyPackets > 0 && everyPackets < 32);
+			ackFrequency = everyPackets;
+			ackDelay = delay;
+		}
+
 		int GetHeaderSize() const
 		{
 			return Connection::GetHeaderSize() + reliabilitySystem.GetHeaderSize();
 		}
 
+		// sequence number of the last packet returned by ReceivePacket
+		unsigned int GetPacketSequence() const
+		{
+			return packetSequence;
+		}
+
 		ReliabilitySystem& GetReliabilitySystem()
 		{
 			return reliabilitySystem;
@@ -1042,11 +2287,12 @@ namespace net
 			data[3] = (unsigned char)(value & 0xFF);
 		}
 
-		void WriteHeader(unsigned char* header, unsigned int sequence, unsigned int ack, unsigned int ack_bits)
+		void WriteHeader(unsigned char* header, unsigned int sequence, unsigned int ack, unsigned int ack_bits, unsigned int ack_delay)
 		{
 			WriteInteger(header, sequence);
 			WriteInteger(header + 4, ack);
 			WriteInteger(header + 8, ack_bits);
+			WriteInteger(header + 12, ack_delay);
 		}
 
 		void ReadInteger(const unsigned char* data, unsigned int& value)
@@ -1055,11 +2301,12 @@ namespace net
 				((unsigned int)data[2] << 8) | ((unsigned int)data[3]));
 		}
 
-		void ReadHeader(const unsigned char* header, unsigned int& sequence, unsigned int& ack, unsigned int& ack_bits)
+		void ReadHeader(const unsigned char* header, unsigned int& sequence, unsigned int& ack, unsigned int& ack_bits, unsigned int& ack_delay)
 		{
 			ReadInteger(header, sequence);
 			ReadInteger(header + 4, ack);
 			ReadInteger(header + 8, ack_bits);
+			ReadInteger(header + 12, ack_delay);
 		}
 
 		virtual void OnStop()
@@ -1072,11 +2319,35 @@ namespace net
 			ClearData();
 		}
 
+		// the keepalive is an ack-only packet, so it brings the peer's acks up to date too; until something has
+		// arrived there is nothing to ack, and an ack of sequence zero would be a false one
+		virtual bool SendKeepAlive()
+		{
+			if (reliabilitySystem.GetReceivedPackets() == 0)
+				return Connection::SendKeepAlive();
+			return SendAck();
+		}
+
 	private:
 
 		void ClearData()
 		{
 			reliabilitySystem.Reset();
+			ClearPendingAcks();
+			packetSequence = 0;
+		}
+
+		void ClearPendingAcks()
+		{
+			unackedPackets = 0;
+			ackTimer.Cancel();
+		}
+
+		// delayed ack: nothing went back with a header for a while, so acknowledge what has arrived
+		void SendDelayedAck()
+		{
+			if (unackedPackets > 0 && IsConnected())
+				SendAck();
 		}
 
 #ifdef NET_UNIT_TEST
@@ -1084,6 +2355,12 @@ namespace net
 #endif
 
 		ReliabilitySystem reliabilitySystem;	// reliability system: manages sequence numbers and acks, tracks network stats etc.
+
+		int ackFrequency;						// received packets that trigger an ack-only packet straight away
+		float ackDelay;							// longest a received packet waits for its ack
+		int unackedPackets;						// packets received since acks last went out
+		Timer ackTimer;							// due an ack delay after the first of those packets arrived
+		unsigned int packetSequence;			// sequence of the last data packet handed to the caller
 	};
 }
 
@@ -0,0 +1,476 @@
+/*
+	Staged file transfer pipeline
+	  + lock-free single-producer/single-consumer rings connect the stages
+	  + chunk buffers are allocated once up front and recycled through a free ring, so the pipeline depth is fixed
+	  + a full ring (or an empty free ring) stalls the upstream stage, which is how backpressure travels back to disk
+	  + the sender can compress chunks on a pool of workers between the checksum and network stages; chunks are dealt
+	    to the workers in turn and taken back in the same turn, so they still reach the network in file order
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Checksum.h"
+#include "LargeFile.h"
+#include "Compress.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+namespace net
+{
+	// single-producer single-consumer ring
+	//  + exactly one thread may Push and exactly one other thread may Pop
+	//  + head and tail live on separate cache lines so producer and consumer do not false-share
+
+	template <typename T>
+	class SpscRing
+	{
+	public:
+
+		explicit SpscRing(size_t capacity)
+		{
+			size_t size = 1;
+			while (size < capacity + 1)
+				size <<= 1;
+			slots.resize(size);
+			mask = size - 1;
+			head.store(0);
+			tail.store(0);
+		}
+
+		bool Push(const T& value)
+		{
+			const size_t t = tail.load(std::memory_order_relaxed);
+			const size_t next = (t + 1) & mask;
+			if (next == head.load(std::memory_order_acquire))
+				return false;
+			slots[t] = value;
+			tail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		bool Pop(T& value)
+		{
+			const size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+				return false;
+			value = slots[h];
+			head.store((h + 1) & mask, std::memory_order_release);
+			return true;
+		}
+
+		// consumer side: look at the next value without removing it
+		bool Front(T& value) const
+		{
+			const size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+				return false;
+			value = slots[h];
+			return true;
+		}
+
+		size_t Capacity() const
+		{
+			return mask;
+		}
+
+		bool IsEmpty() const
+		{
+			return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+		}
+
+	private:
+
+		std::vector<T> slots;
+		size_t mask;
+		alignas(64) std::atomic<size_t> head;		// next slot to pop (written by consumer)
+		alignas(64) std::atomic<size_t> tail;		// next slot to push (written by producer)
+	};
+
+	// wait strategy for a stage blocked on a ring: spin briefly, then yield, then sleep
+
+	class Backoff
+	{
+	public:
+
+		Backoff() : count(0) {}
+
+		void Wait()
+		{
+			if (count < 64)
+				;
+			else if (count < 128)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			count++;
+		}
+
+		void Reset()
+		{
+			count = 0;
+		}
+
+	private:
+
+		int count;
+	};
+
+	// one pooled buffer of file data moving through the pipeline
+
+	struct Chunk
+	{
+		unsigned char* data;		// pooled storage, capacity is the pool chunk size
+		int size;					// bytes of file data in this chunk
+		uint64_t offset;			// file offset of the first byte
+		int file;					// index of the file in the pipeline's list
+		bool zero;					// every byte is zero (set by the checksum stage)
+		bool fileEnd;				// the file's final chunk (an empty file has one with size zero)
+		bool last;					// end of input marker after every file (size is zero)
+		unsigned char* packed;		// compressed storage when the pool has it, otherwise null
+		int packedSize;				// bytes of compressed data, zero when the chunk goes as it is
+	};
+
+	// true if the size bytes at data are all zero (and there is at least one)
+	inline bool IsZero(const unsigned char* data, int size)
+	{
+		return size > 0 && data[0] == 0 && memcmp(data, data + 1, (size_t)size - 1) == 0;
+	}
+
+	// fixed set of chunk buffers
+	//  + the free ring is filled by the final stage (releasing) and drained by the first stage (acquiring)
+
+	class ChunkPool
+	{
+	public:
+
+		ChunkPool(int chunkSize, int chunkCount)
+			: chunkSize(chunkSize), storage((size_t)chunkSize * chunkCount), chunks(chunkCount), freeChunks(chunkCount)
+		{
+			for (int i = 0; i < chunkCount; ++i)
+			{
+				chunks[i].data = &storage[(size_t)i * chunkSize];
+				chunks[i].size = 0;
+				chunks[i].offset = 0;
+				chunks[i].file = 0;
+				chunks[i].zero = false;
+				chunks[i].fileEnd = false;
+				chunks[i].last = false;
+				chunks[i].packed = NULL;
+				chunks[i].packedSize = 0;
+				freeChunks.Push(&chunks[i]);
+			}
+		}
+
+		Chunk* Acquire()
+		{
+			Chunk* chunk = NULL;
+			return freeChunks.Pop(chunk) ? chunk : NULL;
+		}
+
+		void Release(Chunk* chunk)
+		{
+			bool pushed = freeChunks.Push(chunk);
+			assert(pushed);
+			(void)pushed;
+		}
+
+		int GetChunkSize() const
+		{
+			return chunkSize;
+		}
+
+		// give every chunk room for its compressed data (before any is acquired)
+		void ReservePacked()
+		{
+			const int capacity = CompressBound(chunkSize);
+			packedStorage.resize((size_t)capacity * chunks.size());
+			for (size_t i = 0; i < chunks.size(); ++i)
+				chunks[i].packed = &packedStorage[i * capacity];
+		}
+
+		// true if chunk is one of this pool's, for consumers releasing into one of several pools
+		bool Owns(const Chunk* chunk) const
+		{
+			return chunk >= &chunks[0] && chunk < &chunks[0] + chunks.size();
+		}
+
+	private:
+
+		int chunkSize;
+		std::vector<unsigned char> storage;
+		std::vector<unsigned char> packedStorage;
+		std::vector<Chunk> chunks;
+		SpscRing<Chunk*> freeChunks;
+	};
+
+	// sender pipeline: disk read thread -> checksum thread -> (compression workers ->) network stage
+	//  + the network stage is driven by the caller (the thread that owns the connection) through Front/Pop
+	//  + the checksum thread sees chunks in file order, so a single streaming engine yields the whole-file digest
+	//  + a list of files is read one after another, each ending with a fileEnd chunk and getting its own digest;
+	//    a small file is a single chunk, so the pipeline holds as many files in flight as it has chunks
+
+	class SendPipeline
+	{
+	public:
+
+		SendPipeline(int chunkSize = 64 * 1024, int chunkCount = 64)
+			: pool(chunkSize, chunkCount), readRing(chunkCount), sendRing(chunkCount)
+		{
+			stopping = false;
+			finished = false;
+			nextCompress = 0;
+			nextPacked = 0;
+		}
+
+		~SendPipeline()
+		{
+			Stop();
+		}
+
+		// algorithm may be null when the checksum is computed elsewhere
+		bool Start(const std::string& filePath, const ChecksumAlgorithm* algorithm)
+		{
+			return Start(std::vector<std::string>(1, filePath), algorithm);
+		}
+
+		// compress the chunks on threads workers (0 for one per core) before Start; a chunk comes out with packedSize
+		// set when compressing it paid off, and with zero when it looked incompressible or did not shrink enough
+		void SetCompression(int threads)
+		{
+			assert(!file.IsOpen() && compressRings.empty());
+			if (threads <= 0)
+				threads = (int)std::thread::hardware_concurrency();
+			if (threads <= 0)
+				threads = 1;
+			pool.ReservePacked();
+			const int perWorker = (int)(readRing.Capacity() / threads) + 1;
+			// a ring's counters are alignas(64), so these need C++17's aligned new, which every project builds with
+			for (int i = 0; i < threads; ++i)
+			{
+				compressRings.push_back(std::unique_ptr<SpscRing<Chunk*> >(new SpscRing<Chunk*>(perWorker)));
+				packedRings.push_back(std::unique_ptr<SpscRing<Chunk*> >(new SpscRing<Chunk*>(perWorker)));
+			}
+		}
+
+		// only the first file is opened here; one that cannot be read later is sent empty, which its checksum catches
+		bool Start(const std::vector<std::string>& filePaths, const ChecksumAlgorithm* algorithm)
+		{
+			assert(!file.IsOpen());
+			if (filePaths.empty() || !file.Open(filePaths[0], LargeFile::Reading))
+				return false;
+			this->filePaths = filePaths;
+			digests.assign(filePaths.size(), std::string());
+			if (algorithm)
+				engine = algorithm->create();
+			readerThread = std::thread(&SendPipeline::ReaderStage, this);
+			checksumThread = std::thread(&SendPipeline::ChecksumStage, this);
+			for (size_t i = 0; i < compressRings.size(); ++i)
+				compressThreads.push_back(std::thread(&SendPipeline::CompressStage, this, i));
+			return true;
+		}
+
+		void Stop()
+		{
+			stopping = true;
+			if (readerThread.joinable())
+				readerThread.join();
+			if (checksumThread.joinable())
+				checksumThread.join();
+			for (size_t i = 0; i < compressThreads.size(); ++i)
+				compressThreads[i].join();
+			compressThreads.clear();
+			file.Close();
+		}
+
+		// network stage: next checksummed (and compressed) chunk, or false if the upstream stages have not produced one yet
+		bool Front(Chunk*& chunk)
+		{
+			return compressRings.empty() ? sendRing.Front(chunk) : packedRings[nextPacked]->Front(chunk);
+		}
+
+		// network stage: the front chunk has been sent, recycle its buffer
+		void Pop()
+		{
+			Chunk* chunk = NULL;
+			if (compressRings.empty() ? sendRing.Pop(chunk) : packedRings[nextPacked]->Pop(chunk))
+			{
+				if (chunk->last)
+					finished = true;
+				nextPacked = compressRings.empty() ? 0 : (nextPacked + 1) % packedRings.size();
+				pool.Release(chunk);
+			}
+		}
+
+		// true once the end of file marker has passed through the network stage
+		bool IsFinished() const
+		{
+			return finished;
+		}
+
+		// digest of a file; valid once its fileEnd chunk has reached the network stage
+		const std::string& GetDigest(int index = 0) const
+		{
+			return digests[index];
+		}
+
+	private:
+
+		void ReaderStage()
+		{
+			Backoff backoff;
+			int index = 0;
+			uint64_t offset = 0;
+			uint64_t size = file.GetSize();
+			bool done = false;
+			while (!done && !stopping)
+			{
+				Chunk* chunk = pool.Acquire();
+				if (!chunk)
+				{
+					backoff.Wait();
+					continue;
+				}
+				backoff.Reset();
+
+				chunk->size = 0;
+				chunk->offset = offset;
+				chunk->file = index;
+				chunk->fileEnd = false;
+				chunk->last = index == (int)filePaths.size();
+				if (!chunk->last)
+				{
+					int bytesRead = file.IsOpen() ? file.Read(offset, chunk->data, pool.GetChunkSize()) : 0;
+					if (bytesRead < 0)
+						bytesRead = 0;	// a read error ends the file early, which the receiver's checksum catches
+					chunk->size = bytesRead;
+					offset += bytesRead;
+					chunk->fileEnd = bytesRead < pool.GetChunkSize() || offset >= size;
+				}
+				if (chunk->fileEnd)
+				{
+					file.Close();
+					offset = 0;
+					size = 0;
+					if (++index < (int)filePaths.size() && file.Open(filePaths[index], LargeFile::Reading))
+						size = file.GetSize();
+				}
+				done = chunk->last;
+
+				while (!readRing.Push(chunk) && !stopping)
+					backoff.Wait();
+				backoff.Reset();
+			}
+		}
+
+		void ChecksumStage()
+		{
+			Backoff backoff;
+			uint64_t zeroRun = 0;
+			bool done = false;
+			while (!done && !stopping)
+			{
+				Chunk* chunk = NULL;
+				if (!readRing.Pop(chunk))
+				{
+					backoff.Wait();
+					continue;
+				}
+				backoff.Reset();
+
+				// a hole in a sparse file reads as zeros, which some engines hash without a pass over them
+				//  + runs of zero chunks are hashed in one go, the shortcut costs the same for a chunk as for gigabytes
+				chunk->zero = IsZero(chunk->data, chunk->size);
+				if (engine)
+				{
+					if (chunk->zero)
+					{
+						zeroRun += (uint64_t)chunk->size;
+					}
+					else
+					{
+						if (zeroRun > 0)
+							engine->UpdateZeros(zeroRun);
+						zeroRun = 0;
+						if (chunk->size > 0)
+							engine->Update(chunk->data, (size_t)chunk->size);
+					}
+					if (chunk->fileEnd)
+					{
+						if (zeroRun > 0)
+							engine->UpdateZeros(zeroRun);
+						zeroRun = 0;
+						digests[chunk->file] = engine->GetDigest();	// published to the network stage by the ring push below
+						engine->Reset();
+					}
+				}
+				done = chunk->last;
+
+				// with compression, the workers take the chunks in turn
+				SpscRing<Chunk*>& next = compressRings.empty() ? sendRing : *compressRings[nextCompress];
+				nextCompress = compressRings.empty() ? 0 : (nextCompress + 1) % compressRings.size();
+				while (!next.Push(chunk) && !stopping)
+					backoff.Wait();
+				backoff.Reset();
+			}
+		}
+
+		// a compression worker: chunks that sample as incompressible (or are zeros, which are never sent) pass through
+		// as they are, and so does one that compresses by less than a sixteenth
+		void CompressStage(size_t index)
+		{
+			Backoff backoff;
+			bool done = false;
+			while (!done && !stopping)
+			{
+				Chunk* chunk = NULL;
+				if (!compressRings[index]->Pop(chunk))
+				{
+					backoff.Wait();
+					continue;
+				}
+				backoff.Reset();
+
+				chunk->packedSize = 0;
+				if (chunk->size > 0 && !chunk->zero && SampleEntropy(chunk->data, chunk->size) <= CompressEntropyLimit)
+				{
+					const int packedSize = Compress(chunk->data, chunk->size, chunk->packed, chunk->size - chunk->size / 16);
+					if (packedSize > 0)
+						chunk->packedSize = packedSize;
+				}
+				done = chunk->last;
+
+				while (!packedRings[index]->Push(chunk) && !stopping)
+					backoff.Wait();
+				backoff.Reset();
+			}
+		}
+
+		ChunkPool pool;
+		SpscRing<Chunk*> readRing;			// reader -> checksum
+		SpscRing<Chunk*> sendRing;			// checksum -> network, when not compressing
+		std::vector<std::unique_ptr<SpscRing<Chunk*> > > compressRings;	// checksum -> each compression worker
+		std::vector<std::unique_ptr<SpscRing<Chunk*> > > packedRings;	// each compression worker -> network
+		size_t nextCompress;				// worker the checksum stage deals the next chunk to
+		size_t nextPacked;					// worker the network stage takes the next chunk from
+		std::vector<std::string> filePaths;
+		std::vector<std::string> digests;	// per file, each written by the checksum stage before its fileEnd chunk moves on
+		LargeFile file;						// the file being read, owned by the reader stage once started
+		ChecksumEnginePtr engine;			// streaming checksum of the current file, owned by the checksum stage
+		std::thread readerThread;
+		std::thread checksumThread;
+		std::vector<std::thread> compressThreads;
+		std::atomic<bool> stopping;
+		bool finished;						// touched only by the network stage
+	};
+}
+
+#endif
@@ -0,0 +1,398 @@
+/*
+	Microbenchmark for the ReliabilitySystem hot paths
+	  + drives a sending and a receiving ReliabilitySystem against each other on simulated time, with no sockets
+	  + acks come back a fixed number of packets later (the in-flight depth), data packets can be lost or reordered
+	  + times every PacketSent, PacketReceived, GenerateAckBits, ProcessAck and Update call and counts the heap
+	    allocations made inside it; time a build with optimisation and NDEBUG, as the asserts scan the queues, but
+	    every scenario runs to the end with asserts on too
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <new>
+
+#include "Net.h"
+
+#pragma warning(disable : 4996)
+
+using namespace std;
+using namespace net;
+
+// ----------------------------------------------------
+// every allocation in the process goes through here, so a method's allocations are the count across its call
+
+static uint64_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+	allocationCount++;
+	void* p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+// ----------------------------------------------------
+// one synthetic workload
+struct Scenario
+{
+	string name;
+	unsigned int maxSequence = 0xFFFFFFFF;
+	int depth = 32;				// packets sent before the ack for a packet arrives
+	float loss = 0.0f;			// probability a data packet never arrives
+	float reorder = 0.0f;		// probability a data packet arrives late
+	int reorderDistance = 3;	// packets that overtake a reordered one
+	float rate = 10000.0f;		// simulated packets per second, sets how long the queues keep entries
+	int updateEvery = 10;		// packets between Update calls, as a send loop ticking while it streams
+	int packets = 20000;		// measured packets
+
+	// packets before measuring starts: the acked queue keeps two seconds of packets, so fill it and the arena first
+	int getWarmup() const
+	{
+		return (int)(rate * 2.0f) + depth + reorderDistance;
+	}
+};
+
+// time and allocations for one method
+struct MethodStats
+{
+	const char* name;
+	uint64_t calls = 0;
+	uint64_t nanoseconds = 0;
+	uint64_t allocations = 0;
+
+	explicit MethodStats(const char* name) : name(name) {}
+};
+
+// measures one call when measuring is on
+class Probe
+{
+public:
+
+	Probe(MethodStats& stats, bool measuring) : stats(stats), measuring(measuring), start(0), allocations(0)
+	{
+		if (measuring)
+		{
+			allocations = allocationCount;
+			start = GetTimeNs();
+		}
+	}
+
+	~Probe()
+	{
+		if (measuring)
+		{
+			const uint64_t end = GetTimeNs();
+			stats.calls++;
+			stats.nanoseconds += end - start;
+			stats.allocations += allocationCount - allocations;
+		}
+	}
+
+private:
+
+	MethodStats& stats;
+	bool measuring;
+	uint64_t start;
+	uint64_t allocations;
+};
+
+// cost of the timer pair around each call, subtracted from the results
+double timerOverhead()
+{
+	const int samples = 1000000;
+	uint64_t total = 0;
+	for (int i = 0; i < samples; ++i)
+	{
+		const uint64_t start = GetTimeNs();
+		total += GetTimeNs() - start;
+	}
+	return (double)total / samples;
+}
+
+struct InFlight
+{
+	int due;				// step the packet or ack arrives on
+	unsigned int sequence;
+	unsigned int ackBits;
+};
+
+bool runScenario(const Scenario& scenario, double overhead, FILE* json, bool firstJson)
+{
+	// sequence_more_recent only works while everything the queues hold spans less than half the sequence space
+	const double retained = scenario.getWarmup();
+	if (scenario.maxSequence != 0xFFFFFFFF && retained >= scenario.maxSequence / 2.0)
+	{
+		printf("%s: rate %.0f/s keeps about %.0f packets queued, too many for max sequence %u\n",
+			scenario.name.c_str(), scenario.rate, retained, scenario.maxSequence);
+		return false;
+	}
+
+	MethodStats packetSent("PacketSent");
+	MethodStats packetReceived("PacketReceived");
+	MethodStats generateAckBits("GenerateAckBits");
+	MethodStats processAck("ProcessAck");
+	MethodStats update("Update");
+
+	ReliabilitySystem sender(scenario.maxSequence);
+	ReliabilitySystem receiver(scenario.maxSequence);
+	mt19937 random(1);
+	uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	deque<InFlight> reordered;		// data packets held back, in arrival order
+	deque<InFlight> acks;			// acks on their way back, in arrival order
+	const float deltaTime = scenario.updateEvery / scenario.rate;
+	const int warmup = scenario.getWarmup();
+	const int steps = warmup + scenario.packets;
+	const int PacketSize = 256;
+
+	for (int step = 0; step < steps; ++step)
+	{
+		const bool measuring = step >= warmup;
+
+		const unsigned int sequence = sender.GetLocalSequence();
+		{
+			Probe probe(packetSent, measuring);
+			sender.PacketSent(PacketSize);
+		}
+
+		// the link: drop, hold back or deliver straight away
+
+		if (uniform(random) < scenario.loss)
+		{
+		}
+		else if (uniform(random) < scenario.reorder)
+		{
+			InFlight packet = { step + scenario.reorderDistance, sequence, 0 };
+			reordered.push_back(packet);
+		}
+		else
+		{
+			InFlight packet = { step, sequence, 0 };
+			reordered.push_front(packet);
+		}
+
+		while (!reordered.empty() && reordered.front().due <= step)
+		{
+			{
+				Probe probe(packetReceived, measuring);
+				receiver.PacketReceived(reordered.front().sequence, PacketSize);
+			}
+			reordered.pop_front();
+
+			InFlight ack = { step + scenario.depth, receiver.GetRemoteSequence(), 0 };
+			{
+				Probe probe(generateAckBits, measuring);
+				ack.ackBits = receiver.GenerateAckBits();
+			}
+			acks.push_back(ack);
+		}
+
+		while (!acks.empty() && acks.front().due <= step)
+		{
+			{
+				Probe probe(processAck, measuring);
+				sender.ProcessAck(acks.front().sequence, acks.front().ackBits);
+			}
+			acks.pop_front();
+		}
+
+		if (step % scenario.updateEvery == 0)
+		{
+			Probe probe(update, measuring);
+			sender.Update(deltaTime);
+			receiver.Update(deltaTime);
+		}
+	}
+
+	// Update covers both sides, so it is counted as two calls
+	update.calls *= 2;
+
+	printf("%s: max sequence %u, depth %d, loss %.2f%%, reorder %.2f%%, %.0f packets/s\n",
+		scenario.name.c_str(), scenario.maxSequence, scenario.depth, scenario.loss * 100.0f, scenario.reorder * 100.0f, scenario.rate);
+	printf("  sent %u, acked %u, lost %u, pending %d\n",
+		sender.GetSentPackets(), sender.GetAckedPackets(), sender.GetLostPackets(), sender.GetPendingAckPackets());
+
+	MethodStats* methods[] = { &packetSent, &packetReceived, &generateAckBits, &processAck, &update };
+	const int methodCount = sizeof(methods) / sizeof(methods[0]);
+
+	if (json)
+		fprintf(json, "%s    {\"scenario\": \"%s\", \"max_sequence\": %u, \"depth\": %d, \"loss\": %g, \"reorder\": %g, \"rate\": %g, \"methods\": {",
+			firstJson ? "" : ",\n", scenario.name.c_str(), scenario.maxSequence, scenario.depth, scenario.loss, scenario.reorder, scenario.rate);
+
+	for (int i = 0; i < methodCount; ++i)
+	{
+		const MethodStats& stats = *methods[i];
+		double nsPerOp = 0.0;
+		double allocationsPerOp = 0.0;
+		if (stats.calls > 0)
+		{
+			nsPerOp = (double)stats.nanoseconds / stats.calls - overhead;
+			if (nsPerOp < 0.0)
+				nsPerOp = 0.0;
+			allocationsPerOp = (double)stats.allocations / stats.calls;
+		}
+		printf("  %-16s %10llu calls %10.1f ns/op %8.3f allocs/op\n", stats.name, (unsigned long long)stats.calls, nsPerOp, allocationsPerOp);
+		if (json)
+			fprintf(json, "%s\"%s\": {\"calls\": %llu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.4f}",
+				i > 0 ? ", " : "", stats.name, (unsigned long long)stats.calls, nsPerOp, allocationsPerOp);
+	}
+
+	if (json)
+		fprintf(json, "}}");
+
+	return true;
+}
+
+void printUsage()
+{
+	printf("Usage: ReliabilityBench [options]\n");
+	printf("  With no workload options the standard scenarios run: steady, deep, lossy and wrap.\n");
+	printf("  --depth <packets>: Packets in flight before an ack returns.\n");
+	printf("  --loss <percent>: Data packets lost.\n");
+	printf("  --reorder <percent>: Data packets overtaken by the next few.\n");
+	printf("  --max-sequence <n>: Sequence numbers wrap after n (small values test the wrap).\n");
+	printf("  --rate <packets/s>: Simulated send rate, which sets how many entries the queues hold.\n");
+	printf("  --packets <n>: Measured packets per scenario (default 20000).\n");
+	printf("  -o, --out <file>: Also write the results as JSON.\n");
+}
+
+int main(int argc, char* argv[])
+{
+	Scenario custom;
+	custom.name = "custom";
+	bool customized = false;
+	int packets = custom.packets;
+	string outputPath;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			printUsage();
+			return 1;
+		}
+		const char* value = argv[++i];
+
+		if (arg == "--depth")
+			custom.depth = atoi(value);
+		else if (arg == "--loss")
+			custom.loss = (float)atof(value) / 100.0f;
+		else if (arg == "--reorder")
+			custom.reorder = (float)atof(value) / 100.0f;
+		else if (arg == "--max-sequence")
+			custom.maxSequence = (unsigned int)strtoul(value, NULL, 0);
+		else if (arg == "--rate")
+			custom.rate = (float)atof(value);
+		else if (arg == "--packets")
+		{
+			packets = atoi(value);
+			continue;
+		}
+		else if (arg == "-o" || arg == "--out")
+		{
+			outputPath = value;
+			continue;
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+		customized = true;
+	}
+
+	vector<Scenario> scenarios;
+	if (customized)
+	{
+		scenarios.push_back(custom);
+	}
+	else
+	{
+		Scenario steady;
+		steady.name = "steady";
+		scenarios.push_back(steady);
+
+		Scenario deep;
+		deep.name = "deep";
+		deep.depth = 1024;
+		deep.rate = 20000.0f;
+		scenarios.push_back(deep);
+
+		Scenario lossy;
+		lossy.name = "lossy";
+		lossy.depth = 64;
+		lossy.loss = 0.01f;
+		lossy.reorder = 0.01f;
+		scenarios.push_back(lossy);
+
+		Scenario wrap;
+		wrap.name = "wrap";
+		wrap.maxSequence = 255;
+		wrap.depth = 16;
+		wrap.loss = 0.01f;
+		wrap.reorder = 0.01f;
+		wrap.rate = 40.0f;
+		wrap.updateEvery = 1;
+		scenarios.push_back(wrap);
+	}
+
+	FILE* json = nullptr;
+	if (!outputPath.empty())
+	{
+		json = fopen(outputPath.c_str(), "w");
+		if (json == nullptr)
+		{
+			printf("could not write %s\n", outputPath.c_str());
+			return 1;
+		}
+		fprintf(json, "{\n  \"scenarios\": [\n");
+	}
+
+	const double overhead = timerOverhead();
+	printf("timer overhead %.1f ns, subtracted from each call\n", overhead);
+
+	bool ok = true;
+	for (size_t i = 0; i < scenarios.size() && ok; ++i)
+	{
+		scenarios[i].packets = packets;
+		ok = runScenario(scenarios[i], overhead, json, i == 0);
+	}
+
+	if (json)
+	{
+		fprintf(json, "\n  ]\n}\n");
+		fclose(json);
+	}
+
+	return ok ? 0 : 1;
+}
@@ -8,17 +8,25 @@
 #include <fstream>
 #include <string>
 #include <vector>
-#include <ctime>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
 
 #include "Net.h"
-#include "CRC.h"
+#include "Checksum.h"
+#include "Pipeline.h"
+#include "LinkEmulator.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Capture.h"
+#include "Transfer.h"
 
 #pragma warning(disable : 4996)
 
 #define VOID "void"
 #define CLIENT "Client"
 #define SERVER "Server"
-#define TRANSFER_COMPLETE "complete"
 
 //#define SHOW_ACKS
 
@@ -32,6 +40,8 @@ const float DeltaTime = 1.0f / 30.0f;
 const float SendRate = 1.0f / 30.0f;
 const float TimeOut = 10.0f;
 const int PacketSize = 256;
+const float SendTick = 0.001f; // loop period while the send pipeline has data, so the window refills promptly
+const int StripePortStep = 2; // stripe i uses the ports plus 2i, so a client and server on one host never collide
 
 class FlowControl
 {
@@ -109,6 +119,12 @@ public:
 		return mode == Good ? 30.0f : 10.0f;
 	}
 
+	// packets allowed in flight (or per tick, until the peer starts acking)
+	int GetSendWindow()
+	{
+		return mode == Good ? 256 : 64;
+	}
+
 private:
 
 	enum Mode
@@ -129,10 +145,23 @@ struct CommandLineArg
 {
 	string mode = "Server"; // Default mode
 	string filePath;
+	string directory; // batch mode: send every file under it over the one connection
 	string checksumMethod = "CRC32";
+	string linkProfile; // link emulator settings or scenario file, empty for a clean link
+	string metrics; // port for the metrics endpoint or file to write them to, empty to print stats instead
+	string traceFile; // packet lifecycle trace, empty for none
+	string pcapFile; // packet capture, empty for none
+	string keyFile; // pre-shared key every packet is sealed with, empty for cleartext
 	string address = "127.0.0.1"; // Default address
 	int port = 30000; // Default port
+	int checksumThreads = 1; // 1 = checksum in the send pipeline, otherwise checksum the file on a separate thread pool
+	int stripes = 1; // connections a file is striped over, client and server must agree
+	vector<unsigned int> bindAddresses; // local addresses the stripes bind to in turn, empty for any
 	bool errorDetectTest = false; // flag to toggle the error detection test for CRC method 
+	bool delta = false; // send only what the server's existing copy of the file lacks
+	bool dedup = false; // send only the chunks the server's chunk store lacks
+	string chunkStore; // server: directory of the chunk store dedup refers to, empty for none
+	int compressThreads = -1; // compression workers for the file's blocks, 0 = one per core, -1 = no compression
 
 	// or initialize a constructor here with the default values 
 	CommandLineArg(int argc, char* argv[])
@@ -156,6 +185,10 @@ private:
 			{
 				filePath = getNextArg(argc, argv, i);
 			}
+			else if (arg == "-d" && mode != SERVER)
+			{
+				directory = getNextArg(argc, argv, i);
+			}
 			else if (arg == "-a")
 			{
 				address = getNextArg(argc, argv, i);
@@ -169,15 +202,128 @@ private:
 			{
 				errorDetectTest = true;
 			}
+			else if (arg == "--delta")
+			{
+				delta = true;
+			}
+			else if (arg == "--dedup")
+			{
+				dedup = true;
+			}
+			else if (arg == "--chunk-store")
+			{
+				chunkStore = getNextArg(argc, argv, i);
+				if (chunkStore == VOID)
+					chunkStore.clear();
+			}
+			else if (arg == "--compress")
+			{
+				string threadsStr = getNextArg(argc, argv, i);
+				compressThreads = threadsStr == VOID ? 0 : stoi(threadsStr);
+				if (compressThreads < 0)
+				{
+					cerr << "Compression threads must be 0 or more" << endl;
+					mode = VOID;
+				}
+			}
+			else if (arg == "-l" || arg == "--link")
+			{
+				linkProfile = getNextArg(argc, argv, i);
+			}
+			else if (arg == "--metrics")
+			{
+				metrics = getNextArg(argc, argv, i);
+			}
+			else if (arg == "--trace")
+			{
+				traceFile = getNextArg(argc, argv, i);
+			}
+			else if (arg == "--pcap")
+			{
+				pcapFile = getNextArg(argc, argv, i);
+			}
+			else if (arg == "--key")
+			{
+				keyFile = getNextArg(argc, argv, i);
+				if (keyFile == VOID)
+					keyFile.clear();
+			}
+			else if (arg == "--stripes")
+			{
+				string stripesStr = getNextArg(argc, argv, i);
+				stripes = stripesStr == VOID ? 1 : stoi(stripesStr);
+				if (stripes < 1 || stripes > MaxStripes)
+				{
+					cerr << "Stripes must be 1 to " << MaxStripes << endl;
+					mode = VOID;
+				}
+			}
+			else if (arg == "--bind")
+			{
+				string list = getNextArg(argc, argv, i);
+				for (size_t start = 0; list != VOID && start <= list.size(); )
+				{
+					size_t comma = list.find(',', start);
+					if (comma == string::npos)
+						comma = list.size();
+					int a, b, c, d;
+					if (sscanf(list.substr(start, comma - start).c_str(), "%d.%d.%d.%d", &a, &b, &c, &d) != 4)
+					{
+						cerr << "Bad bind address list: " << list << endl;
+						mode = VOID;
+						break;
+					}
+					bindAddresses.push_back(Address(a, b, c, d, 0).GetAddress());
+					start = comma + 1;
+				}
+			}
+			else if (arg == "-j")
+			{
+				string threadsStr = getNextArg(argc, argv, i);
+				checksumThreads = threadsStr == VOID ? 1 : stoi(threadsStr);
+			}
+			else if (arg == "-c" || arg == "--checksum")
+			{
+				checksumMethod = getNextArg(argc, argv, i);
+				if (checksumMethod == "list")
+				{
+					PrintChecksumAlgorithms();
+					mode = VOID; // End program once the list is shown
+				}
+				else if (checksumMethod != VOID && FindChecksumAlgorithm(checksumMethod) == nullptr)
+				{
+					cerr << "Unknown checksum method: " << checksumMethod << " (use -c list)" << endl;
+					mode = VOID;
+				}
+			}
 			else if(arg == "-h")
 			{
-				printf("Usage: SENG2040-A1 -m <mode> -f <file_path> -a <address> -p <port>\n");
+				printf("Usage: SENG2040-A1 -m <mode> -f <file_path> -a <address> -p <port> -c <checksum>\n");
 				printf("Arguments:\n");
 				printf("  -m <mode>: Specify the mode of operation (server or client).\n");
 				printf("  -f <file_path>: Specify the path to the file (required for client mode).\n");
+				printf("  -d <directory>: Send every file under <directory> over one connection instead of a single file.\n");
 				printf("  -a <address>: Specify the IP address of the destination.\n");
 				printf("  -p <port>: Specify the port number.\n");
 				printf("  -e: Enable error test to demonstrate whole-file error detection works.\n");
+				printf("  --delta: Update the server's existing copy of the file, sending only the blocks that changed.\n");
+				printf("  --dedup: Cut the file into content-defined chunks and send only those the server's chunk store lacks.\n");
+				printf("  --chunk-store <directory>: Server: keep the chunks of received files in <directory> for --dedup to refer to.\n");
+				printf("  --compress <threads>: Compress the file's blocks on <threads> threads (0 = one per core), sending them as they are\n");
+				printf("     when a sample of them looks incompressible.\n");
+				printf("  -c, --checksum <method>: Whole-file checksum method (default CRC32, 'list' shows all).\n");
+				printf("  -l, --link <settings|file>: Emulate an impaired link for outgoing packets, e.g. \"loss=1%%,delay=20ms,jitter=2ms\".\n");
+				printf("     Settings: loss, burst_enter, burst_exit, burst_loss, reorder, duplicate (%%), delay, jitter, reorder_delay (ms),\n");
+				printf("     rate (kbps), burst, queue (bytes), seed; at=<secs> starts a new phase of a scenario.\n");
+				printf("  --metrics <port|file>: Serve Prometheus metrics on 127.0.0.1:<port>, or rewrite <file> every second,\n");
+				printf("     instead of printing connection stats.\n");
+				printf("  --trace <file>: Record a binary packet lifecycle trace (TraceConvert makes it Perfetto JSON).\n");
+				printf("  --pcap <file>: Capture every datagram sent and received to a pcap file (ReliableUDP.lua dissects it).\n");
+				printf("  --key <file>: Encrypt and authenticate every packet with the pre-shared key in <file> (64 hex digits or\n");
+				printf("     32 raw bytes); server and client need the same key.\n");
+				printf("  -j <threads>: Checksum the file on <threads> threads beside the send pipeline (0 = one per core).\n");
+				printf("  --stripes <n>: Stripe the file over <n> connections, stripe i on the ports plus 2i (server and client alike).\n");
+				printf("  --bind <address,...>: Local addresses the stripes bind to in turn, e.g. one per interface or bonded link.\n");
 				printf("  -h: Display usage.\n");
 
 				mode = VOID; // End program if user chooses to display usage
@@ -200,102 +346,40 @@ private:
 	}
 };
 
-// ------------------------------------------------------
-// creating struct for FileMetadata 
-struct FileMetadata 
-{
-	char fileName[256];
-	uint32_t fileSize;
-	uint32_t CRC;
 
-	FileMetadata(const string& filePath)
-	{
-		getMetadata(filePath);
-		calculateCRC(filePath);
-	}
-
-private:
-
-	void getMetadata(const string& filePath)
-	{
-		// Open the file
-		ifstream file(filePath, ios::binary);
-
-		if (!file.is_open()) 
-		{
-			cerr << "Error opening file: " << filePath << endl;
-			exit(1);
-			// Set default values for metadata
-			strcpy(fileName, "");
-			fileSize = 0;
-		}
-
-		// Get the file name
-		const char* lastSlash = strrchr(filePath.c_str(), '\\');
-
-		if (lastSlash == nullptr) 
-		{
-			lastSlash = fileName;
-		}
-		else 
-		{
-			lastSlash++;
-		}
-		strcpy(fileName, lastSlash);
 
-		// Get the file size
-		file.seekg(0, ios::end);
-		fileSize = file.tellg();
-		file.seekg(0, ios::beg);
 
-		// Close the file
-		file.close();
-	}
-
-public:
-	// serialization method by taking metadata and inserting into byte vector 
-	vector<unsigned char> serializeMetadata(const FileMetadata& metadata)
+// server side of a stripe past the first: drains its connection into the receive pipeline on a thread of its own,
+// so each stripe's socket (and the receive queue the kernel hashed it to) is served by its own core
+void drainStripe(ReliableConnection& connection, FileReceiver& fileReceiver, int stripe, const atomic<bool>& stopping)
+{
+	chrono::steady_clock::time_point lastTime = chrono::steady_clock::now();
+	while (!stopping)
 	{
-		vector<unsigned char> buffer;
+		connection.WaitForPacket(DeltaTime);
 
-		// need to store 32-bit ints into 4 bytes and store into byte vector 
-		for (int i = 0; i <  sizeof(uint32_t); ++i)
+		while (true)
 		{
-			// use shift operator to shift counter i * 8 bits to right 
-			// use 0xFF as a mask to isolate right side byte to append to buffer
-			unsigned char byte = (metadata.fileSize >> (i * 8)) & 0xFF;
-			buffer.push_back(byte);
-		}
-	}
+			unsigned char scratch[PacketSize];
+			unsigned char* packet = fileReceiver.getBuffer(stripe);
+			if (packet == nullptr)
+				packet = scratch;
 
-	void calculateCRC(const string& filePath)
-	{
-		// Open the file
-		ifstream file(filePath, ios::binary);
+			int bytes_read = connection.ReceivePacket(packet, PacketSize);
+			if (bytes_read == 0)
+				break;
 
-		if (!file.is_open())
-		{
-			cerr << "Error opening file: " << filePath << endl;
-			exit(1);
+			if (packet != scratch)
+				fileReceiver.submit(bytes_read, stripe);
+			else
+				fileReceiver.drop();
 		}
 
-		// Read file contents into a buffer
-		vector<char> buffer(std::istreambuf_iterator<char>(file), {});
-
-		// Calculate CRC
-		uint32_t crc = CRC::Calculate(buffer.data(), buffer.size(), CRC::CRC_32());
-
-		CRC = crc;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		connection.Update(chrono::duration<float>(now - lastTime).count());
+		lastTime = now;
 	}
-
-	// methods such as getting the file metadata from file by using the file path 
-	// reading file size and compute the CRC 
-	// convert between FileMetadata and byte array for manual byte array manipulation ? 
-
-};
-
-
-
+}
 
 int main(int argc, char* argv[])
 {
@@ -316,6 +400,11 @@ int main(int argc, char* argv[])
 
 	Mode mode = Server;
 	Address address;
+	unique_ptr<FileReceiver> fileReceiver;
+
+	MetricsRegistry metricsRegistry;
+	TransferMetrics transferMetrics(metricsRegistry);
+	TransferMetrics* metrics = arguments.metrics.empty() ? nullptr : &transferMetrics;
 
 	/*
 	*
@@ -341,10 +430,6 @@ int main(int argc, char* argv[])
 			address = Address(a, b, c, d, arguments.port);
 		}
 
-		FileMetadata metadata(arguments.filePath);
-		cout << "File name " << metadata.fileName << endl;
-		cout << "File size " << metadata.fileSize << endl;
-		cout << "CRC: " << metadata.CRC << endl;
 	}
 	else if (arguments.mode == SERVER)
 	{
@@ -356,6 +441,12 @@ int main(int argc, char* argv[])
 		}
 
 		// Receive metadata and file data
+		fileReceiver.reset(new FileReceiver(PacketSize, "", true, metrics, arguments.stripes));
+		if (!arguments.chunkStore.empty() && !fileReceiver->openChunkStore(arguments.chunkStore))
+		{
+			printf("Error: Unable to open the chunk store in %s\n", arguments.chunkStore.c_str());
+			return 1;
+		}
 	}
 
 	// initialize
@@ -367,22 +458,226 @@ int main(int argc, char* argv[])
 	}
 
 	ReliableConnection connection(ProtocolId, TimeOut);
+	FileSender fileSender(connection, PacketSize);
+	BatchSender batchSender(connection, PacketSize);
+	const bool batch = mode == Client && !arguments.directory.empty();
+
+	if (batch && arguments.stripes > 1)
+	{
+		printf("A batch goes over one connection, ignoring --stripes\n");
+		arguments.stripes = 1;
+	}
+	if (batch && arguments.delta)
+	{
+		printf("A batch is sent whole, ignoring --delta\n");
+		arguments.delta = false;
+	}
+	if (batch && arguments.dedup)
+	{
+		printf("A batch is sent whole, ignoring --dedup\n");
+		arguments.dedup = false;
+	}
+	if (arguments.delta && arguments.dedup)
+	{
+		printf("A delta already sends only what changed, ignoring --dedup\n");
+		arguments.dedup = false;
+	}
+	if (batch && arguments.compressThreads >= 0)
+	{
+		printf("A batch is sent uncompressed, ignoring --compress\n");
+		arguments.compressThreads = -1;
+	}
+	if ((arguments.delta || arguments.dedup) && arguments.compressThreads >= 0)
+	{
+		printf("%s sends uncompressed bytes, ignoring --compress\n", arguments.delta ? "A delta" : "Dedup");
+		arguments.compressThreads = -1;
+	}
+	if (mode == Client && arguments.delta && arguments.stripes > 1)
+	{
+		printf("A delta goes over one connection, ignoring --stripes\n");
+		arguments.stripes = 1;
+	}
+	if (mode == Client && arguments.dedup && arguments.stripes > 1)
+	{
+		printf("Dedup goes over one connection, ignoring --stripes\n");
+		arguments.stripes = 1;
+	}
+
+	// stripes past the first, each with a connection of its own on its own ports
+	vector<unique_ptr<ReliableConnection>> stripeConnections;
+	for (int i = 1; i < arguments.stripes; ++i)
+	{
+		stripeConnections.push_back(unique_ptr<ReliableConnection>(new ReliableConnection(ProtocolId, TimeOut)));
+		if (mode == Client)
+			fileSender.addStripe(*stripeConnections.back());
+	}
+	vector<int> stripeWindows(arguments.stripes);
+
+	if (batch)
+	{
+		if (!batchSender.start(arguments.directory, arguments.checksumMethod))
+		{
+			printf("Error: No files to send in %s\n", arguments.directory.c_str());
+			return 1;
+		}
+		batchSender.setMetrics(metrics);
+
+		cout << "Batch of " << batchSender.getFileCount() << " files, " << batchSender.getTotalBytes() << " bytes" << endl;
+		cout << "Checksum: " << arguments.checksumMethod << " per file" << endl;
+	}
+	else if (mode == Client)
+	{
+		// reader and checksum stages start filling the pipeline while the connection is set up
+		if (arguments.compressThreads >= 0)
+			fileSender.setCompression(arguments.compressThreads);
+		if (!fileSender.start(arguments.filePath, arguments.checksumMethod, arguments.checksumThreads))
+		{
+			printf("Error: Unable to open file\n");
+			return 1;
+		}
+		fileSender.setErrorTest(arguments.errorDetectTest);
+		fileSender.setMetrics(metrics);
+		fileSender.setDelta(arguments.delta);
+		fileSender.setDedup(arguments.dedup);
+
+		const FileMetadata& metadata = fileSender.getMetadata();
+		cout << "File name " << metadata.fileName << endl;
+		cout << "File size " << metadata.fileSize << endl;
+		cout << "Checksum: " << FindChecksumAlgorithm(metadata.checksumId)->name << " (computed while sending)" << endl;
+		if (arguments.stripes > 1)
+			cout << "Striped over " << arguments.stripes << " connections" << endl;
+		if (arguments.delta)
+			cout << "Delta against the server's existing copy" << endl;
+		if (arguments.dedup)
+			cout << "Dedup against the server's chunk store" << endl;
+		if (arguments.compressThreads >= 0)
+			cout << "Compression: " << CompressCodec << " on " << (arguments.compressThreads > 0 ? to_string(arguments.compressThreads) + " threads" : string("one thread per core")) << endl;
+	}
+
+	LinkEmulator linkEmulator;
+	vector<unique_ptr<LinkEmulator>> stripeEmulators; // every stripe is a path of its own with the same impairments
+	if (!arguments.linkProfile.empty())
+	{
+		string error;
+		if (!linkEmulator.Configure(arguments.linkProfile, error))
+		{
+			printf("bad link settings: %s\n", error.c_str());
+			return 1;
+		}
+		linkEmulator.PrintProfile();
+		connection.SetPacketShaper(&linkEmulator);
+
+		for (size_t i = 0; i < stripeConnections.size(); ++i)
+		{
+			stripeEmulators.push_back(unique_ptr<LinkEmulator>(new LinkEmulator()));
+			stripeEmulators.back()->Configure(arguments.linkProfile, error);
+			stripeConnections[i]->SetPacketShaper(stripeEmulators.back().get());
+		}
+	}
+
+	ReliabilityMetrics reliabilityMetrics(metricsRegistry, "reliable_udp");
+	Gauge& rttGauge = metricsRegistry.AddGauge("reliable_udp_srtt_seconds", "Smoothed round trip time.");
+	Gauge& minRttGauge = metricsRegistry.AddGauge("reliable_udp_min_rtt_seconds", "Smallest round trip time seen.");
+	Gauge& sentBandwidthGauge = metricsRegistry.AddGauge("reliable_udp_sent_bandwidth_kbps", "Bandwidth sent over the last second.");
+	Gauge& ackedBandwidthGauge = metricsRegistry.AddGauge("reliable_udp_acked_bandwidth_kbps", "Bandwidth acknowledged over the last second.");
+	Gauge& connectedGauge = metricsRegistry.AddGauge("reliable_udp_connected", "1 while the connection is up.");
+	MetricsExporter metricsExporter(metricsRegistry);
+
+	Tracer tracer;
+	TraceObserver traceObserver(tracer, metrics ? &reliabilityMetrics : nullptr);
+
+	if (!arguments.traceFile.empty())
+	{
+		if (!tracer.Start(arguments.traceFile))
+		{
+			printf("could not write trace %s\n", arguments.traceFile.c_str());
+			return 1;
+		}
+		connection.GetReliabilitySystem().SetObserver(&traceObserver);
+	}
+
+	if (!arguments.keyFile.empty())
+	{
+		unsigned char key[AeadKeySize];
+		if (!LoadKeyFile(arguments.keyFile, key))
+		{
+			printf("could not read a key from %s\n", arguments.keyFile.c_str());
+			return 1;
+		}
+		connection.SetKey(key);
+		for (size_t i = 0; i < stripeConnections.size(); ++i)
+			stripeConnections[i]->SetKey(key);
+		memset(key, 0, sizeof(key));
+		printf("Encrypted with XChaCha20-Poly1305\n");
+	}
+
+	PcapWriter pcapWriter;
+	if (!arguments.pcapFile.empty())
+	{
+		if (!pcapWriter.Start(arguments.pcapFile))
+		{
+			printf("could not write capture %s\n", arguments.pcapFile.c_str());
+			return 1;
+		}
+		connection.SetPacketCapture(&pcapWriter);
+		for (size_t i = 0; i < stripeConnections.size(); ++i)
+			stripeConnections[i]->SetPacketCapture(&pcapWriter);
+	}
+
+	if (metrics)
+	{
+		if (!tracer.IsRunning())
+			connection.GetReliabilitySystem().SetObserver(&reliabilityMetrics);
+
+		char* end = nullptr;
+		const long metricsPort = strtol(arguments.metrics.c_str(), &end, 10);
+		const bool started = *end == '\0' ? metricsExporter.StartHttp((unsigned short)metricsPort) : metricsExporter.StartFile(arguments.metrics, 1.0f);
+		if (!started)
+		{
+			printf("could not export metrics to %s\n", arguments.metrics.c_str());
+			return 1;
+		}
+	}
 
 	const int port = mode == Server ? ServerPort : ClientPort;
+	const vector<unsigned int>& bindAddresses = arguments.bindAddresses;
 
-	if (!connection.Start(port))
+	if (!connection.Start(port, bindAddresses.empty() ? 0 : bindAddresses[0]))
 	{
 		printf("could not start connection on port %d\n", port);
 		return 1;
 	}
 
+	for (size_t i = 0; i < stripeConnections.size(); ++i)
+	{
+		const int stripePort = port + StripePortStep * (int)(i + 1);
+		if (!stripeConnections[i]->Start(stripePort, bindAddresses.empty() ? 0 : bindAddresses[(i + 1) % bindAddresses.size()]))
+		{
+			printf("could not start connection on port %d\n", stripePort);
+			return 1;
+		}
+	}
+
 	if (mode == Client)
 	{
 		connection.Connect(address);
+		for (size_t i = 0; i < stripeConnections.size(); ++i)
+			stripeConnections[i]->Connect(Address(address.GetAddress(), (unsigned short)(address.GetPort() + StripePortStep * (i + 1))));
 	}
 	else
 	{
 		connection.Listen();
+		for (size_t i = 0; i < stripeConnections.size(); ++i)
+			stripeConnections[i]->Listen();
+	}
+
+	// the server drains the first stripe on this thread and every other stripe on one of its own
+	atomic<bool> stopping(false);
+	vector<thread> stripeDrains;
+	if (mode == Server)
+	{
+		for (size_t i = 0; i < stripeConnections.size(); ++i)
+			stripeDrains.push_back(thread(drainStripe, ref(*stripeConnections[i]), ref(*fileReceiver), (int)(i + 1), cref(stopping)));
 	}
 
 	bool connected = false;
@@ -390,23 +685,25 @@ int main(int argc, char* argv[])
 	float statsAccumulator = 0.0f;
 
 	FlowControl flowControl;
+	int lastWindow = 0; // send window last recorded in the trace
+	vector<unsigned char> reply; // server: message from the receive pipeline to the client
 
 	bool loopFlag = true;
-	bool transmissionCompleteFlag = false;
 
-	char filename[256];
-	char trueFilename[256];
-	int filesize;
-	long long int crc;
-
-	ofstream outputFile;
+	chrono::steady_clock::time_point lastTime = chrono::steady_clock::now();
 
 	while (loopFlag)
 	{
+		// the loop period varies while streaming, so advance by measured time rather than a fixed step
+
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		const float deltaTime = chrono::duration<float>(now - lastTime).count();
+		lastTime = now;
+
 		// update flow control
 
 		if (connection.IsConnected())
-			flowControl.Update(DeltaTime, connection.GetReliabilitySystem().GetRoundTripTime() * 1000.0f);
+			flowControl.Update(deltaTime, connection.GetReliabilitySystem().GetRoundTripTime() * 1000.0f);
 
 		const float sendRate = flowControl.GetSendRate();
 
@@ -425,152 +722,127 @@ int main(int argc, char* argv[])
 			connected = true;
 		}
 
-		if (!connected && connection.ConnectFailed())
+		bool connectFailed = connection.ConnectFailed();
+		if (mode == Client)
+		{
+			for (size_t i = 0; i < stripeConnections.size(); ++i)
+				connectFailed = connectFailed || stripeConnections[i]->ConnectFailed();
+		}
+
+		if (!connected && connectFailed)
 		{
 			printf("connection failed\n");
 			break;
 		}
 
-
+		// nothing goes out until the handshake has connected every stripe
+		bool linked = connection.IsConnected();
 		if (mode == Client)
 		{
-			FileMetadata metadata(arguments.filePath);
-			// Read file from disk
-			ifstream file(arguments.filePath, ios::binary);
-			if (!file.is_open())
+			for (size_t i = 0; i < stripeConnections.size(); ++i)
+				linked = linked && stripeConnections[i]->IsConnected();
+		}
+
+		if (mode == Client && linked && !(batch ? batchSender.isComplete() : fileSender.isComplete()))
+		{
+			// network stage: send checksummed chunks in packet sized pieces
+			// backpressure: once the server acks, cap the packets in flight at the window; until then cap each tick's burst
+			ReliabilitySystem& reliability = connection.GetReliabilitySystem();
+			int window = flowControl.GetSendWindow();
+			if (window != lastWindow)
 			{
-				printf("Error: Unable to open file\n");
-				break;
+				tracer.Record(TraceSendWindow, 0, (unsigned int)window);
+				lastWindow = window;
 			}
+			// striped, every stripe has the same window (flow control follows the first stripe's rtt)
+			for (size_t i = 0; i < stripeConnections.size(); ++i)
+			{
+				ReliabilitySystem& stripeReliability = stripeConnections[i]->GetReliabilitySystem();
+				stripeWindows[i + 1] = window - (stripeReliability.GetAckedPackets() > 0 ? stripeReliability.GetPendingAckPackets() : 0);
+			}
+			if (reliability.GetAckedPackets() > 0)
+			{
+				window -= reliability.GetPendingAckPackets();
+			}
+			stripeWindows[0] = window;
 
-			// Extract file metadata
-			string fileName = metadata.fileName;
-			int fileSize = metadata.fileSize;
-			metadata.calculateCRC(arguments.filePath);
-
-			// starting transmission timer 
-			clock_t startTimer = clock();
-
-			// Send file metadata
-			string MetaData = fileName + "|" + to_string(fileSize) + "|" + to_string(metadata.CRC);
-			connection.SendPacket(reinterpret_cast<const unsigned char*>(MetaData.c_str()), MetaData.length());
-
-			// Break file into pieces and send each piece
-			const int chunkSize = 256;
-			char buffer[chunkSize];
-			bool deliberateError = false; // Introduce an error to test Whole-File Error Detection Capabilities
-
-			while (file)
+			if (batch)
 			{
-				file.read(buffer, chunkSize);
-				int bytesRead = file.gcount();
-				if (bytesRead > 0)
+				if (batchSender.update(window))
 				{
-					// for the first byte change value that creates an error 
-					if (arguments.errorDetectTest && !deliberateError)
-					{
-						buffer[0] ^= 0xff;
-						deliberateError = true;
-					}
-					// sending the pieces 
-					connection.SendPacket(reinterpret_cast<const unsigned char*>(buffer), bytesRead);
+					const double transmissionTime = batchSender.getTransmissionTime();
+					printf("Transmission Time: %.2f secs\n", transmissionTime);
+					printf("Files per second: %.0f\n", batchSender.getFileCount() / transmissionTime);
+					printf("Transfer Speed: %.2f megabits/secs\n", batchSender.getTotalBytes() * 8.0 / (transmissionTime * 1000000));
+					printf("Packets: %llu\n", (unsigned long long)batchSender.getPacketsSent());
 				}
 			}
-
-			loopFlag = false; // End top loop once file transfer is complete
-
-			// Send message indicating file transfer completion
-			string transferCompleteMessage = TRANSFER_COMPLETE;
-			connection.SendPacket(reinterpret_cast<const unsigned char*>(transferCompleteMessage.c_str()), transferCompleteMessage.length());
-
-			// ending transmission timer 
-			clock_t endTimer = clock();
-
-			// calculation to get transmission time in sec 
-			double transmissionTime = double(endTimer - startTimer) / CLOCKS_PER_SEC;
-
-			// calculation to get transfer speed 
-			double transferSpeed = (metadata.fileSize * 8) / (transmissionTime * 1000000);
-
-			printf("Transmission Time: %.2f secs\n", transmissionTime);
-			printf("Transfer Speed: %.2f megabits/secs\n", transferSpeed);
+			else if (stripeConnections.empty() ? fileSender.update(window) : fileSender.update(stripeWindows))
+			{
+				// calculation to get transmission time in sec 
+				double transmissionTime = fileSender.getTransmissionTime();
+
+				// calculation to get transfer speed 
+				double transferSpeed = (fileSender.getMetadata().fileSize * 8.0) / (transmissionTime * 1000000);
+
+				printf("Checksum: %s\n", fileSender.getMetadata().checksum.c_str());
+				printf("Transmission Time: %.2f secs\n", transmissionTime);
+				printf("Transfer Speed: %.2f megabits/secs\n", transferSpeed);
+				if (fileSender.getSkippedBytes() > 0)
+					printf("Skipped %llu bytes of zeros\n", (unsigned long long)fileSender.getSkippedBytes());
+				if (arguments.delta)
+					printf("Delta: %llu bytes copied from the server's copy\n", (unsigned long long)fileSender.getCopiedBytes());
+				if (arguments.dedup)
+					printf("Dedup: %llu bytes the server already had\n", (unsigned long long)fileSender.getDedupBytes());
+				if (arguments.compressThreads >= 0)
+					printf("Compressed %llu bytes of the file into %llu\n", (unsigned long long)fileSender.getCompressedBytes(), (unsigned long long)fileSender.getPackedBytes());
+			}
 		}
 
 		while (true)
 		{
-			unsigned char packet[256];
-			int bytes_read = connection.ReceivePacket(packet, sizeof(packet));
+			// the server receives straight into the receive pipeline; the client only needs the acks
+			unsigned char scratch[PacketSize];
+			unsigned char* packet = fileReceiver ? fileReceiver->getBuffer() : nullptr;
+			if (packet == nullptr)
+				packet = scratch;
+
+			int bytes_read = connection.ReceivePacket(packet, PacketSize);
 			if (bytes_read == 0)
 				break;
 
-			string receivedData(reinterpret_cast<char*>(packet), bytes_read);
-
-			// Use sscanf to parse the incoming metadata
-			if (sscanf(receivedData.c_str(), "%255[^|]|%d|%lld", filename, &filesize, &crc) == 3)
+			if (fileReceiver)
 			{
-				// Null-terminate the filename string
-				filename[sizeof(filename) - 1] = '\0';
-				strcpy(trueFilename, filename); // Copy the filename to avoid resetting it after each loop iteration
-
-				// The string is formatted as metadata
-				printf("Filename: %s\n", filename);
-				printf("Filesize: %d\n", filesize);
-				printf("CRC: %lld\n", crc);
-			}
-			else if (receivedData.compare(TRANSFER_COMPLETE) == 0)
-			{
-				transmissionCompleteFlag = true;
-				break; // Break if transfer complete message is received
+				if (packet != scratch)
+					fileReceiver->submit(bytes_read);
+				else
+					fileReceiver->drop();
 			}
 			else
 			{
-				// Write the received data to an output file
-				ofstream outputFile(trueFilename, ios::binary | ios::app); // Open the file in append mode
-				if (outputFile.is_open())
-				{
-					outputFile.write(reinterpret_cast<const char*>(packet), bytes_read);
-					outputFile.flush();
-					outputFile.close();
-				}
-				else
-				{
-					printf("Error: Failed to open file: %s\n", trueFilename);
-				}
+				fileSender.receive(packet, bytes_read);
 			}
 		}
 
-
-		//uint32_t calculatedCRC = CRC::Calculate(&fileDataAccumulated[0], fileDataAccumulateda.size(), CRC::CRC_32());
-
-		if (transmissionCompleteFlag)
+		// the server's replies (a delta's signatures, answers to dedup queries) go back as the window allows
+		if (fileReceiver && connection.IsConnected())
 		{
-			outputFile.close(); // Close file in output stream mode
+			ReliabilitySystem& reliability = connection.GetReliabilitySystem();
+			int window = flowControl.GetSendWindow() - (reliability.GetAckedPackets() > 0 ? reliability.GetPendingAckPackets() : 0);
+			while (window-- > 0 && fileReceiver->popReply(reply))
+				connection.SendPacket(&reply[0], (int)reply.size());
+		}
 
-			ifstream outputFile(trueFilename, ios::binary); // Open file in input stream mode
-			if (outputFile.is_open())
+		// the client's other stripes only bring back acks
+		if (mode == Client)
+		{
+			for (size_t i = 0; i < stripeConnections.size(); ++i)
 			{
-				// Read file contents into a buffer
-				vector<char> buffer(istreambuf_iterator<char>(outputFile), {});
-
-				// Calculate CRC
-				uint32_t calculatedCRC = CRC::Calculate(buffer.data(), buffer.size(), CRC::CRC_32());
-
-				if (calculatedCRC == crc) // Check crc calculated from received file against crc in metadata
-				{
-					printf("CRC check for File Integrity passed.\n");
-				}
-				else
+				unsigned char scratch[PacketSize];
+				while (stripeConnections[i]->ReceivePacket(scratch, PacketSize) > 0)
 				{
-					printf("CRC check for File Integrity failed.\n");
 				}
 			}
-			else
-			{
-				printf("Error: Failed to open file: %s\n", trueFilename);
-			}
-
-			transmissionCompleteFlag = false;
-			outputFile.close();
 		}
 
 #ifdef SHOW_ACKS
@@ -588,15 +860,36 @@ int main(int argc, char* argv[])
 
 		// update connection
 
-		connection.Update(DeltaTime);
+		connection.Update(deltaTime);
+		if (mode == Client)
+		{
+			for (size_t i = 0; i < stripeConnections.size(); ++i)
+				stripeConnections[i]->Update(deltaTime);
+		}
 
 		// show connection stats
 
-		statsAccumulator += DeltaTime;
+		statsAccumulator += deltaTime;
+
+		if (metrics)
+		{
+			// the exporter reads these whenever it is asked, so keep them current rather than printing
+			connectedGauge.Set(connection.IsConnected() ? 1.0 : 0.0);
+			if (statsAccumulator >= 0.25f)
+			{
+				ReliabilitySystem& reliability = connection.GetReliabilitySystem();
+				rttGauge.Set(reliability.GetRoundTripTime());
+				minRttGauge.Set(reliability.GetMinRoundTripTime());
+				sentBandwidthGauge.Set(reliability.GetSentBandwidth());
+				ackedBandwidthGauge.Set(reliability.GetAckedBandwidth());
+				statsAccumulator = 0.0f;
+			}
+		}
 
 		while (statsAccumulator >= 0.25f && connection.IsConnected())
 		{
 			float rtt = connection.GetReliabilitySystem().GetRoundTripTime();
+			float min_rtt = connection.GetReliabilitySystem().GetMinRoundTripTime();
 
 			unsigned int sent_packets = connection.GetReliabilitySystem().GetSentPackets();
 			unsigned int acked_packets = connection.GetReliabilitySystem().GetAckedPackets();
@@ -605,17 +898,57 @@ int main(int argc, char* argv[])
 			float sent_bandwidth = connection.GetReliabilitySystem().GetSentBandwidth();
 			float acked_bandwidth = connection.GetReliabilitySystem().GetAckedBandwidth();
 
-			printf("rtt %.1fms, sent %d, acked %d, lost %d (%.1f%%), sent bandwidth = %.1fkbps, acked bandwidth = %.1fkbps\n",
-				rtt * 1000.0f, sent_packets, acked_packets, lost_packets,
+			printf("rtt %.3fms (min %.3fms), sent %d, acked %d, lost %d (%.1f%%), sent bandwidth = %.1fkbps, acked bandwidth = %.1fkbps\n",
+				rtt * 1000.0f, min_rtt * 1000.0f, sent_packets, acked_packets, lost_packets,
 				sent_packets > 0.0f ? (float)lost_packets / (float)sent_packets * 100.0f : 0.0f,
 				sent_bandwidth, acked_bandwidth);
 
+			if (fileReceiver && fileReceiver->getDroppedPackets() > 0)
+				printf("receive pipeline full, dropped %d packets\n", fileReceiver->getDroppedPackets());
+			if (connection.GetRejectedPackets() > 0)
+				printf("rejected %llu packets that failed authentication\n", (unsigned long long)connection.GetRejectedPackets());
+
 			statsAccumulator -= 0.25f;
 		}
 
-		net::wait(DeltaTime);
+		bool linksIdle = linkEmulator.IsIdle();
+		for (size_t i = 0; i < stripeEmulators.size(); ++i)
+			linksIdle = linksIdle && stripeEmulators[i]->IsIdle();
+
+		// the server sleeps on the socket so it wakes as soon as packets arrive and keeps draining at line rate
+		if (mode == Server)
+			connection.WaitForPacket(DeltaTime);
+		else
+			net::wait(!(batch ? batchSender.isComplete() : fileSender.isComplete()) || !linksIdle ? SendTick : DeltaTime);
+
+		// End top loop once file transfer is complete and the link has delivered it
+		if (mode == Client && (batch ? batchSender.isComplete() : fileSender.isComplete()) && linksIdle)
+			loopFlag = false;
 		}
 
+	stopping = true;
+	for (size_t i = 0; i < stripeDrains.size(); ++i)
+		stripeDrains[i].join();
+
+	if (!arguments.linkProfile.empty())
+		linkEmulator.PrintStats();
+
+	if (tracer.IsRunning())
+	{
+		tracer.Stop();
+		if (tracer.GetDroppedEvents() > 0)
+			printf("trace dropped %llu events\n", (unsigned long long)tracer.GetDroppedEvents());
+	}
+
+	if (pcapWriter.IsRunning())
+	{
+		pcapWriter.Stop();
+		printf("captured %llu datagrams", (unsigned long long)pcapWriter.GetCapturedPackets());
+		if (pcapWriter.GetDroppedPackets() > 0)
+			printf(", dropped %llu", (unsigned long long)pcapWriter.GetDroppedPackets());
+		printf("\n");
+	}
+
 	ShutdownSockets();
 
 	return 0;
@@ -0,0 +1,185 @@
+--[[
+	Wireshark dissector for the reliable udp protocol
+	  + copy into the Wireshark personal plugins folder (Help > About > Folders), then open a capture made with --pcap
+	  + every datagram is the protocol id followed by the reliability header, all big-endian:
+	      protocol id  u32   set by the program (0x11223344), datagrams with another id are not ours
+	      sequence     u32   sequence number of this packet
+	      ack          u32   most recent sequence number received from the peer
+	      ack bits     u32   bit n set means ack - 1 - n was received too
+	      ack delay    u32   microseconds the receiver held the ack before sending it
+	  + the rest is the file transfer's message: nothing (an ack on its own), the metadata "name|size|checksumId",
+	    the completion "complete|digest", or a piece of the file: a u64 offset followed by the bytes at that offset
+	    (the offset's first byte is always zero, which no text message starts with)
+	  + binary messages start with a byte of 1 to 3 for a batch (manifest, data records, complete), 4 for a zero
+	    range, 5 for a stripe end, 6 to 8 for a delta (start, signatures, copies), 9 to 11 for dedup (query,
+	    answer, references) or 12 for a piece of a compressed block, and are named but not decoded further, their
+	    contents are mostly varints
+	  + control messages go behind the complement of the protocol id: a type byte of 1 to 4 for the handshake
+	    (hello, challenge, response, welcome) or 5 for a keepalive, then for a challenge or response a u32 time in
+	    seconds and a u64 cookie; a reliable connection's keepalive is an ack on its own once it has something to ack
+	  + with --key, everything after the protocol id is sealed: a u64 session id and u64 counter (little-endian), a
+	    16 byte tag, then the encrypted header and message; set the Encrypted preference to show those instead
+	  + found by protocol id on any port, and decoded by default on the program's and the benchmark's ports
+]]
+
+local rudp = Proto("rudp", "Reliable UDP")
+
+local fields = {
+	protocol_id = ProtoField.uint32("rudp.protocol_id", "Protocol ID", base.HEX),
+	sequence = ProtoField.uint32("rudp.seq", "Sequence", base.DEC),
+	ack = ProtoField.uint32("rudp.ack", "Ack", base.DEC),
+	ack_bits = ProtoField.uint32("rudp.ack_bits", "Ack bits", base.HEX),
+	acked = ProtoField.uint32("rudp.acked", "Packets acked", base.DEC),
+	ack_delay = ProtoField.uint32("rudp.ack_delay", "Ack delay (us)", base.DEC),
+	message = ProtoField.string("rudp.message", "Message"),
+	file_name = ProtoField.string("rudp.file_name", "File name"),
+	file_size = ProtoField.string("rudp.file_size", "File size"),
+	checksum_id = ProtoField.string("rudp.checksum_id", "Checksum id"),
+	digest = ProtoField.string("rudp.digest", "Digest"),
+	offset = ProtoField.uint64("rudp.offset", "File offset", base.DEC),
+	data = ProtoField.bytes("rudp.data", "Data"),
+	session = ProtoField.uint64("rudp.session", "Session", base.HEX),
+	counter = ProtoField.uint64("rudp.counter", "Packet counter", base.DEC),
+	tag = ProtoField.bytes("rudp.tag", "Tag"),
+	ciphertext = ProtoField.bytes("rudp.ciphertext", "Ciphertext"),
+	control = ProtoField.string("rudp.control", "Control"),
+	cookie_time = ProtoField.uint32("rudp.cookie_time", "Cookie time", base.DEC),
+	cookie = ProtoField.uint64("rudp.cookie", "Cookie", base.HEX),
+}
+rudp.fields = fields
+
+rudp.prefs.protocol_id = Pref.uint("Protocol ID", 0x11223344, "Protocol id the program was run with")
+rudp.prefs.encrypted = Pref.bool("Encrypted", false, "The program was run with --key")
+
+local HeaderSize = 20
+local DataHeaderSize = 8
+local SealedSize = 36 -- protocol id, session, counter and tag
+local BinaryMessages = { "batch manifest", "batch data", "batch complete", "zero range", "stripe end",
+	"delta start", "delta signatures", "delta copy", "dedup query", "dedup answer", "dedup reference",
+	"compressed data" }
+local ControlMessages = { "hello", "challenge", "response", "welcome", "keepalive" }
+
+local function count_bits(value)
+	local count = 0
+	while value > 0 do
+		count = count + (value % 2)
+		value = math.floor(value / 2)
+	end
+	return count
+end
+
+local function dissect_message(buffer, tree)
+	if buffer:len() == HeaderSize then
+		tree:add(fields.message, "ack only")
+		return "ack"
+	end
+
+	local payload = buffer(HeaderSize)
+	if payload:len() >= DataHeaderSize and payload(0, 1):uint() == 0 then
+		tree:add(fields.message, payload, "data")
+		tree:add(fields.offset, payload(0, DataHeaderSize))
+		if payload:len() > DataHeaderSize then
+			tree:add(fields.data, payload(DataHeaderSize))
+		end
+		return "data @" .. payload(0, DataHeaderSize):uint64():tonumber()
+	end
+
+	local binary = BinaryMessages[payload(0, 1):uint()]
+	if binary then
+		tree:add(fields.message, payload, binary)
+		return binary
+	end
+
+	local text = payload:raw()
+	local digest = text:match("^complete|(%x*)")
+	if digest then
+		tree:add(fields.message, payload, "complete")
+		tree:add(fields.digest, payload, digest)
+		return "complete"
+	end
+
+	local name, size, checksum = text:match("^([^|]+)|(%d+)|(%d+)")
+	if name then
+		tree:add(fields.message, payload, "metadata")
+		tree:add(fields.file_name, payload, name)
+		tree:add(fields.file_size, payload, size)
+		tree:add(fields.checksum_id, payload, checksum)
+		return "metadata " .. name
+	end
+
+	tree:add(fields.message, payload, "unknown")
+	return "unknown"
+end
+
+local function control_id()
+	return 0xFFFFFFFF - rudp.prefs.protocol_id
+end
+
+local function dissect_control(buffer, pinfo, tree)
+	tree:add(fields.protocol_id, buffer(0, 4))
+	local name = ControlMessages[buffer(4, 1):uint()] or "unknown"
+	tree:add(fields.control, buffer(4, 1), name)
+	if buffer:len() >= 17 and (name == "challenge" or name == "response") then
+		tree:add(fields.cookie_time, buffer(5, 4))
+		tree:add(fields.cookie, buffer(9, 8))
+	end
+	pinfo.cols.info = name
+	return buffer:len()
+end
+
+function rudp.dissector(buffer, pinfo, root)
+	local control = buffer:len() > 4 and buffer(0, 4):uint() == control_id()
+	local minimum = rudp.prefs.encrypted and SealedSize or (control and 5 or HeaderSize)
+	if buffer:len() < minimum or (buffer(0, 4):uint() ~= rudp.prefs.protocol_id and not control) then
+		return 0
+	end
+
+	pinfo.cols.protocol = "RUDP"
+	local tree = root:add(rudp, buffer())
+
+	if rudp.prefs.encrypted then
+		tree:add(fields.protocol_id, buffer(0, 4))
+		tree:add_le(fields.session, buffer(4, 8))
+		tree:add_le(fields.counter, buffer(12, 8))
+		tree:add(fields.tag, buffer(20, 16))
+		if buffer:len() > SealedSize then
+			tree:add(fields.ciphertext, buffer(SealedSize))
+		end
+		pinfo.cols.info = string.format("sealed %s#%s (%d bytes)", control and "control " or "",
+			buffer(12, 8):le_uint64():tonumber(), buffer:len() - SealedSize)
+		return buffer:len()
+	end
+
+	if control then
+		return dissect_control(buffer, pinfo, tree)
+	end
+
+	local sequence = buffer(4, 4):uint()
+	local ack = buffer(8, 4):uint()
+	local ack_bits = buffer(12, 4):uint()
+
+	tree:add(fields.protocol_id, buffer(0, 4))
+	tree:add(fields.sequence, buffer(4, 4))
+	tree:add(fields.ack, buffer(8, 4))
+	local bits = tree:add(fields.ack_bits, buffer(12, 4))
+	bits:add(fields.acked, buffer(12, 4), count_bits(ack_bits)):set_generated()
+	tree:add(fields.ack_delay, buffer(16, 4))
+
+	local summary = dissect_message(buffer, tree)
+	pinfo.cols.info = string.format("seq=%d ack=%d bits=0x%08x %s (%d bytes)", sequence, ack, ack_bits, summary, buffer:len() - HeaderSize)
+	return buffer:len()
+end
+
+local function heuristic(buffer, pinfo, root)
+	if buffer:len() < 5 or (buffer(0, 4):uint() ~= rudp.prefs.protocol_id and buffer(0, 4):uint() ~= control_id()) then
+		return false
+	end
+	return rudp.dissector(buffer, pinfo, root) > 0
+end
+
+rudp:register_heuristic("udp", heuristic)
+
+local udp_port = DissectorTable.get("udp.port")
+for _, port in ipairs({ 30000, 30001, 40000, 40001 }) do
+	udp_port:add(port, rudp)
+end
@@ -0,0 +1,879 @@
+/*
+	Loopback benchmark for the file transfer
+	  + runs the server on its own thread and the client on the main thread of one process, over loopback
+	  + every combination of file size, payload size and link profile is one run
+	  + reports wall clock goodput, one-way packet latency percentiles, CPU per GB and socket system calls as JSON
+	  + with --files every run is a batch instead, that many files of the run's size over one connection, and
+	    files per second is reported as well
+	  + counts the payload bytes copied on the way between the files and the sockets, and the heap allocations made
+	    in steady state; a single file over a clean link with no capture must make neither, and the exit code says
+	    if one did
+	  + steady state starts once a quarter of the data packets are out and the reliability queues, which keep two
+	    seconds of history, have stopped growing, and ends at three quarters; a run too short for that reports no
+	    count (the default 16M file at 256 byte payloads is long enough)
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <new>
+
+#include "Net.h"
+#include "Checksum.h"
+#include "Pipeline.h"
+#include "LinkEmulator.h"
+#include "Transfer.h"
+#include "Capture.h"
+
+#if PLATFORM == PLATFORM_WINDOWS
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/resource.h>
+#endif
+
+#pragma warning(disable : 4996)
+
+using namespace std;
+using namespace net;
+
+const int ProtocolId = 0x11223344;
+const float DeltaTime = 1.0f / 30.0f;
+const float TimeOut = 10.0f;
+const float SendTick = 0.001f; // same loop period as the client program while it is sending
+const double SteadyWarmUp = 3.0; // seconds of sending before the reliability queues have reached their size
+
+// ----------------------------------------------------
+// every allocation in the process goes through here, from both sides and every pipeline thread
+
+static atomic<uint64_t> allocationCount(0);
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, memory_order_relaxed);
+	void* p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+// ----------------------------------------------------
+// benchmark settings from the command line
+struct BenchArgs
+{
+	vector<uint64_t> fileSizes;
+	vector<int> payloadSizes;
+	vector<string> profiles; // link emulator settings applied to both directions, empty for a clean link
+	string checksumMethod = "CRC32";
+	string workDirectory = "bench_work";
+	string outputPath = "bench_results.json"; // "-" for stdout (shared with the connection log)
+	string pcapPath; // capture of every run's datagrams, empty for none
+	vector<unsigned char> key; // pre-shared key every run's packets are sealed with, empty for cleartext
+	bool sparse = false; // test files are mostly holes, so sizes past 4 GB run in seconds
+	int files = 0; // batch runs: this many files of each size, sent as one batch
+	int serverPort = 40000;
+	int clientPort = 40001;
+	int window = 64; // packets in flight, the client program's window until flow control upgrades to good mode
+	float timeout = 60.0f; // give up on a run after this many seconds
+	bool valid = true;
+
+	BenchArgs(int argc, char* argv[])
+	{
+		parseArgs(argc, argv);
+
+		if (fileSizes.empty())
+		{
+			fileSizes.push_back(1 << 20);
+			fileSizes.push_back(16 << 20);
+		}
+		if (payloadSizes.empty())
+		{
+			payloadSizes.push_back(256);
+			payloadSizes.push_back(1024);
+		}
+		if (profiles.empty())
+		{
+			profiles.push_back("");
+			profiles.push_back("delay=5ms,jitter=1ms");
+			profiles.push_back("loss=0.5%");
+		}
+	}
+
+private:
+
+	void parseArgs(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc && valid; ++i)
+		{
+			string arg = argv[i];
+
+			if (arg == "--sizes")
+			{
+				for (const string& size : split(getNextArg(argc, argv, i), ','))
+					fileSizes.push_back(parseSize(size));
+			}
+			else if (arg == "--payloads")
+			{
+				for (const string& payload : split(getNextArg(argc, argv, i), ','))
+					payloadSizes.push_back(stoi(payload));
+			}
+			else if (arg == "--profile")
+			{
+				string profile = getNextArg(argc, argv, i);
+				profiles.push_back(profile == "clean" ? "" : profile);
+			}
+			else if (arg == "-c" || arg == "--checksum")
+			{
+				checksumMethod = getNextArg(argc, argv, i);
+				if (FindChecksumAlgorithm(checksumMethod) == nullptr)
+				{
+					cerr << "Unknown checksum method: " << checksumMethod << endl;
+					valid = false;
+				}
+			}
+			else if (arg == "--window")
+			{
+				window = stoi(getNextArg(argc, argv, i));
+			}
+			else if (arg == "--timeout")
+			{
+				timeout = stof(getNextArg(argc, argv, i));
+			}
+			else if (arg == "--ports")
+			{
+				serverPort = stoi(getNextArg(argc, argv, i));
+				clientPort = serverPort + 1;
+			}
+			else if (arg == "--work")
+			{
+				workDirectory = getNextArg(argc, argv, i);
+			}
+			else if (arg == "-o" || arg == "--out")
+			{
+				outputPath = getNextArg(argc, argv, i);
+			}
+			else if (arg == "--pcap")
+			{
+				pcapPath = getNextArg(argc, argv, i);
+			}
+			else if (arg == "--key")
+			{
+				const string keyPath = getNextArg(argc, argv, i);
+				key.resize(AeadKeySize);
+				if (valid && !LoadKeyFile(keyPath, &key[0]))
+				{
+					cerr << "Could not read a key from " << keyPath << endl;
+					valid = false;
+				}
+			}
+			else if (arg == "--sparse")
+			{
+				sparse = true;
+			}
+			else if (arg == "--files")
+			{
+				files = stoi(getNextArg(argc, argv, i));
+			}
+			else
+			{
+				printf("Usage: ReliableUDPBench [options]\n");
+				printf("  --sizes <list>: File sizes, with K, M or G suffixes (default 1M,16M).\n");
+				printf("  --payloads <list>: Data bytes per packet (default 256,1024).\n");
+				printf("  --profile <settings|file|clean>: Link emulator settings for both directions, repeat for more\n");
+				printf("     (default clean, \"delay=5ms,jitter=1ms\" and \"loss=0.5%%\"); delay is one way, so rtt is twice it.\n");
+				printf("  -c, --checksum <method>: Whole-file checksum method (default CRC32).\n");
+				printf("  --window <packets>: Packets in flight (default 64).\n");
+				printf("  --timeout <secs>: Abandon a run after this long (default 60).\n");
+				printf("  --ports <port>: Server port, the client uses the next one (default 40000).\n");
+				printf("  --work <dir>: Directory for the generated and received files (default bench_work).\n");
+				printf("  -o, --out <file|->: Where to write the JSON results (default bench_results.json).\n");
+				printf("  --pcap <file>: Capture both sides of every run to a pcap file, to measure what capture costs.\n");
+				printf("  --key <file>: Seal every packet with the pre-shared key in <file>, to measure what encryption costs.\n");
+				printf("  --sparse: Test files hold data only at the start, across each 4 GB boundary and at the end, the rest\n");
+				printf("     are holes that are never sent (e.g. --sizes 9G --sparse checks 64-bit offsets over loopback).\n");
+				printf("  --files <count>: Send <count> files of each size as one batch per run, spread over directories of\n");
+				printf("     100 (e.g. --files 10000 --sizes 100,4K measures small-file throughput).\n");
+				valid = false;
+			}
+		}
+	}
+
+	string getNextArg(int argc, char* argv[], int& index)
+	{
+		if (index + 1 < argc)
+		{
+			return argv[++index];
+		}
+		cerr << "Missing argument for option: " << argv[index] << endl;
+		valid = false;
+		return "";
+	}
+
+	static vector<string> split(const string& text, char separator)
+	{
+		vector<string> parts;
+		size_t start = 0;
+		while (start <= text.size())
+		{
+			size_t end = text.find(separator, start);
+			if (end == string::npos)
+				end = text.size();
+			if (end > start)
+				parts.push_back(text.substr(start, end - start));
+			start = end + 1;
+		}
+		return parts;
+	}
+
+	static uint64_t parseSize(const string& text)
+	{
+		char* end = nullptr;
+		double size = strtod(text.c_str(), &end);
+		switch (*end)
+		{
+		case 'K': case 'k': size *= 1024.0; break;
+		case 'M': case 'm': size *= 1024.0 * 1024.0; break;
+		case 'G': case 'g': size *= 1024.0 * 1024.0 * 1024.0; break;
+		}
+		return (uint64_t)size;
+	}
+};
+
+// ----------------------------------------------------
+// one cell of the matrix and what it measured
+struct BenchRun
+{
+	uint64_t fileSize;		// of each file in a batch run
+	int payloadSize;
+	string profile;
+	int files;				// files sent, 1 unless a batch run
+	int filesPassed;
+
+	bool completed;			// the completion message was verified before the timeout
+	bool passed;			// and the checksum and size matched
+	uint64_t receivedSize;	// size of the file on disk, holes included
+	uint64_t bytesWritten;
+	double seconds;			// client start to the received file being closed
+	double goodput;			// received file bytes per second of wall time
+	double filesPerSecond;
+	double latencyP50;		// one-way packet latency, seconds, over packets that arrived
+	double latencyP99;
+	double latencyP999;
+	uint64_t latencySamples;
+	double cpuSeconds;		// both sides together
+	double cpuPerGB;
+	SocketCounters client;
+	SocketCounters server;
+	unsigned int sentPackets;
+	unsigned int lostPackets;
+	int receiverDrops;
+	bool plain;				// a single file over a clean link with no capture, which must copy no payload
+	uint64_t payloadBytesCopied;	// by both sides
+	uint64_t steadyAllocations;	// by the whole process in steady state
+	bool steadyMeasured;	// the transfer lasted long enough to have a steady state
+};
+
+// CPU seconds used by the whole process so far
+double processCpuTime()
+{
+#if PLATFORM == PLATFORM_WINDOWS
+	FILETIME creation, exitTime, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user);
+	const uint64_t kernelTicks = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	const uint64_t userTicks = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+	return (kernelTicks + userTicks) * 100e-9;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+void makeDirectory(const string& path)
+{
+#if PLATFORM == PLATFORM_WINDOWS
+	_mkdir(path.c_str());
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+// byte ranges of the test file that hold data; a sparse file has 1 MB at the start, across every 4 GB boundary
+// (where 32-bit offsets would wrap) and at the end, and holes everywhere else
+vector<pair<uint64_t, uint64_t> > testFileExtents(uint64_t size, bool sparse)
+{
+	vector<pair<uint64_t, uint64_t> > extents;
+	const uint64_t ExtentSize = 1 << 20;
+	if (!sparse || size <= 2 * ExtentSize)
+	{
+		extents.push_back(make_pair(0ULL, size));
+		return extents;
+	}
+	extents.push_back(make_pair(0ULL, ExtentSize));
+	for (uint64_t boundary = 4ULL << 30; boundary + ExtentSize < size; boundary += 4ULL << 30)
+		extents.push_back(make_pair(boundary - ExtentSize / 2 - 1000, ExtentSize));	// not chunk aligned on purpose
+	extents.push_back(make_pair(size - ExtentSize, ExtentSize));
+	return extents;
+}
+
+// random file contents over the extents, the file is sized without writing the rest
+bool writeTestFile(const string& path, uint64_t size, const vector<pair<uint64_t, uint64_t> >& extents)
+{
+	LargeFile file;
+	if (!file.Open(path, LargeFile::Writing) || !file.SetSize(size))
+		return false;
+	mt19937 random((unsigned int)size);
+	vector<unsigned char> block(64 * 1024);
+	for (const pair<uint64_t, uint64_t>& extent : extents)
+	{
+		uint64_t offset = extent.first;
+		const uint64_t end = extent.first + extent.second;
+		while (offset < end)
+		{
+			const size_t count = end - offset < block.size() ? (size_t)(end - offset) : block.size();
+			for (size_t i = 0; i < count; ++i)
+				block[i] = (unsigned char)random();
+			if (!file.Write(offset, &block[0], (int)count))
+				return false;
+			offset += count;
+		}
+	}
+	return true;
+}
+
+// path of a batch file: directories of 100 files, which is how many real trees are spread
+string testTreePath(int index)
+{
+	char path[32];
+	snprintf(path, sizeof(path), "d%04d/f%03d", index / 100, index % 100);
+	return path;
+}
+
+bool writeTestTree(const string& root, int files, uint64_t size)
+{
+	makeDirectory(root);
+	for (int i = 0; i < files; ++i)
+	{
+		const string path = root + "/" + testTreePath(i);
+		if (i % 100 == 0)
+			makeDirectory(path.substr(0, path.rfind('/')));
+		vector<pair<uint64_t, uint64_t> > extents(1, make_pair(0ULL, size));
+		if (!writeTestFile(path, size, extents))
+			return false;
+	}
+	return true;
+}
+
+// remove the files of a tree (the directories are left for the next run)
+void removeTestTree(const string& root)
+{
+	vector<DirectoryEntry> files;
+	ListFiles(root, files);
+	for (const DirectoryEntry& file : files)
+		remove((root + "/" + file.path).c_str());
+}
+
+double percentile(const vector<uint64_t>& sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0.0;
+	size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+	return sorted[index] / 1e9;
+}
+
+// ----------------------------------------------------
+// the server side of a run, on its own thread with its own connection
+class BenchServer
+{
+public:
+
+	BenchServer(const BenchArgs& args, const string& profile, int payloadSize, PacketCapture* capture, vector<uint64_t>& arrivals, atomic<bool>& abandon)
+		: args(args), profile(profile), payloadSize(payloadSize), capture(capture), arrivals(arrivals), abandon(abandon)
+	{
+		finishTime = 0;
+		started = false;
+		failed = false;
+		finished = false;
+		thread = std::thread(&BenchServer::run, this);
+	}
+
+	~BenchServer()
+	{
+		join();
+	}
+
+	// true once the server is listening (or has failed to)
+	bool isReady() const
+	{
+		return started || failed;
+	}
+
+	bool hasFailed() const
+	{
+		return failed;
+	}
+
+	// true once the file (or every file of a batch) has been closed or the run abandoned
+	bool isFinished() const
+	{
+		return finished;
+	}
+
+	void join()
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+
+	// valid after join
+	FileReceiver::Result result;	// of a batch: Passed when every file passed
+	int filesPassed;
+	uint64_t bytesWritten;
+	uint64_t finishTime;
+	SocketCounters counters;
+	int receiverDrops;
+
+private:
+
+	void run()
+	{
+		ReliableConnection connection(ProtocolId, TimeOut);
+		LinkEmulator linkEmulator;
+		string error;
+		if (!profile.empty())
+		{
+			linkEmulator.Configure(profile, error);
+			connection.SetPacketShaper(&linkEmulator);
+		}
+		connection.SetPacketCapture(capture);
+		connection.SetKey(args.key.empty() ? nullptr : &args.key[0]);
+
+		FileReceiver fileReceiver(payloadSize, args.workDirectory + "/received", false);
+		if (!connection.Start(args.serverPort))
+		{
+			printf("could not start connection on port %d\n", args.serverPort);
+			failed = true;
+			return;
+		}
+		connection.Listen();
+		started = true;
+
+		vector<unsigned char> scratch(payloadSize);
+		chrono::steady_clock::time_point lastTime = chrono::steady_clock::now();
+
+		const bool batch = args.files > 0;
+		while (!(batch ? fileReceiver.isBatchComplete() : fileReceiver.getResult() != FileReceiver::Pending) && !abandon)
+		{
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			const float deltaTime = chrono::duration<float>(now - lastTime).count();
+			lastTime = now;
+
+			while (true)
+			{
+				unsigned char* packet = fileReceiver.getBuffer();
+				if (packet == nullptr)
+					packet = &scratch[0];
+
+				int bytes_read = connection.ReceivePacket(packet, payloadSize);
+				if (bytes_read == 0)
+					break;
+
+				// first arrival of each sequence number, duplicates keep the earlier time
+				const unsigned int sequence = connection.GetPacketSequence();
+				if (sequence < arrivals.size() && arrivals[sequence] == 0)
+					arrivals[sequence] = connection.GetReceiveTime();
+
+				if (packet != &scratch[0])
+					fileReceiver.submit(bytes_read);
+				else
+					fileReceiver.drop();
+			}
+
+			connection.Update(deltaTime);
+			connection.WaitForPacket(DeltaTime);
+		}
+
+		finishTime = GetTimeNs();
+		result = fileReceiver.getResult();
+		filesPassed = result == FileReceiver::Passed ? 1 : 0;
+		if (batch)
+		{
+			filesPassed = fileReceiver.getFilesPassed();
+			result = !fileReceiver.isBatchComplete() ? FileReceiver::Pending : fileReceiver.getFilesFailed() == 0 ? FileReceiver::Passed : FileReceiver::Failed;
+		}
+		bytesWritten = fileReceiver.getBytesWritten();
+		receiverDrops = fileReceiver.getDroppedPackets();
+		counters = connection.GetSocketCounters();
+		connection.Stop();
+		finished = true;
+	}
+
+	const BenchArgs& args;
+	string profile;
+	int payloadSize;
+	PacketCapture* capture;
+	vector<uint64_t>& arrivals;	// written by the server thread, read after join
+	atomic<bool>& abandon;
+	atomic<bool> started;
+	atomic<bool> failed;
+	atomic<bool> finished;
+	std::thread thread;
+};
+
+// ----------------------------------------------------
+// a single transfer; the client drives its connection the way the client program does
+bool runTransfer(const BenchArgs& args, BenchRun& run, PacketCapture* capture)
+{
+	const bool batch = args.files > 0;
+	const string sourcePath = args.workDirectory + (batch ? "/tree" : "/source.bin");
+	const string receivedPath = args.workDirectory + "/received/" + (batch ? "" : "source.bin");
+	const vector<pair<uint64_t, uint64_t> > extents = testFileExtents(run.fileSize * (batch ? args.files : 1), args.sparse && !batch);
+	run.files = batch ? args.files : 1;
+	if (batch ? !writeTestTree(sourcePath, args.files, run.fileSize) : !writeTestFile(sourcePath, run.fileSize, extents))
+	{
+		printf("could not write %s\n", sourcePath.c_str());
+		return false;
+	}
+
+	// send and arrival times by sequence number: metadata, the pieces, the completion message and some slack
+	// (the sender skips only whole zero chunks, so each extent can bring a chunk's worth of zeros either side)
+	uint64_t sentBytes = 0;
+	for (const pair<uint64_t, uint64_t>& extent : extents)
+		sentBytes += extent.second + (args.sparse ? 2 * 64 * 1024 : 0);
+	const size_t sequences = (size_t)(sentBytes / (run.payloadSize - DataHeaderSize)) + 16;
+	vector<uint64_t> sendTimes(sequences, 0);
+	vector<uint64_t> arrivals(sequences, 0);
+
+	// the steady state is past connecting, opening and the queues filling, and short of the completion
+	const unsigned int dataPackets = (unsigned int)(sentBytes / (run.payloadSize - DataHeaderSize));
+	bool steadyStarted = false;
+	uint64_t steadyStart = 0;
+
+	ReliableConnection connection(ProtocolId, TimeOut);
+	LinkEmulator linkEmulator;
+	if (!run.profile.empty())
+	{
+		string error;
+		if (!linkEmulator.Configure(run.profile, error))
+		{
+			printf("bad link settings: %s\n", error.c_str());
+			return false;
+		}
+		connection.SetPacketShaper(&linkEmulator);
+	}
+	connection.SetPacketCapture(capture);
+	connection.SetKey(args.key.empty() ? nullptr : &args.key[0]);
+
+	atomic<bool> abandon(false);
+	BenchServer server(args, run.profile, run.payloadSize, capture, arrivals, abandon);
+	while (!server.isReady())
+		this_thread::yield();
+	if (server.hasFailed())
+		return false;
+
+	if (!connection.Start(args.clientPort))
+	{
+		printf("could not start connection on port %d\n", args.clientPort);
+		abandon = true;
+		return false;
+	}
+
+	const double cpuStart = processCpuTime();
+	const uint64_t startTime = GetTimeNs();
+	const uint64_t copiedStart = PayloadBytesCopied().load();
+
+	FileSender fileSender(connection, run.payloadSize);
+	BatchSender batchSender(connection, run.payloadSize);
+	if (batch)
+	{
+		batchSender.start(sourcePath, args.checksumMethod);
+	}
+	else
+	{
+		fileSender.setSendLog(&sendTimes);
+		fileSender.start(sourcePath, args.checksumMethod);
+	}
+	connection.Connect(Address(127, 0, 0, 1, (unsigned short)args.serverPort));
+
+	vector<unsigned char> scratch(run.payloadSize);
+	chrono::steady_clock::time_point lastTime = chrono::steady_clock::now();
+
+	// keep taking acks until the server has closed the file, so the client side costs are counted in full
+	while (!server.isFinished())
+	{
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		const float deltaTime = chrono::duration<float>(now - lastTime).count();
+		lastTime = now;
+
+		if ((GetTimeNs() - startTime) / 1e9 > args.timeout || connection.ConnectFailed())
+			abandon = true;
+
+		ReliabilitySystem& reliability = connection.GetReliabilitySystem();
+		int window = args.window;
+		if (reliability.GetAckedPackets() > 0)
+			window -= reliability.GetPendingAckPackets();
+		// nothing goes out until the handshake has connected
+		if (connection.IsConnected())
+		{
+			if (batch)
+				batchSender.update(window);
+			else
+				fileSender.update(window);
+		}
+
+		const unsigned int sent = reliability.GetSentPackets();
+		if (!steadyStarted && sent >= dataPackets / 4 && (GetTimeNs() - startTime) / 1e9 >= SteadyWarmUp)
+		{
+			steadyStart = allocationCount.load();
+			steadyStarted = true;
+		}
+		if (steadyStarted && !run.steadyMeasured && sent >= dataPackets / 4 * 3)
+		{
+			run.steadyAllocations = allocationCount.load() - steadyStart;
+			run.steadyMeasured = true;
+		}
+
+		while (connection.ReceivePacket(&scratch[0], run.payloadSize) > 0)
+			;
+
+		connection.Update(deltaTime);
+		net::wait(!(batch ? batchSender.isComplete() : fileSender.isComplete()) || !linkEmulator.IsIdle() ? SendTick : DeltaTime);
+	}
+
+	server.join();
+	const double cpuEnd = processCpuTime();
+	const uint64_t copiedEnd = PayloadBytesCopied().load();
+
+	// one-way latency of every data packet that arrived
+	vector<uint64_t> latencies;
+	latencies.reserve(sequences);
+	for (size_t i = 0; i < sequences; ++i)
+	{
+		// the kernel stamp is moved onto the monotonic clock with a little error, so it can land just before the send
+		if (sendTimes[i] != 0 && arrivals[i] != 0)
+			latencies.push_back(arrivals[i] > sendTimes[i] ? arrivals[i] - sendTimes[i] : 0);
+	}
+	sort(latencies.begin(), latencies.end());
+
+	// the digest covers skipped zeros too, so also check the file on disk came out the right size
+	run.receivedSize = 0;
+	if (batch)
+	{
+		vector<DirectoryEntry> received;
+		ListFiles(receivedPath, received);
+		for (const DirectoryEntry& file : received)
+			run.receivedSize += file.size;
+	}
+	else
+	{
+		LargeFile received;
+		run.receivedSize = received.Open(receivedPath, LargeFile::Reading) ? received.GetSize() : 0;
+		received.Close();
+	}
+
+	run.completed = server.result != FileReceiver::Pending;
+	run.passed = server.result == FileReceiver::Passed && run.receivedSize == run.fileSize * run.files;
+	run.filesPassed = server.filesPassed;
+	run.bytesWritten = server.bytesWritten;
+	run.seconds = (server.finishTime - startTime) / 1e9;
+	run.goodput = run.seconds > 0.0 ? run.bytesWritten / run.seconds : 0.0;
+	run.filesPerSecond = run.seconds > 0.0 ? run.filesPassed / run.seconds : 0.0;
+	run.latencyP50 = percentile(latencies, 0.5);
+	run.latencyP99 = percentile(latencies, 0.99);
+	run.latencyP999 = percentile(latencies, 0.999);
+	run.latencySamples = latencies.size();
+	run.cpuSeconds = cpuEnd - cpuStart;
+	run.cpuPerGB = run.bytesWritten > 0 ? run.cpuSeconds / (run.bytesWritten / 1e9) : 0.0;
+	run.client = connection.GetSocketCounters();
+	run.server = server.counters;
+	run.sentPackets = connection.GetReliabilitySystem().GetSentPackets();
+	run.lostPackets = connection.GetReliabilitySystem().GetLostPackets();
+	run.receiverDrops = server.receiverDrops;
+	run.plain = !batch && run.profile.empty() && capture == nullptr;
+	run.payloadBytesCopied = copiedEnd - copiedStart;
+
+	connection.Stop();
+	if (batch)
+	{
+		removeTestTree(sourcePath);
+		removeTestTree(receivedPath);
+	}
+	else
+	{
+		remove(sourcePath.c_str());
+		remove(receivedPath.c_str());
+	}
+	return true;
+}
+
+string jsonString(const string& text)
+{
+	string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+void writeJson(FILE* out, const BenchArgs& args, const vector<BenchRun>& runs)
+{
+	fprintf(out, "{\n  \"checksum\": %s,\n  \"window\": %d,\n  \"sparse\": %s,\n  \"files\": %d,\n  \"encrypted\": %s,\n  \"runs\": [\n",
+		jsonString(args.checksumMethod).c_str(), args.window, args.sparse ? "true" : "false", args.files, args.key.empty() ? "false" : "true");
+	for (size_t i = 0; i < runs.size(); ++i)
+	{
+		const BenchRun& run = runs[i];
+		fprintf(out, "    {\"file_size\": %llu, \"payload_size\": %d, \"profile\": %s, \"completed\": %s, \"passed\": %s,\n",
+			(unsigned long long)run.fileSize, run.payloadSize, jsonString(run.profile.empty() ? "clean" : run.profile).c_str(),
+			run.completed ? "true" : "false", run.passed ? "true" : "false");
+		fprintf(out, "     \"bytes_received\": %llu, \"received_size\": %llu, \"seconds\": %.6f, \"goodput_mbps\": %.3f,\n",
+			(unsigned long long)run.bytesWritten, (unsigned long long)run.receivedSize, run.seconds, run.goodput * 8.0 / 1e6);
+		fprintf(out, "     \"files\": %d, \"files_passed\": %d, \"files_per_second\": %.1f,\n", run.files, run.filesPassed, run.filesPerSecond);
+		fprintf(out, "     \"latency_ms\": {\"p50\": %.4f, \"p99\": %.4f, \"p999\": %.4f, \"samples\": %llu},\n",
+			run.latencyP50 * 1000.0, run.latencyP99 * 1000.0, run.latencyP999 * 1000.0, (unsigned long long)run.latencySamples);
+		fprintf(out, "     \"cpu_seconds\": %.4f, \"cpu_seconds_per_gb\": %.4f,\n", run.cpuSeconds, run.cpuPerGB);
+		fprintf(out, "     \"syscalls\": {\"client\": {\"send\": %llu, \"receive\": %llu, \"wait\": %llu}, \"server\": {\"send\": %llu, \"receive\": %llu, \"wait\": %llu}},\n",
+			(unsigned long long)run.client.sends, (unsigned long long)run.client.receives, (unsigned long long)run.client.waits,
+			(unsigned long long)run.server.sends, (unsigned long long)run.server.receives, (unsigned long long)run.server.waits);
+		fprintf(out, "     \"payload_bytes_copied\": %llu, \"copied_bytes_per_packet\": %.1f, \"steady_allocations\": %s,\n",
+			(unsigned long long)run.payloadBytesCopied, run.sentPackets > 0 ? (double)run.payloadBytesCopied / run.sentPackets : 0.0,
+			run.steadyMeasured ? to_string(run.steadyAllocations).c_str() : "null");
+		fprintf(out, "     \"sent_packets\": %u, \"lost_packets\": %u, \"receiver_drops\": %d}%s\n",
+			run.sentPackets, run.lostPackets, run.receiverDrops, i + 1 < runs.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	if (!args.valid)
+	{
+		return 1;
+	}
+
+	for (const string& profile : args.profiles)
+	{
+		LinkEmulator check;
+		string error;
+		if (!check.Configure(profile, error))
+		{
+			printf("bad link settings '%s': %s\n", profile.c_str(), error.c_str());
+			return 1;
+		}
+	}
+
+	if (!InitializeSockets())
+	{
+		printf("failed to initialize sockets\n");
+		return 1;
+	}
+
+	makeDirectory(args.workDirectory);
+	makeDirectory(args.workDirectory + "/received");
+
+	PcapWriter pcapWriter;
+	if (!args.pcapPath.empty() && !pcapWriter.Start(args.pcapPath))
+	{
+		printf("could not write capture %s\n", args.pcapPath.c_str());
+		return 1;
+	}
+	PacketCapture* capture = pcapWriter.IsRunning() ? &pcapWriter : nullptr;
+
+	vector<BenchRun> runs;
+	int failedChecks = 0;
+	for (uint64_t fileSize : args.fileSizes)
+	{
+		for (int payloadSize : args.payloadSizes)
+		{
+			for (const string& profile : args.profiles)
+			{
+				BenchRun run = BenchRun();
+				run.fileSize = fileSize;
+				run.payloadSize = payloadSize;
+				run.profile = profile;
+
+				fprintf(stderr, "%llu bytes, %d byte payloads, %s: ", (unsigned long long)fileSize, payloadSize, profile.empty() ? "clean" : profile.c_str());
+				if (!runTransfer(args, run, capture))
+				{
+					fprintf(stderr, "failed to run\n");
+					ShutdownSockets();
+					return 1;
+				}
+				fprintf(stderr, "%s, %.1f Mbit/s, p99 %.3f ms", run.passed ? "passed" : run.completed ? "corrupt" : "incomplete",
+					run.goodput * 8.0 / 1e6, run.latencyP99 * 1000.0);
+				if (args.files > 0)
+					fprintf(stderr, ", %d files passed, %.0f files/s", run.filesPassed, run.filesPerSecond);
+				fprintf(stderr, ", %.1f payload bytes copied per packet", run.sentPackets > 0 ? (double)run.payloadBytesCopied / run.sentPackets : 0.0);
+				if (run.plain && run.payloadBytesCopied > 0)
+				{
+					fprintf(stderr, " (FAILED: the plain path copied %llu payload bytes)", (unsigned long long)run.payloadBytesCopied);
+					failedChecks++;
+				}
+				if (run.steadyMeasured)
+					fprintf(stderr, ", %llu allocations in steady state", (unsigned long long)run.steadyAllocations);
+				if (run.plain && run.steadyMeasured && run.steadyAllocations > 0)
+				{
+					fprintf(stderr, " (FAILED: the plain path allocated)");
+					failedChecks++;
+				}
+				fprintf(stderr, "\n");
+				runs.push_back(run);
+			}
+		}
+	}
+
+	ShutdownSockets();
+
+	if (pcapWriter.IsRunning())
+	{
+		pcapWriter.Stop();
+		fprintf(stderr, "captured %llu datagrams, dropped %llu\n",
+			(unsigned long long)pcapWriter.GetCapturedPackets(), (unsigned long long)pcapWriter.GetDroppedPackets());
+	}
+
+	FILE* out = args.outputPath == "-" ? stdout : fopen(args.outputPath.c_str(), "w");
+	if (out == nullptr)
+	{
+		printf("could not write %s\n", args.outputPath.c_str());
+		return 1;
+	}
+	writeJson(out, args, runs);
+	if (out != stdout)
+		fclose(out);
+
+	return failedChecks > 0 ? 1 : 0;
+}
@@ -0,0 +1,304 @@
+/*
+	Packet lifecycle trace
+	  + events (sent, received, acked, lost, rtt sample, send window) are stamped with GetTimeNs and pushed onto a
+	    lock-free ring owned by the recording thread, so recording never blocks or shares a cache line with another thread
+	  + a writer thread drains every ring into a compact binary file; if a ring fills, events are counted and dropped
+	  + TraceConvert turns the file into Chrome trace / Perfetto JSON with rtt, in-flight and window timelines
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "Net.h"
+#include "Pipeline.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#endif
+
+namespace net
+{
+	// file layout: the 8 byte TraceMagic, then TraceRecordSize byte records, all little-endian
+	//  + time u64 (ns), sequence u32, value u32, type u8, thread u8, two reserved bytes
+	//  + records are grouped by the thread that wrote them, so sort by time before reading them in order
+
+	const char TraceMagic[8] = { 'R', 'U', 'D', 'P', 'T', 'R', 'C', '1' };
+	const int TraceRecordSize = 20;
+
+	enum TraceEventType
+	{
+		TracePacketSent = 1,		// value: payload bytes
+		TracePacketReceived = 2,	// value: payload bytes
+		TracePacketAcked = 3,
+		TracePacketLost = 4,
+		TraceRetransmit = 5,		// value: attempt (reserved, nothing retransmits yet)
+		TraceRttSample = 6,			// value: rtt in microseconds
+		TraceSendWindow = 7			// value: packets the sender may have in flight
+	};
+
+	struct TraceEvent
+	{
+		uint64_t time;
+		unsigned int sequence;
+		unsigned int value;
+		unsigned char type;
+		unsigned char thread;
+	};
+
+	inline void WriteTraceRecord(unsigned char record[TraceRecordSize], const TraceEvent& event)
+	{
+		for (int i = 0; i < 8; ++i)
+			record[i] = (unsigned char)(event.time >> (i * 8));
+		for (int i = 0; i < 4; ++i)
+		{
+			record[8 + i] = (unsigned char)(event.sequence >> (i * 8));
+			record[12 + i] = (unsigned char)(event.value >> (i * 8));
+		}
+		record[16] = event.type;
+		record[17] = event.thread;
+		record[18] = 0;
+		record[19] = 0;
+	}
+
+	inline void ReadTraceRecord(const unsigned char record[TraceRecordSize], TraceEvent& event)
+	{
+		event.time = 0;
+		for (int i = 0; i < 8; ++i)
+			event.time |= (uint64_t)record[i] << (i * 8);
+		event.sequence = 0;
+		event.value = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			event.sequence |= (unsigned int)record[8 + i] << (i * 8);
+			event.value |= (unsigned int)record[12 + i] << (i * 8);
+		}
+		event.type = record[16];
+		event.thread = record[17];
+	}
+
+	// records events from any number of threads into one trace file
+
+	class Tracer
+	{
+	public:
+
+		static const int RingSize = 64 * 1024;		// events a thread can get ahead of the writer
+
+		Tracer() : id(NextId()), file(NULL), running(false), stopping(false), dropped(0)
+		{
+		}
+
+		~Tracer()
+		{
+			Stop();
+		}
+
+		bool Start(const std::string& path)
+		{
+			assert(file == NULL);
+			file = fopen(path.c_str(), "wb");
+			if (file == NULL)
+				return false;
+			fwrite(TraceMagic, 1, sizeof(TraceMagic), file);
+			stopping = false;
+			writer = std::thread(&Tracer::WriterThread, this);
+			running = true;
+			return true;
+		}
+
+		// write out everything recorded so far and close the file
+		void Stop()
+		{
+			running = false;
+			stopping = true;
+			if (writer.joinable())
+				writer.join();
+			if (file)
+			{
+				Drain();
+				fclose(file);
+				file = NULL;
+			}
+		}
+
+		bool IsRunning() const
+		{
+			return running;
+		}
+
+		void Record(TraceEventType type, unsigned int sequence, unsigned int value = 0)
+		{
+			if (!running)
+				return;
+			ThreadRing* ring = GetThreadRing();
+			TraceEvent event;
+			event.time = GetTimeNs();
+			event.sequence = sequence;
+			event.value = value;
+			event.type = (unsigned char)type;
+			event.thread = ring->thread;
+			if (!ring->events.Push(event))
+				dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// events lost because a thread's ring was full
+		uint64_t GetDroppedEvents() const
+		{
+			return dropped.load(std::memory_order_relaxed);
+		}
+
+	private:
+
+		struct ThreadRing
+		{
+			ThreadRing(unsigned char thread) : events(RingSize), thread(thread) {}
+			SpscRing<TraceEvent> events;
+			unsigned char thread;
+		};
+
+		static unsigned int NextId()
+		{
+			static std::atomic<unsigned int> next(1);
+			return next.fetch_add(1);
+		}
+
+		// each thread finds its ring through a thread local cache, so only its first event takes the lock
+		ThreadRing* GetThreadRing()
+		{
+			struct Cache
+			{
+				unsigned int tracer;
+				ThreadRing* ring;
+			};
+			static thread_local Cache cache = { 0, NULL };
+			if (cache.tracer != id)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				rings.push_back(std::unique_ptr<ThreadRing>(new ThreadRing((unsigned char)rings.size())));
+				cache.tracer = id;
+				cache.ring = rings.back().get();
+			}
+			return cache.ring;
+		}
+
+		void WriterThread()
+		{
+			while (!stopping)
+			{
+				if (Drain() == 0)
+					wait(0.01f);
+			}
+		}
+
+		int Drain()
+		{
+			std::vector<ThreadRing*> current;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (size_t i = 0; i < rings.size(); ++i)
+					current.push_back(rings[i].get());
+			}
+
+			int written = 0;
+			unsigned char buffer[256 * TraceRecordSize];
+			int buffered = 0;
+			for (size_t i = 0; i < current.size(); ++i)
+			{
+				TraceEvent event;
+				while (current[i]->events.Pop(event))
+				{
+					WriteTraceRecord(&buffer[buffered * TraceRecordSize], event);
+					if (++buffered == 256)
+					{
+						fwrite(buffer, TraceRecordSize, buffered, file);
+						buffered = 0;
+					}
+					written++;
+				}
+			}
+			if (buffered > 0)
+				fwrite(buffer, TraceRecordSize, buffered, file);
+			// the server usually ends by being killed, so keep the file current rather than relying on Stop
+			if (written > 0)
+				fflush(file);
+			return written;
+		}
+
+		const unsigned int id;
+		FILE* file;
+		std::atomic<bool> running;
+		std::thread writer;
+		std::atomic<bool> stopping;
+		std::atomic<uint64_t> dropped;
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadRing> > rings;
+	};
+
+	// records reliability events, passing each on to another observer (such as metrics) if there is one
+
+	class TraceObserver : public ReliabilityObserver
+	{
+	public:
+
+		TraceObserver(Tracer& tracer, ReliabilityObserver* next = NULL) : tracer(tracer), next(next)
+		{
+		}
+
+		void OnPacketSent(unsigned int sequence, int size)
+		{
+			tracer.Record(TracePacketSent, sequence, (unsigned int)size);
+			if (next)
+				next->OnPacketSent(sequence, size);
+		}
+
+		void OnPacketReceived(unsigned int sequence, int size)
+		{
+			tracer.Record(TracePacketReceived, sequence, (unsigned int)size);
+			if (next)
+				next->OnPacketReceived(sequence, size);
+		}
+
+		void OnPacketAcked(unsigned int sequence)
+		{
+			tracer.Record(TracePacketAcked, sequence);
+			if (next)
+				next->OnPacketAcked(sequence);
+		}
+
+		void OnPacketLost(unsigned int sequence)
+		{
+			tracer.Record(TracePacketLost, sequence);
+			if (next)
+				next->OnPacketLost(sequence);
+		}
+
+		void OnRoundTripTime(uint64_t sample)
+		{
+			const uint64_t microseconds = sample / 1000;
+			tracer.Record(TraceRttSample, 0, microseconds < 0xFFFFFFFF ? (unsigned int)microseconds : 0xFFFFFFFF);
+			if (next)
+				next->OnRoundTripTime(sample);
+		}
+
+	private:
+
+		Tracer& tracer;
+		ReliabilityObserver* next;
+	};
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
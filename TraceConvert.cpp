@@ -0,0 +1,229 @@
+/*
+	Trace converter
+	  + reads a packet lifecycle trace written with --trace and writes Chrome trace / Perfetto JSON
+	    (load it in ui.perfetto.dev or chrome://tracing)
+	  + every packet is an async slice from send to ack or loss, receives are instant events, and rtt,
+	    packets in flight and the send window are counter tracks
+	  + optionally writes the rtt and window timelines as CSV in 1 ms steps and prints a summary
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#include "Trace.h"
+
+#pragma warning(disable : 4996)
+
+using namespace std;
+using namespace net;
+
+struct TimelinePoint
+{
+	double time;		// ms since the first event
+	int inFlight;
+	unsigned int window;
+	double rttSample;	// ms, zero when no sample fell in this step
+	double srtt;		// ms, smoothed as the connection does it
+};
+
+bool readTrace(const char* path, vector<TraceEvent>& events)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		printf("could not open %s\n", path);
+		return false;
+	}
+
+	char magic[sizeof(TraceMagic)];
+	if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, TraceMagic, sizeof(magic)) != 0)
+	{
+		printf("%s is not a trace file\n", path);
+		fclose(file);
+		return false;
+	}
+
+	unsigned char record[TraceRecordSize];
+	while (fread(record, 1, TraceRecordSize, file) == (size_t)TraceRecordSize)
+	{
+		TraceEvent event;
+		ReadTraceRecord(record, event);
+		events.push_back(event);
+	}
+	fclose(file);
+
+	// each thread's records are together in the file
+	stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.time < b.time; });
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printf("Usage: TraceConvert <trace file> <json file> [--timeline <csv file>]\n");
+		return 1;
+	}
+
+	const char* timelinePath = NULL;
+	for (int i = 3; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], "--timeline") == 0)
+			timelinePath = argv[++i];
+	}
+
+	vector<TraceEvent> events;
+	if (!readTrace(argv[1], events))
+		return 1;
+	if (events.empty())
+	{
+		printf("%s has no events\n", argv[1]);
+		return 1;
+	}
+
+	FILE* json = fopen(argv[2], "w");
+	if (json == NULL)
+	{
+		printf("could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	const uint64_t start = events.front().time;
+	const uint64_t CounterInterval = 50000;	// at most one in-flight counter event per 50 us, the slices carry the detail
+
+	fprintf(json, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	fprintf(json, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"ReliableUDP\"}}");
+
+	set<unsigned int> outstanding;		// sent packets waiting for an ack or loss
+	vector<unsigned char> threads;
+	vector<uint64_t> counts(8, 0);
+	vector<double> rttSamples;
+	vector<TimelinePoint> timeline;
+	int inFlight = 0;
+	int maxInFlight = 0;
+	unsigned int window = 0;
+	double srtt = 0.0;
+	uint64_t lastCounter = 0;
+	bool counterPending = false;
+
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		const TraceEvent& event = events[i];
+		const double ts = (event.time - start) / 1000.0;	// microseconds, the unit trace viewers expect
+		if (event.type < counts.size())
+			counts[event.type]++;
+		if (find(threads.begin(), threads.end(), event.thread) == threads.end())
+		{
+			threads.push_back(event.thread);
+			fprintf(json, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}", event.thread, event.thread);
+		}
+
+		double rttSample = 0.0;
+		switch (event.type)
+		{
+		case TracePacketSent:
+			fprintf(json, ",\n{\"name\": \"packet %u\", \"cat\": \"packet\", \"ph\": \"b\", \"id\": %u, \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"bytes\": %u}}",
+				event.sequence, event.sequence, ts, event.thread, event.value);
+			outstanding.insert(event.sequence);
+			inFlight++;
+			counterPending = true;
+			break;
+
+		case TracePacketAcked:
+		case TracePacketLost:
+			if (outstanding.erase(event.sequence))
+			{
+				fprintf(json, ",\n{\"name\": \"packet %u\", \"cat\": \"packet\", \"ph\": \"e\", \"id\": %u, \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"result\": \"%s\"}}",
+					event.sequence, event.sequence, ts, event.thread, event.type == TracePacketAcked ? "acked" : "lost");
+				inFlight--;
+				counterPending = true;
+			}
+			if (event.type == TracePacketLost)
+				fprintf(json, ",\n{\"name\": \"lost %u\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}", event.sequence, ts, event.thread);
+			break;
+
+		case TracePacketReceived:
+			fprintf(json, ",\n{\"name\": \"received %u\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"bytes\": %u}}",
+				event.sequence, ts, event.thread, event.value);
+			break;
+
+		case TraceRetransmit:
+			fprintf(json, ",\n{\"name\": \"retransmit %u\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"attempt\": %u}}",
+				event.sequence, ts, event.thread, event.value);
+			break;
+
+		case TraceRttSample:
+			rttSample = event.value / 1000.0;
+			rttSamples.push_back(rttSample);
+			srtt = srtt == 0.0 ? rttSample : srtt * 0.875 + rttSample * 0.125;
+			fprintf(json, ",\n{\"name\": \"rtt ms\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"args\": {\"sample\": %.3f, \"smoothed\": %.3f}}", ts, rttSample, srtt);
+			break;
+
+		case TraceSendWindow:
+			window = event.value;
+			fprintf(json, ",\n{\"name\": \"send window\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"args\": {\"packets\": %u}}", ts, window);
+			break;
+		}
+
+		if (inFlight > maxInFlight)
+			maxInFlight = inFlight;
+		if (counterPending && (event.time - lastCounter >= CounterInterval || i + 1 == events.size()))
+		{
+			fprintf(json, ",\n{\"name\": \"in flight\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"args\": {\"packets\": %d}}", ts, inFlight);
+			lastCounter = event.time;
+			counterPending = false;
+		}
+
+		// timeline in 1 ms steps, each step holds the state at its end
+		const double ms = (event.time - start) / 1e6;
+		const size_t step = (size_t)ms;
+		while (timeline.size() <= step)
+		{
+			TimelinePoint point = { (double)timeline.size(), inFlight, window, 0.0, srtt };
+			timeline.push_back(point);
+		}
+		TimelinePoint& point = timeline[step];
+		point.inFlight = inFlight;
+		point.window = window;
+		point.srtt = srtt;
+		if (rttSample > 0.0)
+			point.rttSample = rttSample;
+	}
+
+	fprintf(json, "\n]}\n");
+	fclose(json);
+
+	if (timelinePath)
+	{
+		FILE* csv = fopen(timelinePath, "w");
+		if (csv == NULL)
+		{
+			printf("could not write %s\n", timelinePath);
+			return 1;
+		}
+		fprintf(csv, "time_ms,in_flight,send_window,rtt_sample_ms,srtt_ms\n");
+		for (size_t i = 0; i < timeline.size(); ++i)
+		{
+			const TimelinePoint& point = timeline[i];
+			fprintf(csv, "%.0f,%d,%u,%.3f,%.3f\n", point.time, point.inFlight, point.window, point.rttSample, point.srtt);
+		}
+		fclose(csv);
+	}
+
+	printf("%zu events over %.3f s on %zu threads\n", events.size(), (events.back().time - start) / 1e9, threads.size());
+	printf("sent %llu, received %llu, acked %llu, lost %llu, retransmitted %llu, max in flight %d\n",
+		(unsigned long long)counts[TracePacketSent], (unsigned long long)counts[TracePacketReceived], (unsigned long long)counts[TracePacketAcked],
+		(unsigned long long)counts[TracePacketLost], (unsigned long long)counts[TraceRetransmit], maxInFlight);
+	if (!rttSamples.empty())
+	{
+		sort(rttSamples.begin(), rttSamples.end());
+		printf("rtt min %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms (%zu samples)\n",
+			rttSamples.front(), rttSamples[rttSamples.size() / 2], rttSamples[(size_t)(rttSamples.size() * 0.99)], rttSamples.back(), rttSamples.size());
+	}
+
+	return 0;
+}
@@ -0,0 +1,2833 @@
+/*
+	File transfer over a reliable connection
+	  + FileMetadata describes the file being sent, FileSender is the client's network stage and FileReceiver the server's receive pipeline
+	  + shared by the client/server program and the loopback benchmark
+	  + messages: the metadata "name|size|checksumId", data (an 8 byte big-endian file offset, then file bytes) and the
+	    completion "complete|digest"; offsets stay below 2^56, so a data message always starts with a zero byte,
+	    which text messages never do
+	  + sizes and offsets are 64-bit throughout, and pieces of the file that are all zero are not sent at all:
+	    the receiver sizes the file up front, so skipped ranges are left as holes that read back as zeros
+	  + a batch (BatchSender) sends a whole directory tree over the one connection with binary messages of its own,
+	    told apart by a first byte of 1 to 3:
+	      manifest   checksumId, the first file's id, then per file its size, how much of the previous entry's path
+	                 its path shares, and the rest of the path; the first entry of each packet shares nothing, so a
+	                 lost manifest packet costs only the files it names
+	      data       records packed back to back, each starting with the file id shifted left once; a clear low bit
+	                 is followed by offset, length and the bytes, a set one by the length and text of the file's digest
+	      complete   the number of files in the batch
+	    every number is an unsigned LEB128 varint, and file ids start at 1
+	  + a striped transfer spreads the data messages of one file over several connections (stripes) and the receiver
+	    puts them back in order; as a gap could then be a piece still on its way over another stripe, runs of skipped
+	    zeros are announced with a zero range message (a byte of 4, then offset and length as varints), each stripe but
+	    the first ends with a stripe end message (a byte of 5), and the completion, on the first stripe with the
+	    metadata, becomes "complete|digest|stripes"
+	  + a delta updates the receiver's existing copy of a file with what changed: the sender opens with a delta start
+	    (a byte of 6, then size, checksumId and the name), the receiver answers with the signatures of its copy's blocks
+	    (a byte of 7, then block size, block count and first block, and per block a little-endian u32 weak and u64
+	    strong checksum, see Delta.h), and the sender sends the bytes that match no block as data messages and the rest
+	    as delta copies (a byte of 8, then records of offset, block and block count); the new file is written beside
+	    the old copy and replaces it once its digest matches
+	  + with dedup, the sender cuts the file into content-defined chunks (Dedup.h) and asks which of them the receiver's
+	    chunk store has (a byte of 9, then records of offset, size and 16 byte id); the receiver answers with a bitmap (a
+	    byte of 10, then the first chunk's offset, the chunk count and a bit per chunk, set if stored), and the sender
+	    sends the chunks it lacks as data messages and the rest as references (a byte of 11, then records like the
+	    question's), which the receiver fills in from its store; the chunks that arrive as data join the store
+	  + compressed, the metadata names the codec after the checksumId ("name|size|checksumId|lz4", see Compress.h) and a
+	    block of the file that compresses goes as compressed data messages instead (a byte of 12, then the block's
+	    offset and size, the compressed size and where among the compressed bytes the piece starts, then the piece);
+	    blocks that would not shrink go as plain data messages
+*/
+
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include "Net.h"
+#include "Checksum.h"
+#include "Pipeline.h"
+#include "Metrics.h"
+#include "LargeFile.h"
+#include "Delta.h"
+#include "Dedup.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#endif
+
+#define TRANSFER_COMPLETE "complete"
+#define DELTA_SUFFIX ".delta" // a delta's new file is written beside the old copy under its name plus this
+
+const int ReceiveBuffers = 16384; // packets the receive pipeline can hold before the socket drain has to drop
+const int DataHeaderSize = 8; // file offset in front of the bytes of each data message
+
+inline void WriteFileOffset(unsigned char header[DataHeaderSize], uint64_t offset)
+{
+	for (int i = 0; i < DataHeaderSize; ++i)
+		header[i] = (unsigned char)(offset >> ((DataHeaderSize - 1 - i) * 8));
+}
+
+inline uint64_t ReadFileOffset(const unsigned char header[DataHeaderSize])
+{
+	uint64_t offset = 0;
+	for (int i = 0; i < DataHeaderSize; ++i)
+		offset = (offset << 8) | header[i];
+	return offset;
+}
+
+const unsigned char BatchManifest = 1;
+const unsigned char BatchData = 2;
+const unsigned char BatchComplete = 3;
+const unsigned char ZeroRange = 4;
+const unsigned char StripeEnd = 5;
+const unsigned char DeltaStart = 6;
+const unsigned char DeltaSignatures = 7;
+const unsigned char DeltaCopy = 8;
+const unsigned char DedupQuery = 9;
+const unsigned char DedupAnswer = 10;
+const unsigned char DedupRef = 11;
+const unsigned char CompressedData = 12;
+const int MaxStripes = 16;
+const int MaxVarintSize = 10;
+const int DeltaSignatureSize = 12; // weak and strong checksum of a block in a signatures message
+const int DeltaCopySlice = 1 << 20; // bytes of the old copy read at a time for copies and signatures
+const int DeltaFeedPerUpdate = 4 << 20; // file bytes the delta (or dedup) sender scans per update, so runs of copies do not hold up the loop
+const double DeltaSignatureWait = 2.0; // seconds the delta sender waits for signatures still missing before sending without them
+const int DedupIdSize = 16; // chunk id in a dedup query or reference, the low then the high half, little-endian
+const int DedupBufferLimit = 16 << 20; // file bytes the dedup sender holds while it waits for answers
+const double DedupAnswerWait = 1.0; // seconds the dedup sender waits for the answer about a chunk before sending it whole
+const int CompressBlockSize = 64 * 1024; // largest block a compressed data message expands to, the send pipeline's chunk size
+const int CompressBlocks = 64; // decompressed blocks the receiver can have queued for the disk stage
+
+// seven bits a byte, low bits first, the high bit set on every byte but the last
+inline int WriteVarint(unsigned char* p, uint64_t value)
+{
+	int size = 0;
+	while (value >= 0x80)
+	{
+		p[size++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	p[size++] = (unsigned char)value;
+	return size;
+}
+
+inline int VarintSize(uint64_t value)
+{
+	int size = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+// advances p past the varint, false if it runs past end or is too long
+inline bool ReadVarint(const unsigned char*& p, const unsigned char* end, uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; p < end && shift < 64; shift += 7)
+	{
+		const unsigned char byte = *p++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// a chunk id as it goes on the wire
+inline void WriteChunkId(unsigned char* p, const net::ChunkId& id)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		p[i] = (unsigned char)(id.low >> (i * 8));
+		p[8 + i] = (unsigned char)(id.high >> (i * 8));
+	}
+}
+
+inline net::ChunkId ReadChunkId(const unsigned char* p)
+{
+	net::ChunkId id = { 0, 0 };
+	for (int i = 7; i >= 0; --i)
+	{
+		id.low = (id.low << 8) | p[i];
+		id.high = (id.high << 8) | p[8 + i];
+	}
+	return id;
+}
+
+// ------------------------------------------------------
+// transfer progress published through a metrics registry, shared by the sender and receiver of a process
+struct TransferMetrics
+{
+	net::Counter& fileBytesSent;
+	net::Counter& fileBytesWritten;
+	net::Counter& receiverDrops;
+	net::Counter& filesPassed;
+	net::Counter& filesFailed;
+
+	explicit TransferMetrics(net::MetricsRegistry& registry)
+		: fileBytesSent(registry.AddCounter("reliable_udp_file_bytes_sent_total", "File bytes handed to the connection by the sender.")),
+		  fileBytesWritten(registry.AddCounter("reliable_udp_file_bytes_written_total", "File bytes the receiver has written to disk.")),
+		  receiverDrops(registry.AddCounter("reliable_udp_receiver_drops_total", "Packets dropped because every receive buffer was queued.")),
+		  filesPassed(registry.AddCounter("reliable_udp_files_passed_total", "Received files whose checksum matched.")),
+		  filesFailed(registry.AddCounter("reliable_udp_files_failed_total", "Received files whose checksum did not match."))
+	{
+	}
+};
+
+// ------------------------------------------------------
+// creating struct for FileMetadata 
+struct FileMetadata 
+{
+	char fileName[256];
+	uint64_t fileSize;
+	int checksumId;
+	std::string checksum; // empty until the send pipeline or the parallel checksum has finished
+
+	FileMetadata(const std::string& filePath, const std::string& checksumMethod, int checksumThreads = 1)
+	{
+		getMetadata(filePath);
+		checksumId = net::FindChecksumAlgorithm(checksumMethod)->id;
+		if (checksumThreads != 1)
+		{
+			startParallelChecksum(filePath, checksumMethod, checksumThreads);
+		}
+	}
+
+private:
+
+	void getMetadata(const std::string& filePath)
+	{
+		// Open the file
+		net::LargeFile file;
+
+		if (!file.Open(filePath, net::LargeFile::Reading)) 
+		{
+			std::cerr << "Error opening file: " << filePath << std::endl;
+			exit(1);
+			// Set default values for metadata
+			strcpy(fileName, "");
+			fileSize = 0;
+		}
+
+		// Get the file name
+		const char* lastSlash = strrchr(filePath.c_str(), '\\');
+		const char* lastForwardSlash = strrchr(filePath.c_str(), '/');
+
+		if (lastForwardSlash != nullptr && (lastSlash == nullptr || lastForwardSlash > lastSlash))
+		{
+			lastSlash = lastForwardSlash;
+		}
+
+		if (lastSlash == nullptr) 
+		{
+			lastSlash = filePath.c_str();
+		}
+		else 
+		{
+			lastSlash++;
+		}
+		strcpy(fileName, lastSlash);
+
+		// Get the file size
+		fileSize = file.GetSize();
+
+		// Close the file
+		file.Close();
+	}
+
+public:
+	// serialization method by taking metadata and inserting into byte vector 
+	std::vector<unsigned char> serializeMetadata(const FileMetadata& metadata)
+	{
+		std::vector<unsigned char> buffer;
+
+		// need to store the 64-bit size into 8 bytes and store into byte vector 
+		for (int i = 0; i < (int)sizeof(uint64_t); ++i)
+		{
+			// use shift operator to shift counter i * 8 bits to right 
+			// use 0xFF as a mask to isolate right side byte to append to buffer
+			unsigned char byte = (metadata.fileSize >> (i * 8)) & 0xFF;
+			buffer.push_back(byte);
+		}
+		return buffer;
+	}
+
+	// hash the file in blocks on a thread pool; the digest is collected later by waitForChecksum
+	void startParallelChecksum(const std::string& filePath, const std::string& checksumMethod, int checksumThreads)
+	{
+		const net::ChecksumAlgorithm* algorithm = net::FindChecksumAlgorithm(checksumMethod);
+
+		parallelChecksum.reset(new net::ParallelChecksum(*algorithm, checksumThreads));
+		parallelChecksum->Start(filePath, fileSize);
+	}
+
+	const std::string& waitForChecksum()
+	{
+		if (parallelChecksum)
+		{
+			checksum = parallelChecksum->Wait();
+			parallelChecksum.reset();
+		}
+		return checksum;
+	}
+
+	// stream the file through the selected engine in large blocks instead of slurping it into memory
+	static std::string calculateFileChecksum(std::ifstream& file, const net::ChecksumAlgorithm& algorithm)
+	{
+		net::ChecksumEnginePtr engine = algorithm.create();
+		std::vector<char> buffer(1 << 20);
+
+		while (file)
+		{
+			file.read(buffer.data(), buffer.size());
+			std::streamsize bytesRead = file.gcount();
+			if (bytesRead > 0)
+			{
+				engine->Update(buffer.data(), (size_t)bytesRead);
+			}
+		}
+
+		return engine->GetDigest();
+	}
+
+	// methods such as getting the file metadata from file by using the file path 
+	// reading file size and compute the CRC 
+	// convert between FileMetadata and byte array for manual byte array manipulation ? 
+
+private:
+
+	std::unique_ptr<net::ParallelChecksum> parallelChecksum;
+};
+
+// ------------------------------------------------------
+// receive pipeline for the server
+//  + the main loop owns the connection and does nothing but drain the socket into pooled packet buffers
+//  + a verification thread parses the messages and hashes the file data as it arrives
+//  + a write-behind thread keeps the output file open and appends to it, so disk stalls never hold up the socket
+//  + batches are taken the same way; every file of a batch stays open from its manifest entry to its digest record,
+//    so the records of many files can share a packet
+//  + a striped transfer has a drain stage per stripe, each on its own thread with its own buffers and ring; verification
+//    takes from every ring and holds pieces that arrive ahead of the hashed offset until the gap before them fills
+//  + a delta start has verification read the existing copy for its block signatures, which queue up for the main
+//    loop to send back; a delta copy is hashed from the old copy by verification and copied by the disk stage
+//  + with a chunk store, verification answers dedup queries from the store's index, gathers the chunks it said it lacks
+//    from the data that follows and adds them; a dedup reference is read from the store, hashed and copied like a delta copy
+//  + verification puts the pieces of a compressed block together and decompresses it into a buffer of its own, which
+//    goes to the disk stage like the data of a packet
+class FileReceiver
+{
+public:
+
+	enum Result { Pending, Passed, Failed };
+
+	// files are written to outputDirectory (the working directory when empty); verbose prints each file's metadata and result
+	// metrics, when given, must outlive the receiver
+	// stripeCount is the number of connections a striped sender spreads each file over, one drain stage per stripe
+	FileReceiver(int payloadSize, const std::string& outputDirectory = "", bool verbose = true, TransferMetrics* metrics = nullptr, int stripeCount = 1)
+		: writeRing(ReceiveBuffers), payloadSize(payloadSize), outputDirectory(outputDirectory), verbose(verbose), metrics(metrics),
+		blocks(CompressBlockSize, CompressBlocks)
+	{
+		assert(stripeCount >= 1 && stripeCount <= MaxStripes);
+		const int buffers = std::max(ReceiveBuffers / stripeCount, 1024);
+		for (int i = 0; i < stripeCount; ++i)
+		{
+			stripes.push_back(std::unique_ptr<Stripe>(new Stripe(payloadSize, buffers)));
+		}
+		nextStripe = 0;
+		stripesEnded = 0;
+		heldCompletion = nullptr;
+		heldCompletionStripes = 1;
+		droppedPackets = 0;
+		bytesWritten = 0;
+		result = Pending;
+		completeTime = 0;
+		filesPassed = 0;
+		filesFailed = 0;
+		batchComplete = false;
+		batchAlgorithm = nullptr;
+		batchStartTime = 0;
+		storedBytes = 0;
+		packedOffset = NoBlock;
+		packedReceived = 0;
+		stopping = false;
+		verifyThread = std::thread(&FileReceiver::verifyStage, this);
+		writeThread = std::thread(&FileReceiver::writeStage, this);
+	}
+
+	~FileReceiver()
+	{
+		stopping = true;
+		verifyThread.join();
+		writeThread.join();
+	}
+
+	// drain stage: buffer to receive the next packet into, null if every buffer is still queued downstream
+	unsigned char* getBuffer(int stripe = 0)
+	{
+		Stripe& drain = *stripes[stripe];
+		if (drain.spare == nullptr)
+		{
+			drain.spare = drain.pool.Acquire();
+		}
+		return drain.spare != nullptr ? drain.spare->data : nullptr;
+	}
+
+	// drain stage: pass the packet received into the buffer on to verification
+	void submit(int size, int stripe = 0)
+	{
+		Stripe& drain = *stripes[stripe];
+		assert(drain.spare != nullptr);
+		drain.spare->size = size;
+		drain.verifyRing.Push(drain.spare); // never full, the ring has a slot for every pooled buffer
+		drain.spare = nullptr;
+	}
+
+	// drain stage: a packet arrived while no buffer was free
+	void drop()
+	{
+		droppedPackets++;
+		if (metrics)
+		{
+			metrics->receiverDrops.Add();
+		}
+	}
+
+	int getDroppedPackets() const
+	{
+		return droppedPackets;
+	}
+
+	// file bytes on disk so far for the current file
+	uint64_t getBytesWritten() const
+	{
+		return bytesWritten;
+	}
+
+	// outcome of the last file, Pending until its completion message has been verified and the file closed
+	Result getResult() const
+	{
+		return (Result)result.load();
+	}
+
+	// when the completion message reached verification (net::GetTimeNs clock)
+	uint64_t getCompleteTime() const
+	{
+		return completeTime;
+	}
+
+	// files of the current batch verified so far
+	int getFilesPassed() const
+	{
+		return filesPassed;
+	}
+
+	int getFilesFailed() const
+	{
+		return filesFailed;
+	}
+
+	// true once the batch's completion message has been verified and every file of it closed
+	bool isBatchComplete() const
+	{
+		return batchComplete;
+	}
+
+	// keep the chunks of the files received in a store in directory, so that later files can refer to them instead of
+	// sending them; before the first packet arrives, false if the store cannot be opened
+	bool openChunkStore(const std::string& directory)
+	{
+		if (!chunkStore.Open(directory))
+		{
+			return false;
+		}
+		if (verbose)
+		{
+			printf("Chunk store %s: %llu chunks, %llu bytes\n", directory.c_str(),
+				(unsigned long long)chunkStore.GetChunkCount(), (unsigned long long)chunkStore.GetDataSize());
+		}
+		return true;
+	}
+
+	// main loop: the next message for the sender (the signatures of a delta, answers to dedup queries), false if none is waiting
+	bool popReply(std::vector<unsigned char>& reply)
+	{
+		std::lock_guard<std::mutex> lock(replyMutex);
+		if (replies.empty())
+		{
+			return false;
+		}
+		reply.swap(replies.front());
+		replies.pop_front();
+		return true;
+	}
+
+private:
+
+	struct DiskWrite
+	{
+		enum Kind { Open, Data, Copy, Stored, Skip, Close, CloseAll };
+		Kind kind;
+		net::Chunk* packet; // returned to the pool by the disk stage whatever the kind, null when a later write shares it
+		uint64_t file; // 0 for a single file transfer, the id of a batch file otherwise
+		uint64_t offset; // Data, Copy and Stored: where the bytes go in the file, Open: the size of the file
+		uint64_t source; // Copy: where the bytes are in the old copy, Stored: in the chunk store's data log
+		const unsigned char* data; // Data: the bytes, inside the packet
+		int size;
+		std::string fileName;
+		bool delta; // Open: write beside the existing file and copy from it, replacing it if the new file passes
+		Result result; // integrity of the file being closed
+	};
+
+	// a batch file whose manifest entry has arrived but whose digest record has not
+	struct BatchFile
+	{
+		std::string name;
+		uint64_t size;
+		uint64_t hashedOffset;
+		net::ChecksumEnginePtr engine;
+	};
+
+	// an open output file and its path for error messages
+	struct OutputFile
+	{
+		net::LargeFile file;
+		std::string name;
+		net::LargeFile basis; // a delta's old copy, which the new file replaces
+		std::string basisName; // empty unless a delta
+	};
+
+	// a chunk the store lacked when the sender asked, gathered from the data messages that carry it
+	struct PendingChunk
+	{
+		net::ChunkId id;
+		int size;
+		std::vector<unsigned char> bytes; // received so far, in order
+	};
+
+	// the buffers and ring of one drain stage; the drain acquires from the pool and the disk stage releases into it
+	struct Stripe
+	{
+		Stripe(int payloadSize, int buffers) : pool(payloadSize + 1, buffers), verifyRing(buffers), spare(nullptr) {}
+
+		net::ChunkPool pool;
+		net::SpscRing<net::Chunk*> verifyRing;	// drain -> verification
+		net::Chunk* spare;						// buffer the drain stage is receiving into
+	};
+
+	void verifyStage()
+	{
+		net::Backoff backoff;
+		net::ChecksumEnginePtr engine;
+		const net::ChecksumAlgorithm* algorithm = nullptr;
+		char filename[256];
+		unsigned long long filesize = 0;
+		int checksumId = 0;
+		char checksum[65] = ""; // cleared after each metadata message, which need not carry one
+		char expectedChecksum[65] = "";
+		uint64_t hashedOffset = 0; // the digest covers the file up to here, in offset order
+		bool opened = false; // between a metadata message and its completion
+		net::LargeFile basis; // a delta's old copy, read for the bytes its copies hash
+		int blockSize = 0; // of the old copy's signatures
+		uint64_t copiedBytes = 0;
+		std::vector<unsigned char> copyBuffer;
+		bool compressed = false; // the metadata named the codec
+		bool refused = false; // the metadata named a path outside the output directory
+
+		while (!stopping)
+		{
+			net::Chunk* packet = nullptr;
+			if (!nextPacket(packet, hashedOffset, opened))
+			{
+				backoff.Wait();
+				continue;
+			}
+			backoff.Reset();
+			if (packet == nullptr)
+			{
+				continue;
+			}
+
+			if (packet->size > 0 && packet->data[0] >= BatchManifest && packet->data[0] <= BatchComplete)
+			{
+				verifyBatch(packet, backoff);
+				continue;
+			}
+
+			DiskWrite write;
+			write.kind = DiskWrite::Skip;
+			write.packet = packet;
+			write.file = 0;
+			write.offset = 0;
+			write.source = 0;
+			write.data = nullptr;
+			write.size = 0;
+			write.delta = false;
+			write.result = Pending;
+
+			// Use sscanf to parse the incoming metadata (buffers have a spare byte for the terminator)
+			const char* receivedData = reinterpret_cast<const char*>(packet->data);
+			packet->data[packet->size] = '\0';
+			checksum[0] = '\0';
+			if (packet->size >= DataHeaderSize && packet->data[0] == 0)
+			{
+				const uint64_t offset = ReadFileOffset(packet->data);
+				const int size = packet->size - DataHeaderSize;
+
+				// hash the data on its way to disk so verification never has to read the file back
+				if (engine && offset >= hashedOffset)
+				{
+					hashZeros(*engine, hashedOffset, offset);
+					engine->Update(packet->data + DataHeaderSize, (size_t)size);
+					hashedOffset = offset + (uint64_t)size;
+				}
+				if (!pendingChunks.empty())
+				{
+					collectChunk(offset, packet->data + DataHeaderSize, size);
+				}
+				// a piece from behind hashedOffset arrived out of order: it is written where it belongs, but the digest will not match
+				write.kind = DiskWrite::Data;
+				write.offset = offset;
+				write.data = packet->data + DataHeaderSize;
+				write.size = size;
+			}
+			else if (packet->size > 0 && packet->data[0] == ZeroRange)
+			{
+				const unsigned char* p = packet->data + 1;
+				uint64_t offset = 0;
+				uint64_t length = 0;
+				if (engine && ReadVarint(p, packet->data + packet->size, offset) && ReadVarint(p, packet->data + packet->size, length) &&
+					offset >= hashedOffset)
+				{
+					hashZeros(*engine, hashedOffset, offset + length);
+					hashedOffset = offset + length;
+				}
+			}
+			else if (packet->size > 0 && packet->data[0] == StripeEnd)
+			{
+				// counted by nextPacket
+			}
+			else if (packet->size > 0 && packet->data[0] == DeltaStart)
+			{
+				const unsigned char* p = packet->data + 1;
+				const unsigned char* end = packet->data + packet->size;
+				uint64_t size = 0;
+				uint64_t id = 0;
+				if (ReadVarint(p, end, size) && ReadVarint(p, end, id) && p < end && end - p < (int)sizeof(filename))
+				{
+					memcpy(filename, p, end - p);
+					filename[end - p] = '\0';
+					refused = !isSafePath(filename);
+					if (refused)
+					{
+						// neither read for signatures nor replaced: the sender goes on without signatures, and the file
+						// fails at its completion
+						printf("Error: Refusing path outside the output directory: %s\n", filename);
+						engine = nullptr;
+						basis.Close();
+						opened = false;
+					}
+					else
+					{
+						filesize = size;
+						checksumId = (int)id;
+						expectedChecksum[0] = '\0';
+
+						// the sender waits for the signatures, so nothing else arrives while the old copy is read
+						basis.Close();
+						blockSize = basis.Open(outputPath(filename), net::LargeFile::Reading) ? net::DeltaBlockSize(basis.GetSize()) : 0;
+						if (verbose)
+						{
+							printf("Filename: %s\n", filename);
+							printf("Filesize: %llu\n", filesize);
+							if (basis.IsOpen())
+								printf("Delta against the existing copy in %d byte blocks\n", blockSize);
+							else
+								printf("Delta with no existing copy, the file comes whole\n");
+						}
+						sendSignatures(basis, blockSize);
+
+						algorithm = net::FindChecksumAlgorithm(checksumId);
+						engine = algorithm != nullptr ? algorithm->create() : nullptr;
+						hashedOffset = 0;
+						copiedBytes = 0;
+						opened = true;
+						write.kind = DiskWrite::Open;
+						write.offset = filesize;
+						write.fileName = filename;
+						write.delta = basis.IsOpen();
+					}
+				}
+			}
+			else if (packet->size > 0 && packet->data[0] == DeltaCopy)
+			{
+				const unsigned char* p = packet->data + 1;
+				const unsigned char* end = packet->data + packet->size;
+				uint64_t offset, block, count;
+				while (ReadVarint(p, end, offset) && ReadVarint(p, end, block) && ReadVarint(p, end, count))
+				{
+					// one from behind is a duplicate, and without an old copy there is nothing to copy, which the digest catches
+					if (!engine || !basis.IsOpen() || offset < hashedOffset)
+					{
+						continue;
+					}
+					hashZeros(*engine, hashedOffset, offset);
+					hashedOffset = offset;
+
+					// hashed in slices on the way to the disk stage, which copies the same slices
+					const uint64_t source = block * (uint64_t)blockSize;
+					const uint64_t length = count * (uint64_t)blockSize;
+					copyBuffer.resize(DeltaCopySlice);
+					for (uint64_t done = 0; done < length && !stopping; )
+					{
+						const int slice = (int)std::min<uint64_t>(length - done, DeltaCopySlice);
+						const int bytesRead = basis.Read(source + done, &copyBuffer[0], slice);
+						if (bytesRead <= 0)
+						{
+							break;
+						}
+						engine->Update(&copyBuffer[0], (size_t)bytesRead);
+
+						DiskWrite copy = write;
+						copy.kind = DiskWrite::Copy;
+						copy.packet = nullptr;
+						copy.offset = offset + done;
+						copy.source = source + done;
+						copy.size = bytesRead;
+						pushWrite(copy, backoff);
+
+						done += (uint64_t)bytesRead;
+						hashedOffset += (uint64_t)bytesRead;
+						copiedBytes += (uint64_t)bytesRead;
+					}
+				}
+			}
+			else if (packet->size > 0 && packet->data[0] == CompressedData)
+			{
+				net::Chunk* block = compressed ? unpack(packet, backoff) : nullptr;
+				if (block != nullptr)
+				{
+					if (engine && block->offset >= hashedOffset)
+					{
+						hashZeros(*engine, hashedOffset, block->offset);
+						engine->Update(block->data, (size_t)block->size);
+						hashedOffset = block->offset + (uint64_t)block->size;
+					}
+					DiskWrite unpacked = write;
+					unpacked.kind = DiskWrite::Data;
+					unpacked.packet = block;
+					unpacked.offset = block->offset;
+					unpacked.data = block->data;
+					unpacked.size = block->size;
+					pushWrite(unpacked, backoff);
+				}
+			}
+			else if (packet->size > 0 && packet->data[0] == DedupQuery)
+			{
+				answerQuery(packet);
+			}
+			else if (packet->size > 0 && packet->data[0] == DedupRef)
+			{
+				const unsigned char* p = packet->data + 1;
+				const unsigned char* end = packet->data + packet->size;
+				uint64_t offset, size;
+				while (ReadVarint(p, end, offset) && ReadVarint(p, end, size) && end - p >= DedupIdSize)
+				{
+					const net::ChunkId id = ReadChunkId(p);
+					p += DedupIdSize;
+
+					// one from behind is a duplicate; a chunk the store lacks, or holds other bytes for, is left out,
+					// which the digest catches
+					uint64_t source = 0;
+					int storedSize = 0;
+					if (!engine || offset < hashedOffset || !chunkStore.Find(id, source, storedSize) || (uint64_t)storedSize != size)
+					{
+						continue;
+					}
+					chunkBuffer.resize((size_t)storedSize);
+					if (chunkStore.Read(source, &chunkBuffer[0], storedSize) != storedSize || !(net::ComputeChunkId(&chunkBuffer[0], storedSize) == id))
+					{
+						continue;
+					}
+					hashZeros(*engine, hashedOffset, offset);
+					engine->Update(&chunkBuffer[0], (size_t)storedSize);
+					hashedOffset = offset + size;
+					storedBytes += size;
+
+					DiskWrite stored = write;
+					stored.kind = DiskWrite::Stored;
+					stored.packet = nullptr;
+					stored.offset = offset;
+					stored.source = source;
+					stored.size = storedSize;
+					pushWrite(stored, backoff);
+				}
+			}
+			else if (strncmp(receivedData, TRANSFER_COMPLETE, strlen(TRANSFER_COMPLETE)) == 0)
+			{
+				opened = false;
+				// The checksum rides on the completion message when it was computed while sending
+				sscanf(receivedData + strlen(TRANSFER_COMPLETE), "|%64[0-9a-f]", expectedChecksum);
+
+				// zeros at the end of the file were never sent
+				if (engine)
+				{
+					hashZeros(*engine, hashedOffset, filesize);
+					hashedOffset = filesize;
+				}
+				if (basis.IsOpen())
+				{
+					if (verbose)
+						printf("Delta copied %llu bytes from the existing copy\n", (unsigned long long)copiedBytes);
+					basis.Close(); // before the disk stage moves the new file over it
+				}
+				if (chunkStore.IsOpen() && verbose)
+				{
+					printf("Dedup took %llu bytes from the chunk store, which now holds %llu chunks\n",
+						(unsigned long long)storedBytes, (unsigned long long)chunkStore.GetChunkCount());
+				}
+				pendingChunks.clear();
+
+				completeTime = net::GetTimeNs();
+				write.result = Failed;
+				if (refused)
+				{
+					printf("Error: %s was refused and not written\n", filename);
+				}
+				else if (algorithm == nullptr)
+				{
+					printf("Error: Unknown checksum method %d in metadata\n", checksumId);
+				}
+				else if (engine->GetDigest() == expectedChecksum) // Check checksum of received data against checksum from the client
+				{
+					if (verbose)
+						printf("%s check for File Integrity passed.\n", algorithm->name);
+					write.result = Passed;
+				}
+				else if (verbose)
+				{
+					printf("%s check for File Integrity failed.\n", algorithm->name);
+				}
+				write.kind = DiskWrite::Close;
+			}
+			else if (sscanf(receivedData, "%255[^|]|%llu|%d|%64[0-9a-f]", filename, &filesize, &checksumId, checksum) >= 3)
+			{
+				// Null-terminate the filename string
+				filename[sizeof(filename) - 1] = '\0';
+
+				// the name is opened for writing at offsets into whatever is there, so it too has to stay inside
+				refused = !isSafePath(filename);
+				if (refused)
+				{
+					printf("Error: Refusing path outside the output directory: %s\n", filename);
+					engine = nullptr;
+					basis.Close();
+					opened = false;
+				}
+				else
+				{
+					// The string is formatted as metadata
+					if (verbose)
+					{
+						printf("Filename: %s\n", filename);
+						printf("Filesize: %llu\n", filesize);
+						printf("Checksum: %s\n", checksum[0] ? checksum : "(sent on completion)");
+					}
+					strcpy(expectedChecksum, checksum);
+
+					// a codec name in place of the old checksum field says blocks may come compressed
+					char codec[16] = "";
+					sscanf(receivedData, "%*[^|]|%*[0-9]|%*[0-9]|%15[a-z0-9]", codec);
+					compressed = checksum[0] == '\0' && strcmp(codec, net::CompressCodec) == 0;
+					if (checksum[0] == '\0' && codec[0] != '\0' && !compressed)
+					{
+						printf("Error: Unknown codec %s in metadata\n", codec);
+					}
+					else if (compressed && verbose)
+					{
+						printf("Compressed with %s\n", codec);
+					}
+					packedOffset = NoBlock;
+					checksum[0] = '\0';
+
+					algorithm = net::FindChecksumAlgorithm(checksumId);
+					engine = algorithm != nullptr ? algorithm->create() : nullptr;
+					hashedOffset = 0;
+					opened = true;
+					basis.Close();
+					pendingChunks.clear();
+					storedBytes = 0;
+					write.kind = DiskWrite::Open;
+					write.offset = filesize;
+					write.fileName = filename;
+				}
+			}
+
+			pushWrite(write, backoff);
+		}
+	}
+
+	// verification's next packet, or null when the one taken from a ring is held back; false if every ring is empty
+	//  + a single stripe hands packets on in the order they arrived
+	//  + with several, pieces (data and zero ranges) past hashedOffset are held until the gap before them fills, and
+	//    the completion until every other stripe has ended; then whatever is still held lies past a piece that was
+	//    lost, and goes on in offset order for the digest to catch
+	bool nextPacket(net::Chunk*& packet, uint64_t hashedOffset, bool opened)
+	{
+		const bool ended = heldCompletion != nullptr && stripesEnded >= heldCompletionStripes - 1;
+		if (opened && !heldPieces.empty() && (heldPieces.begin()->first <= hashedOffset || ended))
+		{
+			packet = heldPieces.begin()->second;
+			heldPieces.erase(heldPieces.begin());
+			return true;
+		}
+		if (ended)
+		{
+			packet = heldCompletion;
+			heldCompletion = nullptr;
+			stripesEnded = 0;
+			return true;
+		}
+
+		for (size_t i = 0; i < stripes.size(); ++i)
+		{
+			Stripe& stripe = *stripes[nextStripe];
+			nextStripe = (nextStripe + 1) % stripes.size();
+			if (!stripe.verifyRing.Pop(packet))
+			{
+				continue;
+			}
+			if (stripes.size() == 1 || packet->size == 0)
+			{
+				return true;
+			}
+
+			uint64_t offset = 0;
+			bool piece = false;
+			if (packet->size >= DataHeaderSize && packet->data[0] == 0)
+			{
+				offset = ReadFileOffset(packet->data);
+				piece = true;
+			}
+			else if (packet->data[0] == ZeroRange || packet->data[0] == DeltaCopy || packet->data[0] == DedupRef || packet->data[0] == CompressedData)
+			{
+				// all start with the offset of the first range they cover (every piece of a compressed block with the
+				// block's, so they all go on once the block before is done and are put together in any order)
+				const unsigned char* p = packet->data + 1;
+				piece = ReadVarint(p, packet->data + packet->size, offset);
+			}
+			else if (packet->data[0] == StripeEnd)
+			{
+				stripesEnded++;
+			}
+			else if (packet->size >= (int)strlen(TRANSFER_COMPLETE) && memcmp(packet->data, TRANSFER_COMPLETE, strlen(TRANSFER_COMPLETE)) == 0)
+			{
+				// the sender's stripe count follows the digest, a sender on one connection has no stripe ends to wait for
+				packet->data[packet->size] = '\0';
+				const char* digest = reinterpret_cast<const char*>(packet->data) + strlen(TRANSFER_COMPLETE);
+				const char* stripeCount = *digest == '|' ? strchr(digest + 1, '|') : nullptr;
+				heldCompletionStripes = stripeCount != nullptr ? atoi(stripeCount + 1) : 1;
+				heldCompletion = packet;
+				packet = nullptr;
+			}
+
+			// a piece goes on if it is next in the file (or from behind, which the digest catches), otherwise it waits;
+			// a duplicate of a held piece waits beside it and follows it as a piece from behind
+			if (piece && (!opened || offset > hashedOffset))
+			{
+				heldPieces.insert(std::make_pair(offset, packet));
+				packet = nullptr;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// disk stage: give a packet back to the pool of the stripe that received it, or a decompressed block to its pool
+	void release(net::Chunk* packet)
+	{
+		if (blocks.Owns(packet))
+		{
+			blocks.Release(packet);
+			return;
+		}
+		for (size_t i = 0; i < stripes.size(); ++i)
+		{
+			if (stripes[i]->pool.Owns(packet))
+			{
+				stripes[i]->pool.Release(packet);
+				return;
+			}
+		}
+		assert(false);
+	}
+
+	// queue the signatures of the old copy's whole blocks for the sender, a packet at a time as they are computed so
+	// the first are on their way while the rest of the copy is read; without a copy, one message of no blocks
+	void sendSignatures(net::LargeFile& basis, int blockSize)
+	{
+		const uint64_t blockCount = basis.IsOpen() ? basis.GetSize() / (uint64_t)blockSize : 0;
+		const int perMessage = (payloadSize - 1 - 3 * MaxVarintSize) / DeltaSignatureSize;
+		const int sliceBlocks = blockSize > 0 ? std::max(DeltaCopySlice / blockSize, 1) : 1;
+		std::vector<unsigned char> slice;
+		uint64_t sliceFirst = 0;
+		uint64_t sliceBlocksRead = 0;
+		uint64_t block = 0;
+		do
+		{
+			std::vector<unsigned char> reply(1 + 3 * MaxVarintSize + perMessage * DeltaSignatureSize);
+			reply[0] = DeltaSignatures;
+			int size = 1;
+			size += WriteVarint(&reply[size], (uint64_t)blockSize);
+			size += WriteVarint(&reply[size], blockCount);
+			size += WriteVarint(&reply[size], block);
+			for (int i = 0; i < perMessage && block < blockCount; ++i, ++block)
+			{
+				if (block >= sliceFirst + sliceBlocksRead)
+				{
+					slice.resize((size_t)sliceBlocks * blockSize);
+					const int bytesRead = basis.Read(block * (uint64_t)blockSize, &slice[0], (int)slice.size());
+					sliceFirst = block;
+					sliceBlocksRead = bytesRead > 0 ? (uint64_t)(bytesRead / blockSize) : 0;
+					if (sliceBlocksRead == 0)
+					{
+						break; // the copy shrank or cannot be read, the sender takes the rest as lost
+					}
+				}
+				const net::BlockSignature signature = net::ComputeBlockSignature(&slice[(size_t)(block - sliceFirst) * blockSize], blockSize);
+				for (int b = 0; b < 4; ++b)
+					reply[size++] = (unsigned char)(signature.weak >> (b * 8));
+				for (int b = 0; b < 8; ++b)
+					reply[size++] = (unsigned char)(signature.strong >> (b * 8));
+			}
+			reply.resize(size);
+
+			std::lock_guard<std::mutex> lock(replyMutex);
+			replies.push_back(std::vector<unsigned char>());
+			replies.back().swap(reply);
+		}
+		while (block < blockCount && sliceBlocksRead > 0 && !stopping);
+	}
+
+	// add a compressed piece to its block; once the block is whole, its bytes decompressed into a buffer of the block
+	// pool (null until then, or if the block is damaged)
+	net::Chunk* unpack(const net::Chunk* packet, net::Backoff& backoff)
+	{
+		const unsigned char* p = packet->data + 1;
+		const unsigned char* end = packet->data + packet->size;
+		uint64_t offset, size, packedSize, position;
+		if (!ReadVarint(p, end, offset) || !ReadVarint(p, end, size) || !ReadVarint(p, end, packedSize) || !ReadVarint(p, end, position) ||
+			size == 0 || size > (uint64_t)CompressBlockSize || packedSize == 0 || packedSize > (uint64_t)net::CompressBound(CompressBlockSize) ||
+			position + (uint64_t)(end - p) > packedSize)
+		{
+			return nullptr;
+		}
+		if (offset != packedOffset || packedSize != packedBlock.size())
+		{
+			// a new block; one left unfinished lost a piece, which the digest catches
+			packedOffset = offset;
+			packedBlock.resize((size_t)packedSize);
+			packedPieces.clear();
+			packedReceived = 0;
+		}
+		if (std::find(packedPieces.begin(), packedPieces.end(), position) != packedPieces.end())
+		{
+			return nullptr; // a duplicate
+		}
+		packedPieces.push_back(position);
+		memcpy(&packedBlock[(size_t)position], p, (size_t)(end - p));
+		net::CountPayloadCopy((size_t)(end - p));
+		packedReceived += (uint64_t)(end - p);
+		if (packedReceived < packedSize)
+		{
+			return nullptr;
+		}
+
+		packedOffset = NoBlock;
+		net::Chunk* block = nullptr;
+		while ((block = blocks.Acquire()) == nullptr && !stopping)
+		{
+			backoff.Wait();
+		}
+		backoff.Reset();
+		if (block == nullptr)
+		{
+			return nullptr;
+		}
+		block->offset = offset;
+		block->size = net::Decompress(&packedBlock[0], (int)packedSize, block->data, (int)size);
+		if (block->size != (int)size)
+		{
+			blocks.Release(block);
+			return nullptr;
+		}
+		return block;
+	}
+
+	// answer a dedup query with a bit per chunk the store has, and note the others, whose bytes follow as data
+	void answerQuery(const net::Chunk* packet)
+	{
+		const unsigned char* p = packet->data + 1;
+		const unsigned char* end = packet->data + packet->size;
+		std::vector<unsigned char> bits((size_t)packet->size / 8 + 1, 0);
+		uint64_t first = 0;
+		uint64_t count = 0;
+		uint64_t offset, size;
+		while (ReadVarint(p, end, offset) && ReadVarint(p, end, size) && end - p >= DedupIdSize)
+		{
+			const net::ChunkId id = ReadChunkId(p);
+			p += DedupIdSize;
+			if (count == 0)
+			{
+				first = offset;
+			}
+
+			uint64_t storedOffset = 0;
+			int storedSize = 0;
+			if (chunkStore.Find(id, storedOffset, storedSize) && (uint64_t)storedSize == size)
+			{
+				bits[(size_t)(count / 8)] |= (unsigned char)(1 << (count % 8));
+			}
+			else if (chunkStore.IsOpen() && size > 0 && size <= (uint64_t)net::MaxChunkSize)
+			{
+				PendingChunk& chunk = pendingChunks[offset];
+				chunk.id = id;
+				chunk.size = (int)size;
+				chunk.bytes.clear();
+			}
+			count++;
+		}
+
+		std::vector<unsigned char> reply(1 + 2 * MaxVarintSize + (size_t)(count + 7) / 8);
+		reply[0] = DedupAnswer;
+		int replySize = 1;
+		replySize += WriteVarint(&reply[replySize], first);
+		replySize += WriteVarint(&reply[replySize], count);
+		memcpy(&reply[replySize], &bits[0], (size_t)(count + 7) / 8);
+		reply.resize(replySize + (size_t)(count + 7) / 8);
+
+		std::lock_guard<std::mutex> lock(replyMutex);
+		replies.push_back(std::vector<unsigned char>());
+		replies.back().swap(reply);
+	}
+
+	// a data message's bytes, added to the chunk they belong to if the store lacks it; a chunk that is whole and
+	// matches its id joins the store (one that cannot be written is only missed by later files)
+	void collectChunk(uint64_t offset, const unsigned char* data, int size)
+	{
+		std::map<uint64_t, PendingChunk>::iterator found = pendingChunks.upper_bound(offset);
+		if (found == pendingChunks.begin())
+		{
+			return;
+		}
+		--found;
+		PendingChunk& chunk = found->second;
+		if (offset != found->first + chunk.bytes.size() || chunk.bytes.size() + (size_t)size > (size_t)chunk.size)
+		{
+			return;
+		}
+		chunk.bytes.insert(chunk.bytes.end(), data, data + size);
+		if ((int)chunk.bytes.size() == chunk.size)
+		{
+			if (net::ComputeChunkId(&chunk.bytes[0], chunk.size) == chunk.id)
+			{
+				chunkStore.Add(chunk.id, &chunk.bytes[0], chunk.size);
+			}
+			pendingChunks.erase(found);
+		}
+	}
+
+	std::string outputPath(const std::string& fileName) const
+	{
+		return outputDirectory.empty() ? fileName : outputDirectory + "/" + fileName;
+	}
+
+	void pushWrite(const DiskWrite& write, net::Backoff& backoff)
+	{
+		while (!writeRing.Push(write) && !stopping)
+		{
+			backoff.Wait();
+		}
+		backoff.Reset();
+	}
+
+	// parse a batch message into disk writes; the last write of the packet carries it back to the pool
+	void verifyBatch(net::Chunk* packet, net::Backoff& backoff)
+	{
+		const unsigned char* p = packet->data + 1;
+		const unsigned char* end = packet->data + packet->size;
+		batchWrites.clear();
+
+		DiskWrite write;
+		write.packet = nullptr;
+		write.offset = 0;
+		write.source = 0;
+		write.data = nullptr;
+		write.size = 0;
+		write.delta = false;
+		write.result = Pending;
+
+		if (packet->data[0] == BatchManifest)
+		{
+			uint64_t checksumId = 0;
+			uint64_t id = 0;
+			if (ReadVarint(p, end, checksumId) && ReadVarint(p, end, id))
+			{
+				if (id == 1)
+				{
+					// a new batch
+					batchFiles.clear();
+					batchStartTime = net::GetTimeNs();
+					filesPassed = 0;
+					filesFailed = 0;
+					batchComplete = false;
+					batchAlgorithm = net::FindChecksumAlgorithm((int)checksumId);
+					if (batchAlgorithm == nullptr)
+						printf("Error: Unknown checksum method %d in manifest\n", (int)checksumId);
+				}
+
+				// the prefix never carries over from another packet, which may have been lost
+				batchPath.clear();
+				uint64_t size, shared, length;
+				for (; ReadVarint(p, end, size) && ReadVarint(p, end, shared) && ReadVarint(p, end, length); ++id)
+				{
+					if (shared > batchPath.size() || length > (uint64_t)(end - p))
+						break;
+					batchPath = batchPath.substr(0, (size_t)shared) + std::string(reinterpret_cast<const char*>(p), (size_t)length);
+					p += length;
+					if (!isSafePath(batchPath))
+					{
+						printf("Error: Refusing path outside the output directory: %s\n", batchPath.c_str());
+						continue; // its records are dropped and its digest record counts it as failed
+					}
+
+					BatchFile& file = batchFiles[id];
+					file.name = batchPath;
+					file.size = size;
+					file.hashedOffset = 0;
+					file.engine = batchAlgorithm != nullptr ? batchAlgorithm->create() : nullptr;
+
+					write.kind = DiskWrite::Open;
+					write.file = id;
+					write.offset = size;
+					write.fileName = batchPath;
+					batchWrites.push_back(write);
+				}
+			}
+		}
+		else if (packet->data[0] == BatchData)
+		{
+			uint64_t code;
+			while (ReadVarint(p, end, code))
+			{
+				const uint64_t id = code >> 1;
+				std::map<uint64_t, BatchFile>::iterator found = batchFiles.find(id);
+				uint64_t offset = 0;
+				uint64_t length = 0;
+				if (code & 1)
+				{
+					// digest record, the end of the file
+					if (!ReadVarint(p, end, length) || length > (uint64_t)(end - p))
+						break;
+					const std::string digest(reinterpret_cast<const char*>(p), (size_t)length);
+					p += length;
+
+					Result fileResult = Failed;
+					if (found != batchFiles.end())
+					{
+						BatchFile& file = found->second;
+						if (file.engine)
+						{
+							hashZeros(*file.engine, file.hashedOffset, file.size);
+							if (file.engine->GetDigest() == digest)
+								fileResult = Passed;
+						}
+						if (fileResult == Failed && verbose)
+							printf("%s check for File Integrity failed: %s\n", batchAlgorithm ? batchAlgorithm->name : "unknown", file.name.c_str());
+
+						write.kind = DiskWrite::Close;
+						write.file = id;
+						write.result = fileResult;
+						batchWrites.push_back(write);
+						batchFiles.erase(found);
+					}
+					(fileResult == Passed ? filesPassed : filesFailed)++;
+				}
+				else
+				{
+					if (!ReadVarint(p, end, offset) || !ReadVarint(p, end, length) || length > (uint64_t)(end - p))
+						break;
+					if (found != batchFiles.end())
+					{
+						BatchFile& file = found->second;
+						if (file.engine && offset >= file.hashedOffset)
+						{
+							hashZeros(*file.engine, file.hashedOffset, offset);
+							file.engine->Update(p, (size_t)length);
+							file.hashedOffset = offset + length;
+						}
+						write.kind = DiskWrite::Data;
+						write.file = id;
+						write.offset = offset;
+						write.data = p;
+						write.size = (int)length;
+						batchWrites.push_back(write);
+					}
+					p += length;
+				}
+			}
+		}
+		else
+		{
+			uint64_t count = 0;
+			ReadVarint(p, end, count);
+
+			// files whose digest record (or whole manifest packet) never arrived
+			for (std::map<uint64_t, BatchFile>::const_iterator i = batchFiles.begin(); i != batchFiles.end(); ++i)
+			{
+				if (verbose)
+					printf("Error: %s never completed\n", i->second.name.c_str());
+				filesFailed++;
+			}
+			batchFiles.clear();
+			if ((uint64_t)(filesPassed + filesFailed) < count)
+				filesFailed += (int)(count - (uint64_t)(filesPassed + filesFailed));
+
+			completeTime = net::GetTimeNs();
+			if (verbose)
+			{
+				const double seconds = (completeTime - batchStartTime) / 1e9;
+				printf("Batch of %llu files: %d passed, %d failed in %.2f secs (%.0f files/sec)\n",
+					(unsigned long long)count, filesPassed.load(), filesFailed.load(), seconds, seconds > 0.0 ? count / seconds : 0.0);
+			}
+
+			write.kind = DiskWrite::CloseAll;
+			write.file = 0;
+			batchWrites.push_back(write);
+		}
+
+		if (batchWrites.empty())
+		{
+			write.kind = DiskWrite::Skip;
+			batchWrites.push_back(write);
+		}
+		batchWrites.back().packet = packet;
+		for (size_t i = 0; i < batchWrites.size(); ++i)
+			pushWrite(batchWrites[i], backoff);
+	}
+
+	// a path from a manifest has to stay inside the output directory
+	static bool isSafePath(const std::string& path)
+	{
+		if (path.empty() || path[0] == '/' || path.find_first_of("\\:") != std::string::npos)
+			return false;
+		size_t start = 0;
+		while (true)
+		{
+			const size_t slash = path.find('/', start);
+			const std::string part = path.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+			if (part.empty() || part == "." || part == "..")
+				return false;
+			if (slash == std::string::npos)
+				return true;
+			start = slash + 1;
+		}
+	}
+
+	// feed the digest the zeros a skipped range of the file holds
+	//  + a hole can be gigabytes and not every engine has a shortcut, so give way between slices to keep the
+	//    socket drain running on a busy core
+	static void hashZeros(net::ChecksumEngine& engine, uint64_t from, uint64_t to)
+	{
+		const uint64_t Slice = 16 << 20;
+		while (from < to)
+		{
+			const uint64_t length = to - from < Slice ? to - from : Slice;
+			engine.UpdateZeros(length);
+			from += length;
+			std::this_thread::yield();
+		}
+	}
+
+	void writeStage()
+	{
+		net::Backoff backoff;
+		std::map<uint64_t, std::unique_ptr<OutputFile> > outputFiles; // open files by id
+		std::string lastDirectory; // batch paths arrive sorted, so most files go in the directory made for the one before
+		std::vector<unsigned char> copyBuffer;
+		net::LargeFile storedChunks; // the chunk store's data log, opened the way the store has it so both can share it
+
+		while (!stopping)
+		{
+			DiskWrite write;
+			if (!writeRing.Pop(write))
+			{
+				backoff.Wait();
+				continue;
+			}
+			backoff.Reset();
+
+			if (write.kind == DiskWrite::Open)
+			{
+				std::unique_ptr<OutputFile>& output = outputFiles[write.file];
+				output.reset(new OutputFile());
+				output->name = outputPath(write.fileName);
+				if (write.delta)
+				{
+					output->basisName = output->name;
+					output->name += DELTA_SUFFIX;
+				}
+				if (write.file <= 1)
+				{
+					// a single file, or the first of a batch
+					bytesWritten = 0;
+					result = Pending;
+					batchComplete = false;
+				}
+
+				const size_t slash = output->name.rfind('/');
+				if (write.file != 0 && slash != std::string::npos && output->name.compare(0, slash, lastDirectory) != 0)
+				{
+					net::CreateParentDirectories(output->name);
+					lastDirectory = output->name.substr(0, slash);
+				}
+
+				if (!output->file.Open(output->name, net::LargeFile::Writing))
+				{
+					printf("Error: Failed to open file: %s\n", output->name.c_str());
+					outputFiles.erase(write.file);
+				}
+				else if (write.delta && !output->basis.Open(output->basisName, net::LargeFile::Reading))
+				{
+					printf("Error: Failed to open file: %s\n", output->basisName.c_str());
+					outputFiles.erase(write.file);
+				}
+				else if (!output->file.SetSize(write.offset)) // full size up front, so ranges never sent read back as zeros
+				{
+					printf("Error: Failed to size file: %s\n", output->name.c_str());
+					outputFiles.erase(write.file);
+				}
+			}
+			else if (write.kind == DiskWrite::Data)
+			{
+				// Write the received data where its offset says, the file stays open for the whole transfer
+				std::map<uint64_t, std::unique_ptr<OutputFile> >::iterator found = outputFiles.find(write.file);
+				if (found == outputFiles.end())
+				{
+					// never opened, or closed after an error
+				}
+				else if (!found->second->file.Write(write.offset, write.data, write.size))
+				{
+					printf("Error: Failed to write file: %s\n", found->second->name.c_str());
+					outputFiles.erase(found);
+				}
+				else
+				{
+					bytesWritten += (uint64_t)write.size;
+					if (metrics)
+					{
+						metrics->fileBytesWritten.Add((uint64_t)write.size);
+					}
+				}
+			}
+			else if (write.kind == DiskWrite::Copy || write.kind == DiskWrite::Stored)
+			{
+				// bytes a delta keeps from the old copy, or a dedup reference takes from the chunk store
+				std::map<uint64_t, std::unique_ptr<OutputFile> >::iterator found = outputFiles.find(write.file);
+				copyBuffer.resize((size_t)write.size);
+				if (write.kind == DiskWrite::Stored && !storedChunks.IsOpen())
+				{
+					storedChunks.Open(chunkStore.GetDataPath(), net::LargeFile::Updating);
+				}
+				if (found == outputFiles.end())
+				{
+					// never opened, or closed after an error
+				}
+				else if ((write.kind == DiskWrite::Copy ? found->second->basis : storedChunks).Read(write.source, &copyBuffer[0], write.size) != write.size ||
+					!found->second->file.Write(write.offset, &copyBuffer[0], write.size))
+				{
+					printf("Error: Failed to copy into file: %s\n", found->second->name.c_str());
+					outputFiles.erase(found);
+				}
+				else
+				{
+					bytesWritten += (uint64_t)write.size;
+					if (metrics)
+					{
+						metrics->fileBytesWritten.Add((uint64_t)write.size);
+					}
+				}
+			}
+			else if (write.kind == DiskWrite::Close)
+			{
+				// a delta's new file replaces the old copy if it passed, and is thrown away if not
+				std::map<uint64_t, std::unique_ptr<OutputFile> >::iterator found = outputFiles.find(write.file);
+				if (found != outputFiles.end() && !found->second->basisName.empty())
+				{
+					OutputFile& output = *found->second;
+					output.file.Close();
+					output.basis.Close();
+					if (write.result == Passed && !net::RenameOver(output.name, output.basisName))
+					{
+						printf("Error: Failed to replace file: %s\n", output.basisName.c_str());
+					}
+					else if (write.result != Passed)
+					{
+						net::RemoveFile(output.name);
+					}
+				}
+				outputFiles.erase(write.file);
+				if (write.file == 0)
+				{
+					result = write.result;
+				}
+				if (metrics)
+				{
+					(write.result == Passed ? metrics->filesPassed : metrics->filesFailed).Add();
+				}
+			}
+			else if (write.kind == DiskWrite::CloseAll)
+			{
+				outputFiles.clear();
+				batchComplete = true;
+			}
+
+			if (write.packet != nullptr)
+			{
+				release(write.packet);
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<Stripe> > stripes;
+	net::SpscRing<DiskWrite> writeRing;		// verification -> disk
+	size_t nextStripe; // ring verification takes from next, so a busy stripe cannot starve the others
+	std::multimap<uint64_t, net::Chunk*> heldPieces; // striped pieces past the hashed offset, by offset
+	net::Chunk* heldCompletion; // striped completion waiting for the other stripes to end
+	int heldCompletionStripes; // stripes the held completion's sender used
+	int stripesEnded; // stripe end messages since the last completion
+	int payloadSize;
+	std::string outputDirectory;
+	bool verbose;
+	TransferMetrics* metrics;
+	std::mutex replyMutex;
+	std::deque<std::vector<unsigned char> > replies; // verification -> main loop
+	net::ChunkStore chunkStore; // opened before the first packet, then touched only by verification
+	std::map<uint64_t, PendingChunk> pendingChunks; // chunks of the current file the store lacks, by offset
+	std::vector<unsigned char> chunkBuffer; // a referenced chunk read back from the store
+	uint64_t storedBytes; // bytes of the current file taken from the store
+	static const uint64_t NoBlock = ~0ULL;
+	uint64_t packedOffset; // the compressed block being put together, NoBlock when none
+	std::vector<unsigned char> packedBlock;
+	std::vector<uint64_t> packedPieces; // where the pieces received so far start, to pass over duplicates
+	uint64_t packedReceived;
+	net::ChunkPool blocks; // decompressed blocks, acquired by verification and released by the disk stage
+	std::atomic<int> droppedPackets;
+	std::atomic<uint64_t> bytesWritten;
+	std::atomic<int> result;
+	std::atomic<uint64_t> completeTime;
+	std::atomic<int> filesPassed;
+	std::atomic<int> filesFailed;
+	std::atomic<bool> batchComplete;
+	std::map<uint64_t, BatchFile> batchFiles; // touched only by verification, like the rest of the batch state
+	std::vector<DiskWrite> batchWrites;
+	const net::ChecksumAlgorithm* batchAlgorithm;
+	std::string batchPath; // path of the last manifest entry, which the next one in its packet shares a prefix with
+	uint64_t batchStartTime;
+	std::atomic<bool> stopping;
+	std::thread verifyThread;
+	std::thread writeThread;
+};
+
+// ------------------------------------------------------
+// network stage of the client
+//  + sends the metadata, then the file in payload sized pieces as the send pipeline hands over checksummed chunks,
+//    then the completion message carrying the checksum
+//  + each piece carries its file offset; pipeline chunks that are all zero (such as sparse holes) are skipped, and each
+//    run of them is announced with a zero range instead
+//  + the caller owns the connection loop and says on each update how many packets the window allows
+//  + striped, the data goes out over every stripe's connection: each piece to the stripe with the most room in its
+//    window, so a slower path is handed less; the metadata and completion stay on the first stripe
+//  + as a delta, the metadata is a delta start and the chunks go through a delta encoder once the receiver's
+//    signatures are in, so only what the receiver's copy lacks is sent; copies of consecutive blocks merge into
+//    one record and records are packed into as few packets as they fit
+//  + with dedup, the chunks go through content-defined chunking; each packet of chunk ids is a query to the receiver,
+//    and a chunk is sent once its answer is in (or overdue): as a reference if the receiver has it, whole if not
+//  + compressed, the send pipeline's workers compress each chunk and the pieces of the compressed bytes go out instead
+class FileSender
+{
+public:
+
+	FileSender(net::ReliableConnection& connection, int payloadSize)
+		: connection(connection), payloadSize(payloadSize), copyPacket(payloadSize)
+	{
+		stripes.push_back(&connection);
+		checksumThreads = 1;
+		chunkOffset = 0;
+		zeroOffset = 0;
+		zeroLength = 0;
+		skippedBytes = 0;
+		started = false;
+		complete = false;
+		errorTest = false;
+		sendLog = nullptr;
+		metrics = nullptr;
+		delta = false;
+		signaturesKnown = false;
+		signaturesReceived = 0;
+		blockSize = 0;
+		encoding = false;
+		operationPending = false;
+		copyPacketSize = 0;
+		copyOffset = 0;
+		copyBlock = 0;
+		copyCount = 0;
+		copiedBytes = 0;
+		dedup = false;
+		dedupUnasked = 0;
+		dedupBase = 0;
+		dedupCut = 0;
+		dedupInputDone = false;
+		dedupSent = 0;
+		dedupBytes = 0;
+		compression = false;
+		compressedBytes = 0;
+		packedBytes = 0;
+	}
+
+	// compress the blocks of the file on threads workers (0 for one per core) before start; not for a delta or dedup,
+	// which send from the uncompressed bytes
+	void setCompression(int threads)
+	{
+		assert(!metadata);
+		sendPipeline.SetCompression(threads);
+		compression = true;
+		blockMessage.resize(payloadSize);
+	}
+
+	// read the metadata and start the reader and checksum stages, false if the file cannot be read
+	bool start(const std::string& filePath, const std::string& checksumMethod, int checksumThreads = 1)
+	{
+		metadata.reset(new FileMetadata(filePath, checksumMethod, checksumThreads));
+		this->checksumThreads = checksumThreads;
+
+		const net::ChecksumAlgorithm* pipelineChecksum = checksumThreads == 1 ? net::FindChecksumAlgorithm(metadata->checksumId) : nullptr;
+		return sendPipeline.Start(filePath, pipelineChecksum);
+	}
+
+	// flip the first byte on the wire (after it has been hashed) to show the receiver catches corruption
+	void setErrorTest(bool enabled)
+	{
+		errorTest = enabled;
+	}
+
+	// count the file bytes sent (null for none)
+	void setMetrics(TransferMetrics* metrics)
+	{
+		this->metrics = metrics;
+	}
+
+	// record net::GetTimeNs for each data packet of the first stripe, indexed by its sequence number (the log is not grown)
+	void setSendLog(std::vector<uint64_t>* log)
+	{
+		sendLog = log;
+	}
+
+	// stripe the data over another connection as well (before the first update); the constructor's is stripe 0
+	void addStripe(net::ReliableConnection& stripe)
+	{
+		assert(!started && (int)stripes.size() < MaxStripes);
+		stripes.push_back(&stripe);
+	}
+
+	int getStripeCount() const
+	{
+		return (int)stripes.size();
+	}
+
+	// send only what the receiver's existing copy of the file lacks (before the first update, on one connection)
+	void setDelta(bool enabled)
+	{
+		assert(!started && (!enabled || stripes.size() == 1));
+		delta = enabled;
+	}
+
+	// send only the chunks the receiver's chunk store lacks (before the first update, on one connection, not as a delta)
+	void setDedup(bool enabled)
+	{
+		assert(!started && (!enabled || (stripes.size() == 1 && !delta)));
+		dedup = enabled;
+	}
+
+	// the client's receive loop hands over each message from the receiver; only a delta's signatures and the answers
+	// to dedup queries are of interest
+	void receive(const unsigned char* data, int size)
+	{
+		if (dedup && size > 0 && data[0] == DedupAnswer)
+		{
+			receiveAnswer(data, size);
+			return;
+		}
+		if (!delta || encoding || size <= 0 || data[0] != DeltaSignatures)
+		{
+			return;
+		}
+
+		const unsigned char* p = data + 1;
+		const unsigned char* end = data + size;
+		uint64_t messageBlockSize, blockCount, block;
+		if (!ReadVarint(p, end, messageBlockSize) || !ReadVarint(p, end, blockCount) || !ReadVarint(p, end, block))
+		{
+			return;
+		}
+		if (!signaturesKnown)
+		{
+			if (blockCount > 0 && (messageBlockSize < (uint64_t)net::MinDeltaBlockSize || messageBlockSize > (uint64_t)net::MaxDeltaBlockSize ||
+				blockCount >= 0xFFFFFFFF))
+			{
+				return;
+			}
+			blockSize = (int)messageBlockSize;
+			signatureIndex.Reset(blockCount);
+			signatureReceived.assign((size_t)blockCount, false);
+			signaturesKnown = true;
+		}
+
+		for (; end - p >= DeltaSignatureSize && block < signatureReceived.size(); ++block, p += DeltaSignatureSize)
+		{
+			net::BlockSignature signature = { 0, 0 };
+			for (int b = 0; b < 4; ++b)
+				signature.weak |= (uint32_t)p[b] << (b * 8);
+			for (int b = 0; b < 8; ++b)
+				signature.strong |= (uint64_t)p[4 + b] << (b * 8);
+			if (!signatureReceived[(size_t)block])
+			{
+				signatureReceived[(size_t)block] = true;
+				signaturesReceived++;
+				signatureIndex.Add(block, signature);
+			}
+		}
+		signatureTime = std::chrono::steady_clock::now();
+	}
+
+	// send up to window data packets, returns true once the completion message has gone out
+	bool update(int window)
+	{
+		assert(stripes.size() == 1);
+		return send(&window);
+	}
+
+	// striped: up to windows[i] packets on stripe i, each window is reduced by the packets sent on it
+	bool update(std::vector<int>& windows)
+	{
+		assert(windows.size() == stripes.size());
+		return send(&windows[0]);
+	}
+
+	bool isComplete() const
+	{
+		return complete;
+	}
+
+	const FileMetadata& getMetadata() const
+	{
+		return *metadata;
+	}
+
+	// wall clock seconds from the metadata to the completion message
+	double getTransmissionTime() const
+	{
+		return std::chrono::duration<double>(endTime - startTime).count();
+	}
+
+	// file bytes left out because their chunk was all zero
+	uint64_t getSkippedBytes() const
+	{
+		return skippedBytes;
+	}
+
+	// file bytes a delta left the receiver to copy from its existing copy
+	uint64_t getCopiedBytes() const
+	{
+		return copiedBytes;
+	}
+
+	// file bytes dedup referred to rather than sent, as the receiver's chunk store had them
+	uint64_t getDedupBytes() const
+	{
+		return dedupBytes;
+	}
+
+	// file bytes that went compressed, and the compressed bytes they went as
+	uint64_t getCompressedBytes() const
+	{
+		return compressedBytes;
+	}
+
+	uint64_t getPackedBytes() const
+	{
+		return packedBytes;
+	}
+
+private:
+
+	// a content-defined chunk cut but not sent yet
+	struct DedupChunk
+	{
+		enum State { Unasked, Asked, Stored, Missing };
+		uint64_t offset;
+		int size;
+		net::ChunkId id; // not computed for a zero chunk, which is announced as a zero range rather than asked about
+		bool zero;
+		State state;
+		std::chrono::steady_clock::time_point askTime;
+	};
+
+	bool send(int windows[])
+	{
+		if (complete)
+		{
+			return true;
+		}
+		if (delta)
+		{
+			return sendDelta(windows);
+		}
+		if (dedup)
+		{
+			return sendDedup(windows);
+		}
+
+		if (!started)
+		{
+			// starting transmission timer 
+			startTime = std::chrono::steady_clock::now();
+
+			// Send file metadata (the checksum follows in the completion message)
+			std::string MetaData = std::string(metadata->fileName) + "|" + std::to_string(metadata->fileSize) + "|" + std::to_string(metadata->checksumId);
+			if (compression)
+			{
+				MetaData += std::string("|") + net::CompressCodec;
+			}
+			connection.SendPacket(reinterpret_cast<const unsigned char*>(MetaData.c_str()), (int)MetaData.length());
+			started = true;
+		}
+
+		// a full window leaves chunks in the pipeline, which stalls the checksum and reader stages behind it
+		net::Chunk* chunk = nullptr;
+		while (sendPipeline.Front(chunk))
+		{
+			if (chunk->last)
+			{
+				sendPipeline.Pop();
+				break;
+			}
+
+			// nothing to send for an empty file, and the receiver's file reads back zeros wherever nothing was written
+			if (chunkOffset == 0 && (chunk->zero || chunk->size == 0))
+			{
+				// the receiver is told, a run of zero chunks at a time, so a striped one does not wait for the range
+				if (chunk->size > 0)
+				{
+					if (zeroOffset + zeroLength != chunk->offset && !sendZeros(windows))
+					{
+						break;
+					}
+					if (zeroLength == 0)
+					{
+						zeroOffset = chunk->offset;
+					}
+					zeroLength += (uint64_t)chunk->size;
+				}
+				skippedBytes += (uint64_t)chunk->size;
+				sendPipeline.Pop();
+				continue;
+			}
+
+			if (!sendZeros(windows))
+			{
+				break;
+			}
+			const int stripe = pickStripe(windows);
+			if (stripe < 0)
+			{
+				break;
+			}
+
+			// a compressed chunk goes in pieces of its compressed bytes, each saying where among them it starts
+			const bool packed = chunk->packedSize > 0;
+			const int blockSize = packed ? chunk->packedSize : chunk->size;
+			int headerSize = DataHeaderSize;
+			if (packed)
+			{
+				blockMessage[0] = CompressedData;
+				headerSize = 1;
+				headerSize += WriteVarint(&blockMessage[headerSize], chunk->offset);
+				headerSize += WriteVarint(&blockMessage[headerSize], (uint64_t)chunk->size);
+				headerSize += WriteVarint(&blockMessage[headerSize], (uint64_t)chunk->packedSize);
+				headerSize += WriteVarint(&blockMessage[headerSize], (uint64_t)chunkOffset);
+			}
+			unsigned char* piece = (packed ? chunk->packed : chunk->data) + chunkOffset;
+			int pieceSize = blockSize - chunkOffset;
+			if (pieceSize > payloadSize - headerSize)
+			{
+				pieceSize = payloadSize - headerSize;
+			}
+
+			// for the first byte change value that creates an error (after the checksum stage has hashed it)
+			if (errorTest)
+			{
+				piece[0] ^= 0xff;
+				errorTest = false;
+			}
+
+			if (sendLog != nullptr && stripe == 0)
+			{
+				const unsigned int sequence = connection.GetReliabilitySystem().GetLocalSequence();
+				if (sequence < sendLog->size())
+				{
+					(*sendLog)[sequence] = net::GetTimeNs();
+				}
+			}
+
+			// sending the pieces behind their offset; a compressed piece's header is too long to go in front of the
+			// piece without a copy
+			if (packed)
+			{
+				memcpy(&blockMessage[headerSize], piece, (size_t)pieceSize);
+				net::CountPayloadCopy((size_t)pieceSize);
+				stripes[stripe]->SendPacket(&blockMessage[0], headerSize + pieceSize);
+			}
+			else
+			{
+				unsigned char header[DataHeaderSize];
+				WriteFileOffset(header, chunk->offset + (uint64_t)chunkOffset);
+				stripes[stripe]->SendPacket(header, DataHeaderSize, piece, pieceSize);
+			}
+			windows[stripe]--;
+			if (metrics && !packed)
+			{
+				metrics->fileBytesSent.Add((uint64_t)pieceSize);
+			}
+
+			chunkOffset += pieceSize;
+			if (chunkOffset == blockSize)
+			{
+				if (packed)
+				{
+					compressedBytes += (uint64_t)chunk->size;
+					packedBytes += (uint64_t)chunk->packedSize;
+					if (metrics)
+					{
+						metrics->fileBytesSent.Add((uint64_t)chunk->size);
+					}
+				}
+				sendPipeline.Pop();
+				chunkOffset = 0;
+			}
+		}
+
+		if (sendPipeline.IsFinished() && sendZeros(windows))
+		{
+			// the other stripes end first, so the receiver knows when everything they carried has arrived
+			for (size_t i = 1; i < stripes.size(); ++i)
+			{
+				const unsigned char end = StripeEnd;
+				stripes[i]->SendPacket(&end, 1);
+			}
+
+			// Send message indicating file transfer completion, carrying the checksum
+			metadata->checksum = checksumThreads == 1 ? sendPipeline.GetDigest() : metadata->waitForChecksum();
+			std::string transferCompleteMessage = std::string(TRANSFER_COMPLETE) + "|" + metadata->checksum;
+			if (stripes.size() > 1)
+			{
+				transferCompleteMessage += "|" + std::to_string(stripes.size());
+			}
+			connection.SendPacket(reinterpret_cast<const unsigned char*>(transferCompleteMessage.c_str()), (int)transferCompleteMessage.length());
+
+			endTime = std::chrono::steady_clock::now();
+			complete = true;
+		}
+
+		return complete;
+	}
+
+	// the stripe with the most room left in its window, -1 if every window is used up
+	int pickStripe(const int windows[]) const
+	{
+		int best = -1;
+		for (int i = 0; i < (int)stripes.size(); ++i)
+		{
+			if (windows[i] > 0 && (best < 0 || windows[i] > windows[best]))
+			{
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	// announce the run of zero chunks passed over, false if no stripe has room for the message
+	bool sendZeros(int windows[])
+	{
+		if (zeroLength == 0)
+		{
+			return true;
+		}
+		const int stripe = pickStripe(windows);
+		if (stripe < 0)
+		{
+			return false;
+		}
+
+		unsigned char message[1 + 2 * MaxVarintSize];
+		message[0] = ZeroRange;
+		int size = 1;
+		size += WriteVarint(&message[size], zeroOffset);
+		size += WriteVarint(&message[size], zeroLength);
+		stripes[stripe]->SendPacket(message, size);
+		windows[stripe]--;
+		zeroLength = 0;
+		return true;
+	}
+
+	bool sendDelta(int windows[])
+	{
+		if (!started)
+		{
+			startTime = std::chrono::steady_clock::now();
+
+			// the receiver answers with the signatures of its copy
+			const size_t nameLength = strlen(metadata->fileName);
+			std::vector<unsigned char> message(1 + 2 * MaxVarintSize + nameLength);
+			message[0] = DeltaStart;
+			int size = 1;
+			size += WriteVarint(&message[size], metadata->fileSize);
+			size += WriteVarint(&message[size], (uint64_t)metadata->checksumId);
+			memcpy(&message[size], metadata->fileName, nameLength);
+			size += (int)nameLength;
+			connection.SendPacket(&message[0], size);
+			signatureTime = startTime;
+			started = true;
+		}
+
+		if (!encoding)
+		{
+			// every signature is in, or the ones still missing are taken as lost and their blocks go as literals
+			const bool allReceived = signaturesKnown && signaturesReceived == signatureReceived.size();
+			if (!allReceived && std::chrono::duration<double>(std::chrono::steady_clock::now() - signatureTime).count() < DeltaSignatureWait)
+			{
+				return false;
+			}
+			encoder.Start(&signatureIndex, blockSize, payloadSize - DataHeaderSize);
+			encoding = true;
+		}
+
+		int fed = 0;
+		while (true)
+		{
+			if (!operationPending)
+			{
+				if (encoder.Next(operation))
+				{
+					operationPending = true;
+				}
+				else if (encoder.IsDone())
+				{
+					break;
+				}
+				else
+				{
+					net::Chunk* chunk = nullptr;
+					if (fed >= DeltaFeedPerUpdate || !sendPipeline.Front(chunk))
+					{
+						return false;
+					}
+					if (chunk->last)
+					{
+						encoder.Finish();
+					}
+					else
+					{
+						encoder.Feed(chunk->data, chunk->size);
+						fed += chunk->size;
+					}
+					sendPipeline.Pop();
+					continue;
+				}
+			}
+
+			// messages go out in file order, so a zero range or packet of copies is sent before whatever follows it
+			const bool zero = net::IsZero(operation.data, operation.size);
+			if (operation.copy && !zero)
+			{
+				if (!sendZeros(windows) || !addCopy(windows))
+				{
+					return false;
+				}
+			}
+			else if (zero)
+			{
+				// the receiver's new file starts out as zeros (holes, even where a block of the old copy matched),
+				// so like a run of zero chunks they are only announced
+				if (!flushCopies(windows) || (zeroOffset + zeroLength != operation.offset && !sendZeros(windows)))
+				{
+					return false;
+				}
+				if (zeroLength == 0)
+				{
+					zeroOffset = operation.offset;
+				}
+				zeroLength += (uint64_t)operation.size;
+				skippedBytes += (uint64_t)operation.size;
+			}
+			else
+			{
+				if (!flushCopies(windows) || !sendZeros(windows) || windows[0] <= 0)
+				{
+					return false;
+				}
+				if (errorTest)
+				{
+					operation.data[0] ^= 0xff;
+					errorTest = false;
+				}
+				if (sendLog != nullptr)
+				{
+					const unsigned int sequence = connection.GetReliabilitySystem().GetLocalSequence();
+					if (sequence < sendLog->size())
+					{
+						(*sendLog)[sequence] = net::GetTimeNs();
+					}
+				}
+				unsigned char header[DataHeaderSize];
+				WriteFileOffset(header, operation.offset);
+				connection.SendPacket(header, DataHeaderSize, operation.data, operation.size);
+				windows[0]--;
+				if (metrics)
+				{
+					metrics->fileBytesSent.Add((uint64_t)operation.size);
+				}
+			}
+			operationPending = false;
+		}
+
+		if (!flushCopies(windows) || !sendZeros(windows))
+		{
+			return false;
+		}
+		metadata->checksum = checksumThreads == 1 ? sendPipeline.GetDigest() : metadata->waitForChecksum();
+		const std::string transferCompleteMessage = std::string(TRANSFER_COMPLETE) + "|" + metadata->checksum;
+		connection.SendPacket(reinterpret_cast<const unsigned char*>(transferCompleteMessage.c_str()), (int)transferCompleteMessage.length());
+
+		endTime = std::chrono::steady_clock::now();
+		complete = true;
+		return true;
+	}
+
+	bool sendDedup(int windows[])
+	{
+		if (!started)
+		{
+			startTime = std::chrono::steady_clock::now();
+			const std::string MetaData = std::string(metadata->fileName) + "|" + std::to_string(metadata->fileSize) + "|" + std::to_string(metadata->checksumId);
+			connection.SendPacket(reinterpret_cast<const unsigned char*>(MetaData.c_str()), (int)MetaData.length());
+			started = true;
+		}
+
+		// take in what the pipeline has, up to the buffer limit, and cut it into chunks
+		int fed = 0;
+		net::Chunk* chunk = nullptr;
+		while (!dedupInputDone && fed < DeltaFeedPerUpdate && dedupBase + dedupBuffer.size() - dedupSendOffset() < (uint64_t)DedupBufferLimit &&
+			sendPipeline.Front(chunk))
+		{
+			if (chunk->last)
+			{
+				dedupInputDone = true;
+			}
+			else
+			{
+				// the bytes sent are dropped once they are half the buffer, so each is moved only a few times
+				const size_t sent = (size_t)(dedupSendOffset() - dedupBase);
+				if (sent > 0 && sent >= dedupBuffer.size() / 2)
+				{
+					dedupBuffer.erase(dedupBuffer.begin(), dedupBuffer.begin() + sent);
+					dedupBase += sent;
+				}
+				dedupBuffer.insert(dedupBuffer.end(), chunk->data, chunk->data + chunk->size);
+				fed += chunk->size;
+			}
+			sendPipeline.Pop();
+		}
+		cutChunks();
+
+		// a query is held back until a packet of chunks is waiting, unless no more are coming for now
+		if (!sendQueries(windows, fed < DeltaFeedPerUpdate))
+		{
+			return false;
+		}
+
+		// messages go out in file order, so references and zero ranges are sent before whatever follows them
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		while (!dedupChunks.empty())
+		{
+			DedupChunk& front = dedupChunks.front();
+			unsigned char* data = &dedupBuffer[(size_t)(front.offset - dedupBase)];
+			if (front.zero)
+			{
+				if (!sendCopies(windows) || (zeroOffset + zeroLength != front.offset && !sendZeros(windows)))
+				{
+					return false;
+				}
+				if (zeroLength == 0)
+				{
+					zeroOffset = front.offset;
+				}
+				zeroLength += (uint64_t)front.size;
+				skippedBytes += (uint64_t)front.size;
+			}
+			else if (front.state == DedupChunk::Unasked ||
+				(front.state == DedupChunk::Asked && std::chrono::duration<double>(now - front.askTime).count() < DedupAnswerWait))
+			{
+				return false;
+			}
+			else if (front.state == DedupChunk::Stored)
+			{
+				if (!sendZeros(windows) || !addReference(front, windows))
+				{
+					return false;
+				}
+				dedupBytes += (uint64_t)front.size;
+			}
+			else
+			{
+				// the receiver lacks it, or never answered: a late answer no longer changes how it goes
+				front.state = DedupChunk::Missing;
+				if (!sendCopies(windows) || !sendZeros(windows))
+				{
+					return false;
+				}
+				while (dedupSent < front.size)
+				{
+					if (windows[0] <= 0)
+					{
+						return false;
+					}
+					const int pieceSize = std::min(front.size - dedupSent, payloadSize - DataHeaderSize);
+					if (errorTest)
+					{
+						data[dedupSent] ^= 0xff;
+						errorTest = false;
+					}
+					if (sendLog != nullptr)
+					{
+						const unsigned int sequence = connection.GetReliabilitySystem().GetLocalSequence();
+						if (sequence < sendLog->size())
+						{
+							(*sendLog)[sequence] = net::GetTimeNs();
+						}
+					}
+					unsigned char header[DataHeaderSize];
+					WriteFileOffset(header, front.offset + (uint64_t)dedupSent);
+					connection.SendPacket(header, DataHeaderSize, data + dedupSent, pieceSize);
+					windows[0]--;
+					if (metrics)
+					{
+						metrics->fileBytesSent.Add((uint64_t)pieceSize);
+					}
+					dedupSent += pieceSize;
+				}
+				dedupSent = 0;
+			}
+			dedupChunks.pop_front();
+			if (dedupUnasked > 0)
+			{
+				dedupUnasked--;
+			}
+		}
+
+		if (!dedupInputDone || dedupCut != dedupBase + dedupBuffer.size() || !sendCopies(windows) || !sendZeros(windows))
+		{
+			return false;
+		}
+		metadata->checksum = checksumThreads == 1 ? sendPipeline.GetDigest() : metadata->waitForChecksum();
+		const std::string transferCompleteMessage = std::string(TRANSFER_COMPLETE) + "|" + metadata->checksum;
+		connection.SendPacket(reinterpret_cast<const unsigned char*>(transferCompleteMessage.c_str()), (int)transferCompleteMessage.length());
+
+		endTime = std::chrono::steady_clock::now();
+		complete = true;
+		return true;
+	}
+
+	// file offset of the first byte dedup has not sent (or referred to, or announced as zeros)
+	uint64_t dedupSendOffset() const
+	{
+		return dedupChunks.empty() ? dedupCut : dedupChunks.front().offset;
+	}
+
+	// cut the bytes taken in into chunks; the last bytes of the file are cut once it is all in, as no boundary past
+	// them can change where theirs fall
+	void cutChunks()
+	{
+		while (true)
+		{
+			const size_t start = (size_t)(dedupCut - dedupBase);
+			const size_t available = dedupBuffer.size() - start;
+			if (available == 0 || (available < (size_t)net::MaxChunkSize && !dedupInputDone))
+			{
+				return;
+			}
+			const int limit = (int)std::min(available, (size_t)net::MaxChunkSize);
+			DedupChunk chunk;
+			chunk.offset = dedupCut;
+			if (limit == net::MaxChunkSize && net::IsZero(&dedupBuffer[start], limit))
+			{
+				chunk.size = net::ZeroChunkSize();
+				chunk.zero = true;
+			}
+			else
+			{
+				chunk.size = net::FindChunkBoundary(&dedupBuffer[start], limit);
+				chunk.zero = net::IsZero(&dedupBuffer[start], chunk.size);
+			}
+			chunk.id.low = 0;
+			chunk.id.high = 0;
+			if (!chunk.zero)
+			{
+				chunk.id = net::ComputeChunkId(&dedupBuffer[start], chunk.size);
+			}
+			chunk.state = DedupChunk::Unasked;
+			dedupChunks.push_back(chunk);
+			dedupCut += (uint64_t)chunk.size;
+		}
+	}
+
+	// ask about the chunks cut since the last query, a packet of them at a time; a packet that is not full goes only
+	// when partial says no more chunks are coming for now; false if the window is used up
+	bool sendQueries(int windows[], bool partial)
+	{
+		std::vector<unsigned char> query(payloadSize);
+		query[0] = DedupQuery;
+		while (dedupUnasked < dedupChunks.size())
+		{
+			int size = 1;
+			size_t end = dedupUnasked;
+			for (; end < dedupChunks.size(); ++end)
+			{
+				const DedupChunk& chunk = dedupChunks[end];
+				if (chunk.zero)
+				{
+					continue;
+				}
+				if (size + VarintSize(chunk.offset) + VarintSize((uint64_t)chunk.size) + DedupIdSize > payloadSize)
+				{
+					break;
+				}
+				size += WriteVarint(&query[size], chunk.offset);
+				size += WriteVarint(&query[size], (uint64_t)chunk.size);
+				WriteChunkId(&query[size], chunk.id);
+				size += DedupIdSize;
+			}
+			if (size > 1)
+			{
+				if (end == dedupChunks.size() && !partial)
+				{
+					return true;
+				}
+				if (windows[0] <= 0)
+				{
+					return false;
+				}
+				connection.SendPacket(&query[0], size);
+				windows[0]--;
+			}
+
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			for (; dedupUnasked < end; ++dedupUnasked)
+			{
+				DedupChunk& chunk = dedupChunks[dedupUnasked];
+				if (!chunk.zero)
+				{
+					chunk.state = DedupChunk::Asked;
+					chunk.askTime = now;
+				}
+			}
+		}
+		return true;
+	}
+
+	// an answer covers the chunks one query asked about, from the one at its first offset on, skipping zero chunks as
+	// the query did; chunks already sent whole are no longer there to match
+	void receiveAnswer(const unsigned char* data, int size)
+	{
+		const unsigned char* p = data + 1;
+		const unsigned char* end = data + size;
+		uint64_t first, count;
+		if (!ReadVarint(p, end, first) || !ReadVarint(p, end, count) || count > (uint64_t)(end - p) * 8)
+		{
+			return;
+		}
+		size_t i = 0;
+		while (i < dedupChunks.size() && dedupChunks[i].offset < first)
+		{
+			i++;
+		}
+		if (i == dedupChunks.size() || dedupChunks[i].offset != first)
+		{
+			return;
+		}
+		for (uint64_t n = 0; n < count && i < dedupChunks.size(); ++i)
+		{
+			DedupChunk& chunk = dedupChunks[i];
+			if (chunk.zero)
+			{
+				continue;
+			}
+			if (chunk.state == DedupChunk::Asked)
+			{
+				chunk.state = (p[n / 8] >> (n % 8)) & 1 ? DedupChunk::Stored : DedupChunk::Missing;
+			}
+			n++;
+		}
+	}
+
+	// pack a reference to a chunk the receiver has, sending the packet first if it does not fit; false if the window is used up
+	bool addReference(const DedupChunk& chunk, int windows[])
+	{
+		const int recordSize = VarintSize(chunk.offset) + VarintSize((uint64_t)chunk.size) + DedupIdSize;
+		if (copyPacketSize + recordSize > payloadSize && !sendCopies(windows))
+		{
+			return false;
+		}
+		if (copyPacketSize == 0)
+		{
+			copyPacket[0] = DedupRef;
+			copyPacketSize = 1;
+		}
+		copyPacketSize += WriteVarint(&copyPacket[copyPacketSize], chunk.offset);
+		copyPacketSize += WriteVarint(&copyPacket[copyPacketSize], (uint64_t)chunk.size);
+		WriteChunkId(&copyPacket[copyPacketSize], chunk.id);
+		copyPacketSize += DedupIdSize;
+		return true;
+	}
+
+	// the pending operation is a copy: extend the copy record being built, or start another
+	bool addCopy(int windows[])
+	{
+		if (copyCount == 0 || copyOffset + copyCount * (uint64_t)blockSize != operation.offset || copyBlock + copyCount != operation.block)
+		{
+			if (!packCopy(windows))
+			{
+				return false;
+			}
+			copyOffset = operation.offset;
+			copyBlock = operation.block;
+		}
+		copyCount++;
+		copiedBytes += (uint64_t)operation.size;
+		return true;
+	}
+
+	// move the copy record being built into the packet, sending the packet first if it does not fit; false if the window is used up
+	bool packCopy(int windows[])
+	{
+		if (copyCount == 0)
+		{
+			return true;
+		}
+		const int recordSize = VarintSize(copyOffset) + VarintSize(copyBlock) + VarintSize(copyCount);
+		if (copyPacketSize + recordSize > payloadSize && !sendCopies(windows))
+		{
+			return false;
+		}
+		if (copyPacketSize == 0)
+		{
+			copyPacket[0] = DeltaCopy;
+			copyPacketSize = 1;
+		}
+		copyPacketSize += WriteVarint(&copyPacket[copyPacketSize], copyOffset);
+		copyPacketSize += WriteVarint(&copyPacket[copyPacketSize], copyBlock);
+		copyPacketSize += WriteVarint(&copyPacket[copyPacketSize], copyCount);
+		copyCount = 0;
+		return true;
+	}
+
+	bool sendCopies(int windows[])
+	{
+		if (copyPacketSize == 0)
+		{
+			return true;
+		}
+		if (windows[0] <= 0)
+		{
+			return false;
+		}
+		connection.SendPacket(&copyPacket[0], copyPacketSize);
+		windows[0]--;
+		copyPacketSize = 0;
+		return true;
+	}
+
+	// everything copied so far on its way, false if the window is used up
+	bool flushCopies(int windows[])
+	{
+		return packCopy(windows) && sendCopies(windows);
+	}
+
+	net::ReliableConnection& connection;
+	std::vector<net::ReliableConnection*> stripes; // connection first
+	int payloadSize;
+	int checksumThreads;
+	std::unique_ptr<FileMetadata> metadata;
+	net::SendPipeline sendPipeline;
+	int chunkOffset; // bytes of the pipeline's front chunk already sent
+	uint64_t zeroOffset; // run of zero chunks not yet announced
+	uint64_t zeroLength;
+	uint64_t skippedBytes;
+	bool started;
+	bool complete;
+	bool errorTest;
+	std::vector<uint64_t>* sendLog;
+	TransferMetrics* metrics;
+	bool delta;
+	net::SignatureIndex signatureIndex; // the receiver's blocks
+	std::vector<bool> signatureReceived; // by block
+	uint64_t signaturesReceived;
+	bool signaturesKnown; // a signatures message has said how many blocks there are
+	int blockSize;
+	std::chrono::steady_clock::time_point signatureTime; // of the delta start or the last signatures message
+	bool encoding; // the signatures are in and the file is going through the encoder
+	net::DeltaEncoder encoder;
+	net::DeltaEncoder::Operation operation; // taken from the encoder but not sent yet
+	bool operationPending;
+	std::vector<unsigned char> copyPacket; // copy (or dedup reference) records being packed
+	int copyPacketSize; // bytes of copyPacket in use, zero when empty
+	uint64_t copyOffset; // the copy record being built, which consecutive blocks extend
+	uint64_t copyBlock;
+	uint64_t copyCount;
+	uint64_t copiedBytes;
+	bool dedup;
+	std::deque<DedupChunk> dedupChunks; // cut but not sent, in file order
+	size_t dedupUnasked; // index in dedupChunks of the first chunk not asked about yet
+	std::vector<unsigned char> dedupBuffer; // the file from dedupBase on
+	uint64_t dedupBase;
+	uint64_t dedupCut; // file offset the chunks cut so far end at
+	bool dedupInputDone; // the pipeline's last chunk has been taken
+	int dedupSent; // bytes of the front chunk sent, when it goes whole
+	uint64_t dedupBytes;
+	bool compression;
+	std::vector<unsigned char> blockMessage; // a compressed piece behind its header
+	uint64_t compressedBytes;
+	uint64_t packedBytes;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point endTime;
+};
+
+// ------------------------------------------------------
+// network stage of the client for a batch: every file under a directory over the one connection
+//  + the send pipeline reads the files one after another in small chunks, so hundreds of small files are in flight
+//  + records of consecutive files are packed into the same packet, so a packet can finish several small files
+//  + manifest entries go out a packet at a time, each packet ahead of the first record of the files it names
+//  + like FileSender, the caller owns the connection loop and says on each update how many packets the window allows
+class BatchSender
+{
+public:
+
+	BatchSender(net::ReliableConnection& connection, int payloadSize)
+		: connection(connection), payloadSize(payloadSize), sendPipeline(16 * 1024, 256), packet(payloadSize)
+	{
+		algorithm = nullptr;
+		totalBytes = 0;
+		skippedBytes = 0;
+		manifestSent = 0;
+		packetSize = 0;
+		chunkOffset = 0;
+		packetsSent = 0;
+		started = false;
+		complete = false;
+		metrics = nullptr;
+	}
+
+	// list the tree and start reading it, false if there is nothing to send
+	bool start(const std::string& directory, const std::string& checksumMethod)
+	{
+		std::vector<net::DirectoryEntry> entries;
+		if (!net::ListFiles(directory, entries))
+		{
+			return false;
+		}
+
+		algorithm = net::FindChecksumAlgorithm(checksumMethod);
+		std::vector<std::string> paths;
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			// an entry has to fit a manifest packet of its own
+			if (1 + 5 * MaxVarintSize + (int)entries[i].path.size() > payloadSize)
+			{
+				printf("Skipping %s: the path is too long for %d byte packets\n", entries[i].path.c_str(), payloadSize);
+				continue;
+			}
+			files.push_back(entries[i]);
+			paths.push_back(directory + "/" + entries[i].path);
+			totalBytes += entries[i].size;
+		}
+
+		return !files.empty() && sendPipeline.Start(paths, algorithm);
+	}
+
+	// count the file bytes sent (null for none)
+	void setMetrics(TransferMetrics* metrics)
+	{
+		this->metrics = metrics;
+	}
+
+	// send up to window packets, returns true once the completion message has gone out
+	bool update(int window)
+	{
+		if (complete)
+		{
+			return true;
+		}
+
+		if (!started)
+		{
+			startTime = std::chrono::steady_clock::now();
+			started = true;
+		}
+
+		net::Chunk* chunk = nullptr;
+		while (sendPipeline.Front(chunk))
+		{
+			if (chunk->last)
+			{
+				if (!flush(window))
+				{
+					return false;
+				}
+				sendPipeline.Pop();
+
+				unsigned char message[1 + MaxVarintSize];
+				message[0] = BatchComplete;
+				const int size = 1 + WriteVarint(message + 1, files.size());
+				connection.SendPacket(message, size);
+				packetsSent++;
+
+				endTime = std::chrono::steady_clock::now();
+				complete = true;
+				return true;
+			}
+
+			// the file's manifest entry goes first
+			if ((size_t)chunk->file >= manifestSent && !sendManifest(window))
+			{
+				return false;
+			}
+
+			const uint64_t id = (uint64_t)chunk->file + 1;
+			while (chunkOffset < chunk->size && !chunk->zero)
+			{
+				// fill what is left of the packet, or start another if not even a byte fits
+				startPacket();
+				const uint64_t offset = chunk->offset + (uint64_t)chunkOffset;
+				const int remaining = chunk->size - chunkOffset;
+				const int space = payloadSize - packetSize - VarintSize(id << 1) - VarintSize(offset) - VarintSize((uint64_t)remaining);
+				if (space <= 0)
+				{
+					if (!flush(window))
+					{
+						return false;
+					}
+					continue;
+				}
+
+				const int length = remaining < space ? remaining : space;
+				packetSize += WriteVarint(&packet[packetSize], id << 1);
+				packetSize += WriteVarint(&packet[packetSize], offset);
+				packetSize += WriteVarint(&packet[packetSize], (uint64_t)length);
+				memcpy(&packet[packetSize], chunk->data + chunkOffset, length);
+				net::CountPayloadCopy((size_t)length);
+				packetSize += length;
+				chunkOffset += length;
+				if (metrics)
+				{
+					metrics->fileBytesSent.Add((uint64_t)length);
+				}
+			}
+
+			if (chunk->fileEnd)
+			{
+				const std::string& digest = sendPipeline.GetDigest(chunk->file);
+				const int recordSize = VarintSize((id << 1) | 1) + VarintSize(digest.size()) + (int)digest.size();
+				startPacket();
+				if (packetSize + recordSize > payloadSize && !flush(window))
+				{
+					return false;
+				}
+				startPacket();
+				packetSize += WriteVarint(&packet[packetSize], (id << 1) | 1);
+				packetSize += WriteVarint(&packet[packetSize], digest.size());
+				memcpy(&packet[packetSize], digest.data(), digest.size());
+				packetSize += (int)digest.size();
+			}
+
+			// the receiver's file reads back zeros wherever nothing was written
+			if (chunk->zero)
+			{
+				skippedBytes += (uint64_t)chunk->size;
+			}
+			sendPipeline.Pop();
+			chunkOffset = 0;
+		}
+
+		// the reader is behind, so send what is packed rather than wait for it to fill
+		flush(window);
+		return false;
+	}
+
+	bool isComplete() const
+	{
+		return complete;
+	}
+
+	size_t getFileCount() const
+	{
+		return files.size();
+	}
+
+	uint64_t getTotalBytes() const
+	{
+		return totalBytes;
+	}
+
+	// file bytes left out because their chunk was all zero
+	uint64_t getSkippedBytes() const
+	{
+		return skippedBytes;
+	}
+
+	// manifest, data and completion packets
+	uint64_t getPacketsSent() const
+	{
+		return packetsSent;
+	}
+
+	// wall clock seconds from the first update to the completion message
+	double getTransmissionTime() const
+	{
+		return std::chrono::duration<double>(endTime - startTime).count();
+	}
+
+private:
+
+	void startPacket()
+	{
+		if (packetSize == 0)
+		{
+			packet[0] = BatchData;
+			packetSize = 1;
+		}
+	}
+
+	// send the packed records, false if the window is used up
+	bool flush(int& window)
+	{
+		if (packetSize <= 1)
+		{
+			return true;
+		}
+		if (window <= 0)
+		{
+			return false;
+		}
+		connection.SendPacket(&packet[0], packetSize);
+		packetsSent++;
+		packetSize = 0;
+		window--;
+		return true;
+	}
+
+	// send the next manifest entries, as many as fit a packet; false if the window is used up
+	bool sendManifest(int& window)
+	{
+		if (window <= 0)
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> manifest(payloadSize);
+		manifest[0] = BatchManifest;
+		int size = 1;
+		size += WriteVarint(&manifest[size], algorithm ? (uint64_t)algorithm->id : 0);
+		size += WriteVarint(&manifest[size], manifestSent + 1);
+
+		// each packet stands alone: the receiver may never see the one before it
+		const std::string* previous = nullptr;
+		for (; manifestSent < files.size(); ++manifestSent)
+		{
+			const net::DirectoryEntry& file = files[manifestSent];
+			size_t shared = 0;
+			while (previous && shared < previous->size() && shared < file.path.size() && (*previous)[shared] == file.path[shared])
+			{
+				shared++;
+			}
+			const size_t suffix = file.path.size() - shared;
+			if (size + VarintSize(file.size) + VarintSize(shared) + VarintSize(suffix) + (int)suffix > payloadSize)
+			{
+				break;
+			}
+			size += WriteVarint(&manifest[size], file.size);
+			size += WriteVarint(&manifest[size], shared);
+			size += WriteVarint(&manifest[size], suffix);
+			memcpy(&manifest[size], file.path.data() + shared, suffix);
+			size += (int)suffix;
+			previous = &file.path;
+		}
+
+		connection.SendPacket(&manifest[0], size);
+		packetsSent++;
+		window--;
+		return true;
+	}
+
+	net::ReliableConnection& connection;
+	int payloadSize;
+	net::SendPipeline sendPipeline;
+	const net::ChecksumAlgorithm* algorithm;
+	std::vector<net::DirectoryEntry> files; // in id order, id = index + 1
+	uint64_t totalBytes;
+	uint64_t skippedBytes;
+	size_t manifestSent; // files whose manifest entry has gone out
+	std::vector<unsigned char> packet; // data records being packed
+	int packetSize; // bytes of packet in use, at most the type byte when no record is packed
+	int chunkOffset; // bytes of the pipeline's front chunk already packed
+	uint64_t packetsSent;
+	bool started;
+	bool complete;
+	TransferMetrics* metrics;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point endTime;
+};
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif